@@ -23,7 +23,9 @@
 // ソフトウェアバージョン
 #define SOFTWARE_VERSION "3.0.0"
 // ハードウェアバージョン (10: Rev1, 20: Rev2, 30: Rev3, 40: Rev4)
+#ifndef HARDWARE_VERSION  // ホストテストではコンパイルオプションで切り替える
 #define HARDWARE_VERSION 30
+#endif
 
 
 
@@ -62,6 +64,7 @@
 #define TEMP_LOW_THRESHOLD        15.0  // 低温閾値
 #define HUMIDITY_LOW_THRESHOLD    40.0  // 低湿度閾値
 #define LIGHT_LOW_THRESHOLD       100   // 暗さ閾値
+#define ARCHIVE_SOIL_TEMP_ERROR   0.25  // 土壌温度の間引き記録の許容誤差 [℃]（TMP102の分解能の4倍、読み取りの揺らぎより大きく）
 
 
 // センサータイプ定義
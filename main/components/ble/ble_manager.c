@@ -56,6 +56,29 @@ static uint8_t g_last_sequence_num = 0;
 static bool g_command_processing = false;
 static uint32_t g_system_uptime = 0;
 static uint32_t g_total_sensor_readings = 0;
+static ble_flush_callback_t g_flush_callback = NULL;  // システムリセット前の履歴ログの書き出し
+
+/* --- Range Query Streaming State --- */
+#define RANGE_STREAM_SEND_RETRIES  50   // 1チャンクの送信を再試行する回数
+#define RANGE_STREAM_RETRY_MS      20   // mbuf が空くのを待つ間隔
+
+// CMD_QUERY_RANGE の送信状態（先頭チャンクはコマンドへのレスポンス、残りは送信タスクが送る）
+typedef struct {
+    data_buffer_query_t query;
+    bool from_archive;
+    uint8_t column_count;
+    uint8_t sequence_num;
+    uint16_t total_rows;
+    uint16_t next_row;        // 次に送る行
+    uint16_t rows_per_chunk;
+    uint32_t start_offset;    // 要求の開始から行0までの分数
+} range_stream_t;
+
+static range_stream_t g_range_stream;
+static volatile bool g_range_stream_active = false;   // 送信タスクが残りのチャンクを送信中
+static bool g_range_stream_pending = false;           // 先頭チャンクの送信後に送信タスクを起こす
+static TaskHandle_t g_range_stream_task_handle = NULL;
+static uint8_t g_range_stream_buffer[BLE_RESPONSE_BUFFER_SIZE];
 
 /* --- BLE Activity LED Timer --- */
 static TimerHandle_t g_ble_led_timer = NULL;
@@ -126,7 +149,25 @@ static esp_err_t handle_save_timezone(uint8_t sequence_num, uint8_t *response_bu
 static esp_err_t handle_control_led(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
 static esp_err_t handle_set_led_brightness(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
 static esp_err_t handle_get_sensor_config(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_minute_block(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_daily_summary(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+static esp_err_t handle_get_channel_profile(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+#endif
 static esp_err_t find_data_by_time(const struct tm *target_time, time_data_response_t *result);
+static esp_err_t handle_query_range(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_gaps(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_period_stats(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_events(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_drying_forecast(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_set_rules(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_rules(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_rule_stats(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_list_profiles(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_get_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_set_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_select_profile(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
+static esp_err_t handle_delete_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length);
 static esp_err_t send_response_notification(const uint8_t *response_data, size_t response_length);
 
 // Access Callback prototypes
@@ -278,9 +319,9 @@ static int gatt_svr_access_data_status_cb(uint16_t conn_handle, uint16_t attr_ha
 
         ble_data_status_t status;
         status.count = stats.minute_data_count;
-        status.capacity = DATA_BUFFER_MINUTES_PER_DAY;
+        status.capacity = DATA_BUFFER_MINUTE_CAPACITY;
         status.f_empty = (stats.minute_data_count == 0) ? 1 : 0;
-        status.f_full = (stats.minute_data_count >= DATA_BUFFER_MINUTES_PER_DAY) ? 1 : 0;
+        status.f_full = (stats.minute_data_count >= DATA_BUFFER_MINUTE_CAPACITY) ? 1 : 0;
 
         int rc = os_mbuf_append(ctxt->om, &status, sizeof(status));
         if (rc != 0) {
@@ -337,7 +378,17 @@ static int gatt_svr_access_command_cb(uint16_t conn_handle, uint16_t attr_handle
 
     ESP_LOGI(TAG, "Sending response notification, length=%d", response_length);
     ESP_LOGI(TAG, "Response Data: ");
-    send_response_notification(response_buffer, response_length);
+    esp_err_t send_err = send_response_notification(response_buffer, response_length);
+
+    // 範囲クエリの残りのチャンクは、先頭チャンクを送ってから送信タスクで送る
+    if (g_range_stream_pending) {
+        g_range_stream_pending = false;
+        if (send_err == ESP_OK) {
+            xTaskNotifyGive(g_range_stream_task_handle);
+        } else {
+            g_range_stream_active = false;
+        }
+    }
 
     g_command_processing = false;
     return 0;
@@ -387,6 +438,10 @@ static esp_err_t process_ble_command(const ble_command_packet_t *cmd_packet,
             resp->data_length = 0;
             *response_length = sizeof(ble_response_packet_t);
             send_response_notification(response_buffer, *response_length);
+            // 書き戻しバッファの1分データを履歴ログに保存（履歴ログのライターであるセンサー読み取りタスクで書き出す）
+            if (g_flush_callback != NULL && g_flush_callback() != ESP_OK) {
+                ESP_LOGW(TAG, "History flush before reset failed");
+            }
             vTaskDelay(pdMS_TO_TICKS(500));
             esp_restart();
             break;
@@ -451,6 +506,56 @@ static esp_err_t process_ble_command(const ble_command_packet_t *cmd_packet,
         case CMD_GET_SENSOR_CONFIG:
             err = handle_get_sensor_config(cmd_packet->sequence_num, response_buffer, response_length);
             break;
+        case CMD_GET_MINUTE_BLOCK:
+            err = handle_get_minute_block(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_DAILY_SUMMARY:
+            err = handle_get_daily_summary(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        case CMD_GET_CHANNEL_PROFILE:
+            err = handle_get_channel_profile(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+#endif
+        case CMD_QUERY_RANGE:
+            err = handle_query_range(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_GAPS:
+            err = handle_get_gaps(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_PERIOD_STATS:
+            err = handle_get_period_stats(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_EVENTS:
+            err = handle_get_events(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_DRYING_FORECAST:
+            err = handle_get_drying_forecast(cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_SET_RULES:
+            err = handle_set_rules(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_RULES:
+            err = handle_get_rules(cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_RULE_STATS:
+            err = handle_get_rule_stats(cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_LIST_PROFILES:
+            err = handle_list_profiles(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_GET_PROFILE_SLOT:
+            err = handle_get_profile_slot(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_SET_PROFILE_SLOT:
+            err = handle_set_profile_slot(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_SELECT_PROFILE:
+            err = handle_select_profile(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
+        case CMD_DELETE_PROFILE_SLOT:
+            err = handle_delete_profile_slot(cmd_packet->data, cmd_packet->data_length, cmd_packet->sequence_num, response_buffer, response_length);
+            break;
         default: {
             ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
             resp->response_id = cmd_packet->command_id;
@@ -628,27 +733,37 @@ static esp_err_t handle_set_plant_profile(const uint8_t *data, uint16_t data_len
     resp->sequence_num = sequence_num;
     resp->data_length = 0;
 
-    if (data_length != sizeof(plant_profile_t)) {
+    // 旧形式（archive_error を追加する前の56バイト）も受け付け、足りないフィールドは現在のプロファイルの値を使う。
+    // plant_profile_t より長いものは切り詰めずに拒否する（NVSのレコードと違い、不正な書き込みや未対応の新しい形式）
+    const plant_profile_t *current = plant_manager_get_profile();
+    plant_profile_t profile;
+    if (current == NULL) {
+        resp->status_code = RESP_STATUS_ERROR;
+        *response_length = sizeof(ble_response_packet_t);
+        return ESP_OK;
+    }
+    if (data_length > sizeof(plant_profile_t) || profile_library_decode(data, data_length, current, &profile) != ESP_OK) {
         resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        *response_length = sizeof(ble_response_packet_t);
+        return ESP_OK;
+    }
+
+    // アクティブのスロットに保存して適用
+    const profile_library_t *library = plant_manager_get_profile_library();
+    esp_err_t err = (library != NULL) ? plant_manager_store_profile(library->active, &profile, NULL) : ESP_ERR_INVALID_STATE;
+    if (err == ESP_OK) {
+        resp->status_code = RESP_STATUS_SUCCESS;
     } else {
-        plant_profile_t profile;
-        memcpy(&profile, data, sizeof(plant_profile_t));
-        esp_err_t err = nvs_config_save_plant_profile(&profile);
-        if (err == ESP_OK) {
-            plant_manager_update_profile(&profile);
-            resp->status_code = RESP_STATUS_SUCCESS;
-        } else {
-            resp->status_code = RESP_STATUS_ERROR;
-        }
+        resp->status_code = RESP_STATUS_ERROR;
     }
     // Debug logging
-    ESP_LOGI(TAG, "Plant profile set, status: %d", resp->status_code);
-    ESP_LOGI(TAG, "  Name: %s", ((plant_profile_t *)data)->plant_name);
-    ESP_LOGI(TAG, "  Soil Dry Threshold: %.2f mV", ((plant_profile_t *)data)->soil_dry_threshold);
-    ESP_LOGI(TAG, "  Soil Wet Threshold: %.2f mV", ((plant_profile_t *)data)->soil_wet_threshold);
-    ESP_LOGI(TAG, "  Soil Dry Days for Watering: %d days", ((plant_profile_t *)data)->soil_dry_days_for_watering);
-    ESP_LOGI(TAG, "  Temp High Limit: %.2f °C", ((plant_profile_t *)data)->temp_high_limit);
-    ESP_LOGI(TAG, "  Temp Low Limit: %.2f °C", ((plant_profile_t *)data)->temp_low_limit); 
+    ESP_LOGI(TAG, "Plant profile set (%u bytes), status: %d", data_length, resp->status_code);
+    ESP_LOGI(TAG, "  Name: %s", profile.plant_name);
+    ESP_LOGI(TAG, "  Soil Dry Threshold: %.2f mV", profile.soil_dry_threshold);
+    ESP_LOGI(TAG, "  Soil Wet Threshold: %.2f mV", profile.soil_wet_threshold);
+    ESP_LOGI(TAG, "  Soil Dry Days for Watering: %d days", profile.soil_dry_days_for_watering);
+    ESP_LOGI(TAG, "  Temp High Limit: %.2f °C", profile.temp_high_limit);
+    ESP_LOGI(TAG, "  Temp Low Limit: %.2f °C", profile.temp_low_limit);
 
     *response_length = sizeof(ble_response_packet_t);
     return ESP_OK;
@@ -887,8 +1002,15 @@ static esp_err_t handle_save_plant_profile(uint8_t sequence_num, uint8_t *respon
         return ESP_OK;
     }
 
-    // 植物プロファイルをNVSに保存
-    esp_err_t err = nvs_config_save_plant_profile(profile);
+    // 植物プロファイルをアクティブのスロットに保存
+    const profile_library_t *library = plant_manager_get_profile_library();
+    if (library == NULL) {
+        resp->status_code = RESP_STATUS_ERROR;
+        ESP_LOGE(TAG, "Profile library not available");
+        *response_length = sizeof(ble_response_packet_t);
+        return ESP_OK;
+    }
+    esp_err_t err = plant_manager_store_profile(library->active, profile, NULL);
 
     if (err == ESP_OK) {
         resp->status_code = RESP_STATUS_SUCCESS;
@@ -1126,6 +1248,789 @@ static esp_err_t handle_get_sensor_config(uint8_t sequence_num, uint8_t *respons
     return ESP_OK;
 }
 
+static esp_err_t handle_get_minute_block(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_MINUTE_BLOCK;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(minute_block_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    struct tm start_time;
+    memcpy(&start_time, &((const minute_block_request_t *)data)->start_time, sizeof(struct tm));
+
+    // レスポンスバッファの残りをブロックの最大サイズとして使う
+    uint16_t length, count;
+    esp_err_t ret = data_buffer_encode_minute_block(&start_time, resp->data,
+                                                    BLE_RESPONSE_BUFFER_SIZE - sizeof(ble_response_packet_t),
+                                                    &length, &count);
+    if (ret != ESP_OK) {
+        resp->status_code = (ret == ESP_ERR_NOT_FOUND) ? RESP_STATUS_ERROR : RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = length;
+    *response_length = sizeof(ble_response_packet_t) + length;
+
+    ESP_LOGI(TAG, "CMD_GET_MINUTE_BLOCK: %u samples in %u bytes", count, length);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_daily_summary(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_DAILY_SUMMARY;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(daily_summary_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    struct tm date;
+    memcpy(&date, &((const daily_summary_request_t *)data)->date, sizeof(struct tm));
+
+    daily_summary_data_t summary;
+    if (data_buffer_get_daily_summary(&date, &summary) != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_OK;
+    }
+
+    daily_summary_response_t result;
+    memcpy(&result.date, &summary.date, sizeof(struct tm));
+    result.valid_samples = summary.valid_samples;
+    result.complete = summary.complete ? 1 : 0;
+    result.min_temperature = summary.min_temperature;
+    result.avg_temperature = summary.avg_temperature;
+    result.max_temperature = summary.max_temperature;
+    result.avg_humidity = summary.avg_humidity;
+    result.avg_lux = summary.avg_lux;
+    result.min_soil_moisture = summary.min_soil_moisture;
+    result.avg_soil_moisture = summary.avg_soil_moisture;
+    result.max_soil_moisture = summary.max_soil_moisture;
+    result.min_soil_temperature = summary.min_soil_temperature;
+    result.avg_soil_temperature = summary.avg_soil_temperature;
+    result.max_soil_temperature = summary.max_soil_temperature;
+    memcpy(result.temperature_quantiles, summary.temperature_quantiles, sizeof(result.temperature_quantiles));
+    memcpy(result.humidity_quantiles, summary.humidity_quantiles, sizeof(result.humidity_quantiles));
+    memcpy(result.lux_quantiles, summary.lux_quantiles, sizeof(result.lux_quantiles));
+    memcpy(result.soil_moisture_quantiles, summary.soil_moisture_quantiles, sizeof(result.soil_moisture_quantiles));
+    memcpy(result.soil_temperature_quantiles, summary.soil_temperature_quantiles, sizeof(result.soil_temperature_quantiles));
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(daily_summary_response_t);
+    memcpy(resp->data, &result, sizeof(daily_summary_response_t));
+    *response_length = sizeof(ble_response_packet_t) + sizeof(daily_summary_response_t);
+
+    ESP_LOGI(TAG, "CMD_GET_DAILY_SUMMARY: %04d-%02d-%02d, %u samples, soil p50=%.3f",
+             summary.date.tm_year + 1900, summary.date.tm_mon + 1, summary.date.tm_mday,
+             summary.valid_samples, summary.soil_moisture_quantiles[DAILY_QUANTILE_P50]);
+    return ESP_OK;
+}
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+static esp_err_t handle_get_channel_profile(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_CHANNEL_PROFILE;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    const channel_profile_request_t *req = (const channel_profile_request_t *)data;
+    if (data_length != sizeof(channel_profile_request_t) ||
+        (req->period != CHANNEL_PROFILE_PERIOD_HOURLY && req->period != CHANNEL_PROFILE_PERIOD_DAILY)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    struct tm time;
+    memcpy(&time, &req->time, sizeof(struct tm));
+
+    channel_profile_response_t result;
+    memset(&result, 0, sizeof(result));
+    result.period = req->period;
+    if (req->period == CHANNEL_PROFILE_PERIOD_HOURLY) {
+        // 対象時刻を含む1時間
+        time_t t = mktime(&time);
+        t -= t % 3600;
+        struct tm start, end;
+        localtime_r(&t, &start);
+        t += 3600;
+        localtime_r(&t, &end);
+        channel_point_data_t point;
+        uint16_t count = 0;
+        if (data_buffer_get_channel_history(&start, &end, &point, 1, &count) != ESP_OK || count == 0) {
+            resp->status_code = RESP_STATUS_ERROR;
+            return ESP_OK;
+        }
+        memcpy(&result.start, &point.timestamp, sizeof(struct tm));
+        result.samples = point.samples;
+        result.probe_valid_mask = point.probe_valid_mask;
+        memcpy(result.min_capacitance, point.min_capacitance, sizeof(result.min_capacitance));
+        memcpy(result.avg_capacitance, point.avg_capacitance, sizeof(result.avg_capacitance));
+        memcpy(result.max_capacitance, point.max_capacitance, sizeof(result.max_capacitance));
+        memcpy(result.min_soil_temperature, point.min_probe_temperature, sizeof(result.min_soil_temperature));
+        memcpy(result.avg_soil_temperature, point.avg_probe_temperature, sizeof(result.avg_soil_temperature));
+        memcpy(result.max_soil_temperature, point.max_probe_temperature, sizeof(result.max_soil_temperature));
+    } else {
+        daily_summary_data_t summary;
+        if (data_buffer_get_daily_summary(&time, &summary) != ESP_OK) {
+            resp->status_code = RESP_STATUS_ERROR;
+            return ESP_OK;
+        }
+        memcpy(&result.start, &summary.date, sizeof(struct tm));
+        result.samples = summary.valid_samples;
+        result.probe_valid_mask = summary.probe_valid_mask;
+        memcpy(result.min_capacitance, summary.min_capacitance, sizeof(result.min_capacitance));
+        memcpy(result.avg_capacitance, summary.avg_capacitance, sizeof(result.avg_capacitance));
+        memcpy(result.max_capacitance, summary.max_capacitance, sizeof(result.max_capacitance));
+        memcpy(result.min_soil_temperature, summary.min_probe_temperature, sizeof(result.min_soil_temperature));
+        memcpy(result.avg_soil_temperature, summary.avg_probe_temperature, sizeof(result.avg_soil_temperature));
+        memcpy(result.max_soil_temperature, summary.max_probe_temperature, sizeof(result.max_soil_temperature));
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(channel_profile_response_t);
+    memcpy(resp->data, &result, sizeof(channel_profile_response_t));
+    *response_length = sizeof(ble_response_packet_t) + sizeof(channel_profile_response_t);
+
+    ESP_LOGI(TAG, "CMD_GET_CHANNEL_PROFILE: period=%d, %u samples, probes=0x%02X",
+             result.period, result.samples, result.probe_valid_mask);
+    return ESP_OK;
+}
+#endif
+
+/**
+ * 範囲クエリの first_row からの1チャンクを取得してレスポンスパケットに格納
+ */
+static esp_err_t fill_range_chunk(const range_stream_t *stream, uint16_t first_row, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_QUERY_RANGE;
+    resp->sequence_num = stream->sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    uint16_t max_rows = stream->total_rows - first_row;
+    if (max_rows > stream->rows_per_chunk) {
+        max_rows = stream->rows_per_chunk;
+    }
+    range_query_chunk_t *chunk = (range_query_chunk_t *)resp->data;
+    uint16_t rows = 0;
+    esp_err_t err = stream->from_archive ? data_buffer_query_archive(&stream->query, first_row, max_rows, chunk->columns, &rows)
+                                         : data_buffer_query(&stream->query, first_row, max_rows, chunk->columns, &rows);
+    if (err != ESP_OK || rows == 0) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+    chunk->total_rows = stream->total_rows;
+    chunk->first_row = first_row;
+    chunk->rows = rows;
+    chunk->field_mask = stream->query.field_mask;
+    chunk->start_offset = stream->start_offset;
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(range_query_chunk_t) + rows * stream->column_count * sizeof(int16_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+    return ESP_OK;
+}
+
+/**
+ * 範囲クエリの2チャンク目以降の送信タスク
+ * 通知の mbuf はホストタスクが送信完了イベントを処理して返却するため、送信待ちはホストタスクの外で行う
+ */
+static void range_stream_task(void *param)
+{
+    uint8_t *buffer = g_range_stream_buffer;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        range_stream_t *stream = &g_range_stream;
+        int chunks = 1;
+        while (stream->next_row < stream->total_rows) {
+            size_t length = 0;
+            esp_err_t ret = fill_range_chunk(stream, stream->next_row, buffer, &length);
+            if (ret == ESP_OK) {
+                ret = ESP_FAIL;
+                for (int retry = 0; retry < RANGE_STREAM_SEND_RETRIES && g_conn_handle != BLE_HS_CONN_HANDLE_NONE; retry++) {
+                    ret = send_response_notification(buffer, length);
+                    if (ret == ESP_OK) {
+                        break;
+                    }
+                    vTaskDelay(pdMS_TO_TICKS(RANGE_STREAM_RETRY_MS));
+                }
+            }
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "CMD_QUERY_RANGE: failed to send chunk at row %u", stream->next_row);
+                // 途中で打ち切ったことを通知する（届かなければクライアントのタイムアウトに任せる）
+                ble_response_packet_t *resp = (ble_response_packet_t *)buffer;
+                resp->response_id = CMD_QUERY_RANGE;
+                resp->status_code = RESP_STATUS_ERROR;
+                resp->sequence_num = stream->sequence_num;
+                resp->data_length = 0;
+                send_response_notification(buffer, sizeof(ble_response_packet_t));
+                break;
+            }
+            stream->next_row += ((range_query_chunk_t *)((ble_response_packet_t *)buffer)->data)->rows;
+            chunks++;
+        }
+
+        ESP_LOGI(TAG, "CMD_QUERY_RANGE: streamed %u of %u rows in %d chunks", stream->next_row, stream->total_rows, chunks);
+        g_range_stream_active = false;
+    }
+}
+
+static esp_err_t handle_query_range(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_QUERY_RANGE;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(range_query_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+    // 前のクエリの送信中は受け付けない
+    if (g_range_stream_active || g_range_stream_task_handle == NULL) {
+        resp->status_code = RESP_STATUS_BUSY;
+        return ESP_OK;
+    }
+
+    const range_query_request_t *req = (const range_query_request_t *)data;
+    struct tm start_time, end_time;
+    memcpy(&start_time, &req->start_time, sizeof(struct tm));
+    memcpy(&end_time, &req->end_time, sizeof(struct tm));
+
+    range_stream_t *stream = &g_range_stream;
+    stream->query.window.start_minute = (uint32_t)(mktime(&start_time) / 60);
+    stream->query.window.end_minute = (uint32_t)(mktime(&end_time) / 60);
+    stream->query.step_minutes = req->step_minutes;
+    stream->query.field_mask = req->field_mask;
+    stream->query.aggregate = (data_buffer_aggregate_t)(req->aggregate & ~RANGE_QUERY_FROM_ARCHIVE);
+    stream->from_archive = (req->aggregate & RANGE_QUERY_FROM_ARCHIVE) != 0;
+    stream->column_count = data_buffer_query_columns(&stream->query);
+    stream->sequence_num = sequence_num;
+    if (stream->column_count == 0 || (stream->from_archive && stream->query.aggregate == DATA_BUFFER_AGG_LTTB)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    // 保持範囲で打ち切る（行数の上限を超える範囲は切り詰めずに拒否する）
+    uint32_t requested_start = stream->query.window.start_minute;
+    esp_err_t err = data_buffer_query_freeze(&stream->query, stream->from_archive, &stream->total_rows);
+    if (err == ESP_ERR_INVALID_SIZE) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_OK;
+    }
+    stream->start_offset = stream->query.window.start_minute - requested_start;
+
+    // 1通知に収まる行数ずつ取得する。先頭チャンクは呼び出し元が送信し、残りは送信タスクが送る
+    size_t header_size = sizeof(ble_response_packet_t) + sizeof(range_query_chunk_t);
+    stream->rows_per_chunk = (uint16_t)((BLE_RESPONSE_BUFFER_SIZE - header_size) / (stream->column_count * sizeof(int16_t)));
+    if (fill_range_chunk(stream, 0, response_buffer, response_length) != ESP_OK) {
+        resp->data_length = 0;
+        *response_length = sizeof(ble_response_packet_t);
+        return ESP_FAIL;
+    }
+    stream->next_row = ((range_query_chunk_t *)resp->data)->rows;
+    if (stream->next_row < stream->total_rows) {
+        g_range_stream_active = true;
+        g_range_stream_pending = true;
+    }
+
+    ESP_LOGI(TAG, "CMD_QUERY_RANGE: %u rows x %u columns from +%lu min (step %u min, agg %d%s)",
+             stream->total_rows, stream->column_count, (unsigned long)stream->start_offset,
+             stream->query.step_minutes, stream->query.aggregate, stream->from_archive ? ", archive" : "");
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_gaps(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_GAPS;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(gap_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    const gap_request_t *req = (const gap_request_t *)data;
+    struct tm start_time, end_time;
+    memcpy(&start_time, &req->start_time, sizeof(struct tm));
+    memcpy(&end_time, &req->end_time, sizeof(struct tm));
+
+    data_buffer_window_t window;
+    window.start_minute = (uint32_t)(mktime(&start_time) / 60);
+    window.end_minute = (uint32_t)(mktime(&end_time) / 60);
+    if (window.end_minute <= window.start_minute) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    data_buffer_gap_t gaps[GAP_RESPONSE_MAX_ENTRIES];
+    uint16_t count = 0, total = 0;
+    if (data_buffer_get_gaps(&window, gaps, GAP_RESPONSE_MAX_ENTRIES, &count, &total) != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    gap_response_t *result = (gap_response_t *)resp->data;
+    result->window_minutes = window.end_minute - window.start_minute;
+    result->present_minutes = data_buffer_count_minutes(&window);
+    result->total_gaps = total;
+    result->gap_count = (uint8_t)count;
+    for (int i = 0; i < count; i++) {
+        result->gaps[i].offset_minutes = gaps[i].start_minute - window.start_minute;
+        result->gaps[i].length_minutes = gaps[i].length;
+        result->gaps[i].reason = gaps[i].reason;
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(gap_response_t) + count * sizeof(gap_entry_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_GET_GAPS: %lu minutes, %u present, %u gaps (%u sent)",
+             (unsigned long)result->window_minutes, result->present_minutes, total, count);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_period_stats(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_PERIOD_STATS;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(period_stats_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    const period_stats_request_t *req = (const period_stats_request_t *)data;
+    struct tm start_date, end_date;
+    memcpy(&start_date, &req->start_date, sizeof(struct tm));
+    memcpy(&end_date, &req->end_date, sizeof(struct tm));
+
+    static data_buffer_period_stats_t stats;
+    esp_err_t ret;
+    if (req->period == PERIOD_STATS_DAY_RANGE) {
+        ret = data_buffer_merge_days(&start_date, &end_date, &stats);
+    } else if (req->period <= DATA_BUFFER_PERIOD_MONTH) {
+        ret = data_buffer_get_period_stats((data_buffer_period_t)req->period, &start_date, &stats);
+    } else {
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    if (ret != ESP_OK) {
+        resp->status_code = (ret == ESP_ERR_INVALID_ARG) ? RESP_STATUS_INVALID_PARAMETER : RESP_STATUS_ERROR;
+        return ret;
+    }
+
+    period_stats_response_t *result = (period_stats_response_t *)resp->data;
+    memcpy(&result->start_date, &stats.start, sizeof(struct tm));
+    result->days = stats.days;
+    for (int f = 0; f < QUANTILE_FIELD_COUNT; f++) {
+        const data_buffer_field_stats_t *src = &stats.field[f];
+        result->field[f].samples = src->samples;
+        result->field[f].mean = src->mean;
+        result->field[f].stddev = src->stddev;
+        result->field[f].min = src->min;
+        result->field[f].max = src->max;
+        result->field[f].p10 = src->quantiles[0];
+        result->field[f].p50 = src->quantiles[1];
+        result->field[f].p90 = src->quantiles[2];
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(period_stats_response_t);
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_GET_PERIOD_STATS: period %u, %04d/%02d/%02d, %u days",
+             req->period, stats.start.tm_year + 1900, stats.start.tm_mon + 1, stats.start.tm_mday, stats.days);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_events(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_EVENTS;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != sizeof(event_request_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    const event_request_t *req = (const event_request_t *)data;
+    uint16_t max_events = (req->max_events < EVENT_RESPONSE_MAX_ENTRIES) ? req->max_events : EVENT_RESPONSE_MAX_ENTRIES;
+    event_response_t *result = (event_response_t *)resp->data;
+    uint16_t count = 0, total = 0;
+
+    if (req->mode == EVENT_REQUEST_LAST) {
+        count = event_log_get_last(max_events, result->events);
+        total = event_log_count();
+    } else if (req->mode == EVENT_REQUEST_RANGE) {
+        struct tm start_time, end_time;
+        memcpy(&start_time, &req->start_time, sizeof(struct tm));
+        memcpy(&end_time, &req->end_time, sizeof(struct tm));
+        if (event_log_get_range((uint32_t)mktime(&start_time), (uint32_t)mktime(&end_time), req->skip,
+                                result->events, max_events, &count, &total) != ESP_OK) {
+            resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+            return ESP_FAIL;
+        }
+    } else {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_FAIL;
+    }
+
+    result->total_events = total;
+    result->event_count = (uint8_t)count;
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(event_response_t) + count * sizeof(event_entry_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_GET_EVENTS: mode %u, %u events (%u total)", req->mode, count, total);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_drying_forecast(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_DRYING_FORECAST;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    drying_forecast_t forecast;
+    const plant_profile_t *profile = plant_manager_get_profile();
+    if (profile == NULL || plant_manager_get_drying_forecast(&forecast) != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    drying_forecast_response_t result = {
+        .hours_until_dry = forecast.hours_until_dry,
+        .current_moisture = forecast.current_moisture,
+        .dry_threshold = profile->soil_dry_threshold,
+        .day_rate = forecast.rate[DRYING_PERIOD_DAY],
+        .night_rate = forecast.rate[DRYING_PERIOD_NIGHT],
+        .day_fraction = forecast.day_fraction,
+        .day_samples = forecast.samples[DRYING_PERIOD_DAY],
+        .night_samples = forecast.samples[DRYING_PERIOD_NIGHT],
+        .valid_mask = forecast.valid_mask,
+    };
+    memcpy(resp->data, &result, sizeof(result));
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(drying_forecast_response_t);
+    *response_length = sizeof(ble_response_packet_t) + sizeof(drying_forecast_response_t);
+
+    ESP_LOGI(TAG, "CMD_GET_DRYING_FORECAST: %.1f h until dry (day %.4f/h, night %.4f/h, valid 0x%02x)",
+             forecast.hours_until_dry, forecast.rate[DRYING_PERIOD_DAY], forecast.rate[DRYING_PERIOD_NIGHT],
+             forecast.valid_mask);
+    return ESP_OK;
+}
+
+static esp_err_t handle_set_rules(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_SET_RULES;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    // version, count に続いて count 件のルール
+    if (data_length < RULE_SET_HEADER_SIZE || data[1] > RULE_ENGINE_MAX_RULES || data_length != RULE_SET_SIZE(data[1])) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    rule_set_t rules;
+    memset(&rules, 0, sizeof(rules));
+    memcpy(&rules, data, data_length);
+    uint16_t total_cost = 0;
+    esp_err_t err = rule_engine_check(&rules, ERROR_CONDITION, &total_cost);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CMD_SET_RULES: invalid rules (%s)", esp_err_to_name(err));
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+    err = plant_manager_set_rules(&rules);
+    if (err != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_OK;
+    }
+
+    rule_set_response_t result = {
+        .total_cost = total_cost,
+        .max_cost = RULE_ENGINE_MAX_COST,
+    };
+    memcpy(resp->data, &result, sizeof(result));
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(rule_set_response_t);
+    *response_length = sizeof(ble_response_packet_t) + sizeof(rule_set_response_t);
+
+    ESP_LOGI(TAG, "CMD_SET_RULES: %u rules, cost %u/%u", rules.count, total_cost, RULE_ENGINE_MAX_COST);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_rules(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_RULES;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    rule_set_t rules;
+    bool is_custom;
+    if (plant_manager_get_rules(&rules, &is_custom) != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    rule_get_response_t *result = (rule_get_response_t *)resp->data;
+    result->is_custom = is_custom ? 1 : 0;
+    result->version = rules.version;
+    result->count = rules.count;
+    memcpy(result->rules, rules.rules, rules.count * sizeof(rule_t));
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(rule_get_response_t) + rules.count * sizeof(rule_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_GET_RULES: %u rules (%s)", rules.count, is_custom ? "custom" : "default");
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_rule_stats(uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_RULE_STATS;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    static rule_engine_t engine;  // NimBLEタスクのスタックを使わない（コマンドは1件ずつ処理）
+    if (plant_manager_get_rule_engine(&engine) != ESP_OK) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    rule_stats_response_t *result = (rule_stats_response_t *)resp->data;
+    result->evaluations = engine.evaluations;
+    result->total_cost = engine.total_cost;
+    result->max_cost = RULE_ENGINE_MAX_COST;
+    result->rule_count = engine.set.count;
+    for (uint8_t i = 0; i < engine.set.count; i++) {
+        const rule_state_t *state = &engine.state[i];
+        rule_stats_entry_t *entry = &result->rules[i];
+        entry->cost = state->cost;
+        entry->state = (uint8_t)((state->active ? 0x01 : 0) | (state->holding ? 0x02 : 0));
+        entry->true_count = state->true_count;
+        entry->matches = state->matches;
+        entry->max_cycles = state->max_cycles;
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(rule_stats_response_t) + engine.set.count * sizeof(rule_stats_entry_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_GET_RULE_STATS: %u rules, %lu evaluations, cost %u", engine.set.count,
+             (unsigned long)engine.evaluations, engine.total_cost);
+    return ESP_OK;
+}
+
+// プロファイルのライブラリ操作のエラーをレスポンスの状態に変換
+static uint8_t profile_status_from_error(esp_err_t err)
+{
+    switch (err) {
+        case ESP_OK:                return RESP_STATUS_SUCCESS;
+        case ESP_ERR_INVALID_ARG:
+        case ESP_ERR_NOT_FOUND:
+        case ESP_ERR_INVALID_STATE:
+        case ESP_ERR_NO_MEM:        return RESP_STATUS_INVALID_PARAMETER;
+        default:                    return RESP_STATUS_ERROR;
+    }
+}
+
+static esp_err_t handle_list_profiles(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_LIST_PROFILES;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    const profile_library_t *library = plant_manager_get_profile_library();
+    if (library == NULL) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    // 開始するスロット番号（省略時は0）。7件を超える分は最後のスロット番号 + 1 から続けて取得する
+    uint8_t start = (data_length >= 1) ? data[0] : 0;
+
+    profile_list_response_t *result = (profile_list_response_t *)resp->data;
+    result->used_mask = library->used_mask;
+    result->active = library->active;
+    result->count = 0;
+    for (uint8_t i = start; i < PROFILE_LIBRARY_SLOTS && result->count < PROFILE_LIST_MAX_ENTRIES; i++) {
+        const plant_profile_t *profile = profile_library_get(library, i);
+        if (profile == NULL) {
+            continue;
+        }
+        profile_list_entry_t *entry = &result->entries[result->count++];
+        entry->index = i;
+        memcpy(entry->plant_name, profile->plant_name, sizeof(entry->plant_name));
+    }
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = (uint16_t)(sizeof(profile_list_response_t) + result->count * sizeof(profile_list_entry_t));
+    *response_length = sizeof(ble_response_packet_t) + resp->data_length;
+
+    ESP_LOGI(TAG, "CMD_LIST_PROFILES: start %u, %u profiles, active %u", start, result->count, library->active);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_GET_PROFILE_SLOT;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    const profile_library_t *library = plant_manager_get_profile_library();
+    if (library == NULL) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_FAIL;
+    }
+
+    const plant_profile_t *profile = (data_length == 1) ? profile_library_get(library, data[0]) : NULL;
+    if (profile == NULL) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    profile_slot_response_t *result = (profile_slot_response_t *)resp->data;
+    result->index = data[0];
+    result->is_active = (data[0] == library->active) ? 1 : 0;
+    memcpy(&result->profile, profile, sizeof(plant_profile_t));
+
+    resp->status_code = RESP_STATUS_SUCCESS;
+    resp->data_length = sizeof(profile_slot_response_t);
+    *response_length = sizeof(ble_response_packet_t) + sizeof(profile_slot_response_t);
+
+    ESP_LOGI(TAG, "CMD_GET_PROFILE_SLOT: slot %u (%s)", data[0], profile->plant_name);
+    return ESP_OK;
+}
+
+static esp_err_t handle_set_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_SET_PROFILE_SLOT;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    const profile_library_t *library = plant_manager_get_profile_library();
+    const plant_profile_t *current = plant_manager_get_profile();
+    if (library == NULL || current == NULL) {
+        resp->status_code = RESP_STATUS_ERROR;
+        return ESP_OK;
+    }
+
+    // 旧形式のプロファイル（archive_error を追加する前）も受け付け、足りないフィールドは
+    // 書き込み先のスロットの値（空きスロットなら現在のプロファイルの値）を使う。plant_profile_t より長いものは拒否する
+    if (data_length < 1 || data_length - 1 > sizeof(plant_profile_t)) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+    uint8_t index = data[0];  // profile_slot_request_t.index
+    const plant_profile_t *defaults = profile_library_get(library, index);
+    plant_profile_t profile;
+    if (profile_library_decode(data + 1, data_length - 1, (defaults != NULL) ? defaults : current, &profile) != ESP_OK) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    uint8_t stored_index = PROFILE_LIBRARY_NONE;
+    esp_err_t err = plant_manager_store_profile(index, &profile, &stored_index);
+    resp->status_code = profile_status_from_error(err);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "CMD_SET_PROFILE_SLOT: slot %u failed (%s)", index, esp_err_to_name(err));
+        return ESP_OK;
+    }
+
+    // 保存したスロット番号を返す
+    resp->data[0] = stored_index;
+    resp->data_length = 1;
+    *response_length = sizeof(ble_response_packet_t) + 1;
+
+    ESP_LOGI(TAG, "CMD_SET_PROFILE_SLOT: slot %u (%s)", stored_index, profile.plant_name);
+    return ESP_OK;
+}
+
+static esp_err_t handle_select_profile(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_SELECT_PROFILE;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != 1) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    esp_err_t err = plant_manager_select_profile(data[0]);
+    resp->status_code = profile_status_from_error(err);
+    ESP_LOGI(TAG, "CMD_SELECT_PROFILE: slot %u (%s)", data[0], esp_err_to_name(err));
+    return ESP_OK;
+}
+
+static esp_err_t handle_delete_profile_slot(const uint8_t *data, uint16_t data_length, uint8_t sequence_num, uint8_t *response_buffer, size_t *response_length)
+{
+    ble_response_packet_t *resp = (ble_response_packet_t *)response_buffer;
+    resp->response_id = CMD_DELETE_PROFILE_SLOT;
+    resp->sequence_num = sequence_num;
+    resp->data_length = 0;
+    *response_length = sizeof(ble_response_packet_t);
+
+    if (data_length != 1) {
+        resp->status_code = RESP_STATUS_INVALID_PARAMETER;
+        return ESP_OK;
+    }
+
+    esp_err_t err = plant_manager_delete_profile(data[0]);
+    resp->status_code = profile_status_from_error(err);
+    ESP_LOGI(TAG, "CMD_DELETE_PROFILE_SLOT: slot %u (%s)", data[0], esp_err_to_name(err));
+    return ESP_OK;
+}
+
 static esp_err_t send_response_notification(const uint8_t *response_data, size_t response_length)
 {
     if (g_conn_handle == BLE_HS_CONN_HANDLE_NONE || !g_is_subscribed_response) {
@@ -1329,6 +2234,11 @@ static esp_err_t generate_ble_device_name(char *device_name, size_t max_len)
     return ESP_OK;
 }
 
+void ble_manager_set_flush_callback(ble_flush_callback_t callback)
+{
+    g_flush_callback = callback;
+}
+
 esp_err_t ble_manager_init(void)
 {
     esp_err_t ret;
@@ -1353,6 +2263,12 @@ esp_err_t ble_manager_init(void)
     // --- 追加: ストア設定の初期化 (必須) ---
     //ble_store_config_init();
 
+    // 範囲クエリの2チャンク目以降の送信タスク
+    if (xTaskCreate(range_stream_task, "ble_range", 4096, NULL, 3, &g_range_stream_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create range query stream task");
+        g_range_stream_task_handle = NULL;
+    }
+
     ble_hs_cfg.reset_cb = on_reset;
     ble_hs_cfg.sync_cb = on_sync;
     ble_hs_cfg.gatts_register_cb = NULL;
@@ -1414,4 +2330,4 @@ void print_ble_system_info(void)
     ESP_LOGI(TAG, "  - Command: Write commands to device");
     ESP_LOGI(TAG, "  - Response: Read/Notify for command responses");
     ESP_LOGI(TAG, "  - Data Transfer: Read/Write/Notify for large data");
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "host/ble_hs.h" // ble_gap_event のためにインクルード
 #include "../../common_types.h" // HARDWARE_VERSION のためにインクルード
 #include "../plant_logic/plant_manager.h" // plant_profile_t のためにインクルード
+#include "../plant_logic/event_log.h" // event_entry_t のためにインクルード
+#include "../plant_logic/profile_library.h" // PROFILE_LIBRARY_SLOTS のためにインクルード
 
 /* --- Constants --- */
 
@@ -37,6 +39,234 @@ typedef struct __attribute__((packed)) {
     struct tm requested_time; // 要求する時間
 } time_data_request_t;
 
+// 1分データ圧縮ブロック取得リクエスト用構造体（CMD_GET_MINUTE_BLOCK用）
+// レスポンスは minute_codec 形式のブロック（ヘッダー8バイト + ビット列）
+typedef struct __attribute__((packed)) {
+    struct tm start_time;     // 開始時刻（この時刻以降のデータを古い順に格納）
+} minute_block_request_t;
+
+// 日別サマリー取得リクエスト用構造体（CMD_GET_DAILY_SUMMARY用）
+typedef struct __attribute__((packed)) {
+    struct tm date;           // 対象日（年月日のみ参照）
+} daily_summary_request_t;
+
+// 日別サマリー取得レスポンス用構造体（143バイト）
+// 分位点は P²法による逐次推定値（添字 0:p10, 1:p50, 2:p90）
+typedef struct __attribute__((packed)) {
+    struct tm date;                    // 日付
+    uint16_t valid_samples;            // 有効サンプル数
+    uint8_t complete;                  // 1日分のデータが完全か
+    float min_temperature;             // 最低気温 [℃]
+    float avg_temperature;             // 平均気温 [℃]
+    float max_temperature;             // 最高気温 [℃]
+    float avg_humidity;                // 平均湿度 [%]
+    float avg_lux;                     // 平均照度 [lux]
+    float min_soil_moisture;           // 最小土壌水分
+    float avg_soil_moisture;           // 平均土壌水分
+    float max_soil_moisture;           // 最大土壌水分
+    float min_soil_temperature;        // 最低土壌温度 [℃]
+    float avg_soil_temperature;        // 平均土壌温度 [℃]
+    float max_soil_temperature;        // 最高土壌温度 [℃]
+    float temperature_quantiles[3];    // 気温 p10/p50/p90
+    float humidity_quantiles[3];       // 湿度 p10/p50/p90
+    float lux_quantiles[3];            // 照度 p10/p50/p90
+    float soil_moisture_quantiles[3];  // 土壌水分 p10/p50/p90
+    float soil_temperature_quantiles[3]; // 土壌温度 p10/p50/p90
+} daily_summary_response_t;
+
+// チャンネル別集計取得リクエスト用構造体（CMD_GET_CHANNEL_PROFILE用）
+typedef struct __attribute__((packed)) {
+    struct tm time;           // 対象時刻（その時刻を含む1時間、または日）
+    uint8_t period;           // 集計期間 (CHANNEL_PROFILE_PERIOD_*)
+} channel_profile_request_t;
+
+#define CHANNEL_PROFILE_PERIOD_HOURLY  0   // 1時間集計（直近7日）
+#define CHANNEL_PROFILE_PERIOD_DAILY   1   // 日別集計（直近30日）
+
+// チャンネル別集計取得レスポンス用構造体（136バイト）
+// 静電容量は FDC1004 ch1〜4、土壌温度は TMP102[0..3]（深さ 12.5/40/65/90mm）の順
+typedef struct __attribute__((packed)) {
+    struct tm start;                   // 区間の開始時刻（日別は日付）
+    uint8_t period;                    // 集計期間 (CHANNEL_PROFILE_PERIOD_*)
+    uint16_t samples;                  // 区間内の1分データ数
+    uint8_t probe_valid_mask;          // 有効サンプルのあった土壌温度センサー（bit i: TMP102[i]）
+    float min_capacitance[4];          // 最小静電容量 [pF]
+    float avg_capacitance[4];          // 平均静電容量 [pF]
+    float max_capacitance[4];          // 最大静電容量 [pF]
+    float min_soil_temperature[4];     // 最低土壌温度 [℃]
+    float avg_soil_temperature[4];     // 平均土壌温度 [℃]
+    float max_soil_temperature[4];     // 最高土壌温度 [℃]
+} channel_profile_response_t;
+
+// 範囲クエリリクエスト用構造体（CMD_QUERY_RANGE用、77バイト）
+typedef struct __attribute__((packed)) {
+    struct tm start_time;     // 開始時刻（この時刻を含む）
+    struct tm end_time;       // 終了時刻（この時刻を含まない）
+    uint16_t step_minutes;    // 1行の分数（1: 間引きなし）
+    uint16_t field_mask;      // 取得するフィールド（bit f: data_buffer_field_t）
+    uint8_t aggregate;        // 1行内の集約方法（data_buffer_aggregate_t、LTTBは1フィールドのみ）| RANGE_QUERY_FROM_ARCHIVE
+} range_query_request_t;
+
+#define RANGE_QUERY_FROM_ARCHIVE  0x80  // aggregate の上位ビット: 間引き記録から1分単位に復元した値で集約（LTTBは不可）
+
+// 範囲クエリレスポンスのチャンク（CMD_QUERY_RANGE用）
+// 結果は複数のレスポンス通知に分けて送信し、各通知に行の範囲と列を格納する
+typedef struct __attribute__((packed)) {
+    uint16_t total_rows;      // 全行数
+    uint16_t first_row;       // このチャンクの先頭行
+    uint16_t rows;            // このチャンクの行数
+    uint16_t field_mask;      // 列のフィールド（フィールド番号の小さい順に rows 要素ずつ並ぶ）
+    uint32_t start_offset;    // start_time から行0の先頭までの分数（保持範囲より前を行単位で切り詰めた分）
+    int16_t columns[];        // 列データ（欠測: INT16_MIN、LTTBは値の後ろに行内の分の列）
+} range_query_chunk_t;
+
+// 欠測区間取得リクエスト用構造体（CMD_GET_GAPS用、72バイト）
+typedef struct __attribute__((packed)) {
+    struct tm start_time;     // 開始時刻（この時刻を含む）
+    struct tm end_time;       // 終了時刻（この時刻を含まない）
+} gap_request_t;
+
+#define GAP_RESPONSE_MAX_ENTRIES  24  // 1レスポンスに格納する欠測区間の最大数
+
+// 欠測区間（CMD_GET_GAPS用、9バイト）
+typedef struct __attribute__((packed)) {
+    uint32_t offset_minutes;  // 開始時刻からの分数
+    uint32_t length_minutes;  // 欠測の分数
+    uint8_t reason;           // 原因（data_buffer_gap_reason_t）
+} gap_entry_t;
+
+// 欠測区間取得レスポンス用構造体（9 + 9 × gap_count バイト）
+typedef struct __attribute__((packed)) {
+    uint32_t window_minutes;  // 範囲の分数
+    uint16_t present_minutes; // 1分データのある分の数
+    uint16_t total_gaps;      // 範囲内の欠測区間の総数（gap_count より多い場合は続きを開始時刻をずらして取得）
+    uint8_t gap_count;        // 格納した欠測区間の数
+    gap_entry_t gaps[];       // 欠測区間（古い順）
+} gap_response_t;
+
+#define PERIOD_STATS_DAY_RANGE    2   // period: 任意の日の範囲（0: 週、1: 月は data_buffer_period_t）
+
+// 週・月・日範囲の統計取得リクエスト用構造体（CMD_GET_PERIOD_STATS用、73バイト）
+typedef struct __attribute__((packed)) {
+    uint8_t period;           // 0: 週（月曜始まり）、1: 月、2: 任意の日の範囲
+    struct tm start_date;     // 週・月: 対象期間に含まれる日付、日の範囲: 最初の日
+    struct tm end_date;       // 日の範囲: 最後の日（この日を含む、最大31日間）。週・月では無視
+} period_stats_request_t;
+
+// 1フィールドの統計（CMD_GET_PERIOD_STATS用、30バイト）
+typedef struct __attribute__((packed)) {
+    uint16_t samples;         // サンプル数（0: データなし）
+    float mean;
+    float stddev;
+    float min;
+    float max;
+    float p10;
+    float p50;
+    float p90;
+} period_field_stats_t;
+
+// 週・月・日範囲の統計レスポンス用構造体（187バイト）
+// フィールドは 気温[℃]・湿度[%]・照度[lux]・土壌水分（Rev3/Rev4: [pF]、その他: [mV]）・土壌温度[℃] の順
+typedef struct __attribute__((packed)) {
+    struct tm start_date;     // 期間の最初の日
+    uint8_t days;             // 結合した日数
+    period_field_stats_t field[5];
+} period_stats_response_t;
+
+#define EVENT_REQUEST_LAST        0   // mode: 最新のイベントから max_events 件（新しい順）
+#define EVENT_REQUEST_RANGE       1   // mode: 期間内のイベント（古い順）
+#define EVENT_RESPONSE_MAX_ENTRIES  30  // 1レスポンスに格納するイベントの最大数
+
+// イベント取得リクエスト用構造体（CMD_GET_EVENTS用、76バイト）
+typedef struct __attribute__((packed)) {
+    uint8_t mode;             // EVENT_REQUEST_LAST / EVENT_REQUEST_RANGE
+    uint8_t max_events;       // 取得する最大件数（EVENT_RESPONSE_MAX_ENTRIES まで）
+    uint16_t skip;            // 期間指定: 先頭から読み飛ばす件数（続きの取得用）
+    struct tm start_time;     // 期間指定: 開始時刻（この時刻を含む）
+    struct tm end_time;       // 期間指定: 終了時刻（この時刻を含まない）
+} event_request_t;
+
+// イベント取得レスポンス用構造体（3 + 8 × event_count バイト）
+typedef struct __attribute__((packed)) {
+    uint16_t total_events;    // 最新N件: 保持しているイベント数、期間指定: 期間内のイベントの総数
+    uint8_t event_count;      // 格納したイベントの数
+    event_entry_t events[];   // イベント
+} event_response_t;
+
+// 乾燥予測レスポンス用構造体（CMD_GET_DRYING_FORECAST用、29バイト）
+typedef struct __attribute__((packed)) {
+    float hours_until_dry;    // 乾燥閾値に達するまでの予測時間 [時]（0: 既に乾燥, -1: 予測できない）
+    float current_moisture;   // 予測に使った現在の土壌水分
+    float dry_threshold;      // 乾燥閾値（植物プロファイル）
+    float day_rate;           // 昼の乾燥速度 [土壌水分の単位 / 時]（正: 乾燥方向）
+    float night_rate;         // 夜の乾燥速度 [土壌水分の単位 / 時]
+    float day_fraction;       // 昼のサンプルの割合（予測で昼と夜の速度を混ぜる比率）
+    uint16_t day_samples;     // 昼の速度の推定に使ったサンプル数（灌水でやり直した後）
+    uint16_t night_samples;   // 夜の速度の推定に使ったサンプル数
+    uint8_t valid_mask;       // bit0: 夜の速度が有効, bit1: 昼の速度が有効
+} drying_forecast_response_t;
+
+// ルール書き込みレスポンス用構造体（CMD_SET_RULES用、4バイト）
+typedef struct __attribute__((packed)) {
+    uint16_t total_cost;      // 1回の評価の費用の合計
+    uint16_t max_cost;        // 費用の上限（RULE_ENGINE_MAX_COST）
+} rule_set_response_t;
+
+// ルール取得レスポンス用構造体（CMD_GET_RULES用、3 + 15 × count バイト）
+typedef struct __attribute__((packed)) {
+    uint8_t is_custom;        // 1: 書き込まれたルール, 0: 植物プロファイルから作る既定のルール
+    uint8_t version;          // RULE_SET_VERSION
+    uint8_t count;            // ルール数
+    rule_t rules[];           // ルール
+} rule_get_response_t;
+
+// ルールごとの評価の実績（CMD_GET_RULE_STATS用、14バイト）
+typedef struct __attribute__((packed)) {
+    uint8_t cost;             // 1回の評価の費用
+    uint8_t state;            // bit0: 直前の評価で成立, bit1: 連結全体が成立中（継続時間の待ちを含む）
+    uint32_t true_count;      // 成立した回数
+    uint32_t matches;         // 状態を決めた回数
+    uint32_t max_cycles;      // 評価にかかった最大のCPUサイクル数
+} rule_stats_entry_t;
+
+// ルールの評価の実績レスポンス用構造体（CMD_GET_RULE_STATS用、9 + 14 × rule_count バイト）
+typedef struct __attribute__((packed)) {
+    uint32_t evaluations;     // 表を読み込んでから評価した回数
+    uint16_t total_cost;      // 1回の評価の費用の合計
+    uint16_t max_cost;        // 費用の上限（RULE_ENGINE_MAX_COST）
+    uint8_t rule_count;       // ルール数
+    rule_stats_entry_t rules[]; // ルールごとの実績
+} rule_stats_response_t;
+
+#define PROFILE_LIST_MAX_ENTRIES    7   // 1回のレスポンスに入れるスロット数（4 + 33 × 7 = 235バイト）
+
+// プロファイルのライブラリ一覧のスロット（CMD_LIST_PROFILES用、33バイト）
+typedef struct __attribute__((packed)) {
+    uint8_t index;            // スロット番号
+    char plant_name[32];      // 植物の名前
+} profile_list_entry_t;
+
+// プロファイルのライブラリ一覧レスポンス用構造体（CMD_LIST_PROFILES用、4 + 33 × count バイト）
+typedef struct __attribute__((packed)) {
+    uint16_t used_mask;       // プロファイルのあるスロット（bit: スロット番号）
+    uint8_t active;           // アクティブのスロット番号
+    uint8_t count;            // このレスポンスのスロット数（リクエストの開始番号以降のプロファイルのあるスロット、最大 PROFILE_LIST_MAX_ENTRIES）
+    profile_list_entry_t entries[];
+} profile_list_response_t;
+
+// スロットのプロファイル取得レスポンス用構造体（CMD_GET_PROFILE_SLOT用）
+typedef struct __attribute__((packed)) {
+    uint8_t index;            // スロット番号
+    uint8_t is_active;        // 1: アクティブのスロット
+    plant_profile_t profile;  // 植物プロファイル
+} profile_slot_response_t;
+
+// スロットへのプロファイル書き込みリクエスト用構造体（CMD_SET_PROFILE_SLOT用）
+typedef struct __attribute__((packed)) {
+    uint8_t index;            // スロット番号（0xFF: 同じ名前のスロット、なければ空きスロット）
+    plant_profile_t profile;  // 植物プロファイル
+} profile_slot_request_t;
+
 // 時間指定データ取得レスポンス用構造体
 #if (HARDWARE_VERSION == 10 || HARDWARE_VERSION == 20) // Rev1 or Rev2
 typedef struct __attribute__((packed)) {
@@ -135,6 +365,22 @@ typedef enum {
     CMD_CONTROL_LED = 0x18,         // LED制御（WS2812）
     CMD_SET_LED_BRIGHTNESS = 0x19,  // LED輝度設定
     CMD_GET_SENSOR_CONFIG = 0x1A,   // 土壌センサー構成情報取得
+    CMD_GET_MINUTE_BLOCK = 0x1B,    // 1分データ圧縮ブロック取得
+    CMD_GET_DAILY_SUMMARY = 0x1C,   // 日別サマリー取得（分位点含む）
+    CMD_GET_CHANNEL_PROFILE = 0x1D, // チャンネル別集計取得（Rev3/Rev4）
+    CMD_QUERY_RANGE = 0x1E,         // 範囲クエリ（フィールド指定・間引き、複数通知で送信）
+    CMD_GET_GAPS = 0x1F,            // 欠測区間取得
+    CMD_GET_PERIOD_STATS = 0x20,    // 週・月・日範囲の統計取得
+    CMD_GET_EVENTS = 0x21,          // イベント（灌水など）取得
+    CMD_GET_DRYING_FORECAST = 0x22, // 乾燥速度と乾燥までの予測時間取得
+    CMD_SET_RULES = 0x23,           // 状態判定のルール設定（NVSに保存）
+    CMD_GET_RULES = 0x24,           // 状態判定のルール取得
+    CMD_GET_RULE_STATS = 0x25,      // ルールごとの評価の費用と実績取得
+    CMD_LIST_PROFILES = 0x26,       // プロファイルのライブラリ一覧取得
+    CMD_GET_PROFILE_SLOT = 0x27,    // スロットのプロファイル取得
+    CMD_SET_PROFILE_SLOT = 0x28,    // スロットにプロファイルを保存
+    CMD_SELECT_PROFILE = 0x29,      // アクティブのプロファイル切り替え（スロット番号だけを保存）
+    CMD_DELETE_PROFILE_SLOT = 0x2A, // スロットのプロファイル削除
 } ble_command_id_t;
 
 typedef enum {
@@ -149,7 +395,11 @@ typedef enum {
 
 /* --- Public Function Prototypes --- */
 
+// 履歴ログの書き出し（履歴ログのライターのタスクで書き出して完了を待つ）
+typedef esp_err_t (*ble_flush_callback_t)(void);
+
 esp_err_t ble_manager_init(void);    // BLEマネージャー初期化
+void ble_manager_set_flush_callback(ble_flush_callback_t callback); // システムリセット前の履歴ログの書き出しを登録
 void ble_host_task(void *param); // BLEホストタスク
 void print_ble_system_info(void); // BLEシステム情報を表示
 void start_advertising(void);   // 広告開始
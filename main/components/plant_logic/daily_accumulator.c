@@ -0,0 +1,217 @@
+#include "daily_accumulator.h"
+#include "data_buffer.h"
+#include <string.h>
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+// プライベート関数の宣言
+static void channel_accumulator_reset(channel_accumulator_t *ch);
+static void channel_accumulator_add(channel_accumulator_t *ch, const minute_record_t *rec);
+static void channel_accumulator_to_summary(const channel_accumulator_t *ch, uint16_t count, daily_summary_data_t *summary);
+#endif
+
+/**
+ * アキュムレータを指定日の空の状態に初期化
+ */
+void daily_accumulator_reset(daily_accumulator_t *acc, uint32_t day_start, uint32_t day_end) {
+    daily_quantiles_t *quantiles = acc->quantiles;
+    stat_summary_t *stats = acc->stats;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    channel_accumulator_t *channels = acc->channels;
+#endif
+    memset(acc, 0, sizeof(daily_accumulator_t));
+    acc->quantiles = quantiles;
+    if (quantiles != NULL) {
+        daily_quantiles_reset(quantiles);
+    }
+    acc->stats = stats;
+    if (stats != NULL) {
+        stat_summary_reset(stats);
+    }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    acc->channels = channels;
+    if (channels != NULL) {
+        channel_accumulator_reset(channels);
+    }
+#endif
+    acc->day_start = day_start;
+    acc->day_end = day_end;
+    acc->temp_min = INT16_MAX;
+    acc->temp_max = INT16_MIN;
+    acc->humidity_min = UINT16_MAX;
+    acc->humidity_max = 0;
+    acc->lux_min = UINT32_MAX;
+    acc->lux_max = 0;
+    acc->soil_min = INT32_MAX;
+    acc->soil_max = INT32_MIN;
+    acc->soil_temp_min = INT16_MAX;
+    acc->soil_temp_max = INT16_MIN;
+}
+
+/**
+ * 1分レコードを積算
+ */
+void daily_accumulator_add(daily_accumulator_t *acc, const minute_record_t *rec) {
+    acc->count++;
+
+    // 気温
+    acc->temp_sum += rec->temperature;
+    if (rec->temperature < acc->temp_min) acc->temp_min = rec->temperature;
+    if (rec->temperature > acc->temp_max) acc->temp_max = rec->temperature;
+
+    // 湿度・照度
+    acc->humidity_sum += rec->humidity;
+    if (rec->humidity < acc->humidity_min) acc->humidity_min = rec->humidity;
+    if (rec->humidity > acc->humidity_max) acc->humidity_max = rec->humidity;
+    uint32_t lux = minute_record_lux_raw(rec->lux);
+    acc->lux_sum += lux;
+    if (lux < acc->lux_min) acc->lux_min = lux;
+    if (lux > acc->lux_max) acc->lux_max = lux;
+
+    // 土壌水分
+    int32_t soil = minute_record_soil_moisture_raw(rec);
+    acc->soil_sum += soil;
+    if (soil < acc->soil_min) acc->soil_min = soil;
+    if (soil > acc->soil_max) acc->soil_max = soil;
+
+    // 土壌温度（代表値）
+    int16_t soil_temp;
+    if (minute_record_soil_temperature_raw(rec, &soil_temp)) {
+        acc->soil_temp_count++;
+        acc->soil_temp_sum += soil_temp;
+        if (soil_temp < acc->soil_temp_min) acc->soil_temp_min = soil_temp;
+        if (soil_temp > acc->soil_temp_max) acc->soil_temp_max = soil_temp;
+    }
+
+    // 分位点
+    if (acc->quantiles != NULL) {
+        daily_quantiles_add(acc->quantiles, rec);
+    }
+
+    // 週・月に結合する要約
+    if (acc->stats != NULL) {
+        stat_summary_add(acc->stats, rec);
+    }
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // チャンネル別
+    if (acc->channels != NULL) {
+        channel_accumulator_add(acc->channels, rec);
+    }
+#endif
+}
+
+/**
+ * アキュムレータから日別サマリーを生成
+ */
+esp_err_t daily_accumulator_to_summary(const daily_accumulator_t *acc, const struct tm *date,
+                                       daily_summary_data_t *summary) {
+    memset(summary, 0, sizeof(daily_summary_data_t));
+    summary->date.tm_year = date->tm_year;
+    summary->date.tm_mon = date->tm_mon;
+    summary->date.tm_mday = date->tm_mday;
+    summary->date.tm_wday = date->tm_wday;
+    summary->date.tm_yday = date->tm_yday;
+    summary->date.tm_isdst = date->tm_isdst;
+
+    if (acc->count == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    float count = (float)acc->count;
+    summary->avg_temperature = acc->temp_sum / count / MINUTE_RECORD_TEMP_SCALE;
+    summary->min_temperature = acc->temp_min / MINUTE_RECORD_TEMP_SCALE;
+    summary->max_temperature = acc->temp_max / MINUTE_RECORD_TEMP_SCALE;
+    summary->avg_humidity = acc->humidity_sum / count / MINUTE_RECORD_HUMIDITY_SCALE;
+    summary->avg_lux = (float)acc->lux_sum / count / MINUTE_RECORD_LUX_SCALE;
+    summary->avg_soil_moisture = acc->soil_sum / count / MINUTE_RECORD_SOIL_SCALE;
+    summary->min_soil_moisture = acc->soil_min / MINUTE_RECORD_SOIL_SCALE;
+    summary->max_soil_moisture = acc->soil_max / MINUTE_RECORD_SOIL_SCALE;
+
+    // 土壌温度の平均は従来どおり全サンプル数で割る（センサー未接続時は0℃付近になる）
+    summary->avg_soil_temperature = acc->soil_temp_sum / count / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    if (acc->soil_temp_count > 0) {
+        summary->min_soil_temperature = acc->soil_temp_min / MINUTE_RECORD_PROBE_TEMP_SCALE;
+        summary->max_soil_temperature = acc->soil_temp_max / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    } else {
+        summary->min_soil_temperature = 999;
+        summary->max_soil_temperature = -999;
+    }
+
+    if (acc->quantiles != NULL) {
+        daily_quantiles_to_summary(acc->quantiles, summary);
+    }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    if (acc->channels != NULL) {
+        channel_accumulator_to_summary(acc->channels, acc->count, summary);
+    }
+#endif
+
+    summary->valid_samples = acc->count;
+    summary->complete = (acc->count >= 1200); // 20時間以上のデータがあれば完全とみなす
+
+    return ESP_OK;
+}
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+// プライベート関数の実装
+
+static void channel_accumulator_reset(channel_accumulator_t *ch) {
+    memset(ch, 0, sizeof(channel_accumulator_t));
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        ch->cap_min[c] = INT16_MAX;
+        ch->cap_max[c] = INT16_MIN;
+    }
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        ch->probe_min[p] = INT16_MAX;
+        ch->probe_max[p] = INT16_MIN;
+    }
+}
+
+/**
+ * 1分レコードの全チャンネルを積算
+ * 土壌温度は有効なセンサー数（先頭から連続）の分だけ積算する
+ */
+static void channel_accumulator_add(channel_accumulator_t *ch, const minute_record_t *rec) {
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        int16_t cap = rec->soil_moisture_capacitance[c];
+        ch->cap_sum[c] += cap;
+        if (cap < ch->cap_min[c]) ch->cap_min[c] = cap;
+        if (cap > ch->cap_max[c]) ch->cap_max[c] = cap;
+    }
+
+    int16_t probe[TMP102_MAX_DEVICES];
+    uint8_t probe_count = minute_record_probe_temperatures_raw(rec, probe);
+    for (int p = 0; p < probe_count; p++) {
+        ch->probe_count[p]++;
+        ch->probe_sum[p] += probe[p];
+        if (probe[p] < ch->probe_min[p]) ch->probe_min[p] = probe[p];
+        if (probe[p] > ch->probe_max[p]) ch->probe_max[p] = probe[p];
+    }
+}
+
+/**
+ * チャンネル別の集計値を日別サマリーに格納
+ * 土壌温度は各センサーの有効サンプルのみで平均する（有効サンプルのないセンサーは min=999 / max=-999）
+ */
+static void channel_accumulator_to_summary(const channel_accumulator_t *ch, uint16_t count, daily_summary_data_t *summary) {
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        summary->min_capacitance[c] = ch->cap_min[c] / MINUTE_RECORD_CAP_SCALE;
+        summary->avg_capacitance[c] = ch->cap_sum[c] / (float)count / MINUTE_RECORD_CAP_SCALE;
+        summary->max_capacitance[c] = ch->cap_max[c] / MINUTE_RECORD_CAP_SCALE;
+    }
+
+    summary->probe_valid_mask = 0;
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        if (ch->probe_count[p] == 0) {
+            summary->min_probe_temperature[p] = 999;
+            summary->avg_probe_temperature[p] = 0;
+            summary->max_probe_temperature[p] = -999;
+            continue;
+        }
+        summary->probe_valid_mask |= (uint8_t)(1u << p);
+        summary->min_probe_temperature[p] = ch->probe_min[p] / MINUTE_RECORD_PROBE_TEMP_SCALE;
+        summary->avg_probe_temperature[p] = ch->probe_sum[p] / (float)ch->probe_count[p] / MINUTE_RECORD_PROBE_TEMP_SCALE;
+        summary->max_probe_temperature[p] = ch->probe_max[p] / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    }
+}
+#endif
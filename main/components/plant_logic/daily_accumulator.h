@@ -0,0 +1,103 @@
+#pragma once
+
+#include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "minute_record.h"
+#include "quantile_sketch.h"
+#include "stat_summary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct daily_summary_data_t;
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * チャンネル別の逐次集計（静電容量 FDC1004 ch1〜4 / 土壌温度 TMP102[0..3]）
+ * 項目ごとにチャンネルを添字とする配列にまとめ、1分レコード1件を1回のループで全チャンネルに積算する
+ */
+typedef struct {
+    int32_t  cap_sum[FDC1004_CHANNEL_COUNT];    // 静電容量合計 [1/2048 pF]
+    int16_t  cap_min[FDC1004_CHANNEL_COUNT];
+    int16_t  cap_max[FDC1004_CHANNEL_COUNT];
+    int32_t  probe_sum[TMP102_MAX_DEVICES];     // 土壌温度合計 [1/16℃]
+    int16_t  probe_min[TMP102_MAX_DEVICES];
+    int16_t  probe_max[TMP102_MAX_DEVICES];
+    uint16_t probe_count[TMP102_MAX_DEVICES];   // 土壌温度の有効サンプル数
+} channel_accumulator_t;
+#endif
+
+/**
+ * 1日分の集計アキュムレータ
+ * パック形式レコードの整数値のまま積算するため、加算順序に依存せず
+ * 逐次更新と全件再計算で同一の結果になる
+ */
+typedef struct {
+    uint32_t day_start;         // 対象日の開始エポック分（ローカル時刻0:00）
+    uint32_t day_end;           // 対象日の終了エポック分（翌日0:00、この値は含まない）
+    uint16_t count;             // サンプル数
+    int32_t  temp_sum;          // 気温合計 [0.01℃]
+    int16_t  temp_min;
+    int16_t  temp_max;
+    int32_t  humidity_sum;      // 湿度合計 [0.01%]
+    uint16_t humidity_min;
+    uint16_t humidity_max;
+    uint64_t lux_sum;           // 照度合計 [0.01lux]
+    uint32_t lux_min;
+    uint32_t lux_max;
+    int32_t  soil_sum;          // 土壌水分合計 [MINUTE_RECORD_SOIL_SCALE]
+    int32_t  soil_min;
+    int32_t  soil_max;
+    uint16_t soil_temp_count;   // 土壌温度の有効サンプル数
+    int32_t  soil_temp_sum;     // 土壌温度合計 [1/16℃]
+    int16_t  soil_temp_min;
+    int16_t  soil_temp_max;
+    daily_quantiles_t *quantiles; // 分位点の推定先（日別のみ、NULL: 推定しない）。resetで初期化されるが付け替えはしない
+    stat_summary_t *stats;        // 週・月に結合する要約の積算先（日別のみ、NULL: 積算しない）。quantilesと同様
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    channel_accumulator_t *channels; // チャンネル別集計の積算先（日別・1時間のみ、NULL: 集計しない）。quantilesと同様
+#endif
+} daily_accumulator_t;
+
+/**
+ * アキュムレータを指定日の空の状態に初期化
+ * 分位点の推定先（quantiles）・結合可能な要約（stats）・チャンネル別集計（channels）が設定されていれば、それも空の状態にする
+ * @param acc 対象アキュムレータ
+ * @param day_start 対象日の開始エポック分
+ * @param day_end 対象日の終了エポック分
+ */
+void daily_accumulator_reset(daily_accumulator_t *acc, uint32_t day_start, uint32_t day_end);
+
+/**
+ * 1分レコードを積算（O(1)）
+ * @param acc 対象アキュムレータ
+ * @param rec 追加するレコード
+ */
+void daily_accumulator_add(daily_accumulator_t *acc, const minute_record_t *rec);
+
+/**
+ * アキュムレータから日別サマリーを生成
+ * @param acc 対象アキュムレータ
+ * @param date サマリーに設定する日付
+ * @param summary 格納先
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no samples
+ */
+esp_err_t daily_accumulator_to_summary(const daily_accumulator_t *acc, const struct tm *date,
+                                       struct daily_summary_data_t *summary);
+
+/**
+ * エポック分がアキュムレータの対象日に含まれるか判定
+ * @param acc 対象アキュムレータ
+ * @param epoch_minute 判定するエポック分
+ * @return true: 対象日に含まれる
+ */
+static inline bool daily_accumulator_contains(const daily_accumulator_t *acc, uint32_t epoch_minute) {
+    return epoch_minute >= acc->day_start && epoch_minute < acc->day_end;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,26 +1,230 @@
 #include "data_buffer.h"
+#include "minute_record.h"
+#include "minute_columns.h"
+#include "daily_accumulator.h"
+#include "rollup_tier.h"
+#include "minute_codec.h"
+#include "history_log.h"
+#include "swinging_door.h"
+#include "seqlock.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_system.h"
+#endif
 #include <string.h>
 #include <math.h>
 #include "../../common_types.h"
 
 static const char *TAG = "DataBuffer";
 
+// 履歴ログのエントリ形式
+typedef struct __attribute__((packed)) {
+    uint32_t epoch_minute;      // エポック分
+    minute_record_t record;     // パック形式の1分データ
+} history_minute_entry_t;
+
+typedef struct {
+    uint32_t day_start;         // 開始エポック分
+    daily_summary_data_t summary;
+    stat_summary_t stats;       // 週・月に結合する要約
+} history_daily_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t key;               // 期間番号（period_key）
+    uint8_t period;             // data_buffer_period_t
+    stat_summary_t stats;       // 確定した期間の要約
+} history_period_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t bucket;            // 区間番号（エポック分 / 区間長）
+    rollup_record_t record;     // 確定した集計レコード
+} history_rollup_entry_t;
+
+// 日別スロットの空き
+#define DAILY_DAY_EMPTY             UINT32_MAX
+
+// 週・月の要約
+#define PERIOD_COUNT                2           // DATA_BUFFER_PERIOD_WEEK / MONTH
+#define PERIOD_CAPACITY             12          // DATA_BUFFER_STATS_WEEKS / MONTHS の大きい方
+#define PERIOD_KEY_EMPTY            UINT32_MAX
+
+_Static_assert(DATA_BUFFER_STATS_WEEKS <= PERIOD_CAPACITY && DATA_BUFFER_STATS_MONTHS <= PERIOD_CAPACITY,
+               "週・月の要約のリングが足りない");
+
+static const uint8_t k_period_capacity[PERIOD_COUNT] = { DATA_BUFFER_STATS_WEEKS, DATA_BUFFER_STATS_MONTHS };
+
+// 期間統計の生値から日別サマリーの単位への換算（quantile_field_t の順）
+static const float k_stat_scale[QUANTILE_FIELD_COUNT] = {
+    MINUTE_RECORD_TEMP_SCALE, MINUTE_RECORD_HUMIDITY_SCALE, MINUTE_RECORD_LUX_SCALE,
+    MINUTE_RECORD_SOIL_SCALE, MINUTE_RECORD_PROBE_TEMP_SCALE
+};
+static const float k_stat_quantiles[DAILY_QUANTILE_COUNT] = { 0.10f, 0.50f, 0.90f };
+
+// 再起動用の退避領域
+#ifdef ESP_PLATFORM
+#define SNAPSHOT_RETAINED           __NOINIT_ATTR   // ソフトウェアリセットでは消えないDRAM（電源投入時は不定）
+#else
+#define SNAPSHOT_RETAINED                           // ホストテスト: data_buffer_init で消去しない静的変数
+#endif
+#define SNAPSHOT_MAGIC              0x534E5031u     // "SNP1"
+#define SNAPSHOT_MINUTES            (DATA_BUFFER_SNAPSHOT_HOURS * 60)
+#define SNAPSHOT_TRIM_MINUTES       30              // ブロックに収まらない場合に先頭から削る分数
+
+typedef struct {
+    uint32_t magic;             // SNAPSHOT_MAGIC（書き込み中・復元済みは0）
+    uint32_t crc32;             // size + block[0..size) のCRC32
+    uint16_t size;              // 圧縮ブロックのバイト数
+    uint8_t block[DATA_BUFFER_SNAPSHOT_SIZE];
+} retained_snapshot_t;
+
+// 集計階層（g_rollup_tiers[tier - DATA_BUFFER_TIER_10MIN]）
+#define ROLLUP_TIER_COUNT           (DATA_BUFFER_TIER_COUNT - DATA_BUFFER_TIER_10MIN)
+
+_Static_assert(MINUTE_COLUMNS_CAPACITY == DATA_BUFFER_MINUTE_CAPACITY, "minute_columns と1分リングのスロット数が一致しない");
+
+static const uint16_t k_tier_bucket_minutes[DATA_BUFFER_TIER_COUNT] = {
+    1, DATA_BUFFER_TIER10_MINUTES, DATA_BUFFER_HOURLY_MINUTES
+};
+static const uint16_t k_tier_capacity[DATA_BUFFER_TIER_COUNT] = {
+    DATA_BUFFER_MINUTE_CAPACITY, DATA_BUFFER_TIER10_CAPACITY, DATA_BUFFER_HOURLY_CAPACITY
+};
+
 // プライベート変数
-static minute_data_t g_minute_buffer[DATA_BUFFER_MINUTES_PER_DAY];
-static daily_summary_data_t g_daily_buffer[DATA_BUFFER_DAYS_PER_MONTH];
-static uint16_t g_minute_write_index = 0;
-static uint8_t g_daily_write_index = 0;
+static minute_columns_t g_minute_columns;  // 1分データ（列形式: フィールドごとの配列 + 時刻キー列 + 有効ビットマップ）
+static daily_summary_data_t g_daily_buffer[DATA_BUFFER_DAYS_PER_MONTH];   // エポック日 % 30 のスロットに格納
+static uint32_t g_daily_epoch_day[DATA_BUFFER_DAYS_PER_MONTH];      // 各スロットのエポック日（DAILY_DAY_EMPTY: 空き）
+static uint32_t g_daily_start_minute[DATA_BUFFER_DAYS_PER_MONTH];   // 各日別データの開始エポック分（履歴ログ・削除判定用）
+static uint32_t g_daily_newest_day = DAILY_DAY_EMPTY;               // 格納済みの最新エポック日
+static rollup_record_t g_tier10_buffer[DATA_BUFFER_TIER10_CAPACITY];  // 10分集計（7日分）
+static rollup_record_t g_hourly_buffer[DATA_BUFFER_HOURLY_CAPACITY];  // 1時間集計（31日分）
+static rollup_tier_t g_rollup_tiers[ROLLUP_TIER_COUNT];
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+static channel_rollup_record_t g_channel_hourly_buffer[DATA_BUFFER_CHANNEL_HOURLY_CAPACITY]; // チャンネル別1時間集計（7日分）
+static channel_rollup_ring_t g_channel_hourly;
+static channel_accumulator_t g_hourly_channels;  // 書き込み中の1時間区間のチャンネル別集計（g_rollup_tiers[1].acc.channels）
+static channel_accumulator_t g_day_channels;     // 書き込み中の日のチャンネル別集計（g_day_acc.channels）
+#endif
+static uint32_t g_latest_epoch_minute = 0; // 格納済みデータの最新エポック分（階層の保持範囲の基準）
+static uint32_t g_last_added_minute = 0;   // 直近に data_buffer_add_minute_data で格納した1件のエポック分（ライタータスクのみ）
+static daily_accumulator_t g_day_acc;     // 書き込み中の日の逐次集計
+static daily_quantiles_t g_day_quantiles; // 書き込み中の日の分位点推定（g_day_acc.quantiles）
+static stat_summary_t g_day_stats;        // 書き込み中の日の結合可能な要約（g_day_acc.stats）
+static stat_summary_t g_stats_days[DATA_BUFFER_STATS_DAYS];   // 日ごとの要約（エポック日 % 32 のスロット）
+static uint32_t g_stats_day_key[DATA_BUFFER_STATS_DAYS];      // 各スロットのエポック日（DAILY_DAY_EMPTY: 空き）
+static stat_summary_t g_period_stats[PERIOD_COUNT][PERIOD_CAPACITY];  // 週・月の要約（期間番号 % 保持数のスロット）
+static uint32_t g_period_key[PERIOD_COUNT][PERIOD_CAPACITY];          // 各スロットの期間番号（PERIOD_KEY_EMPTY: 空き）
+static uint32_t g_stats_closed_day = DAILY_DAY_EMPTY;  // 週・月に結合済みの最新エポック日
+static struct tm g_day_acc_date;          // 書き込み中の日の日付
+static data_buffer_gap_t g_gap_log[DATA_BUFFER_GAP_LOG_SIZE];  // 記録時に検出した欠測（古いものから上書き）
+static uint8_t g_gap_log_next = 0;        // 次に書き込む g_gap_log の位置
+static int64_t g_last_live_us = 0;        // 最後に1分データを記録したesp_timer時刻（0: 起動後未記録）
+static swinging_door_t g_archives[DATA_BUFFER_FIELD_COUNT];   // フィールドごとの間引き記録（g_minute_lock で保護）
+static swinging_door_point_t g_archive_points[DATA_BUFFER_FIELD_COUNT][DATA_BUFFER_ARCHIVE_CAPACITY];
+// 他のタスクから設定された許容誤差（生値）。g_minute_lock のライターはセンサー読み取りタスクだけなので、
+// 記録し直しは次の data_buffer_add_minute_data で行う（値を書いてから g_pending_archive_mask のビットを立てる）
+static int32_t g_pending_deviation[DATA_BUFFER_FIELD_COUNT];
+static uint32_t g_pending_archive_mask = 0;
 static bool g_initialized = false;
 
+// 書き込みは sensor_read_task（data_buffer_add_minute_data）のみ。分析タスク・NimBLEホストタスクからの
+// 読み出しはシーケンスロックで書き込みとの重なりを検出して読み直す（書き込み側は待たない）
+static seqlock_t g_minute_lock;            // 1分リング・最新エポック分
+static seqlock_t g_summary_lock;           // 日別サマリー・10分/1時間集計
+
+// フラッシュ履歴ログ（日別サマリー領域 + 1分データ領域）
+static history_log_t g_minute_log;
+static history_log_t g_daily_log;
+static uint8_t g_minute_page_buf[HISTORY_LOG_PAGE_SIZE];                                     // 書き戻しバッファ
+static uint8_t g_daily_page_buf[HISTORY_LOG_HEADER_SIZE + sizeof(history_daily_entry_t)];   // 1日1ページで即時封印
+static history_log_t g_rollup_logs[ROLLUP_TIER_COUNT];
+static uint8_t g_rollup_page_buf[ROLLUP_TIER_COUNT][HISTORY_LOG_PAGE_SIZE / 4];              // 1/4ページ単位で封印
+static history_log_t g_period_log;
+static uint8_t g_period_page_buf[HISTORY_LOG_PAGE_SIZE / 4];                                 // 1/4ページ単位で封印
+static bool g_period_log_ready = false;    // 週・月の要約ログの復元が済み、追記できる
+static bool g_history_enabled = false;
+static bool g_replaying = false;
+static SNAPSHOT_RETAINED retained_snapshot_t g_snapshot;  // 再起動用の退避（data_buffer_init で消去しない）
+
+/**
+ * 範囲クエリの1分ごとのサンプルの取り出し元
+ */
+typedef struct {
+    bool archive;               // true: 間引き記録から復元, false: 1分リング
+    data_buffer_iter_t it;      // 1分リングの走査位置
+    uint32_t next_minute;       // 間引き記録で次に復元するエポック分
+    uint32_t end_minute;        // 範囲の終了（含まない）
+} query_source_t;
+
 // プライベート関数の宣言
 static esp_err_t calculate_daily_summary(const struct tm *date, daily_summary_data_t *summary);
-static uint16_t get_minute_index_by_time(const struct tm *timestamp);
-static uint8_t get_daily_index_by_date(const struct tm *date);
-static bool is_same_day(const struct tm *tm1, const struct tm *tm2);
-static bool is_same_minute(const struct tm *tm1, const struct tm *tm2);
+static uint32_t tm_to_epoch_day(const struct tm *date);
+static const daily_summary_data_t *find_daily_summary(uint32_t epoch_day);
+static int put_daily_summary(uint32_t epoch_day, uint32_t day_start, const daily_summary_data_t *summary);
+static void init_daily_buffer(void);
 static void copy_tm_date_only(struct tm *dest, const struct tm *src);
 static void copy_tm_full(struct tm *dest, const struct tm *src);
+static uint32_t tm_to_epoch_minute(const struct tm *timestamp);
+static void get_day_epoch_range(const struct tm *date, uint32_t *start_minute, uint32_t *end_minute);
+static inline uint16_t minute_slot(uint32_t epoch_minute);
+static inline uint16_t minute_key(uint32_t epoch_minute);
+static inline uint32_t slot_epoch_minute(uint16_t slot);
+static inline bool slot_holds(uint16_t slot, uint32_t epoch_minute);
+static bool find_minute_record(uint32_t epoch_minute, minute_record_t *rec);
+static bool read_minute_record(uint32_t epoch_minute, minute_record_t *rec);
+static void accumulate_from_buffer(daily_accumulator_t *acc);
+static void update_rollup_tiers(uint32_t epoch_minute, bool evicted, uint32_t evicted_minute);
+static void store_rollup_record(rollup_tier_t *tier, const daily_accumulator_t *acc, bool prefer_sealed);
+static void refold_sealed_bucket(rollup_tier_t *tier, uint32_t bucket);
+static void init_rollup_tiers(void);
+static data_buffer_tier_t select_history_tier(uint32_t start_minute, uint32_t end_minute, uint16_t max_points);
+static void minute_record_to_point(const minute_record_t *rec, history_point_data_t *point);
+static bool store_minute_record(uint32_t epoch_minute, const minute_record_t *rec, const struct tm *datetime);
+static uint8_t classify_gap(uint32_t gap_minutes, int64_t now_us);
+static void log_gap(uint32_t start_minute, uint32_t length, uint8_t reason);
+static void restart_minute_ring(uint32_t epoch_minute);
+static void trim_rollups_after(uint32_t epoch_minute, uint32_t newest_minute);
+static void trim_summaries_after(uint32_t epoch_day);
+static uint8_t find_gap_reason(uint32_t start_minute, uint32_t end_minute);
+static void ring_range(uint32_t latest, uint32_t *first_minute, uint32_t *end_minute);
+static int store_day_summary(void);
+static void restore_from_history(void);
+static void restore_minute_entry(const void *entry, void *ctx);
+static void restore_daily_entry(const void *entry, void *ctx);
+static void restore_rollup_entry(const void *entry, void *ctx);
+static void restore_period_entry(const void *entry, void *ctx);
+static uint16_t encode_snapshot(uint32_t latest);
+static uint32_t snapshot_crc(void);
+static bool snapshot_usable(void);
+static void restore_snapshot(void);
+#ifdef ESP_PLATFORM
+static void snapshot_shutdown_handler(void);
+#endif
+static void init_period_stats(void);
+static void put_day_stats(uint32_t epoch_day, const stat_summary_t *stats);
+static const stat_summary_t *find_day_stats(uint32_t epoch_day);
+static void close_day_stats(uint32_t epoch_day);
+static void rebuild_open_periods(void);
+static uint32_t period_key(uint8_t period, uint32_t epoch_day);
+static uint32_t period_start_day(uint8_t period, uint32_t key);
+static void stats_to_result(const stat_summary_t *stats, uint32_t first_day, data_buffer_period_stats_t *result);
+static bool query_valid(const data_buffer_query_t *query);
+static bool column_field_raw(uint16_t slot, uint8_t field, int32_t *value);
+static bool iter_advance(data_buffer_iter_t *it, uint16_t field_mask, int32_t *values, uint16_t *valid_mask);
+static int16_t query_field_output(uint8_t field, int32_t value);
+static esp_err_t run_query(const data_buffer_query_t *query, bool archive, uint16_t first_row, uint16_t max_rows,
+                           int16_t *columns, uint16_t *rows);
+static void query_source_begin(query_source_t *source, bool archive, const data_buffer_window_t *window);
+static bool query_source_next(query_source_t *source, uint16_t field_mask, uint32_t *epoch_minute,
+                              int32_t *values, uint16_t *valid_mask);
+static float field_raw_scale(uint8_t field);
+static void init_archives(void);
+static void update_archives(uint32_t epoch_minute, uint16_t slot);
+static void apply_pending_archive_errors(void);
+static void query_lttb(const data_buffer_query_t *query, uint8_t field, uint16_t first_row, uint16_t row_count,
+                       uint16_t max_rows, int16_t *columns);
 
 
 /**
@@ -29,25 +233,62 @@ static void copy_tm_full(struct tm *dest, const struct tm *src);
 esp_err_t data_buffer_init(void) {
     ESP_LOGI(TAG, "Initializing data buffer system");
     
-    // 1分データバッファを初期化
-    memset(g_minute_buffer, 0, sizeof(g_minute_buffer));
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        g_minute_buffer[i].valid = false;
+    // 再初期化の場合は未封印のデータを先に書き出す
+    if (g_initialized) {
+        data_buffer_flush();
     }
     
+    // 1分データバッファを初期化
+    seqlock_write_begin(&g_minute_lock);
+    minute_columns_clear(&g_minute_columns);
+    g_latest_epoch_minute = 0;
+    g_last_added_minute = 0;
+    memset(g_gap_log, 0, sizeof(g_gap_log));
+    g_gap_log_next = 0;
+    init_archives();
+    seqlock_write_end(&g_minute_lock);
+    g_last_live_us = 0;
+    
     // 日別データバッファを初期化
-    memset(g_daily_buffer, 0, sizeof(g_daily_buffer));
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        g_daily_buffer[i].complete = false;
-    }
+    init_daily_buffer();
     
-    g_minute_write_index = 0;
-    g_daily_write_index = 0;
+    // 10分/1時間集計を初期化
+    init_rollup_tiers();
+    
+    // 週・月の要約を初期化
+    init_period_stats();
+    g_period_log_ready = false;
+
+    g_day_acc.quantiles = &g_day_quantiles;
+    g_day_acc.stats = &g_day_stats;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    g_day_acc.channels = &g_day_channels;
+#endif
+    daily_accumulator_reset(&g_day_acc, 0, 0);
     g_initialized = true;
     
+    // フラッシュの履歴ログからRAMバッファを復元し、ソフトウェアリセット前の退避で履歴ログより新しい分を補う
+    restore_from_history();
+    restore_snapshot();
+#ifdef ESP_PLATFORM
+    static bool s_shutdown_registered = false;
+    if (!s_shutdown_registered) {
+        s_shutdown_registered = (esp_register_shutdown_handler(snapshot_shutdown_handler) == ESP_OK);
+    }
+#endif
+    
     ESP_LOGI(TAG, "Data buffer system initialized successfully");
-    ESP_LOGI(TAG, "Minute buffer size: %d entries", DATA_BUFFER_MINUTES_PER_DAY);
+    ESP_LOGI(TAG, "Minute buffer size: %d entries (%d bytes/record, %d bytes total, columnar)",
+             DATA_BUFFER_MINUTE_CAPACITY, (int)sizeof(minute_record_t), (int)sizeof(g_minute_columns));
+    ESP_LOGI(TAG, "Rollup tiers: 10min %d entries, hourly %d entries (%d bytes/record, %d bytes total)",
+             DATA_BUFFER_TIER10_CAPACITY, DATA_BUFFER_HOURLY_CAPACITY, (int)sizeof(rollup_record_t),
+             (int)(sizeof(g_tier10_buffer) + sizeof(g_hourly_buffer)));
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    ESP_LOGI(TAG, "Channel rollup: hourly %d entries (%d bytes/record, %d bytes total)",
+             DATA_BUFFER_CHANNEL_HOURLY_CAPACITY, (int)sizeof(channel_rollup_record_t), (int)sizeof(g_channel_hourly_buffer));
+#endif
     ESP_LOGI(TAG, "Daily buffer size: %d entries", DATA_BUFFER_DAYS_PER_MONTH);
+    ESP_LOGI(TAG, "History RAM total: %d bytes", (int)data_buffer_ram_usage());
     
     return ESP_OK;
 }
@@ -66,59 +307,132 @@ esp_err_t data_buffer_add_minute_data(const soil_data_t *sensor_data) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // 現在の書き込み位置にデータを格納
-    minute_data_t *entry = &g_minute_buffer[g_minute_write_index];
-
-    copy_tm_full(&entry->timestamp, &sensor_data->datetime);
-    entry->temperature = sensor_data->temperature;
-    entry->humidity = sensor_data->humidity;
-    entry->lux = sensor_data->lux;
-    entry->soil_moisture = sensor_data->soil_moisture;
+    // 受信データを1分データ形式に変換
+    minute_data_t entry;
+    memset(&entry, 0, sizeof(entry));
+    copy_tm_full(&entry.timestamp, &sensor_data->datetime);
+    entry.temperature = sensor_data->temperature;
+    entry.humidity = sensor_data->humidity;
+    entry.lux = sensor_data->lux;
+    entry.soil_moisture = sensor_data->soil_moisture;
 #if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
     // Rev3/Rev4: TMP102 x4の土壌温度データをコピー
-    entry->soil_temperature_count = sensor_data->soil_temperature_count;
+    entry.soil_temperature_count = sensor_data->soil_temperature_count;
     for (int i = 0; i < TMP102_MAX_DEVICES; i++) {
-        entry->soil_temperature[i] = sensor_data->soil_temperature[i];
+        entry.soil_temperature[i] = sensor_data->soil_temperature[i];
     }
     // FDC1004静電容量データをコピー
     for (int i = 0; i < FDC1004_CHANNEL_COUNT; i++) {
-        entry->soil_moisture_capacitance[i] = sensor_data->soil_moisture_capacitance[i];
+        entry.soil_moisture_capacitance[i] = sensor_data->soil_moisture_capacitance[i];
     }
 #if HARDWARE_VERSION == 40
     // 拡張温度センサー (DS18B20) データをコピー
-    entry->ext_temperature = sensor_data->ext_temperature;
-    entry->ext_temperature_valid = sensor_data->ext_temperature_valid;
+    entry.ext_temperature = sensor_data->ext_temperature;
+    entry.ext_temperature_valid = sensor_data->ext_temperature_valid;
 #endif
 #endif
+    entry.valid = true;
 
-    entry->valid = true;
+    // 設定された許容誤差の記録し直しは、1分リングのライターであるこのタスクで行う
+    apply_pending_archive_errors();
+
+    // タイムスタンプから求めたスロットにパック形式で格納（同じスロットの古いデータは上書き）
+    history_minute_entry_t log_entry;
+    log_entry.epoch_minute = tm_to_epoch_minute(&sensor_data->datetime);
+    minute_record_encode(&entry, minute_key(log_entry.epoch_minute), &log_entry.record);
+    if (!store_minute_record(log_entry.epoch_minute, &log_entry.record, &sensor_data->datetime)) {
+        ESP_LOGW(TAG, "Clock moved back into a closed day (%04d-%02d-%02d %02d:%02d), sample dropped",
+                 sensor_data->datetime.tm_year + 1900, sensor_data->datetime.tm_mon + 1, sensor_data->datetime.tm_mday,
+                 sensor_data->datetime.tm_hour, sensor_data->datetime.tm_min);
+        return ESP_ERR_INVALID_STATE;
+    }
+    g_last_added_minute = log_entry.epoch_minute;
 
 #if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
     ESP_LOGD(TAG, "Added minute data at index %d: temp=%.1f, humidity=%.1f, soil=%.0f, soil_temp_count=%d",
-             g_minute_write_index, entry->temperature, entry->humidity, entry->soil_moisture, entry->soil_temperature_count);
+             minute_slot(log_entry.epoch_minute), entry.temperature, entry.humidity, entry.soil_moisture, entry.soil_temperature_count);
 #else
     ESP_LOGD(TAG, "Added minute data at index %d: temp=%.1f, humidity=%.1f, soil=%.0f, soil_temp1=%.1f, soil_temp2=%.1f",
-             g_minute_write_index, entry->temperature, entry->humidity, entry->soil_moisture, entry->soil_temperature1, entry->soil_temperature2);
+             minute_slot(log_entry.epoch_minute), entry.temperature, entry.humidity, entry.soil_moisture, entry.soil_temperature1, entry.soil_temperature2);
 #endif
 
-    // インデックスを更新（リングバッファ）
-    g_minute_write_index = (g_minute_write_index + 1) % DATA_BUFFER_MINUTES_PER_DAY;
-    
     // 日別サマリーを更新
-    daily_summary_data_t summary;
-    esp_err_t ret = calculate_daily_summary(&sensor_data->datetime, &summary);
-    if (ret == ESP_OK) {
-        // 日別バッファに格納
-        uint8_t daily_index = get_daily_index_by_date(&sensor_data->datetime);
-        if (daily_index < DATA_BUFFER_DAYS_PER_MONTH) {
-            memcpy(&g_daily_buffer[daily_index], &summary, sizeof(daily_summary_data_t));
-            ESP_LOGD(TAG, "Updated daily summary at index %d", daily_index);
+    int daily_index = store_day_summary();
+    if (daily_index >= 0) {
+        ESP_LOGD(TAG, "Updated daily summary at index %d", daily_index);
+    }
+
+    // 履歴ログに追記（フラッシュへの書き込みはページが満杯になった時のみ）
+    if (g_history_enabled) {
+        esp_err_t ret = history_log_append(&g_minute_log, &log_entry);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to append history log: %s", esp_err_to_name(ret));
         }
     }
     
     return ESP_OK;
 }
 
+/**
+ * 直近に格納した1件のエポック分を取得
+ */
+uint32_t data_buffer_get_last_added_minute(void) {
+    return g_last_added_minute;
+}
+
+/**
+ * 未書き込みの1分データを履歴ログに書き出す
+ */
+esp_err_t data_buffer_flush(void) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!g_history_enabled) {
+        return ESP_OK;
+    }
+    esp_err_t ret = history_log_flush(&g_minute_log);
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        esp_err_t tier_ret = history_log_flush(&g_rollup_logs[t]);
+        if (ret == ESP_OK) {
+            ret = tier_ret;
+        }
+    }
+    esp_err_t period_ret = history_log_flush(&g_period_log);
+    if (ret == ESP_OK) {
+        ret = period_ret;
+    }
+    return ret;
+}
+
+/**
+ * 直近の1分データを再起動用に退避
+ */
+esp_err_t data_buffer_save_snapshot(void) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    g_snapshot.magic = 0;
+    uint32_t latest;
+    uint16_t size;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        latest = g_latest_epoch_minute;
+        size = (latest != 0) ? encode_snapshot(latest) : 0;
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    if (size == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    g_snapshot.size = size;
+    g_snapshot.crc32 = snapshot_crc();
+    g_snapshot.magic = SNAPSHOT_MAGIC;
+    ESP_LOGI(TAG, "Snapshot saved: %u bytes in %lld us", size, (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
 /**
  * 指定された時刻の1分データを取得
  */
@@ -127,15 +441,15 @@ esp_err_t data_buffer_get_minute_data(const struct tm *timestamp, minute_data_t
         return ESP_ERR_INVALID_ARG;
     }
     
-    // 全バッファを検索
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid && is_same_minute(timestamp, &g_minute_buffer[i].timestamp)) {
-            memcpy(data, &g_minute_buffer[i], sizeof(minute_data_t));
-            return ESP_OK;
-        }
+    // タイムスタンプからスロットを直接参照
+    uint32_t target_minute = tm_to_epoch_minute(timestamp);
+    minute_record_t rec;
+    if (!read_minute_record(target_minute, &rec)) {
+        return ESP_ERR_NOT_FOUND;
     }
     
-    return ESP_ERR_NOT_FOUND;
+    minute_record_decode(&rec, target_minute, data);
+    return ESP_OK;
 }
 
 /**
@@ -146,15 +460,20 @@ esp_err_t data_buffer_get_daily_summary(const struct tm *date, daily_summary_dat
         return ESP_ERR_INVALID_ARG;
     }
     
-    // 全バッファを検索
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        if (g_daily_buffer[i].complete && is_same_day(date, &g_daily_buffer[i].date)) {
-            memcpy(summary, &g_daily_buffer[i], sizeof(daily_summary_data_t));
-            return ESP_OK;
+    // エポック日からスロットを直接参照
+    uint32_t epoch_day = tm_to_epoch_day(date);
+    bool found;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        const daily_summary_data_t *stored = find_daily_summary(epoch_day);
+        found = (stored != NULL && stored->complete);
+        if (found) {
+            memcpy(summary, stored, sizeof(daily_summary_data_t));
         }
-    }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
     
-    return ESP_ERR_NOT_FOUND;
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 /**
@@ -165,12 +484,19 @@ esp_err_t data_buffer_get_latest_minute_data(minute_data_t *data) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // 最新のデータは前のインデックス
-    uint16_t latest_index = (g_minute_write_index == 0) ? 
-                           (DATA_BUFFER_MINUTES_PER_DAY - 1) : (g_minute_write_index - 1);
-    
-    if (g_minute_buffer[latest_index].valid) {
-        memcpy(data, &g_minute_buffer[latest_index], sizeof(minute_data_t));
+    // 最新のデータは最新のエポック分のスロット（24時間以内に遡って書き直した分は最新としない）
+    minute_record_t latest;
+    uint32_t latest_minute;
+    bool found;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        latest_minute = g_latest_epoch_minute;
+        found = (latest_minute != 0) && find_minute_record(latest_minute, &latest);
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    
+    if (found) {
+        minute_record_decode(&latest, latest_minute, data);
         return ESP_OK;
     }
     
@@ -185,26 +511,8 @@ esp_err_t data_buffer_get_latest_daily_summary(daily_summary_data_t *summary) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // 最新の完全な日別データを検索
-    time_t latest_time = 0;
-    int latest_index = -1;
-    
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        if (g_daily_buffer[i].complete) {
-            time_t current_time = mktime((struct tm*)&g_daily_buffer[i].date);
-            if (current_time > latest_time) {
-                latest_time = current_time;
-                latest_index = i;
-            }
-        }
-    }
-    
-    if (latest_index >= 0) {
-        memcpy(summary, &g_daily_buffer[latest_index], sizeof(daily_summary_data_t));
-        return ESP_OK;
-    }
-    
-    return ESP_ERR_NOT_FOUND;
+    // 最新日から遡って最初の完全な日別データ
+    return data_buffer_get_recent_daily_summary(0, summary);
 }
 
 /**
@@ -221,40 +529,124 @@ esp_err_t data_buffer_get_recent_daily_summaries(uint8_t days,
         days = DATA_BUFFER_DAYS_PER_MONTH;
     }
     
-    // 有効な日別データを時系列順に収集
-    daily_summary_data_t temp_buffer[DATA_BUFFER_DAYS_PER_MONTH];
-    uint8_t valid_count = 0;
-    
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        if (g_daily_buffer[i].complete) {
-            memcpy(&temp_buffer[valid_count], &g_daily_buffer[i], sizeof(daily_summary_data_t));
-            valid_count++;
+    // 最新日から遡ってN日分の完全なデータの開始日を求め（最大30スロット）、古い順にコピーする
+    uint8_t result_count;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        uint32_t newest = g_daily_newest_day;
+        uint32_t first_day = newest;
+        result_count = 0;
+        for (uint32_t n = 0; n < DATA_BUFFER_DAYS_PER_MONTH && n <= newest && result_count < days; n++) {
+            const daily_summary_data_t *found = find_daily_summary(newest - n);
+            if (found != NULL && found->complete) {
+                first_day = newest - n;
+                result_count++;
+            }
         }
-    }
-    
-    // 日付でソート（バブルソート - データ量が少ないため）
-    for (int i = 0; i < valid_count - 1; i++) {
-        for (int j = 0; j < valid_count - i - 1; j++) {
-            if (data_buffer_compare_date(&temp_buffer[j].date, &temp_buffer[j+1].date) > 0) {
-                daily_summary_data_t temp;
-                memcpy(&temp, &temp_buffer[j], sizeof(daily_summary_data_t));
-                memcpy(&temp_buffer[j], &temp_buffer[j+1], sizeof(daily_summary_data_t));
-                memcpy(&temp_buffer[j+1], &temp, sizeof(daily_summary_data_t));
+        
+        uint8_t copied = 0;
+        for (uint32_t day = first_day; day <= newest && copied < result_count; day++) {
+            const daily_summary_data_t *found = find_daily_summary(day);
+            if (found != NULL && found->complete) {
+                memcpy(&summaries[copied++], found, sizeof(daily_summary_data_t));
             }
         }
-    }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
     
-    // 最新のN日分を取得
-    uint8_t start_index = (valid_count > days) ? (valid_count - days) : 0;
-    uint8_t result_count = valid_count - start_index;
+    *count = result_count;
+    ESP_LOGD(TAG, "Retrieved %d daily summaries out of %d requested", result_count, days);
     
-    for (uint8_t i = 0; i < result_count; i++) {
-        memcpy(&summaries[i], &temp_buffer[start_index + i], sizeof(daily_summary_data_t));
+    return ESP_OK;
+}
+
+/**
+ * 新しい方からN番目の日別サマリーデータを取得
+ */
+esp_err_t data_buffer_get_recent_daily_summary(uint8_t index, daily_summary_data_t *summary) {
+    if (!g_initialized || summary == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
     
-    *count = result_count;
-    ESP_LOGD(TAG, "Retrieved %d daily summaries out of %d requested", result_count, days);
+    bool found_index;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        uint32_t newest = g_daily_newest_day;
+        uint8_t seen = 0;
+        found_index = false;
+        for (uint32_t n = 0; n < DATA_BUFFER_DAYS_PER_MONTH && n <= newest && !found_index; n++) {
+            const daily_summary_data_t *found = find_daily_summary(newest - n);
+            if (found != NULL && found->complete && seen++ == index) {
+                memcpy(summary, found, sizeof(daily_summary_data_t));
+                found_index = true;
+            }
+        }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
     
+    return found_index ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * 指定日を含む週または月の統計を取得
+ */
+esp_err_t data_buffer_get_period_stats(data_buffer_period_t period, const struct tm *date,
+                                       data_buffer_period_stats_t *stats) {
+    if (!g_initialized || date == NULL || stats == NULL || period >= PERIOD_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t key = period_key(period, tm_to_epoch_day(date));
+    uint8_t slot = key % k_period_capacity[period];
+    stat_summary_t merged;
+    bool found;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        found = (g_period_key[period][slot] == key);
+        if (found) {
+            memcpy(&merged, &g_period_stats[period][slot], sizeof(stat_summary_t));
+        }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
+
+    if (!found || merged.days == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    stats_to_result(&merged, period_start_day(period, key), stats);
+    return ESP_OK;
+}
+
+/**
+ * 任意の日の範囲の要約を結合した統計を取得
+ */
+esp_err_t data_buffer_merge_days(const struct tm *first_date, const struct tm *last_date,
+                                 data_buffer_period_stats_t *stats) {
+    if (!g_initialized || first_date == NULL || last_date == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t first_day = tm_to_epoch_day(first_date);
+    uint32_t last_day = tm_to_epoch_day(last_date);
+    if (last_day < first_day || last_day - first_day >= DATA_BUFFER_MERGE_MAX_DAYS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stat_summary_t merged;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        stat_summary_reset(&merged);
+        for (uint32_t day = first_day; day <= last_day; day++) {
+            const stat_summary_t *day_stats = find_day_stats(day);
+            if (day_stats != NULL) {
+                stat_summary_merge(&merged, day_stats);
+            }
+        }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
+
+    if (merged.days == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    stats_to_result(&merged, first_day, stats);
     return ESP_OK;
 }
 
@@ -268,34 +660,180 @@ esp_err_t data_buffer_get_recent_minute_data(uint8_t hours,
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (hours > 24) {
-        hours = 24;
+    if (hours > DATA_BUFFER_MINUTE_CAPACITY / 60) {
+        hours = DATA_BUFFER_MINUTE_CAPACITY / 60;
     }
     
     uint16_t max_entries = hours * 60;
     uint16_t result_count = 0;
     
-    // 現在時刻から過去に向かって検索
-    time_t now;
-    time(&now);
-    time_t cutoff_time = now - (hours * 3600);
+    // 現在時刻から過去N時間のデータを古い順に展開
+    data_buffer_window_t window = data_buffer_window_recent(max_entries);
+    data_buffer_iter_t it;
+    data_buffer_iter_begin(&it, &window);
+    while (result_count < max_entries && data_buffer_iter_next(&it)) {
+        data_buffer_iter_decode(&it, &data[result_count]);
+        result_count++;
+    }
     
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid) {
-            time_t data_time = mktime((struct tm*)&g_minute_buffer[i].timestamp);
-            if (data_time >= cutoff_time && result_count < max_entries) {
-                memcpy(&data[result_count], &g_minute_buffer[i], sizeof(minute_data_t));
-                result_count++;
+    *count = result_count;
+    ESP_LOGD(TAG, "Retrieved %d minute data entries for past %d hours", result_count, hours);
+    
+    return ESP_OK;
+}
+
+/**
+ * 指定期間の履歴データを取得
+ */
+esp_err_t data_buffer_get_history(const struct tm *start, const struct tm *end,
+                                  history_point_data_t *points, uint16_t max_points,
+                                  uint16_t *count, data_buffer_tier_t *tier) {
+    if (!g_initialized || start == NULL || end == NULL || points == NULL || count == NULL || max_points == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint32_t start_minute = tm_to_epoch_minute(start);
+    uint32_t end_minute = tm_to_epoch_minute(end);
+    if (end_minute <= start_minute) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    data_buffer_tier_t selected = select_history_tier(start_minute, end_minute, max_points);
+    uint16_t bucket_minutes = k_tier_bucket_minutes[selected];
+    
+    // 階層の保持範囲 [oldest, latest] に絞って区間を直接参照
+    uint32_t latest_bucket = g_latest_epoch_minute / bucket_minutes;
+    uint32_t oldest_bucket = (latest_bucket >= k_tier_capacity[selected]) ? latest_bucket - k_tier_capacity[selected] + 1 : 0;
+    uint32_t first_bucket = start_minute / bucket_minutes;
+    uint32_t last_bucket = (end_minute - 1) / bucket_minutes;
+    if (first_bucket < oldest_bucket) first_bucket = oldest_bucket;
+    if (last_bucket > latest_bucket) last_bucket = latest_bucket;
+    
+    uint16_t result_count = 0;
+    for (uint32_t bucket = first_bucket; bucket <= last_bucket && result_count < max_points; bucket++) {
+        history_point_data_t *point = &points[result_count];
+        if (selected == DATA_BUFFER_TIER_MINUTE) {
+            minute_record_t rec;
+            if (!read_minute_record(bucket, &rec)) {
+                continue;
+            }
+            minute_record_to_point(&rec, point);
+        } else {
+            rollup_record_t rec;
+            bool found;
+            uint32_t attempts = 0, seq;
+            do {
+                seq = seqlock_read_begin(&g_summary_lock);
+                const rollup_record_t *stored = rollup_tier_find(&g_rollup_tiers[selected - DATA_BUFFER_TIER_10MIN], bucket);
+                found = (stored != NULL);
+                if (found) {
+                    memcpy(&rec, stored, sizeof(rollup_record_t));
+                }
+            } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
+            if (!found) {
+                continue;
             }
+            rollup_record_decode(&rec, point);
         }
+        time_t t = (time_t)bucket * bucket_minutes * 60;
+        localtime_r(&t, &point->timestamp);
+        result_count++;
     }
     
     *count = result_count;
-    ESP_LOGD(TAG, "Retrieved %d minute data entries for past %d hours", result_count, hours);
+    if (tier != NULL) {
+        *tier = selected;
+    }
+    ESP_LOGD(TAG, "Retrieved %d history points from tier %d", result_count, selected);
     
     return ESP_OK;
 }
 
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * 指定期間のチャンネル別1時間集計を取得
+ */
+esp_err_t data_buffer_get_channel_history(const struct tm *start, const struct tm *end,
+                                          channel_point_data_t *points, uint16_t max_points,
+                                          uint16_t *count) {
+    if (!g_initialized || start == NULL || end == NULL || points == NULL || count == NULL || max_points == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t start_minute = tm_to_epoch_minute(start);
+    uint32_t end_minute = tm_to_epoch_minute(end);
+    if (end_minute <= start_minute) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // リングの保持範囲 [oldest, latest] に絞って区間を直接参照
+    uint32_t latest_bucket = g_latest_epoch_minute / DATA_BUFFER_HOURLY_MINUTES;
+    uint32_t oldest_bucket = (latest_bucket >= DATA_BUFFER_CHANNEL_HOURLY_CAPACITY) ?
+                             latest_bucket - DATA_BUFFER_CHANNEL_HOURLY_CAPACITY + 1 : 0;
+    uint32_t first_bucket = start_minute / DATA_BUFFER_HOURLY_MINUTES;
+    uint32_t last_bucket = (end_minute - 1) / DATA_BUFFER_HOURLY_MINUTES;
+    if (first_bucket < oldest_bucket) first_bucket = oldest_bucket;
+    if (last_bucket > latest_bucket) last_bucket = latest_bucket;
+
+    uint16_t result_count = 0;
+    for (uint32_t bucket = first_bucket; bucket <= last_bucket && result_count < max_points; bucket++) {
+        channel_rollup_record_t rec;
+        bool found;
+        uint32_t attempts = 0, seq;
+        do {
+            seq = seqlock_read_begin(&g_summary_lock);
+            const channel_rollup_record_t *stored = channel_rollup_find(&g_channel_hourly, bucket);
+            found = (stored != NULL);
+            if (found) {
+                memcpy(&rec, stored, sizeof(channel_rollup_record_t));
+            }
+        } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
+        if (!found) {
+            continue;
+        }
+
+        channel_point_data_t *point = &points[result_count];
+        channel_rollup_record_decode(&rec, point);
+        time_t t = (time_t)bucket * DATA_BUFFER_HOURLY_MINUTES * 60;
+        localtime_r(&t, &point->timestamp);
+        result_count++;
+    }
+
+    *count = result_count;
+    ESP_LOGD(TAG, "Retrieved %d channel history points", result_count);
+
+    return ESP_OK;
+}
+#endif
+
+/**
+ * 指定時刻以降の1分データを圧縮ブロックにエンコード
+ */
+esp_err_t data_buffer_encode_minute_block(const struct tm *start, uint8_t *buf, uint16_t capacity,
+                                          uint16_t *length, uint16_t *count) {
+    if (!g_initialized || start == NULL || buf == NULL || length == NULL || count == NULL ||
+        capacity <= MINUTE_CODEC_HEADER_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // 開始時刻以降を古い順に走査（リングの保持範囲外はイテレータが読み飛ばす）
+    data_buffer_window_t window = { tm_to_epoch_minute(start), UINT32_MAX };
+    data_buffer_iter_t it;
+    data_buffer_iter_begin(&it, &window);
+    
+    minute_codec_encoder_t enc;
+    minute_codec_encoder_init(&enc, buf, capacity);
+    while (data_buffer_iter_next(&it)) {
+        if (minute_codec_encoder_add(&enc, it.epoch_minute, &it.record) != ESP_OK) {
+            break;
+        }
+    }
+    
+    *count = enc.count;
+    *length = minute_codec_encoder_finish(&enc);
+    return (enc.count > 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
 /**
  * データバッファの統計情報を取得
  */
@@ -306,46 +844,87 @@ esp_err_t data_buffer_get_stats(data_buffer_stats_t *stats) {
     
     memset(stats, 0, sizeof(data_buffer_stats_t));
     
-    time_t oldest_minute = 0, newest_minute = 0;
-    time_t oldest_daily = 0, newest_daily = 0;
-    
-    // 1分データの統計
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid) {
-            stats->minute_data_count++;
-            time_t data_time = mktime((struct tm*)&g_minute_buffer[i].timestamp);
-            
-            if (oldest_minute == 0 || data_time < oldest_minute) {
-                oldest_minute = data_time;
-                copy_tm_full(&stats->oldest_minute_data, &g_minute_buffer[i].timestamp);
-            }
-            if (newest_minute == 0 || data_time > newest_minute) {
-                newest_minute = data_time;
-                copy_tm_full(&stats->newest_minute_data, &g_minute_buffer[i].timestamp);
-            }
-        }
+    uint32_t oldest_minute, newest_minute;
+    uint16_t minute_count;
+    uint32_t attempts = 0, seq;
+    
+    // 1分データの統計（有効ビットが立つのは最新データまでの24時間のみなので、件数はpopcount、
+    // 最古は保持範囲の先頭から空きが続く分を飛ばした位置）
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        uint32_t first_minute, end_minute;
+        newest_minute = g_latest_epoch_minute;
+        ring_range(newest_minute, &first_minute, &end_minute);
+        minute_count = minute_columns_count(&g_minute_columns);
+        oldest_minute = first_minute + minute_columns_run_length(&g_minute_columns, minute_slot(first_minute),
+                                                                 (uint16_t)(end_minute - first_minute), false);
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    stats->minute_data_count = minute_count;
+    if (stats->minute_data_count > 0) {
+        time_t oldest_time = (time_t)oldest_minute * 60;
+        time_t newest_time = (time_t)newest_minute * 60;
+        localtime_r(&oldest_time, &stats->oldest_minute_data);
+        localtime_r(&newest_time, &stats->newest_minute_data);
     }
     
-    // 日別データの統計
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        if (g_daily_buffer[i].complete) {
-            stats->daily_data_count++;
-            time_t data_time = mktime((struct tm*)&g_daily_buffer[i].date);
-            
-            if (oldest_daily == 0 || data_time < oldest_daily) {
-                oldest_daily = data_time;
-                copy_tm_date_only(&stats->oldest_daily_data, &g_daily_buffer[i].date);
+    // 日別データの統計（保持範囲を古い順に走査）
+    attempts = 0;
+    do {
+        seq = seqlock_read_begin(&g_summary_lock);
+        uint32_t newest = g_daily_newest_day;
+        stats->daily_data_count = 0;
+        for (uint32_t n = DATA_BUFFER_DAYS_PER_MONTH; n-- > 0;) {
+            if (n > newest) {
+                continue;
             }
-            if (newest_daily == 0 || data_time > newest_daily) {
-                newest_daily = data_time;
-                copy_tm_date_only(&stats->newest_daily_data, &g_daily_buffer[i].date);
+            const daily_summary_data_t *found = find_daily_summary(newest - n);
+            if (found != NULL && found->complete) {
+                if (stats->daily_data_count == 0) {
+                    copy_tm_date_only(&stats->oldest_daily_data, &found->date);
+                }
+                copy_tm_date_only(&stats->newest_daily_data, &found->date);
+                stats->daily_data_count++;
             }
         }
-    }
+    } while (seqlock_read_retry(&g_summary_lock, seq, &attempts));
     
     return ESP_OK;
 }
 
+/**
+ * 履歴データが使用する静的RAMの合計
+ */
+size_t data_buffer_ram_usage(void) {
+    size_t total = 0;
+
+    // 1分リング・日別データ・集計階層
+    total += sizeof(g_minute_columns) + sizeof(g_latest_epoch_minute);
+    total += sizeof(g_daily_buffer) + sizeof(g_daily_epoch_day) + sizeof(g_daily_start_minute) + sizeof(g_daily_newest_day);
+    total += sizeof(g_tier10_buffer) + sizeof(g_hourly_buffer) + sizeof(g_rollup_tiers);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    total += sizeof(g_channel_hourly_buffer) + sizeof(g_channel_hourly) + sizeof(g_hourly_channels) + sizeof(g_day_channels);
+#endif
+
+    // 書き込み中の日・週・月の要約
+    total += sizeof(g_day_acc) + sizeof(g_day_quantiles) + sizeof(g_day_stats) + sizeof(g_day_acc_date);
+    total += sizeof(g_stats_days) + sizeof(g_stats_day_key) + sizeof(g_stats_closed_day);
+    total += sizeof(g_period_stats) + sizeof(g_period_key);
+
+    // 欠測記録・間引き記録
+    total += sizeof(g_gap_log) + sizeof(g_gap_log_next) + sizeof(g_last_live_us);
+    total += sizeof(g_archives) + sizeof(g_archive_points) + sizeof(g_pending_deviation) + sizeof(g_pending_archive_mask);
+
+    // 履歴ログ・再起動用の退避
+    total += sizeof(g_minute_log) + sizeof(g_minute_page_buf) + sizeof(g_daily_log) + sizeof(g_daily_page_buf);
+    total += sizeof(g_rollup_logs) + sizeof(g_rollup_page_buf) + sizeof(g_period_log) + sizeof(g_period_page_buf);
+    total += sizeof(g_snapshot);
+
+    // 状態フラグ・シーケンスロック
+    total += sizeof(g_initialized) + sizeof(g_period_log_ready) + sizeof(g_history_enabled) + sizeof(g_replaying);
+    total += sizeof(g_minute_lock) + sizeof(g_summary_lock);
+    return total;
+}
+
 /**
  * 現在のバッファ使用状況をログ出力
  */
@@ -356,13 +935,16 @@ void data_buffer_print_status(void) {
     }
     
     data_buffer_stats_t stats;
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
     if (data_buffer_get_stats(&stats) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get buffer stats");
         return;
     }
+    uint32_t stats_cycles = esp_cpu_get_cycle_count() - start_cycles;
     
     ESP_LOGI(TAG, "=== Data Buffer Status ===");
-    ESP_LOGI(TAG, "Minute data: %d/%d entries", stats.minute_data_count, DATA_BUFFER_MINUTES_PER_DAY);
+    ESP_LOGI(TAG, "get_stats: %lu cycles", (unsigned long)stats_cycles);
+    ESP_LOGI(TAG, "Minute data: %d/%d entries", stats.minute_data_count, DATA_BUFFER_MINUTE_CAPACITY);
     ESP_LOGI(TAG, "Daily data: %d/%d entries", stats.daily_data_count, DATA_BUFFER_DAYS_PER_MONTH);
     
     if (stats.minute_data_count > 0) {
@@ -390,165 +972,1710 @@ static esp_err_t calculate_daily_summary(const struct tm *date, daily_summary_da
         return ESP_ERR_INVALID_ARG;
     }
     
-    memset(summary, 0, sizeof(daily_summary_data_t));
-    copy_tm_date_only(&summary->date, date);
+    // 対象日のエポック分範囲 [start, end) の1分データを全件集計
+    uint32_t day_start, day_end;
+    get_day_epoch_range(date, &day_start, &day_end);
 
-    float temp_sum = 0, humidity_sum = 0, lux_sum = 0, soil_sum = 0, soil_temp_sum = 0;
-    float min_temp = 999, max_temp = -999;
-    float min_soil = 999999, max_soil = -999999;
-    float min_soil_temp = 999, max_soil_temp = -999;
-    uint16_t count = 0;
+    daily_accumulator_t acc;
+    daily_quantiles_t quantiles;
+    acc.quantiles = &quantiles;
+    acc.stats = NULL;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    channel_accumulator_t channels;
+    acc.channels = &channels;
+#endif
+    daily_accumulator_reset(&acc, day_start, day_end);
+    accumulate_from_buffer(&acc);
 
-    // 指定された日の1分データを集計
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid && is_same_day(date, &g_minute_buffer[i].timestamp)) {
-            count++;
+    esp_err_t ret = daily_accumulator_to_summary(&acc, date, summary);
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Daily summary calculated: samples=%d, avg_temp=%.1f, avg_soil=%.0f, avg_soil_temp=%.1f",
+                 summary->valid_samples, summary->avg_temperature, summary->avg_soil_moisture, summary->avg_soil_temperature);
+    }
+    return ret;
+}
 
-            // 温度
-            temp_sum += g_minute_buffer[i].temperature;
-            if (g_minute_buffer[i].temperature < min_temp) min_temp = g_minute_buffer[i].temperature;
-            if (g_minute_buffer[i].temperature > max_temp) max_temp = g_minute_buffer[i].temperature;
+/**
+ * アキュムレータの対象範囲に含まれる1分データをバッファから積算
+ * 範囲内の各エポック分のスロットを直接参照する（10分集計は10回、日別は1440回）
+ */
+static void accumulate_from_buffer(daily_accumulator_t *acc) {
+    for (uint32_t epoch_minute = acc->day_start; epoch_minute < acc->day_end; epoch_minute++) {
+        minute_record_t rec;
+        if (find_minute_record(epoch_minute, &rec)) {
+            daily_accumulator_add(acc, &rec);
+        }
+    }
+}
 
-            // その他
-            humidity_sum += g_minute_buffer[i].humidity;
-            lux_sum += g_minute_buffer[i].lux;
-            soil_sum += g_minute_buffer[i].soil_moisture;
+/**
+ * 1分レコードをスロットに格納し、書き込み中の日の集計を更新
+ * @param datetime レコードの時刻（NULLの場合はエポック分から変換）
+ * @return false: 確定済みの日に入るため格納しなかった
+ */
+static bool store_minute_record(uint32_t epoch_minute, const minute_record_t *rec, const struct tm *datetime) {
+    if (g_latest_epoch_minute >= DATA_BUFFER_MINUTE_CAPACITY &&
+        epoch_minute <= g_latest_epoch_minute - DATA_BUFFER_MINUTE_CAPACITY) {
+        // 最新データより24時間以上前に戻った場合は時計の巻き戻しとみなす（時刻同期前の不正なRTCなどで最新データが未来に進んでいた）。
+        // 最新データは増える一方で再起動後も復元されるため、捨てると実時刻が追いつくまで記録が止まる
+        restart_minute_ring(epoch_minute);
+    } else if (g_day_acc.count > 0 && epoch_minute < g_day_acc.day_start) {
+        // 24時間以内の巻き戻しで日付をまたいだ（0:05 → 23:58 など）サンプルは、確定済みの前日に入るので捨てる。
+        // 書き込み中の日を切り替えると当日を途中で確定し、日別ログの重複と週・月の要約への二重の結合になる。
+        // その分は巻き戻し前に記録済みで、1分リングにも残っている
+        return false;
+    }
 
-            // 土壌水分
-            if (g_minute_buffer[i].soil_moisture < min_soil) min_soil = g_minute_buffer[i].soil_moisture;
-            if (g_minute_buffer[i].soil_moisture > max_soil) max_soil = g_minute_buffer[i].soil_moisture;
+    // 最新データより後の分が空いた場合は、間のスロット（24時間以上前のデータ）を空きにする。
+    // 有効ビットが立つのは常に最新データまでの24時間だけとなり、件数と欠測はビットマップから求まる
+    uint32_t skipped = 0;
+    if (g_latest_epoch_minute != 0 && epoch_minute > g_latest_epoch_minute + 1) {
+        skipped = epoch_minute - g_latest_epoch_minute - 1;
+    }
+    int64_t now_us = esp_timer_get_time();
+    uint8_t reason = (skipped > 0 && !g_replaying) ? classify_gap(skipped, now_us) : DATA_BUFFER_GAP_UNKNOWN;
 
-            // 土壌温度
-#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
-            // Rev3/Rev4: TMP102の最初のセンサーを代表値として使用
-            if (g_minute_buffer[i].soil_temperature_count > 0) {
-                soil_temp_sum += g_minute_buffer[i].soil_temperature[0];
-                if (g_minute_buffer[i].soil_temperature[0] < min_soil_temp) min_soil_temp = g_minute_buffer[i].soil_temperature[0];
-                if (g_minute_buffer[i].soil_temperature[0] > max_soil_temp) max_soil_temp = g_minute_buffer[i].soil_temperature[0];
-            }
-#else
-            soil_temp_sum += g_minute_buffer[i].soil_temperature1;
-            if (g_minute_buffer[i].soil_temperature1 < min_soil_temp) min_soil_temp = g_minute_buffer[i].soil_temperature1;
-            if (g_minute_buffer[i].soil_temperature1 > max_soil_temp) max_soil_temp = g_minute_buffer[i].soil_temperature1;
-#endif
+    uint16_t slot = minute_slot(epoch_minute);
+    bool evicted = minute_columns_is_valid(&g_minute_columns, slot);
+    uint32_t evicted_minute = evicted ? slot_epoch_minute(slot) : 0;
+    bool evicts_from_day = evicted && daily_accumulator_contains(&g_day_acc, evicted_minute);
+    minute_record_t stored;
+    memcpy(&stored, rec, sizeof(minute_record_t));
+    stored.minute_key = minute_key(epoch_minute);
+    seqlock_write_begin(&g_minute_lock);
+    if (skipped > 0) {
+        uint16_t erase_count = (skipped < DATA_BUFFER_MINUTE_CAPACITY) ? (uint16_t)skipped : DATA_BUFFER_MINUTE_CAPACITY;
+        minute_columns_erase_range(&g_minute_columns, minute_slot(g_latest_epoch_minute + 1), erase_count);
+        if (!g_replaying) {
+            log_gap(g_latest_epoch_minute + 1, skipped, reason);
         }
     }
+    minute_columns_put(&g_minute_columns, slot, &stored);
+    if (epoch_minute > g_latest_epoch_minute) {
+        update_archives(epoch_minute, slot);
+        g_latest_epoch_minute = epoch_minute;
+    }
+    seqlock_write_end(&g_minute_lock);
+    if (!g_replaying) {
+        g_last_live_us = now_us;
+    }
 
-    if (count > 0) {
-        summary->avg_temperature = temp_sum / count;
-        summary->min_temperature = min_temp;
-        summary->max_temperature = max_temp;
-        summary->avg_humidity = humidity_sum / count;
-        summary->avg_lux = lux_sum / count;
-        summary->avg_soil_moisture = soil_sum / count;
-        summary->min_soil_moisture = min_soil;
-        summary->max_soil_moisture = max_soil;
-        summary->avg_soil_temperature = soil_temp_sum / count;
-        summary->min_soil_temperature = min_soil_temp;
-        summary->max_soil_temperature = max_soil_temp;
-        summary->valid_samples = count;
-        summary->complete = (count >= 1200); // 20時間以上のデータがあれば完全とみなす
+    // 通常は O(1) の逐次積算。日付が変わった場合と、同じ日のサンプルが上書きされた場合のみ再集計する
+    if (!daily_accumulator_contains(&g_day_acc, epoch_minute)) {
+        // 前日の集計を確定し、履歴ログに記録
+        if (g_day_acc.count > 0) {
+            int daily_index = store_day_summary();
+            if (daily_index >= 0) {
+                close_day_stats(g_daily_epoch_day[daily_index]);
+            }
+            if (daily_index >= 0 && g_history_enabled && !g_replaying) {
+                history_daily_entry_t daily_entry;
+                daily_entry.day_start = g_daily_start_minute[daily_index];
+                memcpy(&daily_entry.summary, &g_daily_buffer[daily_index], sizeof(daily_summary_data_t));
+                const stat_summary_t *day_stats = find_day_stats(g_daily_epoch_day[daily_index]);
+                if (day_stats != NULL) {
+                    memcpy(&daily_entry.stats, day_stats, sizeof(stat_summary_t));
+                } else {
+                    stat_summary_reset(&daily_entry.stats);
+                }
+                if (history_log_append(&g_daily_log, &daily_entry) != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to append daily history");
+                }
+            }
+        }
 
-        ESP_LOGD(TAG, "Daily summary calculated: samples=%d, avg_temp=%.1f, avg_soil=%.0f, avg_soil_temp=%.1f",
-                 count, summary->avg_temperature, summary->avg_soil_moisture, summary->avg_soil_temperature);
+        struct tm local;
+        if (datetime == NULL) {
+            time_t t = (time_t)epoch_minute * 60;
+            localtime_r(&t, &local);
+            datetime = &local;
+        }
+        copy_tm_date_only(&g_day_acc_date, datetime);
 
-        return ESP_OK;
+        uint32_t day_start, day_end;
+        get_day_epoch_range(datetime, &day_start, &day_end);
+        daily_accumulator_reset(&g_day_acc, day_start, day_end);
+        accumulate_from_buffer(&g_day_acc);
+    } else if (evicts_from_day) {
+        daily_accumulator_reset(&g_day_acc, g_day_acc.day_start, g_day_acc.day_end);
+        accumulate_from_buffer(&g_day_acc);
+    } else {
+        daily_accumulator_add(&g_day_acc, &stored);
     }
-    
-    return ESP_ERR_NOT_FOUND;
+
+    update_rollup_tiers(epoch_minute, evicted, evicted_minute);
+    return true;
 }
 
 /**
- * 時刻比較ユーティリティ関数
+ * 間引き記録を空にする（許容誤差の設定は残す。g_minute_lock の書き込み区間内で呼び出す）
  */
-int data_buffer_compare_time(const struct tm *tm1, const struct tm *tm2) {
-    if (tm1 == NULL || tm2 == NULL) return 0;
-    
-    time_t time1 = mktime((struct tm*)tm1);
-    time_t time2 = mktime((struct tm*)tm2);
-    
-    if (time1 < time2) return -1;
-    if (time1 > time2) return 1;
-    return 0;
+static void init_archives(void) {
+    for (int f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+        swinging_door_init(&g_archives[f], g_archive_points[f], DATA_BUFFER_ARCHIVE_CAPACITY, g_archives[f].deviation);
+    }
+}
+
+/**
+ * 最新の1分データを間引き記録に追加（g_minute_lock の書き込み区間内で呼び出す）
+ * 値のないフィールド（未検出の土壌温度センサー）は追加せず、記録上は欠測になる
+ */
+static void update_archives(uint32_t epoch_minute, uint16_t slot) {
+    for (uint8_t f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+        int32_t value;
+        if (g_archives[f].deviation > 0 && column_field_raw(slot, f, &value)) {
+            swinging_door_add(&g_archives[f], epoch_minute, value);
+        }
+    }
+}
+
+/**
+ * フィールドの単位（℃, %, lux, pF/mV）から1分データの整数単位への倍率
+ */
+static float field_raw_scale(uint8_t field) {
+    switch (field) {
+    case DATA_BUFFER_FIELD_TEMPERATURE:
+        return MINUTE_RECORD_TEMP_SCALE;
+    case DATA_BUFFER_FIELD_HUMIDITY:
+        return MINUTE_RECORD_HUMIDITY_SCALE;
+    case DATA_BUFFER_FIELD_LUX:
+        return MINUTE_RECORD_LUX_SCALE;
+    case DATA_BUFFER_FIELD_SOIL_MOISTURE:
+        return MINUTE_RECORD_SOIL_SCALE;
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE:
+        return MINUTE_RECORD_PROBE_TEMP_SCALE;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE2:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE3:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE4:
+        return MINUTE_RECORD_PROBE_TEMP_SCALE;
+    default:
+        return MINUTE_RECORD_CAP_SCALE;
+#else
+    default:
+        return 1.0f;
+#endif
+    }
+}
+
+/**
+ * 記録時に検出した欠測の原因を推定
+ * 起動後の最初の記録なら再起動、時刻の進みが実際の経過時間（esp_timer）の2倍を超えれば時刻の飛び、
+ * それ以外は記録の停止とみなす
+ * @param gap_minutes 欠測の分数
+ * @param now_us 現在のesp_timer時刻
+ * @return 原因（data_buffer_gap_reason_t）
+ */
+static uint8_t classify_gap(uint32_t gap_minutes, int64_t now_us) {
+    if (g_last_live_us == 0) {
+        return DATA_BUFFER_GAP_REBOOT;
+    }
+    int64_t elapsed_minutes = (now_us - g_last_live_us) / (60 * 1000000LL);
+    if ((int64_t)gap_minutes + 1 > 2 * elapsed_minutes + 1) {
+        return DATA_BUFFER_GAP_TIME_JUMP;
+    }
+    return DATA_BUFFER_GAP_STALL;
+}
+
+/**
+ * 欠測を記録（g_minute_lock の書き込み区間内で呼び出す）
+ */
+static void log_gap(uint32_t start_minute, uint32_t length, uint8_t reason) {
+    data_buffer_gap_t *gap = &g_gap_log[g_gap_log_next];
+    gap->start_minute = start_minute;
+    gap->length = length;
+    gap->reason = reason;
+    g_gap_log_next = (g_gap_log_next + 1) % DATA_BUFFER_GAP_LOG_SIZE;
+}
+
+/**
+ * 時計の巻き戻しで1分リングと間引き記録を空にし、epoch_minute から記録し直す
+ * 新しい保持範囲のうち epoch_minute より前は時刻の飛びによる欠測として記録する。書き込み中の日・10分/1時間区間の集計は
+ * 確定せずに捨て、epoch_minute より後の10分/1時間集計と、その日より後の日別データ・日ごとの要約・週・月の要約も捨てる
+ * （残すと保持範囲の基準が未来のままになり、実時刻が追いつくまで日の確定を受け付けない）
+ */
+static void restart_minute_ring(uint32_t epoch_minute) {
+    uint32_t first_minute, end_minute;
+    ring_range(epoch_minute, &first_minute, &end_minute);
+    uint32_t newest_minute = g_latest_epoch_minute;
+    ESP_LOGW(TAG, "Clock moved back %lu minutes, restarting minute ring",
+             (unsigned long)(newest_minute - epoch_minute));
+
+    seqlock_write_begin(&g_minute_lock);
+    minute_columns_clear(&g_minute_columns);
+    init_archives();
+    if (!g_replaying && epoch_minute > first_minute) {
+        log_gap(first_minute, epoch_minute - first_minute, DATA_BUFFER_GAP_TIME_JUMP);
+    }
+    g_latest_epoch_minute = 0;
+    seqlock_write_end(&g_minute_lock);
+
+    daily_accumulator_reset(&g_day_acc, 0, 0);
+
+    trim_rollups_after(epoch_minute, newest_minute);
+    time_t t = (time_t)epoch_minute * 60;
+    struct tm local;
+    localtime_r(&t, &local);
+    trim_summaries_after(tm_to_epoch_day(&local));
+}
+
+/**
+ * 10分/1時間集計の書き込み中の区間を捨て、epoch_minute の区間より後（newest_minute まで）の区間を空きにする
+ */
+static void trim_rollups_after(uint32_t epoch_minute, uint32_t newest_minute) {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        rollup_tier_t *tier = &g_rollup_tiers[t];
+        daily_accumulator_reset(&tier->acc, 0, 0);
+
+        // 未来の区間は newest_minute から保持区間数までのスロットにしか残っていない
+        uint32_t first = rollup_tier_bucket(tier, epoch_minute) + 1;
+        uint32_t last = rollup_tier_bucket(tier, newest_minute);
+        if (last >= first + tier->capacity) {
+            first = last - tier->capacity + 1;
+        }
+        seqlock_write_begin(&g_summary_lock);
+        for (uint32_t bucket = first; bucket <= last; bucket++) {
+            rollup_tier_remove(tier, bucket);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+            if (tier->acc.channels != NULL) {
+                channel_rollup_remove(&g_channel_hourly, bucket);
+            }
+#endif
+        }
+        seqlock_write_end(&g_summary_lock);
+    }
+}
+
+/**
+ * epoch_day より後の日別データ・日ごとの要約と、それを含む週・月の要約を捨てる
+ * 書き込み中の週・月は残った日ごとの要約から組み立て直す
+ */
+static void trim_summaries_after(uint32_t epoch_day) {
+    uint32_t newest_stats_day = DAILY_DAY_EMPTY;
+    seqlock_write_begin(&g_summary_lock);
+    g_daily_newest_day = DAILY_DAY_EMPTY;
+    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
+        if (g_daily_epoch_day[i] == DAILY_DAY_EMPTY) {
+            continue;
+        }
+        if (g_daily_epoch_day[i] > epoch_day) {
+            memset(&g_daily_buffer[i], 0, sizeof(daily_summary_data_t));
+            g_daily_epoch_day[i] = DAILY_DAY_EMPTY;
+            g_daily_start_minute[i] = 0;
+        } else if (g_daily_newest_day == DAILY_DAY_EMPTY || g_daily_epoch_day[i] > g_daily_newest_day) {
+            g_daily_newest_day = g_daily_epoch_day[i];
+        }
+    }
+    for (int i = 0; i < DATA_BUFFER_STATS_DAYS; i++) {
+        if (g_stats_day_key[i] == DAILY_DAY_EMPTY) {
+            continue;
+        }
+        if (g_stats_day_key[i] > epoch_day) {
+            g_stats_day_key[i] = DAILY_DAY_EMPTY;
+        } else if (newest_stats_day == DAILY_DAY_EMPTY || g_stats_day_key[i] > newest_stats_day) {
+            newest_stats_day = g_stats_day_key[i];
+        }
+    }
+    // 残った最新の日を含む週・月は組み立て直すので、それより後の週・月を捨てる（残った日がなければ epoch_day の週・月から）
+    for (uint8_t p = 0; p < PERIOD_COUNT; p++) {
+        uint32_t keep = (newest_stats_day != DAILY_DAY_EMPTY) ? period_key(p, newest_stats_day) : period_key(p, epoch_day) - 1;
+        for (int i = 0; i < k_period_capacity[p]; i++) {
+            if (g_period_key[p][i] != PERIOD_KEY_EMPTY && g_period_key[p][i] > keep) {
+                g_period_key[p][i] = PERIOD_KEY_EMPTY;
+            }
+        }
+    }
+    seqlock_write_end(&g_summary_lock);
+
+    g_stats_closed_day = DAILY_DAY_EMPTY;
+    rebuild_open_periods();
+}
+
+/**
+ * 区間 [start, end) に重なる記録済みの欠測の原因を取得（新しい記録を優先）
+ */
+static uint8_t find_gap_reason(uint32_t start_minute, uint32_t end_minute) {
+    for (int n = 1; n <= DATA_BUFFER_GAP_LOG_SIZE; n++) {
+        const data_buffer_gap_t *gap = &g_gap_log[(g_gap_log_next + DATA_BUFFER_GAP_LOG_SIZE - n) % DATA_BUFFER_GAP_LOG_SIZE];
+        if (gap->length > 0 && gap->start_minute < end_minute && start_minute < gap->start_minute + gap->length) {
+            return gap->reason;
+        }
+    }
+    return DATA_BUFFER_GAP_UNKNOWN;
+}
+
+/**
+ * 1分リングの保持範囲 [first, end)（最新データまでの24時間）を取得
+ */
+static void ring_range(uint32_t latest, uint32_t *first_minute, uint32_t *end_minute) {
+    if (latest == 0) {
+        *first_minute = 0;
+        *end_minute = 0;
+        return;
+    }
+    *first_minute = (latest >= DATA_BUFFER_MINUTE_CAPACITY - 1) ? latest - (DATA_BUFFER_MINUTE_CAPACITY - 1) : 0;
+    *end_minute = latest + 1;
+}
+
+/**
+ * 10分/1時間集計を更新
+ * 書き込み中の区間は1分ごとに逐次積算してリングに反映し、区間が切り替わった時点で
+ * 前の区間を確定値として履歴ログに記録する。区間の切り替えと上書き時のみ、
+ * 区間内の1分データ（最大60件）をスロット直接参照で再集計する。
+ * 確定済みの区間に遅れて入ったサンプル（時計の巻き戻し）は、書き込み中の区間を切り替えずに
+ * リング上のレコードだけを組み立て直す（履歴ログには追記しない）
+ * @param evicted 同じスロットの既存データを上書きしたか
+ * @param evicted_minute 上書きされたデータのエポック分
+ */
+static void update_rollup_tiers(uint32_t epoch_minute, bool evicted, uint32_t evicted_minute) {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        rollup_tier_t *tier = &g_rollup_tiers[t];
+        if (tier->acc.count > 0 && epoch_minute < tier->acc.day_start) {
+            refold_sealed_bucket(tier, rollup_tier_bucket(tier, epoch_minute));
+            continue;
+        }
+        if (!daily_accumulator_contains(&tier->acc, epoch_minute)) {
+            if (tier->acc.count > 0 && g_history_enabled && !g_replaying) {
+                history_rollup_entry_t entry;
+                entry.bucket = rollup_tier_bucket(tier, tier->acc.day_start);
+                const rollup_record_t *sealed = rollup_tier_find(tier, entry.bucket);
+                if (sealed != NULL) {
+                    memcpy(&entry.record, sealed, sizeof(rollup_record_t));
+                    if (history_log_append(&g_rollup_logs[t], &entry) != ESP_OK) {
+                        ESP_LOGW(TAG, "Failed to append rollup history (tier %d)", t);
+                    }
+                }
+            }
+
+            uint32_t bucket = rollup_tier_bucket(tier, epoch_minute);
+            daily_accumulator_reset(&tier->acc, bucket * tier->bucket_minutes, (bucket + 1) * tier->bucket_minutes);
+            accumulate_from_buffer(&tier->acc);
+        } else if (evicted && daily_accumulator_contains(&tier->acc, evicted_minute)) {
+            daily_accumulator_reset(&tier->acc, tier->acc.day_start, tier->acc.day_end);
+            accumulate_from_buffer(&tier->acc);
+        } else {
+            minute_record_t rec;
+            find_minute_record(epoch_minute, &rec);
+            daily_accumulator_add(&tier->acc, &rec);
+        }
+        store_rollup_record(tier, &tier->acc, g_replaying);
+    }
+}
+
+/**
+ * 区間の集計を階層のリングに格納
+ * @param acc 区間のアキュムレータ（書き込み中の区間、または組み立て直した確定済みの区間）
+ * @param prefer_sealed true: リングに一部しか残っていない区間は、格納済みの確定値を優先する（復元中・遅れたサンプル）
+ */
+static void store_rollup_record(rollup_tier_t *tier, const daily_accumulator_t *acc, bool prefer_sealed) {
+    if (acc->count == 0) {
+        return;
+    }
+
+    uint32_t bucket = rollup_tier_bucket(tier, acc->day_start);
+    const rollup_record_t *existing = rollup_tier_find(tier, bucket);
+    bool keep_sealed = prefer_sealed && existing != NULL && existing->count > acc->count;
+
+    rollup_record_t rec;
+    if (!keep_sealed) {
+        rollup_record_from_accumulator(acc, &rec);
+    }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // チャンネル別集計は履歴ログを持たないため、復元中も1分データから求めた値を格納する
+    channel_rollup_record_t channel_rec;
+    if (acc->channels != NULL) {
+        channel_rollup_record_from_accumulator(acc->channels, acc->count, &channel_rec);
+    }
+#endif
+    seqlock_write_begin(&g_summary_lock);
+    if (!keep_sealed) {
+        rollup_tier_store(tier, bucket, &rec);
+    }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    if (acc->channels != NULL) {
+        channel_rollup_store(&g_channel_hourly, bucket, &channel_rec);
+    }
+#endif
+    seqlock_write_end(&g_summary_lock);
+}
+
+/**
+ * 確定済みの区間のリング上のレコードを1分データから組み立て直す（書き込み中の区間と履歴ログは変更しない）
+ */
+static void refold_sealed_bucket(rollup_tier_t *tier, uint32_t bucket) {
+    daily_accumulator_t acc;
+    acc.quantiles = NULL;
+    acc.stats = NULL;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    channel_accumulator_t channels;
+    acc.channels = (tier->acc.channels != NULL) ? &channels : NULL;
+#endif
+    daily_accumulator_reset(&acc, bucket * tier->bucket_minutes, (bucket + 1) * tier->bucket_minutes);
+    accumulate_from_buffer(&acc);
+    store_rollup_record(tier, &acc, true);
+}
+
+/**
+ * 10分/1時間集計の階層を空の状態に初期化
+ */
+static void init_rollup_tiers(void) {
+    seqlock_write_begin(&g_summary_lock);
+    rollup_tier_init(&g_rollup_tiers[0], g_tier10_buffer, DATA_BUFFER_TIER10_CAPACITY, DATA_BUFFER_TIER10_MINUTES);
+    rollup_tier_init(&g_rollup_tiers[1], g_hourly_buffer, DATA_BUFFER_HOURLY_CAPACITY, DATA_BUFFER_HOURLY_MINUTES);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // チャンネル別集計は1時間集計の区間に合わせて積算する
+    channel_rollup_init(&g_channel_hourly, g_channel_hourly_buffer, DATA_BUFFER_CHANNEL_HOURLY_CAPACITY);
+    g_rollup_tiers[1].acc.channels = &g_hourly_channels;
+    daily_accumulator_reset(&g_rollup_tiers[1].acc, 0, 0);
+#endif
+    seqlock_write_end(&g_summary_lock);
+}
+
+/**
+ * 書き込み中の日の集計を日別バッファに格納
+ * @return 格納したインデックス、サンプルがない場合は-1
+ */
+static int store_day_summary(void) {
+    daily_summary_data_t summary;
+    if (daily_accumulator_to_summary(&g_day_acc, &g_day_acc_date, &summary) != ESP_OK) {
+        return -1;
+    }
+
+    uint32_t epoch_day = tm_to_epoch_day(&g_day_acc_date);
+    const daily_summary_data_t *stored = find_daily_summary(epoch_day);
+    if (g_replaying && stored != NULL && stored->valid_samples > summary.valid_samples) {
+        // 復元中: リングに一部しか残っていない日は、日別ログの確定値を優先する
+        return epoch_day % DATA_BUFFER_DAYS_PER_MONTH;
+    }
+    int slot = put_daily_summary(epoch_day, g_day_acc.day_start, &summary);
+    if (slot >= 0) {
+        put_day_stats(epoch_day, &g_day_stats);
+    }
+    return slot;
+}
+
+/**
+ * フラッシュの履歴ログからRAMバッファを復元
+ * 日別サマリーを読み込んだ後、1分データを末尾からバッファ容量分だけ再投入する
+ */
+static void restore_from_history(void) {
+    history_storage_t storage;
+    g_history_enabled = false;
+    if (history_storage_get(&storage) != ESP_OK) {
+        return;
+    }
+    uint32_t tier10_offset = DATA_BUFFER_HISTORY_DAILY_REGION;
+    uint32_t hourly_offset = tier10_offset + DATA_BUFFER_HISTORY_TIER10_REGION;
+    uint32_t period_offset = hourly_offset + DATA_BUFFER_HISTORY_HOURLY_REGION;
+    uint32_t minute_offset = period_offset + DATA_BUFFER_HISTORY_PERIOD_REGION;
+    if (storage.size < minute_offset + 2 * HISTORY_LOG_PAGE_SIZE) {
+        ESP_LOGW(TAG, "History partition too small (%lu bytes)", (unsigned long)storage.size);
+        return;
+    }
+
+    esp_err_t ret = history_log_open(&g_daily_log, &storage, 0, DATA_BUFFER_HISTORY_DAILY_REGION,
+                                     sizeof(history_daily_entry_t), g_daily_page_buf, sizeof(g_daily_page_buf));
+    if (ret == ESP_OK) {
+        ret = history_log_open(&g_rollup_logs[0], &storage, tier10_offset, DATA_BUFFER_HISTORY_TIER10_REGION,
+                               sizeof(history_rollup_entry_t), g_rollup_page_buf[0], sizeof(g_rollup_page_buf[0]));
+    }
+    if (ret == ESP_OK) {
+        ret = history_log_open(&g_rollup_logs[1], &storage, hourly_offset, DATA_BUFFER_HISTORY_HOURLY_REGION,
+                               sizeof(history_rollup_entry_t), g_rollup_page_buf[1], sizeof(g_rollup_page_buf[1]));
+    }
+    if (ret == ESP_OK) {
+        ret = history_log_open(&g_period_log, &storage, period_offset, DATA_BUFFER_HISTORY_PERIOD_REGION,
+                               sizeof(history_period_entry_t), g_period_page_buf, sizeof(g_period_page_buf));
+    }
+    if (ret == ESP_OK) {
+        uint32_t minute_region = (storage.size - minute_offset) / HISTORY_LOG_PAGE_SIZE * HISTORY_LOG_PAGE_SIZE;
+        ret = history_log_open(&g_minute_log, &storage, minute_offset, minute_region,
+                               sizeof(history_minute_entry_t), g_minute_page_buf, sizeof(g_minute_page_buf));
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open history log: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t daily_count = 0, minute_count = 0, period_count = 0, rollup_count[ROLLUP_TIER_COUNT] = {0};
+
+    g_replaying = true;
+    history_log_replay(&g_daily_log, DATA_BUFFER_STATS_DAYS, restore_daily_entry, NULL, &daily_count);
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        history_log_replay(&g_rollup_logs[t], g_rollup_tiers[t].capacity, restore_rollup_entry,
+                           &g_rollup_tiers[t], &rollup_count[t]);
+    }
+    // 確定した週・月を読み込んだ後、書き込み中の週・月を日ごとの要約から組み立て直す
+    history_log_replay(&g_period_log, (uint32_t)g_period_log.page_count * g_period_log.entries_per_page,
+                       restore_period_entry, NULL, &period_count);
+    rebuild_open_periods();
+    g_period_log_ready = true;
+    history_log_replay(&g_minute_log, DATA_BUFFER_MINUTE_CAPACITY, restore_minute_entry, NULL, &minute_count);
+    store_day_summary();
+    g_replaying = false;
+    g_history_enabled = true;
+
+    ESP_LOGI(TAG, "Restored %lu minute entries, %lu/%lu rollups, %lu daily summaries and %lu periods from flash in %lld ms",
+             (unsigned long)minute_count, (unsigned long)rollup_count[0], (unsigned long)rollup_count[1],
+             (unsigned long)daily_count, (unsigned long)period_count, (long long)((esp_timer_get_time() - start_us) / 1000));
+}
+
+/**
+ * 直近 SNAPSHOT_MINUTES 分の1分データを1つの圧縮ブロックにする（g_minute_lock の読み出し区間内で呼び出す）
+ * 収まらない場合は先頭を SNAPSHOT_TRIM_MINUTES 分ずつ削って最新側を残す
+ * @param latest 最新データのエポック分
+ * @return ブロックのバイト数（データがない場合は0）
+ */
+static uint16_t encode_snapshot(uint32_t latest) {
+    uint32_t first, end;
+    ring_range(latest, &first, &end);
+    if (end - first > SNAPSHOT_MINUTES) {
+        first = end - SNAPSHOT_MINUTES;
+    }
+
+    minute_codec_encoder_t enc;
+    while (first < end) {
+        minute_codec_encoder_init(&enc, g_snapshot.block, sizeof(g_snapshot.block));
+        bool full = false;
+        for (uint32_t m = first; m < end && !full; m++) {
+            minute_record_t rec;
+            if (find_minute_record(m, &rec)) {
+                full = (minute_codec_encoder_add(&enc, m, &rec) != ESP_OK);
+            }
+        }
+        if (!full) {
+            return (enc.count > 0) ? minute_codec_encoder_finish(&enc) : 0;
+        }
+        first += SNAPSHOT_TRIM_MINUTES;
+    }
+    return 0;
+}
+
+static uint32_t snapshot_crc(void) {
+    uint32_t crc = history_log_crc32(0, &g_snapshot.size, sizeof(g_snapshot.size));
+    return history_log_crc32(crc, g_snapshot.block, g_snapshot.size);
+}
+
+/**
+ * 退避を復元に使えるか（ソフトウェアリセット・パニック等で保持されたRAMで、CRCが一致する）
+ */
+static bool snapshot_usable(void) {
+    if (g_snapshot.magic != SNAPSHOT_MAGIC || g_snapshot.size > sizeof(g_snapshot.block)) {
+        return false;
+    }
+#ifdef ESP_PLATFORM
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || reason == ESP_RST_UNKNOWN) {
+        return false;
+    }
+#endif
+    return snapshot_crc() == g_snapshot.crc32;
+}
+
+/**
+ * ソフトウェアリセット前の退避から、履歴ログより新しい1分データを復元する
+ * 復元した分は履歴ログにも追記し、退避は1回使ったら無効にする
+ */
+static void restore_snapshot(void) {
+    if (!snapshot_usable()) {
+        g_snapshot.magic = 0;
+        return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    minute_codec_decoder_t dec;
+    uint32_t restored = 0;
+    if (minute_codec_decoder_init(&dec, g_snapshot.block, g_snapshot.size) == ESP_OK) {
+        history_minute_entry_t entry;
+        uint32_t epoch_minute;
+        minute_record_t rec;
+        g_replaying = true;
+        while (minute_codec_decoder_next(&dec, &epoch_minute, &rec) == ESP_OK) {
+            if (epoch_minute <= g_latest_epoch_minute) {
+                continue;  // 履歴ログから復元済み
+            }
+            store_minute_record(epoch_minute, &rec, NULL);
+            if (g_history_enabled) {
+                entry.epoch_minute = epoch_minute;
+                memcpy(&entry.record, &rec, sizeof(minute_record_t));
+                entry.record.minute_key = minute_key(epoch_minute);
+                history_log_append(&g_minute_log, &entry);
+            }
+            restored++;
+        }
+        store_day_summary();
+        g_replaying = false;
+    }
+    g_snapshot.magic = 0;
+
+    ESP_LOGI(TAG, "Restored %lu minute entries from warm restart snapshot in %lld us",
+             (unsigned long)restored, (long long)(esp_timer_get_time() - start_us));
+}
+
+#ifdef ESP_PLATFORM
+static void snapshot_shutdown_handler(void) {
+    data_buffer_save_snapshot();
+}
+#endif
+
+static void restore_minute_entry(const void *entry, void *ctx) {
+    const history_minute_entry_t *e = (const history_minute_entry_t *)entry;
+    store_minute_record(e->epoch_minute, &e->record, NULL);
+}
+
+static void restore_daily_entry(const void *entry, void *ctx) {
+    const history_daily_entry_t *e = (const history_daily_entry_t *)entry;
+    uint32_t epoch_day = tm_to_epoch_day(&e->summary.date);
+    if (g_daily_newest_day != DAILY_DAY_EMPTY && epoch_day < g_daily_newest_day) {
+        // ログは確定順なので、前の日に戻ったのは時計の巻き戻し（記録時と同じく、より後の日を捨てる）
+        trim_summaries_after(epoch_day);
+    }
+    put_daily_summary(epoch_day, e->day_start, &e->summary);
+    put_day_stats(epoch_day, &e->stats);
+}
+
+static void restore_period_entry(const void *entry, void *ctx) {
+    const history_period_entry_t *e = (const history_period_entry_t *)entry;
+    if (e->period >= PERIOD_COUNT) {
+        return;
+    }
+    uint8_t slot = e->key % k_period_capacity[e->period];
+    seqlock_write_begin(&g_summary_lock);
+    // 確定した週・月は期間番号の順に記録するので、前の期間に戻ったのは時計の巻き戻し: より後の期間を捨てる
+    for (int i = 0; i < k_period_capacity[e->period]; i++) {
+        if (g_period_key[e->period][i] != PERIOD_KEY_EMPTY && g_period_key[e->period][i] > e->key) {
+            g_period_key[e->period][i] = PERIOD_KEY_EMPTY;
+        }
+    }
+    memcpy(&g_period_stats[e->period][slot], &e->stats, sizeof(stat_summary_t));
+    g_period_key[e->period][slot] = e->key;
+    seqlock_write_end(&g_summary_lock);
+}
+
+static void restore_rollup_entry(const void *entry, void *ctx) {
+    const history_rollup_entry_t *e = (const history_rollup_entry_t *)entry;
+    rollup_tier_t *tier = (rollup_tier_t *)ctx;
+    seqlock_write_begin(&g_summary_lock);
+    rollup_tier_store(tier, e->bucket, &e->record);
+    seqlock_write_end(&g_summary_lock);
+
+    uint32_t last_minute = (e->bucket + 1) * tier->bucket_minutes - 1;
+    if (last_minute > g_latest_epoch_minute) {
+        g_latest_epoch_minute = last_minute;
+    }
+}
+
+/**
+ * 時刻比較ユーティリティ関数
+ */
+int data_buffer_compare_time(const struct tm *tm1, const struct tm *tm2) {
+    if (tm1 == NULL || tm2 == NULL) return 0;
+    
+    time_t time1 = mktime((struct tm*)tm1);
+    time_t time2 = mktime((struct tm*)tm2);
+    
+    if (time1 < time2) return -1;
+    if (time1 > time2) return 1;
+    return 0;
 }
 
 /**
  * 日付比較ユーティリティ関数
  */
-int data_buffer_compare_date(const struct tm *tm1, const struct tm *tm2) {
-    if (tm1 == NULL || tm2 == NULL) return 0;
-    
-    if (tm1->tm_year != tm2->tm_year) return tm1->tm_year - tm2->tm_year;
-    if (tm1->tm_mon != tm2->tm_mon) return tm1->tm_mon - tm2->tm_mon;
-    return tm1->tm_mday - tm2->tm_mday;
+int data_buffer_compare_date(const struct tm *tm1, const struct tm *tm2) {
+    if (tm1 == NULL || tm2 == NULL) return 0;
+    
+    if (tm1->tm_year != tm2->tm_year) return tm1->tm_year - tm2->tm_year;
+    if (tm1->tm_mon != tm2->tm_mon) return tm1->tm_mon - tm2->tm_mon;
+    return tm1->tm_mday - tm2->tm_mday;
+}
+
+// その他のプライベート関数
+
+/**
+ * 日付からエポック日（1970-01-01からの経過日数、ローカル日付基準）を算出
+ * mktimeを使わず暦の年月日から直接求める（days_from_civil）
+ */
+static uint32_t tm_to_epoch_day(const struct tm *date) {
+    int32_t year = date->tm_year + 1900;
+    int32_t month = date->tm_mon + 1;
+    year -= (month <= 2);
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    int32_t year_of_era = year - era * 400;
+    int32_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + date->tm_mday - 1;
+    int32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return (uint32_t)(era * 146097 + day_of_era - 719468);
+}
+
+static void copy_tm_date_only(struct tm *dest, const struct tm *src) {
+    dest->tm_year = src->tm_year;
+    dest->tm_mon = src->tm_mon;
+    dest->tm_mday = src->tm_mday;
+    dest->tm_hour = 0;
+    dest->tm_min = 0;
+    dest->tm_sec = 0;
+    dest->tm_wday = src->tm_wday;
+    dest->tm_yday = src->tm_yday;
+    dest->tm_isdst = src->tm_isdst;
+}
+
+static void copy_tm_full(struct tm *dest, const struct tm *src) {
+    memcpy(dest, src, sizeof(struct tm));
+}
+
+/**
+ * struct tm（ローカル時刻）をエポック分に変換
+ */
+static uint32_t tm_to_epoch_minute(const struct tm *timestamp) {
+    struct tm tmp = *timestamp;
+    time_t t = mktime(&tmp);
+    return (t > 0) ? (uint32_t)(t / 60) : 0;
+}
+
+/**
+ * 指定日のエポック分範囲 [start, end) を取得（ローカル時刻の0:00基準）
+ */
+static void get_day_epoch_range(const struct tm *date, uint32_t *start_minute, uint32_t *end_minute) {
+    struct tm day = {0};
+    day.tm_year = date->tm_year;
+    day.tm_mon = date->tm_mon;
+    day.tm_mday = date->tm_mday;
+    day.tm_isdst = -1;
+    *start_minute = tm_to_epoch_minute(&day);
+
+    day.tm_mday += 1;
+    day.tm_isdst = -1;
+    *end_minute = tm_to_epoch_minute(&day);
+}
+
+/**
+ * エポック分からスロット位置を算出
+ */
+static inline uint16_t minute_slot(uint32_t epoch_minute) {
+    return (uint16_t)(epoch_minute % DATA_BUFFER_MINUTE_CAPACITY);
+}
+
+/**
+ * エポック分から時刻キーを算出（何周目のリングかを表す）
+ * 16bitで約700年分を表現できる
+ */
+static inline uint16_t minute_key(uint32_t epoch_minute) {
+    return (uint16_t)(epoch_minute / DATA_BUFFER_MINUTE_CAPACITY);
+}
+
+/**
+ * スロットに格納されたレコードのエポック分を取得
+ */
+static inline uint32_t slot_epoch_minute(uint16_t slot) {
+    return (uint32_t)g_minute_columns.minute_key[slot] * DATA_BUFFER_MINUTE_CAPACITY + slot;
+}
+
+/**
+ * スロットに指定エポック分のデータがあるか判定（有効ビットと時刻キーで検証）
+ */
+static inline bool slot_holds(uint16_t slot, uint32_t epoch_minute) {
+    return minute_columns_is_valid(&g_minute_columns, slot) &&
+           g_minute_columns.minute_key[slot] == minute_key(epoch_minute);
+}
+
+/**
+ * 指定エポック分のレコードを列から組み立てる（書き込み側用）
+ * @param rec 格納先
+ * @return true: データあり
+ */
+static bool find_minute_record(uint32_t epoch_minute, minute_record_t *rec) {
+    uint16_t slot = minute_slot(epoch_minute);
+    if (!slot_holds(slot, epoch_minute)) {
+        return false;
+    }
+    minute_columns_get(&g_minute_columns, slot, rec);
+    return true;
+}
+
+/**
+ * 指定エポック分のレコードを書き込みと重ならないように取り出す（リーダー用）
+ * @param rec 格納先
+ * @return true: データあり
+ */
+static bool read_minute_record(uint32_t epoch_minute, minute_record_t *rec) {
+    uint32_t attempts = 0, seq;
+    bool found;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        minute_columns_get(&g_minute_columns, minute_slot(epoch_minute), rec);
+        found = !minute_record_is_empty(rec) && rec->minute_key == minute_key(epoch_minute);
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    return found;
+}
+
+/**
+ * 期間の開始時刻を保持し、区間数がmax_points以下になる最も細かい階層を選択
+ */
+static data_buffer_tier_t select_history_tier(uint32_t start_minute, uint32_t end_minute, uint16_t max_points) {
+    for (int t = DATA_BUFFER_TIER_MINUTE; t < DATA_BUFFER_TIER_COUNT; t++) {
+        uint16_t bucket_minutes = k_tier_bucket_minutes[t];
+        uint32_t latest_bucket = g_latest_epoch_minute / bucket_minutes;
+        uint32_t oldest_bucket = (latest_bucket >= k_tier_capacity[t]) ? latest_bucket - k_tier_capacity[t] + 1 : 0;
+        uint32_t buckets = (end_minute - 1) / bucket_minutes - start_minute / bucket_minutes + 1;
+        if (start_minute / bucket_minutes >= oldest_bucket && buckets <= max_points) {
+            return (data_buffer_tier_t)t;
+        }
+    }
+    return DATA_BUFFER_TIER_HOURLY;
+}
+
+/**
+ * 1分レコードを履歴データ点に変換（最小/平均/最大は同じ値）
+ */
+static void minute_record_to_point(const minute_record_t *rec, history_point_data_t *point) {
+    minute_data_t values;
+    minute_record_decode_values(rec, &values);
+
+    point->samples = 1;
+    point->min_temperature = point->avg_temperature = point->max_temperature = values.temperature;
+    point->min_humidity = point->avg_humidity = point->max_humidity = values.humidity;
+    point->min_lux = point->avg_lux = point->max_lux = values.lux;
+    point->min_soil_moisture = point->avg_soil_moisture = point->max_soil_moisture = values.soil_moisture;
+
+    int16_t soil_temp;
+    point->soil_temperature_valid = minute_record_soil_temperature_raw(rec, &soil_temp);
+    point->avg_soil_temperature = point->soil_temperature_valid ? soil_temp / MINUTE_RECORD_PROBE_TEMP_SCALE : 0.0f;
+    point->min_soil_temperature = point->max_soil_temperature = point->avg_soil_temperature;
+}
+
+/**
+ * 指定エポック日の日別データを取得（スロットのエポック日で検証）
+ * @return 見つからない場合はNULL（completeでないデータも返す）
+ */
+static const daily_summary_data_t *find_daily_summary(uint32_t epoch_day) {
+    if (epoch_day == DAILY_DAY_EMPTY) {
+        return NULL;
+    }
+    uint8_t slot = epoch_day % DATA_BUFFER_DAYS_PER_MONTH;
+    if (g_daily_epoch_day[slot] != epoch_day) {
+        return NULL;
+    }
+    return &g_daily_buffer[slot];
+}
+
+/**
+ * 日別データをエポック日のスロットに格納（30日前の日を上書きする）
+ * 最新日から30日以上前の日は保持範囲外なので格納しない
+ * @return 格納したスロット、保持範囲外の場合は-1
+ */
+static int put_daily_summary(uint32_t epoch_day, uint32_t day_start, const daily_summary_data_t *summary) {
+    if (g_daily_newest_day != DAILY_DAY_EMPTY && epoch_day + DATA_BUFFER_DAYS_PER_MONTH <= g_daily_newest_day) {
+        return -1;
+    }
+    uint8_t slot = epoch_day % DATA_BUFFER_DAYS_PER_MONTH;
+    seqlock_write_begin(&g_summary_lock);
+    memcpy(&g_daily_buffer[slot], summary, sizeof(daily_summary_data_t));
+    g_daily_epoch_day[slot] = epoch_day;
+    g_daily_start_minute[slot] = day_start;
+    if (g_daily_newest_day == DAILY_DAY_EMPTY || epoch_day > g_daily_newest_day) {
+        g_daily_newest_day = epoch_day;
+    }
+    seqlock_write_end(&g_summary_lock);
+    return slot;
+}
+
+/**
+ * 週・月の要約を空にする
+ */
+static void init_period_stats(void) {
+    seqlock_write_begin(&g_summary_lock);
+    for (int i = 0; i < DATA_BUFFER_STATS_DAYS; i++) {
+        g_stats_day_key[i] = DAILY_DAY_EMPTY;
+    }
+    for (int p = 0; p < PERIOD_COUNT; p++) {
+        for (int i = 0; i < PERIOD_CAPACITY; i++) {
+            g_period_key[p][i] = PERIOD_KEY_EMPTY;
+        }
+    }
+    g_stats_closed_day = DAILY_DAY_EMPTY;
+    seqlock_write_end(&g_summary_lock);
+}
+
+/**
+ * 日の要約をエポック日のスロットに格納（より新しい日のスロットは上書きしない）
+ */
+static void put_day_stats(uint32_t epoch_day, const stat_summary_t *stats) {
+    uint8_t slot = epoch_day % DATA_BUFFER_STATS_DAYS;
+    if (g_stats_day_key[slot] != DAILY_DAY_EMPTY && g_stats_day_key[slot] > epoch_day) {
+        return;
+    }
+    seqlock_write_begin(&g_summary_lock);
+    memcpy(&g_stats_days[slot], stats, sizeof(stat_summary_t));
+    g_stats_days[slot].days = (stats->field[QUANTILE_FIELD_TEMPERATURE].count > 0) ? 1 : 0;
+    g_stats_day_key[slot] = epoch_day;
+    seqlock_write_end(&g_summary_lock);
+}
+
+/**
+ * 指定エポック日の要約を取得
+ * @return 見つからない場合はNULL
+ */
+static const stat_summary_t *find_day_stats(uint32_t epoch_day) {
+    uint8_t slot = epoch_day % DATA_BUFFER_STATS_DAYS;
+    return (g_stats_day_key[slot] == epoch_day) ? &g_stats_days[slot] : NULL;
+}
+
+/**
+ * 確定した日の要約を週・月の要約に結合（1日1回、結合済みの日は何もしない）
+ * 日が前の日と別の週・月に入った場合は、前の週・月が確定したとして履歴ログに記録する
+ */
+static void close_day_stats(uint32_t epoch_day) {
+    const stat_summary_t *day_stats = find_day_stats(epoch_day);
+    if (day_stats == NULL || (g_stats_closed_day != DAILY_DAY_EMPTY && epoch_day <= g_stats_closed_day)) {
+        return;
+    }
+
+    for (uint8_t p = 0; p < PERIOD_COUNT; p++) {
+        uint32_t key = period_key(p, epoch_day);
+        uint8_t slot = key % k_period_capacity[p];
+        if (g_stats_closed_day != DAILY_DAY_EMPTY && g_period_log_ready) {
+            uint32_t prev_key = period_key(p, g_stats_closed_day);
+            uint8_t prev_slot = prev_key % k_period_capacity[p];
+            if (prev_key != key && g_period_key[p][prev_slot] == prev_key) {
+                history_period_entry_t entry;
+                entry.key = prev_key;
+                entry.period = p;
+                memcpy(&entry.stats, &g_period_stats[p][prev_slot], sizeof(stat_summary_t));
+                if (history_log_append(&g_period_log, &entry) != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to append period history");
+                }
+            }
+        }
+
+        seqlock_write_begin(&g_summary_lock);
+        if (g_period_key[p][slot] != key) {
+            stat_summary_reset(&g_period_stats[p][slot]);
+            g_period_key[p][slot] = key;
+        }
+        stat_summary_merge(&g_period_stats[p][slot], day_stats);
+        seqlock_write_end(&g_summary_lock);
+    }
+    g_stats_closed_day = epoch_day;
+}
+
+/**
+ * 復元した日ごとの要約から、最新の確定日を含む週・月（書き込み中の期間）を組み立て直す
+ */
+static void rebuild_open_periods(void) {
+    uint32_t newest = DAILY_DAY_EMPTY;
+    for (int i = 0; i < DATA_BUFFER_STATS_DAYS; i++) {
+        if (g_stats_day_key[i] != DAILY_DAY_EMPTY && (newest == DAILY_DAY_EMPTY || g_stats_day_key[i] > newest)) {
+            newest = g_stats_day_key[i];
+        }
+    }
+    if (newest == DAILY_DAY_EMPTY) {
+        return;
+    }
+
+    seqlock_write_begin(&g_summary_lock);
+    for (uint8_t p = 0; p < PERIOD_COUNT; p++) {
+        uint32_t key = period_key(p, newest);
+        uint8_t slot = key % k_period_capacity[p];
+        stat_summary_reset(&g_period_stats[p][slot]);
+        g_period_key[p][slot] = key;
+        for (int i = 0; i < DATA_BUFFER_STATS_DAYS; i++) {
+            if (g_stats_day_key[i] != DAILY_DAY_EMPTY && period_key(p, g_stats_day_key[i]) == key) {
+                stat_summary_merge(&g_period_stats[p][slot], &g_stats_days[i]);
+            }
+        }
+    }
+    seqlock_write_end(&g_summary_lock);
+    g_stats_closed_day = newest;
+}
+
+/**
+ * エポック日を含む期間の番号（週: 月曜始まりの通し番号、月: 西暦 × 12 + 月）
+ */
+static uint32_t period_key(uint8_t period, uint32_t epoch_day) {
+    if (period == DATA_BUFFER_PERIOD_WEEK) {
+        return (epoch_day + 3) / 7;  // 1970-01-01 は木曜
+    }
+    time_t t = (time_t)epoch_day * 86400;
+    struct tm date;
+    gmtime_r(&t, &date);
+    return (uint32_t)((date.tm_year + 1900) * 12 + date.tm_mon);
+}
+
+/**
+ * 期間の開始エポック日
+ */
+static uint32_t period_start_day(uint8_t period, uint32_t key) {
+    if (period == DATA_BUFFER_PERIOD_WEEK) {
+        return key * 7 - 3;
+    }
+    struct tm date = {0};
+    date.tm_year = (int)(key / 12) - 1900;
+    date.tm_mon = (int)(key % 12);
+    date.tm_mday = 1;
+    return tm_to_epoch_day(&date);
+}
+
+/**
+ * 要約から期間統計を生成
+ */
+static void stats_to_result(const stat_summary_t *stats, uint32_t first_day, data_buffer_period_stats_t *result) {
+    memset(result, 0, sizeof(data_buffer_period_stats_t));
+    time_t t = (time_t)first_day * 86400;
+    gmtime_r(&t, &result->start);
+    result->days = stats->days;
+    for (int f = 0; f < QUANTILE_FIELD_COUNT; f++) {
+        const stat_field_summary_t *field = &stats->field[f];
+        data_buffer_field_stats_t *out = &result->field[f];
+        out->samples = field->count;
+        if (field->count == 0) {
+            continue;
+        }
+        out->mean = stat_field_mean(field) / k_stat_scale[f];
+        out->stddev = stat_field_stddev(field) / k_stat_scale[f];
+        out->min = field->min / k_stat_scale[f];
+        out->max = field->max / k_stat_scale[f];
+        for (int q = 0; q < DAILY_QUANTILE_COUNT; q++) {
+            out->quantiles[q] = stat_field_quantile(field, (quantile_field_t)f, k_stat_quantiles[q]) / k_stat_scale[f];
+        }
+    }
+}
+
+/**
+ * 日別データバッファを空にする
+ */
+static void init_daily_buffer(void) {
+    seqlock_write_begin(&g_summary_lock);
+    memset(g_daily_buffer, 0, sizeof(g_daily_buffer));
+    memset(g_daily_start_minute, 0, sizeof(g_daily_start_minute));
+    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
+        g_daily_epoch_day[i] = DAILY_DAY_EMPTY;
+    }
+    g_daily_newest_day = DAILY_DAY_EMPTY;
+    seqlock_write_end(&g_summary_lock);
+}
+
+/**
+ * 指定された日の1分データを取得
+ */
+esp_err_t data_buffer_get_day_minute_data(const struct tm *date, 
+                                        minute_data_t *data, 
+                                        uint16_t *count) {
+    if (!g_initialized || date == NULL || data == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint16_t result_count = 0;
+    
+    // 指定された日の1分データを古い順に展開
+    data_buffer_window_t window = data_buffer_window_day(date);
+    data_buffer_iter_t it;
+    data_buffer_iter_begin(&it, &window);
+    while (result_count < DATA_BUFFER_MINUTES_PER_DAY && data_buffer_iter_next(&it)) {
+        data_buffer_iter_decode(&it, &data[result_count]);
+        result_count++;
+    }
+    
+    *count = result_count;
+    ESP_LOGD(TAG, "Retrieved %d minute data entries for specified date", result_count);
+    
+    return ESP_OK;
+}
+
+/**
+ * 過去N分の走査範囲を作成
+ */
+data_buffer_window_t data_buffer_window_recent(uint16_t minutes) {
+    time_t now;
+    time(&now);
+    time_t cutoff_time = now - (time_t)minutes * 60;
+    
+    // cutoff_timeより後の分（従来の data_time > cutoff_time と同じ範囲）。未来側は制限しない
+    data_buffer_window_t window;
+    window.start_minute = (cutoff_time > 0) ? (uint32_t)(cutoff_time / 60) + 1 : 0;
+    window.end_minute = UINT32_MAX;
+    return window;
+}
+
+/**
+ * 指定日の走査範囲を作成
+ */
+data_buffer_window_t data_buffer_window_day(const struct tm *date) {
+    data_buffer_window_t window;
+    get_day_epoch_range(date, &window.start_minute, &window.end_minute);
+    return window;
+}
+
+/**
+ * イテレータを初期化
+ */
+esp_err_t data_buffer_iter_begin(data_buffer_iter_t *it, const data_buffer_window_t *window) {
+    if (it == NULL || window == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(it, 0, sizeof(data_buffer_iter_t));
+    if (!g_initialized) {
+        // 空の範囲として扱う（nextは常にfalse）
+        return ESP_ERR_INVALID_STATE;
+    }
+    it->next_minute = window->start_minute;
+    it->end_minute = window->end_minute;
+    return ESP_OK;
+}
+
+/**
+ * 次の1分データに進む
+ */
+bool data_buffer_iter_next(data_buffer_iter_t *it) {
+    return iter_advance(it, 0, NULL, NULL);
 }
 
-// その他のプライベート関数
+/**
+ * 次の1分データに進み、指定フィールドの値だけを取り出す
+ */
+bool data_buffer_iter_next_fields(data_buffer_iter_t *it, uint16_t field_mask, int32_t *values, uint16_t *valid_mask) {
+    if (field_mask == 0 || values == NULL || valid_mask == NULL) {
+        return false;
+    }
+    return iter_advance(it, field_mask, values, valid_mask);
+}
 
-static bool is_same_day(const struct tm *tm1, const struct tm *tm2) {
-    return (tm1->tm_year == tm2->tm_year && 
-            tm1->tm_mon == tm2->tm_mon && 
-            tm1->tm_mday == tm2->tm_mday);
+/**
+ * イテレータを次の1分データに進める
+ * 1分ずつスロットを直接参照し、値を取り出した前後で書き込みシーケンスが変わっていれば
+ * 同じ分を読み直す（書き込み側は待たせない）
+ * @param field_mask 0: レコード全体を it->record に組み立てる, それ以外: 指定フィールドの列だけを読む
+ */
+static bool iter_advance(data_buffer_iter_t *it, uint16_t field_mask, int32_t *values, uint16_t *valid_mask) {
+    uint32_t attempts = 0;
+    while (it->next_minute < it->end_minute) {
+        uint32_t seq = seqlock_read_begin(&g_minute_lock);
+        uint32_t latest = g_latest_epoch_minute;
+        uint32_t oldest = (latest >= DATA_BUFFER_MINUTE_CAPACITY) ? latest - DATA_BUFFER_MINUTE_CAPACITY + 1 : 0;
+        uint32_t epoch_minute = (it->next_minute < oldest) ? oldest : it->next_minute;
+        
+        bool found = false;
+        if (epoch_minute <= latest && epoch_minute < it->end_minute) {
+            uint16_t slot = minute_slot(epoch_minute);
+            found = slot_holds(slot, epoch_minute);
+            if (found && field_mask == 0) {
+                minute_columns_get(&g_minute_columns, slot, &it->record);
+            } else if (found) {
+                *valid_mask = 0;
+                for (uint16_t m = field_mask; m != 0; m &= (uint16_t)(m - 1)) {
+                    uint8_t f = (uint8_t)__builtin_ctz(m);
+                    if (column_field_raw(slot, f, &values[f])) {
+                        *valid_mask |= (uint16_t)(1u << f);
+                    }
+                }
+            }
+        }
+        if (seqlock_read_retry(&g_minute_lock, seq, &attempts)) {
+            continue;
+        }
+        
+        if (epoch_minute > latest) {
+            // 最新データより先にはまだ何もない
+            return false;
+        }
+        it->next_minute = epoch_minute + 1;
+        if (found) {
+            it->epoch_minute = epoch_minute;
+            return true;
+        }
+    }
+    return false;
 }
 
-static bool is_same_minute(const struct tm *tm1, const struct tm *tm2) {
-    return (tm1->tm_year == tm2->tm_year && 
-            tm1->tm_mon == tm2->tm_mon && 
-            tm1->tm_mday == tm2->tm_mday &&
-            tm1->tm_hour == tm2->tm_hour &&
-            tm1->tm_min == tm2->tm_min);
+/**
+ * 現在位置の時刻を取得
+ */
+time_t data_buffer_iter_time(const data_buffer_iter_t *it) {
+    return (time_t)it->epoch_minute * 60;
 }
 
-static void copy_tm_date_only(struct tm *dest, const struct tm *src) {
-    dest->tm_year = src->tm_year;
-    dest->tm_mon = src->tm_mon;
-    dest->tm_mday = src->tm_mday;
-    dest->tm_hour = 0;
-    dest->tm_min = 0;
-    dest->tm_sec = 0;
-    dest->tm_wday = src->tm_wday;
-    dest->tm_yday = src->tm_yday;
-    dest->tm_isdst = src->tm_isdst;
+/**
+ * 現在位置の気温を取得
+ */
+float data_buffer_iter_temperature(const data_buffer_iter_t *it) {
+    return it->record.temperature / MINUTE_RECORD_TEMP_SCALE;
 }
 
-static void copy_tm_full(struct tm *dest, const struct tm *src) {
-    memcpy(dest, src, sizeof(struct tm));
+/**
+ * 現在位置の湿度を取得
+ */
+float data_buffer_iter_humidity(const data_buffer_iter_t *it) {
+    return it->record.humidity / MINUTE_RECORD_HUMIDITY_SCALE;
 }
 
-static uint16_t get_minute_index_by_time(const struct tm *timestamp) {
-    return (timestamp->tm_hour * 60 + timestamp->tm_min) % DATA_BUFFER_MINUTES_PER_DAY;
+/**
+ * 現在位置の照度を取得
+ */
+float data_buffer_iter_lux(const data_buffer_iter_t *it) {
+    return minute_record_decode_lux(it->record.lux);
 }
 
-static uint8_t get_daily_index_by_date(const struct tm *date) {
-    // 簡易的な日付ハッシュ（月日を基準）
-    return ((date->tm_mon * 31) + date->tm_mday) % DATA_BUFFER_DAYS_PER_MONTH;
+/**
+ * 現在位置の土壌水分を取得
+ */
+float data_buffer_iter_soil_moisture(const data_buffer_iter_t *it) {
+    return minute_record_soil_moisture_raw(&it->record) / MINUTE_RECORD_SOIL_SCALE;
 }
 
 /**
- * 指定された日の1分データを取得
+ * 現在位置の代表土壌温度を取得
  */
-esp_err_t data_buffer_get_day_minute_data(const struct tm *date, 
-                                        minute_data_t *data, 
-                                        uint16_t *count) {
-    if (!g_initialized || date == NULL || data == NULL || count == NULL) {
+bool data_buffer_iter_soil_temperature(const data_buffer_iter_t *it, float *temperature) {
+    int16_t raw;
+    if (!minute_record_soil_temperature_raw(&it->record, &raw)) {
+        return false;
+    }
+    *temperature = raw / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    return true;
+}
+
+/**
+ * 現在位置のレコードを1分データに展開
+ */
+void data_buffer_iter_decode(const data_buffer_iter_t *it, minute_data_t *data) {
+    minute_record_decode(&it->record, it->epoch_minute, data);
+}
+
+/**
+ * 範囲クエリの1行分の集約状態（要求フィールドの順）
+ */
+typedef struct {
+    int64_t  sum[DATA_BUFFER_FIELD_COUNT];
+    int32_t  value[DATA_BUFFER_FIELD_COUNT];   // FIRST / MIN / MAX の現在値
+    uint16_t count[DATA_BUFFER_FIELD_COUNT];
+} query_row_t;
+
+/**
+ * LTTBの1行分の候補点（走査中は選択待ちの行と、その次の行の2つを保持する）
+ */
+typedef struct {
+    int32_t  row;                                  // 行番号（-1: 空）
+    uint8_t  count;
+    uint8_t  offset[DATA_BUFFER_LTTB_MAX_STEP];    // 行内の分
+    int32_t  value[DATA_BUFFER_LTTB_MAX_STEP];     // 生値
+    int64_t  sum_x;                                // 期間の先頭からの分の合計（平均点用）
+    int64_t  sum_y;
+} lttb_bucket_t;
+
+/**
+ * 範囲クエリの列数を取得
+ */
+uint8_t data_buffer_query_columns(const data_buffer_query_t *query) {
+    if (!query_valid(query)) {
+        return 0;
+    }
+    uint8_t columns = (uint8_t)__builtin_popcount(query->field_mask);
+    return (query->aggregate == DATA_BUFFER_AGG_LTTB) ? columns + 1 : columns;
+}
+
+/**
+ * 範囲クエリの全行数を取得
+ */
+uint16_t data_buffer_query_rows(const data_buffer_query_t *query) {
+    if (!g_initialized || !query_valid(query)) {
+        return 0;
+    }
+    uint32_t latest;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        latest = g_latest_epoch_minute;
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+
+    uint32_t end_minute = query->window.end_minute;
+    if (end_minute > latest + 1) {
+        end_minute = latest + 1;
+    }
+    if (end_minute <= query->window.start_minute) {
+        return 0;
+    }
+    uint32_t rows = (end_minute - query->window.start_minute + query->step_minutes - 1) / query->step_minutes;
+    return (rows > DATA_BUFFER_QUERY_MAX_ROWS) ? 0 : (uint16_t)rows;
+}
+
+/**
+ * 範囲クエリの範囲を保持範囲で打ち切って確定し、全行数を取得
+ */
+esp_err_t data_buffer_query_freeze(data_buffer_query_t *query, bool archive, uint16_t *rows) {
+    if (!g_initialized || !query_valid(query) || rows == NULL ||
+        (archive && query->aggregate == DATA_BUFFER_AGG_LTTB)) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    uint16_t result_count = 0;
-    
-    // 指定された日の1分データを収集
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid && is_same_day(date, &g_minute_buffer[i].timestamp)) {
-            if (result_count < DATA_BUFFER_MINUTES_PER_DAY) {
-                memcpy(&data[result_count], &g_minute_buffer[i], sizeof(minute_data_t));
-                result_count++;
+    *rows = 0;
+
+    // 保持している最も古い分（間引き記録は要求フィールドのうち最も古い点）
+    uint32_t latest, first_minute;
+    bool retained;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        latest = g_latest_epoch_minute;
+        retained = false;
+        if (!archive) {
+            uint32_t end_minute;
+            ring_range(latest, &first_minute, &end_minute);
+            retained = (latest != 0);
+        } else {
+            for (uint8_t f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+                uint32_t minute;
+                if ((query->field_mask & (1u << f)) && g_archives[f].deviation > 0 &&
+                    swinging_door_first_minute(&g_archives[f], &minute) && (!retained || minute < first_minute)) {
+                    first_minute = minute;
+                    retained = true;
+                }
             }
         }
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    if (!retained) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // 先頭は行の区切りを保ったまま保持範囲を含む行まで進め、終了は最新データの次の分で打ち切る
+    data_buffer_window_t *window = &query->window;
+    if (window->start_minute < first_minute) {
+        window->start_minute += (first_minute - window->start_minute) / query->step_minutes * query->step_minutes;
+    }
+    if (window->end_minute > latest + 1) {
+        window->end_minute = latest + 1;
+    }
+    if (window->end_minute <= window->start_minute) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t total = (window->end_minute - window->start_minute + query->step_minutes - 1) / query->step_minutes;
+    if (total > DATA_BUFFER_QUERY_MAX_ROWS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *rows = (uint16_t)total;
+    return ESP_OK;
+}
+
+/**
+ * 範囲クエリを実行
+ */
+esp_err_t data_buffer_query(const data_buffer_query_t *query, uint16_t first_row, uint16_t max_rows,
+                            int16_t *columns, uint16_t *rows) {
+    if (!g_initialized || !query_valid(query) || columns == NULL || rows == NULL || max_rows == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return run_query(query, false, first_row, max_rows, columns, rows);
+}
+
+/**
+ * 間引き記録から1分単位に復元した値で範囲クエリを実行
+ */
+esp_err_t data_buffer_query_archive(const data_buffer_query_t *query, uint16_t first_row, uint16_t max_rows,
+                                    int16_t *columns, uint16_t *rows) {
+    if (!g_initialized || !query_valid(query) || query->aggregate == DATA_BUFFER_AGG_LTTB ||
+        columns == NULL || rows == NULL || max_rows == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return run_query(query, true, first_row, max_rows, columns, rows);
+}
+
+/**
+ * 範囲クエリの本体
+ * 範囲内の1分ごとのサンプルを時刻順に1件ずつ取り出し、行が変わった時点で前の行を確定する。
+ * 要求されたフィールドの列だけを整数のまま読む（レコードの組み立てやminute_data_tへの展開はしない）
+ * @param archive true: 間引き記録から復元した値, false: 1分リングの値
+ */
+static esp_err_t run_query(const data_buffer_query_t *query, bool archive, uint16_t first_row, uint16_t max_rows,
+                           int16_t *columns, uint16_t *rows) {
+
+    // 要求フィールドの一覧（列の順）
+    uint8_t fields[DATA_BUFFER_FIELD_COUNT];
+    uint8_t field_count = 0;
+    for (uint8_t f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+        if (query->field_mask & (1u << f)) {
+            fields[field_count++] = f;
+        }
+    }
+
+    uint16_t total_rows = data_buffer_query_rows(query);
+    uint16_t row_count = (first_row < total_rows) ? total_rows - first_row : 0;
+    if (row_count > max_rows) {
+        row_count = max_rows;
+    }
+    *rows = row_count;
+    if (row_count == 0) {
+        return ESP_OK;
+    }
+    uint8_t column_count = data_buffer_query_columns(query);
+    for (int k = 0; k < column_count; k++) {
+        for (int r = 0; r < row_count; r++) {
+            columns[k * max_rows + r] = DATA_BUFFER_QUERY_NONE;
+        }
+    }
+    if (query->aggregate == DATA_BUFFER_AGG_LTTB) {
+        query_lttb(query, fields[0], first_row, row_count, max_rows, columns);
+        return ESP_OK;
+    }
+
+    data_buffer_window_t window;
+    window.start_minute = query->window.start_minute + (uint32_t)first_row * query->step_minutes;
+    window.end_minute = window.start_minute + (uint32_t)row_count * query->step_minutes;
+    if (window.end_minute > query->window.end_minute) {
+        window.end_minute = query->window.end_minute;
+    }
+
+    query_source_t source;
+    query_source_begin(&source, archive, &window);
+    query_row_t acc;
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask = 0;
+    uint32_t epoch_minute = 0;
+    int current = -1;
+    bool more = true;
+    while (more) {
+        more = query_source_next(&source, query->field_mask, &epoch_minute, values, &valid_mask);
+        int row = more ? (int)((epoch_minute - window.start_minute) / query->step_minutes) : -1;
+
+        // 行が変わったら前の行を確定
+        if (row != current && current >= 0) {
+            for (int k = 0; k < field_count; k++) {
+                if (acc.count[k] == 0) {
+                    continue;
+                }
+                int32_t value = acc.value[k];
+                if (query->aggregate == DATA_BUFFER_AGG_AVG) {
+                    int64_t sum = acc.sum[k];
+                    int32_t n = acc.count[k];
+                    value = (int32_t)((sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n);
+                }
+                columns[k * max_rows + current] = query_field_output(fields[k], value);
+            }
+        }
+        if (!more) {
+            break;
+        }
+        if (row != current) {
+            memset(&acc, 0, sizeof(acc));
+            current = row;
+        }
+
+        for (int k = 0; k < field_count; k++) {
+            if (!(valid_mask & (1u << fields[k]))) {
+                continue;
+            }
+            int32_t value = values[fields[k]];
+            if (acc.count[k] == 0) {
+                acc.value[k] = value;
+            } else if ((query->aggregate == DATA_BUFFER_AGG_MIN && value < acc.value[k]) ||
+                       (query->aggregate == DATA_BUFFER_AGG_MAX && value > acc.value[k])) {
+                acc.value[k] = value;
+            }
+            acc.sum[k] += value;
+            acc.count[k]++;
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * 範囲クエリのサンプルの取り出しを開始
+ */
+static void query_source_begin(query_source_t *source, bool archive, const data_buffer_window_t *window) {
+    source->archive = archive;
+    source->next_minute = window->start_minute;
+    source->end_minute = window->end_minute;
+    if (!archive) {
+        data_buffer_iter_begin(&source->it, window);
+    }
+}
+
+/**
+ * 範囲クエリの次のサンプルを取り出す
+ * 1分リングはイテレータで列から、間引き記録は1分ずつ確定点の間を補間して復元する
+ */
+static bool query_source_next(query_source_t *source, uint16_t field_mask, uint32_t *epoch_minute,
+                              int32_t *values, uint16_t *valid_mask) {
+    if (!source->archive) {
+        if (!data_buffer_iter_next_fields(&source->it, field_mask, values, valid_mask)) {
+            return false;
+        }
+        *epoch_minute = source->it.epoch_minute;
+        return true;
+    }
+
+    while (source->next_minute < source->end_minute) {
+        uint32_t minute = source->next_minute++;
+        uint16_t mask;
+        uint32_t attempts = 0, seq;
+        do {
+            seq = seqlock_read_begin(&g_minute_lock);
+            mask = 0;
+            for (uint8_t f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+                if ((field_mask & (1u << f)) && g_archives[f].deviation > 0 &&
+                    swinging_door_value_at(&g_archives[f], minute, &values[f])) {
+                    mask |= 1u << f;
+                }
+            }
+        } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+        if (mask != 0) {
+            *epoch_minute = minute;
+            *valid_mask = mask;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * フィールドの間引き記録の許容誤差を設定（適用は次の1分データの追加時）
+ */
+esp_err_t data_buffer_set_archive_error(data_buffer_field_t field, float error) {
+    if (field >= DATA_BUFFER_FIELD_COUNT || !(error >= 0.0f)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int32_t deviation = (int32_t)(error * field_raw_scale(field));
+    if (error > 0.0f && deviation == 0) {
+        ESP_LOGW(TAG, "Archive error %.4f for field %d is below resolution, archive disabled", error, field);
+    }
+    __atomic_store_n(&g_pending_deviation[field], deviation, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&g_pending_archive_mask, 1u << field, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+/**
+ * 設定された許容誤差を適用（1分リングのライターであるセンサー読み取りタスクから呼び出す）
+ * 許容誤差が変わったフィールドは、1分リングに残っているデータから記録し直す（起動時の復元後に設定した場合も直近24時間分が入る）
+ */
+static void apply_pending_archive_errors(void) {
+    uint32_t mask = __atomic_exchange_n(&g_pending_archive_mask, 0, __ATOMIC_ACQUIRE);
+    for (uint8_t field = 0; mask != 0 && field < DATA_BUFFER_FIELD_COUNT; field++) {
+        if ((mask & (1u << field)) == 0) {
+            continue;
+        }
+        int32_t deviation = __atomic_load_n(&g_pending_deviation[field], __ATOMIC_RELAXED);
+        if (deviation == g_archives[field].deviation && g_archives[field].points != NULL) {
+            continue;
+        }
+
+        uint32_t first_minute, end_minute;
+        ring_range(g_latest_epoch_minute, &first_minute, &end_minute);
+        seqlock_write_begin(&g_minute_lock);
+        swinging_door_init(&g_archives[field], g_archive_points[field], DATA_BUFFER_ARCHIVE_CAPACITY, deviation);
+        for (uint32_t m = first_minute; deviation > 0 && m < end_minute; m++) {
+            uint16_t slot = minute_slot(m);
+            int32_t value;
+            if (minute_columns_is_valid(&g_minute_columns, slot) && column_field_raw(slot, field, &value)) {
+                swinging_door_add(&g_archives[field], m, value);
+            }
+        }
+        seqlock_write_end(&g_minute_lock);
+        ESP_LOGI(TAG, "Archive for field %d: deviation %ld (raw)", field, (long)deviation);
+    }
+}
+
+/**
+ * フィールドの間引き記録の点数を取得
+ */
+uint16_t data_buffer_archive_points(data_buffer_field_t field) {
+    if (field >= DATA_BUFFER_FIELD_COUNT) {
+        return 0;
+    }
+    uint16_t count;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        count = swinging_door_point_count(&g_archives[field]);
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    return count;
+}
+
+/**
+ * 範囲内で1分データのあるエポック分の数を取得
+ */
+uint16_t data_buffer_count_minutes(const data_buffer_window_t *window) {
+    if (!g_initialized || window == NULL) {
+        return 0;
+    }
+
+    uint16_t count;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        uint32_t first_minute, end_minute;
+        ring_range(g_latest_epoch_minute, &first_minute, &end_minute);
+        if (window->start_minute > first_minute) {
+            first_minute = window->start_minute;
+        }
+        if (window->end_minute < end_minute) {
+            end_minute = window->end_minute;
+        }
+        count = (first_minute < end_minute)
+            ? minute_columns_count_range(&g_minute_columns, minute_slot(first_minute), (uint16_t)(end_minute - first_minute))
+            : 0;
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+    return count;
+}
+
+/**
+ * 範囲内の欠測区間を取得
+ */
+esp_err_t data_buffer_get_gaps(const data_buffer_window_t *window, data_buffer_gap_t *gaps, uint16_t max_gaps,
+                               uint16_t *count, uint16_t *total) {
+    if (!g_initialized || window == NULL || count == NULL || (gaps == NULL && max_gaps > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t found, stored;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_minute_lock);
+        found = 0;
+        stored = 0;
+        uint32_t first_minute, end_minute;
+        ring_range(g_latest_epoch_minute, &first_minute, &end_minute);
+        if (window->start_minute > first_minute) {
+            first_minute = window->start_minute;
+        }
+        if (window->end_minute < end_minute) {
+            end_minute = window->end_minute;
+        }
+        if (first_minute >= end_minute) {
+            // 保持範囲と重ならない
+            first_minute = end_minute = window->end_minute;
+        }
+
+        // 区間の並び: 保持範囲より前、保持範囲内の空きの並び、保持範囲より後
+        uint32_t minute = window->start_minute;
+        while (minute < window->end_minute) {
+            uint32_t gap_end;
+            uint8_t reason;
+            if (minute < first_minute || minute >= end_minute) {
+                gap_end = (minute < first_minute) ? first_minute : window->end_minute;
+                reason = DATA_BUFFER_GAP_OUT_OF_RANGE;
+            } else {
+                minute += minute_columns_run_length(&g_minute_columns, minute_slot(minute),
+                                                    (uint16_t)(end_minute - minute), true);
+                if (minute >= end_minute) {
+                    continue;
+                }
+                gap_end = minute + minute_columns_run_length(&g_minute_columns, minute_slot(minute),
+                                                             (uint16_t)(end_minute - minute), false);
+                reason = find_gap_reason(minute, gap_end);
+            }
+            if (stored < max_gaps) {
+                gaps[stored].start_minute = minute;
+                gaps[stored].length = gap_end - minute;
+                gaps[stored].reason = reason;
+                stored++;
+            }
+            found++;
+            minute = gap_end;
+        }
+    } while (seqlock_read_retry(&g_minute_lock, seq, &attempts));
+
+    *count = stored;
+    if (total != NULL) {
+        *total = found;
     }
-    
-    *count = result_count;
-    ESP_LOGD(TAG, "Retrieved %d minute data entries for specified date", result_count);
-    
     return ESP_OK;
 }
 
@@ -562,33 +2689,47 @@ esp_err_t data_buffer_cleanup_old_data(void) {
     
     time_t now;
     time(&now);
-    time_t cutoff_minute = now - (24 * 3600); // 24時間前
-    time_t cutoff_daily = now - (30 * 24 * 3600); // 30日前
+    time_t cutoff_time = now - (DATA_BUFFER_MINUTE_CAPACITY * 60); // 保持期間（24時間）より前
+    uint32_t cutoff_minute = (cutoff_time > 0) ? (uint32_t)((cutoff_time + 59) / 60) : 0;
+    uint32_t now_minute = (now > 0) ? (uint32_t)(now / 60) : 0;
+    uint32_t daily_span = DATA_BUFFER_DAYS_PER_MONTH * DATA_BUFFER_MINUTES_PER_DAY;
+    uint32_t cutoff_daily = (now_minute > daily_span) ? now_minute - daily_span : 0; // 30日前
     
     uint16_t cleaned_minute = 0;
     uint8_t cleaned_daily = 0;
     
-    // 古い1分データを削除
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        if (g_minute_buffer[i].valid) {
-            time_t data_time = mktime((struct tm*)&g_minute_buffer[i].timestamp);
-            if (data_time < cutoff_minute) {
-                g_minute_buffer[i].valid = false;
-                cleaned_minute++;
+    // 古い1分データを削除（保持範囲の先頭から期限までの連続したスロットをビットマップ上で消去）
+    seqlock_write_begin(&g_minute_lock);
+    uint32_t first_minute, end_minute;
+    ring_range(g_latest_epoch_minute, &first_minute, &end_minute);
+    if (cutoff_minute < end_minute) {
+        end_minute = cutoff_minute;
+    }
+    if (first_minute < end_minute) {
+        uint16_t count = (uint16_t)(end_minute - first_minute);
+        uint16_t first_slot = minute_slot(first_minute);
+        cleaned_minute = minute_columns_count_range(&g_minute_columns, first_slot, count);
+        if (cleaned_minute > 0) {
+            minute_columns_erase_range(&g_minute_columns, first_slot, count);
+            log_gap(first_minute, count, DATA_BUFFER_GAP_EXPIRED);
+            if (g_day_acc.count > 0 && first_minute < g_day_acc.day_end && g_day_acc.day_start < end_minute) {
+                // 集計中の日のデータを削除した場合は次回追加時に再集計させる
+                daily_accumulator_reset(&g_day_acc, 0, 0);
             }
         }
     }
+    seqlock_write_end(&g_minute_lock);
     
     // 古い日別データを削除
+    seqlock_write_begin(&g_summary_lock);
     for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        if (g_daily_buffer[i].complete) {
-            time_t data_time = mktime((struct tm*)&g_daily_buffer[i].date);
-            if (data_time < cutoff_daily) {
-                g_daily_buffer[i].complete = false;
-                cleaned_daily++;
-            }
+        if (g_daily_epoch_day[i] != DAILY_DAY_EMPTY && g_daily_start_minute[i] < cutoff_daily) {
+            g_daily_epoch_day[i] = DAILY_DAY_EMPTY;
+            g_daily_buffer[i].complete = false;
+            cleaned_daily++;
         }
     }
+    seqlock_write_end(&g_summary_lock);
     
     ESP_LOGI(TAG, "Cleanup completed: removed %d minute entries, %d daily entries", 
              cleaned_minute, cleaned_daily);
@@ -605,17 +2746,35 @@ esp_err_t data_buffer_clear_all(void) {
     }
     
     // 1分データバッファをクリア
-    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
-        g_minute_buffer[i].valid = false;
-    }
+    seqlock_write_begin(&g_minute_lock);
+    minute_columns_clear(&g_minute_columns);
+    g_latest_epoch_minute = 0;
+    g_last_added_minute = 0;
+    memset(g_gap_log, 0, sizeof(g_gap_log));
+    g_gap_log_next = 0;
+    init_archives();
+    seqlock_write_end(&g_minute_lock);
     
     // 日別データバッファをクリア
-    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
-        g_daily_buffer[i].complete = false;
-    }
+    init_daily_buffer();
+    
+    // 10分/1時間集計をクリア
+    init_rollup_tiers();
+    
+    // 週・月の要約をクリア
+    init_period_stats();
     
-    g_minute_write_index = 0;
-    g_daily_write_index = 0;
+    daily_accumulator_reset(&g_day_acc, 0, 0);
+    
+    // 履歴ログも消去（再起動後に復元されないように）
+    if (g_history_enabled) {
+        history_log_clear(&g_minute_log);
+        history_log_clear(&g_daily_log);
+        for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+            history_log_clear(&g_rollup_logs[t]);
+        }
+        history_log_clear(&g_period_log);
+    }
     
     ESP_LOGI(TAG, "All data buffers cleared");
     
@@ -635,13 +2794,211 @@ esp_err_t data_buffer_recalculate_daily_summary(const struct tm *date) {
     
     if (ret == ESP_OK) {
         // 該当する日別バッファエントリを更新
-        uint8_t daily_index = get_daily_index_by_date(date);
-        if (daily_index < DATA_BUFFER_DAYS_PER_MONTH) {
-            memcpy(&g_daily_buffer[daily_index], &summary, sizeof(daily_summary_data_t));
+        uint32_t day_start, day_end;
+        get_day_epoch_range(date, &day_start, &day_end);
+        if (put_daily_summary(tm_to_epoch_day(date), day_start, &summary) >= 0) {
             ESP_LOGI(TAG, "Daily summary recalculated for %04d-%02d-%02d", 
                      date->tm_year + 1900, date->tm_mon + 1, date->tm_mday);
         }
     }
     
     return ret;
-}
\ No newline at end of file
+}
+
+/**
+ * 範囲クエリの引数を検証
+ */
+static bool query_valid(const data_buffer_query_t *query) {
+    if (query == NULL || query->step_minutes == 0 || query->field_mask == 0 ||
+        (query->field_mask >> DATA_BUFFER_FIELD_COUNT) != 0 ||
+        query->aggregate >= DATA_BUFFER_AGG_COUNT ||
+        query->window.end_minute <= query->window.start_minute) {
+        return false;
+    }
+    if (query->aggregate == DATA_BUFFER_AGG_LTTB) {
+        // LTTBは1フィールドのみ、候補点を保持できる行幅まで
+        return __builtin_popcount(query->field_mask) == 1 && query->step_minutes <= DATA_BUFFER_LTTB_MAX_STEP;
+    }
+    return true;
+}
+
+/**
+ * スロットの1フィールドの生値を列から取り出す（照度は0.01lux単位に展開）
+ * @return false: 値なし（土壌温度センサーが未検出）
+ */
+static bool column_field_raw(uint16_t slot, uint8_t field, int32_t *value) {
+    switch (field) {
+    case DATA_BUFFER_FIELD_TEMPERATURE:
+        *value = g_minute_columns.temperature[slot];
+        return true;
+    case DATA_BUFFER_FIELD_HUMIDITY:
+        *value = g_minute_columns.humidity[slot];
+        return true;
+    case DATA_BUFFER_FIELD_LUX:
+        *value = (int32_t)minute_record_lux_raw(g_minute_columns.lux[slot]);
+        return true;
+    case DATA_BUFFER_FIELD_SOIL_MOISTURE:
+        *value = minute_columns_soil_moisture_raw(&g_minute_columns, slot);
+        return true;
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE: {
+        int16_t raw;
+        if (!minute_columns_soil_temperature_raw(&g_minute_columns, slot, &raw)) {
+            return false;
+        }
+        *value = raw;
+        return true;
+    }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE2:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE3:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE4: {
+        int16_t raw;
+        uint8_t probe = (uint8_t)(field - DATA_BUFFER_FIELD_SOIL_TEMPERATURE2 + 1);
+        if (!minute_record_temp_bits_probe_raw(g_minute_columns.temp_bits[slot], probe, &raw)) {
+            return false;
+        }
+        *value = raw;
+        return true;
+    }
+    default:
+        *value = g_minute_columns.capacitance[field - DATA_BUFFER_FIELD_CAPACITANCE1][slot];
+        return true;
+#else
+    default:
+        return false;
+#endif
+    }
+}
+
+/**
+ * LTTBで行の候補点から1点を選び、列に書き込む
+ * 前の行で選んだ点 A と次の行の平均点 C に対し、三角形 A-B-C の面積が最大の点 B を選ぶ。
+ * C = (sum_x / n, sum_y / n) の割り算を避けるため、面積の n 倍（外積）を整数で比較する。
+ * A がなければ（最初の行）行の先頭の点、C がなければ（最後の行）行の末尾の点を選ぶ
+ * @param prev_x,prev_y 前の行で選んだ点（選んだ点で更新）
+ */
+static void lttb_select(const lttb_bucket_t *bucket, const lttb_bucket_t *next, uint16_t step,
+                        bool *has_prev, int64_t *prev_x, int32_t *prev_y) {
+    int best = 0;
+    if (!*has_prev) {
+        best = 0;
+    } else if (next == NULL) {
+        best = bucket->count - 1;
+    } else {
+        int64_t n = next->count;
+        int64_t dxc = next->sum_x - n * *prev_x;
+        int64_t dyc = next->sum_y - n * (int64_t)*prev_y;
+        int64_t best_area = -1;
+        int64_t row_x = (int64_t)bucket->row * step - *prev_x;
+        for (int i = 0; i < bucket->count; i++) {
+            int64_t area = (row_x + bucket->offset[i]) * dyc - dxc * ((int64_t)bucket->value[i] - *prev_y);
+            if (area < 0) {
+                area = -area;
+            }
+            if (area > best_area) {
+                best_area = area;
+                best = i;
+            }
+        }
+    }
+    *has_prev = true;
+    *prev_x = (int64_t)bucket->row * step + bucket->offset[best];
+    *prev_y = bucket->value[best];
+}
+
+/**
+ * LTTBの選択結果を列に書き込む（出力範囲外の行は無視）
+ */
+static void lttb_output(const lttb_bucket_t *bucket, uint8_t field, uint16_t first_row, uint16_t row_count,
+                        uint16_t max_rows, int16_t *columns, int64_t x, int32_t y, uint16_t step) {
+    if (bucket->row < first_row || bucket->row >= first_row + row_count) {
+        return;
+    }
+    int r = bucket->row - first_row;
+    columns[r] = query_field_output(field, y);
+    columns[max_rows + r] = (int16_t)(x - (int64_t)bucket->row * step);
+}
+
+/**
+ * LTTBで範囲クエリを実行
+ * 選択は前の行の結果に依存するため、分割取得でも期間の先頭から走査する（出力範囲の次の
+ * データのある行まで読めば打ち切る）。保持するのは選択待ちの行と次の行の候補点のみ
+ */
+static void query_lttb(const data_buffer_query_t *query, uint8_t field, uint16_t first_row, uint16_t row_count,
+                       uint16_t max_rows, int16_t *columns) {
+    lttb_bucket_t buckets[2];
+    lttb_bucket_t *pending = &buckets[0];   // 次の行の平均点待ち
+    lttb_bucket_t *next = &buckets[1];      // 走査中の行
+    pending->row = -1;
+    next->row = -1;
+    int32_t last_row = first_row + row_count - 1;
+    uint16_t step = query->step_minutes;
+
+    bool has_prev = false;
+    int64_t prev_x = 0;
+    int32_t prev_y = 0;
+    bool done = false;
+
+    data_buffer_iter_t it;
+    data_buffer_iter_begin(&it, &query->window);
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    while (data_buffer_iter_next_fields(&it, query->field_mask, values, &valid_mask)) {
+        if (valid_mask == 0) {
+            continue;
+        }
+        int32_t value = values[field];
+        int64_t x = it.epoch_minute - query->window.start_minute;
+        int32_t row = (int32_t)(x / step);
+
+        // 走査中の行が確定したら、その平均点を使って選択待ちの行を選ぶ
+        if (row != next->row) {
+            if (next->row >= 0) {
+                if (pending->row >= 0) {
+                    lttb_select(pending, next, step, &has_prev, &prev_x, &prev_y);
+                    lttb_output(pending, field, first_row, row_count, max_rows, columns, prev_x, prev_y, step);
+                }
+                lttb_bucket_t *tmp = pending;
+                pending = next;
+                next = tmp;
+                if (pending->row > last_row) {
+                    done = true;
+                    break;
+                }
+            }
+            next->row = row;
+            next->count = 0;
+            next->sum_x = 0;
+            next->sum_y = 0;
+        }
+        next->offset[next->count] = (uint8_t)(x - (int64_t)row * step);
+        next->value[next->count] = value;
+        next->count++;
+        next->sum_x += x;
+        next->sum_y += value;
+    }
+
+    // 期間の終わり: 最後の行は次の行がないので末尾の点を選ぶ
+    if (!done) {
+        if (pending->row >= 0) {
+            lttb_select(pending, (next->row >= 0) ? next : NULL, step, &has_prev, &prev_x, &prev_y);
+            lttb_output(pending, field, first_row, row_count, max_rows, columns, prev_x, prev_y, step);
+        }
+        if (next->row >= 0) {
+            lttb_select(next, NULL, step, &has_prev, &prev_x, &prev_y);
+            lttb_output(next, field, first_row, row_count, max_rows, columns, prev_x, prev_y, step);
+        }
+    }
+}
+
+/**
+ * 集約した生値を列の16bit値に変換（照度は16bit符号に戻す）
+ */
+static int16_t query_field_output(uint8_t field, int32_t value) {
+    if (field == DATA_BUFFER_FIELD_LUX) {
+        return (int16_t)minute_record_encode_lux(value / MINUTE_RECORD_LUX_SCALE);
+    }
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value <= INT16_MIN) return INT16_MIN + 1;
+    return (int16_t)value;
+}
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include "esp_err.h"
 #include "../../common_types.h" // 修正：plant_manager.hの代わりにcommon_types.hをインクルード
+#include "minute_record.h"
+#include "quantile_sketch.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,6 +15,28 @@ extern "C" {
 // バッファサイズ定数
 #define DATA_BUFFER_MINUTES_PER_DAY     (24 * 60)  // 1440分/日
 #define DATA_BUFFER_DAYS_PER_MONTH      30         // 30日/月
+#define DATA_BUFFER_MINUTE_CAPACITY     DATA_BUFFER_MINUTES_PER_DAY  // 1分データ保持数（24時間）
+#define DATA_BUFFER_TIER10_MINUTES      10         // 10分集計の区間長
+#define DATA_BUFFER_TIER10_CAPACITY     (7 * 24 * 6)   // 10分集計の保持数（7日分）
+#define DATA_BUFFER_HOURLY_MINUTES      60         // 1時間集計の区間長
+#define DATA_BUFFER_HOURLY_CAPACITY     (31 * 24)  // 1時間集計の保持数（31日分）
+#define DATA_BUFFER_CHANNEL_HOURLY_CAPACITY (7 * 24) // チャンネル別1時間集計の保持数（7日分、RAMのみ）
+
+// 履歴パーティションの領域割り当て（先頭から日別 → 10分集計 → 1時間集計 → 1分データ）
+#define DATA_BUFFER_HISTORY_DAILY_REGION  (32 * 4096)  // 日別サマリー領域（1日1ページ x 32）
+#define DATA_BUFFER_HISTORY_TIER10_REGION (24 * 4096)  // 10分集計領域（RAMの7日分を十分に上回る）
+#define DATA_BUFFER_HISTORY_HOURLY_REGION (48 * 4096)  // 1時間集計領域（RAMの31日分を十分に上回る）
+#define DATA_BUFFER_HISTORY_PERIOD_REGION (16 * 4096)  // 週・月の要約領域（確定した週・月、約1年半分）
+
+// 週・月の要約（結合可能な要約を日の確定ごとに結合）
+#define DATA_BUFFER_STATS_DAYS          32         // 日ごとの要約の保持数（当月の全日 + 当日）
+#define DATA_BUFFER_MERGE_MAX_DAYS      31         // 結合できる日の範囲の最大日数（BLEの日の範囲と同じ）
+#define DATA_BUFFER_STATS_WEEKS         12         // 週の要約の保持数（月曜始まり）
+#define DATA_BUFFER_STATS_MONTHS        12         // 月の要約の保持数
+
+// 再起動用の退避（ソフトウェアリセットで消えないRAMに直近の1分データを圧縮して保持）
+#define DATA_BUFFER_SNAPSHOT_HOURS      6          // 退避する時間数（履歴ログの未封印ページ約2時間分を含む）
+#define DATA_BUFFER_SNAPSHOT_SIZE       4096       // 圧縮ブロックの最大サイズ [byte]（約8.5バイト/分）
 
 /**
  * 1分間隔のセンサーデータ構造体
@@ -58,10 +82,79 @@ typedef struct daily_summary_data_t {
     float max_soil_temperature;        // 最高土壌温度
     float min_soil_temperature;        // 最低土壌温度
     float avg_soil_temperature;        // 平均土壌温度
+    // 分位点（P²法による逐次推定、添字 DAILY_QUANTILE_P10 / P50 / P90）
+    float temperature_quantiles[DAILY_QUANTILE_COUNT];       // 気温
+    float humidity_quantiles[DAILY_QUANTILE_COUNT];          // 湿度
+    float lux_quantiles[DAILY_QUANTILE_COUNT];               // 照度
+    float soil_moisture_quantiles[DAILY_QUANTILE_COUNT];     // 土壌水分
+    float soil_temperature_quantiles[DAILY_QUANTILE_COUNT];  // 土壌温度（センサー未接続の日は0）
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // チャンネル別（静電容量 FDC1004 ch1〜4、土壌温度 TMP102[0..3] = 深さ 12.5/40/65/90mm）
+    float min_capacitance[FDC1004_CHANNEL_COUNT];            // 最小静電容量 [pF]
+    float avg_capacitance[FDC1004_CHANNEL_COUNT];            // 平均静電容量 [pF]
+    float max_capacitance[FDC1004_CHANNEL_COUNT];            // 最大静電容量 [pF]
+    float min_probe_temperature[TMP102_MAX_DEVICES];         // 最低土壌温度 [℃]（有効サンプルなし: 999）
+    float avg_probe_temperature[TMP102_MAX_DEVICES];         // 平均土壌温度 [℃]（有効サンプルなし: 0）
+    float max_probe_temperature[TMP102_MAX_DEVICES];         // 最高土壌温度 [℃]（有効サンプルなし: -999）
+    uint8_t probe_valid_mask;                                // 有効サンプルのあった土壌温度センサー（bit i: TMP102[i]）
+#endif
     uint16_t valid_samples;            // 有効サンプル数
     bool complete;                     // 1日分のデータが完全か
 } daily_summary_data_t;
 
+/**
+ * 履歴データの階層（細かい順）
+ */
+typedef enum {
+    DATA_BUFFER_TIER_MINUTE = 0,       // 1分データ（24時間）
+    DATA_BUFFER_TIER_10MIN,            // 10分集計（7日）
+    DATA_BUFFER_TIER_HOURLY,           // 1時間集計（31日）
+    DATA_BUFFER_TIER_COUNT
+} data_buffer_tier_t;
+
+/**
+ * 履歴データ点（1分データまたは10分/1時間集計の1区間）
+ * 集計階層の最小/最大は量子化誤差の分だけ外側に広がる（実際の値を必ず包含する）
+ */
+typedef struct history_point_data_t {
+    struct tm timestamp;               // 区間の開始時刻
+    uint16_t samples;                  // 区間内の1分データ数
+    float min_temperature;             // 最低気温
+    float avg_temperature;             // 平均気温
+    float max_temperature;             // 最高気温
+    float min_humidity;                // 最低湿度
+    float avg_humidity;                // 平均湿度
+    float max_humidity;                // 最高湿度
+    float min_lux;                     // 最小照度
+    float avg_lux;                     // 平均照度
+    float max_lux;                     // 最大照度
+    float min_soil_moisture;           // 最小土壌水分
+    float avg_soil_moisture;           // 平均土壌水分
+    float max_soil_moisture;           // 最大土壌水分
+    float min_soil_temperature;        // 最低土壌温度
+    float avg_soil_temperature;        // 平均土壌温度
+    float max_soil_temperature;        // 最高土壌温度
+    bool soil_temperature_valid;       // 土壌温度の有効性
+} history_point_data_t;
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * チャンネル別の1時間集計（根域の深さ方向プロファイル）
+ * 最小/最大は history_point_data_t と同様に量子化誤差の分だけ外側に広がる
+ */
+typedef struct channel_point_data_t {
+    struct tm timestamp;                               // 区間の開始時刻
+    uint16_t samples;                                  // 区間内の1分データ数
+    float min_capacitance[FDC1004_CHANNEL_COUNT];      // 最小静電容量 [pF]
+    float avg_capacitance[FDC1004_CHANNEL_COUNT];      // 平均静電容量 [pF]
+    float max_capacitance[FDC1004_CHANNEL_COUNT];      // 最大静電容量 [pF]
+    float min_probe_temperature[TMP102_MAX_DEVICES];   // 最低土壌温度 [℃]
+    float avg_probe_temperature[TMP102_MAX_DEVICES];   // 平均土壌温度 [℃]
+    float max_probe_temperature[TMP102_MAX_DEVICES];   // 最高土壌温度 [℃]
+    uint8_t probe_valid_mask;                          // 有効サンプルのあった土壌温度センサー（bit i: TMP102[i]）
+} channel_point_data_t;
+#endif
+
 /**
  * データバッファの統計情報
  */
@@ -78,17 +171,35 @@ typedef struct {
 
 /**
  * データバッファシステムを初期化
+ * historyパーティションがある場合は、履歴ログからバッファを復元する
  * @return ESP_OK on success
  */
 esp_err_t data_buffer_init(void);
 
 /**
  * 1分間隔のセンサーデータを追加
+ * 時計が24時間以内で日付をまたいで戻り、確定済みの日に入るサンプルは格納しない
  * @param sensor_data 追加するセンサーデータ
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the sample falls in an already closed day
  */
 esp_err_t data_buffer_add_minute_data(const soil_data_t *sensor_data);
 
+/**
+ * 未書き込みの1分データをフラッシュの履歴ログに書き出す
+ * 再起動前に呼び出すと、書き戻しバッファ内のデータも次回起動時に復元される。
+ * 履歴ログは data_buffer_add_minute_data と同じタスク（センサー読み取りタスク）からだけ書き込む（他のタスクからは依頼する）
+ * @return ESP_OK on success
+ */
+esp_err_t data_buffer_flush(void);
+
+/**
+ * 直近 DATA_BUFFER_SNAPSHOT_HOURS 時間の1分データを圧縮し、CRC付きでソフトウェアリセットで消えないRAMに退避
+ * ターゲットでは esp_restart() のシャットダウンハンドラとして登録しており、次回の data_buffer_init が
+ * 最初のサンプルより前に復元する（履歴ログより新しい分のみ。電源投入時・CRC不一致は使用しない）
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no minute data
+ */
+esp_err_t data_buffer_save_snapshot(void);
+
 /**
  * 指定された時刻の1分データを取得
  * @param timestamp 取得したい時刻
@@ -112,6 +223,14 @@ esp_err_t data_buffer_get_daily_summary(const struct tm *date, daily_summary_dat
  */
 esp_err_t data_buffer_get_latest_minute_data(minute_data_t *data);
 
+/**
+ * 直近に data_buffer_add_minute_data で格納した1件のエポック分を取得
+ * 格納した時刻の変換（mktime）をやり直さずに、同じタスクでその1件を参照するために使う
+ * （data_buffer_add_minute_data と同じタスクからだけ呼び出す）
+ * @return エポック分（0: 未格納）
+ */
+uint32_t data_buffer_get_last_added_minute(void);
+
 /**
  * 最新の日別サマリーデータを取得
  * @param summary 取得したサマリーデータの格納先
@@ -120,9 +239,11 @@ esp_err_t data_buffer_get_latest_minute_data(minute_data_t *data);
 esp_err_t data_buffer_get_latest_daily_summary(daily_summary_data_t *summary);
 
 /**
- * 過去N日間の日別サマリーデータを取得
+ * 過去N日間の日別サマリーデータを取得（古い順に格納）
+ * 最新日から遡って完全な日（complete）をN日分返す。日別バッファはエポック日で
+ * 直接参照するため、並べ替えや作業用のコピーは行わない
  * @param days 取得したい日数（最大30日）
- * @param summaries 取得したサマリーデータの配列（呼び出し側で確保）
+ * @param summaries 取得したサマリーデータの配列（呼び出し側で days 要素確保）
  * @param count 実際に取得できた日数
  * @return ESP_OK on success
  */
@@ -131,9 +252,72 @@ esp_err_t data_buffer_get_recent_daily_summaries(uint8_t days,
                                                 uint8_t *count);
 
 /**
- * 過去N時間の1分データを取得
+ * 新しい方からindex番目（0: 最新）の完全な日別サマリーデータを1件取得
+ * 配列を確保せずに過去N日を順に調べる場合に使用する
+ * @param index 最新から数えた番号（最大29）
+ * @param summary 取得したサマリーデータの格納先
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if not found
+ */
+esp_err_t data_buffer_get_recent_daily_summary(uint8_t index, daily_summary_data_t *summary);
+
+/**
+ * 週・月の要約の期間
+ */
+typedef enum {
+    DATA_BUFFER_PERIOD_WEEK = 0,       // 月曜0:00からの7日
+    DATA_BUFFER_PERIOD_MONTH,          // 1日0:00からの1か月
+} data_buffer_period_t;
+
+/**
+ * 1フィールドの期間統計（単位は日別サマリーと同じ）
+ */
+typedef struct {
+    uint16_t samples;                               // 1分データ数
+    float mean;                                     // 平均
+    float stddev;                                   // 標準偏差
+    float min;                                      // 最小
+    float max;                                      // 最大
+    float quantiles[DAILY_QUANTILE_COUNT];          // p10 / p50 / p90（ヒストグラムから推定）
+} data_buffer_field_stats_t;
+
+/**
+ * 期間統計（週・月・任意の日の範囲、気温・湿度・照度・土壌水分・土壌温度 = quantile_field_t の順）
+ */
+typedef struct {
+    struct tm start;                                        // 期間の開始日
+    uint8_t days;                                           // データのあった日数
+    data_buffer_field_stats_t field[QUANTILE_FIELD_COUNT];
+} data_buffer_period_stats_t;
+
+/**
+ * 指定日を含む週または月の統計を取得
+ * 週・月の要約は日が確定する（日付が変わる）たびに、その日の要約を結合して更新する。
+ * 書き込み中の日は含まない。確定した週・月は履歴ログに保存され、再起動後も残る
+ * @param period 期間
+ * @param date 期間内の日付
+ * @param stats 格納先
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the period is not held
+ */
+esp_err_t data_buffer_get_period_stats(data_buffer_period_t period, const struct tm *date,
+                                       data_buffer_period_stats_t *stats);
+
+/**
+ * 任意の日の範囲の要約を結合した統計を取得（O(日数)）
+ * 日ごとの要約（直近 DATA_BUFFER_STATS_DAYS 日、書き込み中の日を含む）を結合する
+ * @param first_date 最初の日
+ * @param last_date 最後の日（この日を含む、first_date から最大 DATA_BUFFER_MERGE_MAX_DAYS 日間）
+ * @param stats 格納先
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the range is reversed or longer than DATA_BUFFER_MERGE_MAX_DAYS,
+ *         ESP_ERR_NOT_FOUND if no data
+ */
+esp_err_t data_buffer_merge_days(const struct tm *first_date, const struct tm *last_date,
+                                 data_buffer_period_stats_t *stats);
+
+/**
+ * 過去N時間の1分データを取得（古い順に格納）
+ * data_buffer_iter_* によるコピー版。配列を確保できない場合はイテレータを直接使うこと
  * @param hours 取得したい時間数（最大24時間）
- * @param data 取得したデータの配列（呼び出し側で確保）
+ * @param data 取得したデータの配列（呼び出し側で hours*60 要素確保）
  * @param count 実際に取得できたデータ数
  * @return ESP_OK on success
  */
@@ -143,6 +327,7 @@ esp_err_t data_buffer_get_recent_minute_data(uint8_t hours,
 
 /**
  * 指定された日の1分データを取得
+ * data_buffer_iter_* によるコピー版。配列を確保できない場合はイテレータを直接使うこと
  * @param date 取得したい日付
  * @param data 取得したデータの配列（呼び出し側で1440要素確保）
  * @param count 実際に取得できたデータ数
@@ -152,6 +337,341 @@ esp_err_t data_buffer_get_day_minute_data(const struct tm *date,
                                         minute_data_t *data, 
                                         uint16_t *count);
 
+/**
+ * 1分データの走査範囲（エポック分, UTC, 1970-01-01からの経過分）
+ */
+typedef struct {
+    uint32_t start_minute;      // 開始（この分を含む）
+    uint32_t end_minute;        // 終了（この分を含まない）
+} data_buffer_window_t;
+
+/**
+ * 1分データのイテレータ
+ * リングを時刻順に辿り、配列へのコピーやminute_data_tへの展開をせずに1件ずつ参照する。
+ * 現在位置のレコード（列から組み立てたパック形式1件分）だけを書き込みと重なっていないことを確認して保持するため、
+ * 走査中に別タスクが data_buffer_add_minute_data を呼んでも壊れた値は返さない
+ * （走査中に上書きされた分は読み飛ばし、新しく追加された分は範囲内なら返す）。
+ */
+typedef struct {
+    uint32_t next_minute;       // 次に調べるエポック分
+    uint32_t end_minute;        // 走査範囲の終了（含まない）
+    uint32_t epoch_minute;      // 現在位置のエポック分
+    minute_record_t record;     // 現在位置のレコード
+} data_buffer_iter_t;
+
+/**
+ * 過去N分の走査範囲を作成（現在時刻からN分前より後のデータ）
+ * @param minutes 分数
+ * @return 走査範囲
+ */
+data_buffer_window_t data_buffer_window_recent(uint16_t minutes);
+
+/**
+ * 指定日の走査範囲を作成（ローカル時刻の0:00〜24:00）
+ * @param date 日付
+ * @return 走査範囲
+ */
+data_buffer_window_t data_buffer_window_day(const struct tm *date);
+
+/**
+ * イテレータを初期化
+ * @param it 対象イテレータ
+ * @param window 走査範囲
+ * @return ESP_OK on success
+ */
+esp_err_t data_buffer_iter_begin(data_buffer_iter_t *it, const data_buffer_window_t *window);
+
+/**
+ * 次の1分データに進む（古い順）
+ * @param it 対象イテレータ
+ * @return true: 現在位置にデータあり, false: 走査終了
+ */
+bool data_buffer_iter_next(data_buffer_iter_t *it);
+
+/**
+ * 現在位置の時刻を取得
+ * @param it 対象イテレータ
+ * @return UNIX時刻
+ */
+time_t data_buffer_iter_time(const data_buffer_iter_t *it);
+
+/**
+ * 現在位置の気温を取得
+ * @param it 対象イテレータ
+ * @return 気温 (℃)
+ */
+float data_buffer_iter_temperature(const data_buffer_iter_t *it);
+
+/**
+ * 現在位置の湿度を取得
+ * @param it 対象イテレータ
+ * @return 湿度 (%)
+ */
+float data_buffer_iter_humidity(const data_buffer_iter_t *it);
+
+/**
+ * 現在位置の照度を取得
+ * @param it 対象イテレータ
+ * @return 照度 (lux)
+ */
+float data_buffer_iter_lux(const data_buffer_iter_t *it);
+
+/**
+ * 現在位置の土壌水分を取得（minute_data_t.soil_moisture と同じ単位）
+ * @param it 対象イテレータ
+ * @return 土壌水分 (Rev3/Rev4: 最大静電容量 pF, Rev1/Rev2: mV)
+ */
+float data_buffer_iter_soil_moisture(const data_buffer_iter_t *it);
+
+/**
+ * 現在位置の代表土壌温度を取得（Rev3/Rev4: TMP102[0], Rev1/Rev2: 土壌温度1）
+ * @param it 対象イテレータ
+ * @param temperature 土壌温度 (℃) の格納先
+ * @return true: 有効な値あり
+ */
+bool data_buffer_iter_soil_temperature(const data_buffer_iter_t *it, float *temperature);
+
+/**
+ * 現在位置のレコードを1分データに展開
+ * @param it 対象イテレータ
+ * @param data 格納先
+ */
+void data_buffer_iter_decode(const data_buffer_iter_t *it, minute_data_t *data);
+
+/**
+ * 範囲クエリで取得するフィールド（列の値は1分データのパック形式と同じ整数単位）
+ */
+typedef enum {
+    DATA_BUFFER_FIELD_TEMPERATURE = 0,     // 気温 [0.01℃]
+    DATA_BUFFER_FIELD_HUMIDITY,            // 湿度 [0.01%]
+    DATA_BUFFER_FIELD_LUX,                 // 照度（minute_record_encode_lux形式、uint16として解釈）
+    DATA_BUFFER_FIELD_SOIL_MOISTURE,       // 土壌水分 [1/MINUTE_RECORD_SOIL_SCALE]
+    DATA_BUFFER_FIELD_SOIL_TEMPERATURE,    // 代表土壌温度 [1/16℃]
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    DATA_BUFFER_FIELD_CAPACITANCE1,        // 静電容量 ch1〜4 [1/2048 pF]
+    DATA_BUFFER_FIELD_CAPACITANCE2,
+    DATA_BUFFER_FIELD_CAPACITANCE3,
+    DATA_BUFFER_FIELD_CAPACITANCE4,
+    DATA_BUFFER_FIELD_SOIL_TEMPERATURE2,   // 土壌温度 TMP102[1..3]（深さ順）[1/16℃]
+    DATA_BUFFER_FIELD_SOIL_TEMPERATURE3,
+    DATA_BUFFER_FIELD_SOIL_TEMPERATURE4,
+#endif
+    DATA_BUFFER_FIELD_COUNT
+} data_buffer_field_t;
+
+/**
+ * 次の1分データに進み、指定フィールドの値だけを列から取り出す（古い順）
+ * 1分データは列形式（フィールドごとの配列）で保持しているため、レコード全体を組み立てずに
+ * 要求フィールドの列だけを読む。1〜2フィールドだけを走査する集計に使う（it->record は更新しない）
+ * @param it 対象イテレータ
+ * @param field_mask 取り出すフィールド（bit f: data_buffer_field_t）
+ * @param values 格納先（DATA_BUFFER_FIELD_COUNT要素、values[f] に1分データのパック形式の生値。照度は0.01lux単位）
+ * @param valid_mask 値のあったフィールド（土壌温度センサーが未検出の分はビットが立たない）
+ * @return true: 現在位置にデータあり, false: 走査終了
+ */
+bool data_buffer_iter_next_fields(data_buffer_iter_t *it, uint16_t field_mask, int32_t *values, uint16_t *valid_mask);
+
+/**
+ * 範囲クエリの1行内の集約方法
+ */
+typedef enum {
+    DATA_BUFFER_AGG_FIRST = 0,             // 行の先頭のサンプル
+    DATA_BUFFER_AGG_AVG,                   // 平均（四捨五入）
+    DATA_BUFFER_AGG_MIN,                   // 最小
+    DATA_BUFFER_AGG_MAX,                   // 最大
+    DATA_BUFFER_AGG_LTTB,                  // LTTB（Largest-Triangle-Three-Buckets）で選んだ1点
+    DATA_BUFFER_AGG_COUNT
+} data_buffer_aggregate_t;
+
+#define DATA_BUFFER_QUERY_NONE      INT16_MIN  // データのない行（照度の符号値としても現れない）
+#define DATA_BUFFER_LTTB_MAX_STEP   60         // LTTBの1行の最大分数（走査中に保持する候補点数の上限）
+#define DATA_BUFFER_QUERY_MAX_ROWS  UINT16_MAX // 範囲クエリの最大行数
+
+/**
+ * 範囲クエリ（グラフ描画用に、期間をstep_minutesごとの行に区切って指定フィールドだけを集約する）
+ * 行 r は [window.start_minute + r * step_minutes, + step_minutes) の1分データを集約する。
+ *
+ * DATA_BUFFER_AGG_LTTB では各行から実在する1点を、前の行で選んだ点と次の行の平均点とで作る
+ * 三角形の面積が最大になるように選ぶ（最初の点と最後の点は必ず残る）。平均と違い山や谷が
+ * 潰れないので、1日分を200点程度に減らしてもグラフの形が保たれる。field_mask は1フィールドのみ、
+ * step_minutes は DATA_BUFFER_LTTB_MAX_STEP 以下とし、値の列の後ろに選んだ点の行内の分（0〜step_minutes-1）の列が付く
+ */
+typedef struct {
+    data_buffer_window_t window;           // 走査範囲（終了は最新データの次の分で打ち切る）
+    uint16_t step_minutes;                 // 1行の分数（1: 間引きなし）
+    uint16_t field_mask;                   // 取得するフィールド（bit f: data_buffer_field_t）
+    data_buffer_aggregate_t aggregate;     // 1行内の集約方法
+} data_buffer_query_t;
+
+/**
+ * 範囲クエリの列数を取得（要求フィールド数、LTTBは分の列を含めて2）
+ * @param query クエリ
+ * @return 列数（不正なクエリの場合は0）
+ */
+uint8_t data_buffer_query_columns(const data_buffer_query_t *query);
+
+/**
+ * 範囲クエリの全行数を取得
+ * @param query クエリ
+ * @return 行数（不正なクエリ、または DATA_BUFFER_QUERY_MAX_ROWS を超える場合は0）
+ */
+uint16_t data_buffer_query_rows(const data_buffer_query_t *query);
+
+/**
+ * 範囲クエリの範囲を保持しているデータの範囲で打ち切って確定し、全行数を取得
+ * 先頭は保持範囲（1分リング、または要求フィールドの間引き記録の最も古い点）を含む行まで
+ * step_minutes 単位で進め、終了は現在の最新データの次の分で打ち切る。
+ * 行を分けて取得する前に1回呼び出すと、取得の途中で1分データが追加されても全行数と各行の範囲は変わらない
+ * @param query クエリ（window を書き換える。先頭を進めた分は元の開始からの差で分かる）
+ * @param archive true: 間引き記録から取得する（data_buffer_query_archive）, false: 1分リングから取得する
+ * @param rows 行数
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the query is invalid,
+ *         ESP_ERR_NOT_FOUND if no data is retained in the window,
+ *         ESP_ERR_INVALID_SIZE if the window exceeds DATA_BUFFER_QUERY_MAX_ROWS rows
+ */
+esp_err_t data_buffer_query_freeze(data_buffer_query_t *query, bool archive, uint16_t *rows);
+
+/**
+ * 範囲クエリを実行し、要求フィールドごとの列に格納
+ * 1分リングを範囲の先頭から1回だけ走査し、要求されたフィールドのみを取り出して集約する。
+ * 行を分けて呼び出せば（first_row）、大きな結果を小さなバッファで順に取得できる
+ * @param query クエリ
+ * @param first_row 取得する先頭の行
+ * @param max_rows 取得する最大行数（列の長さ）
+ * @param columns 出力先（data_buffer_query_columns() × max_rows 要素）。フィールド番号の小さい順に
+ *                列を並べ、k番目の列の行 first_row + r は columns[k * max_rows + r] に格納する
+ * @param rows 実際に格納した行数
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the query is invalid
+ */
+esp_err_t data_buffer_query(const data_buffer_query_t *query, uint16_t first_row, uint16_t max_rows,
+                            int16_t *columns, uint16_t *rows);
+
+#define DATA_BUFFER_ARCHIVE_CAPACITY    128  // 間引き記録の1フィールドあたりの確定点数
+
+/**
+ * フィールドの間引き記録（スイングドア方式）の許容誤差を設定
+ * 許容誤差が0より大きいフィールドは1分データの追加ごとに記録し、値が許容誤差の帯を外れた時だけ点を確定する。
+ * ゆっくり変化するフィールド（深い位置の土壌温度など）は、1分リング（24時間）より長い期間を
+ * 少ない点数で保持し、許容誤差以内で1分単位に復元できる（RAMのみ）。
+ * 許容誤差を変更したフィールドは、それまでの記録を破棄して1分リングに残っているデータから記録し直す。
+ * どのタスクからも呼び出せる。適用（記録し直し）は1分リングのライターが次に data_buffer_add_minute_data を呼んだ時に行う
+ * @param field フィールド
+ * @param error 許容誤差（フィールドの単位: ℃, %, lux, 土壌水分・静電容量は pF (Rev3/Rev4) / mV）。0: 記録しない
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if field or error is invalid
+ */
+esp_err_t data_buffer_set_archive_error(data_buffer_field_t field, float error);
+
+/**
+ * フィールドの間引き記録の点数を取得
+ * @param field フィールド
+ * @return 点数（確定点 + 未確定の最後のサンプル）
+ */
+uint16_t data_buffer_archive_points(data_buffer_field_t field);
+
+/**
+ * 間引き記録から1分単位に復元した値で範囲クエリを実行
+ * 行・列の形式は data_buffer_query と同じ（LTTBは不可）。復元値と元の1分データの差は許容誤差以内。
+ * 記録していないフィールドの列と、記録の範囲外・欠測の行は DATA_BUFFER_QUERY_NONE
+ * @param query クエリ
+ * @param first_row 取得する先頭の行
+ * @param max_rows 取得する最大行数（列の長さ）
+ * @param columns 出力先（data_buffer_query と同じ並び）
+ * @param rows 実際に格納した行数
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the query is invalid
+ */
+esp_err_t data_buffer_query_archive(const data_buffer_query_t *query, uint16_t first_row, uint16_t max_rows,
+                                    int16_t *columns, uint16_t *rows);
+
+/**
+ * 欠測区間の原因
+ */
+typedef enum {
+    DATA_BUFFER_GAP_UNKNOWN = 0,        // 不明（復元したデータの欠測など）
+    DATA_BUFFER_GAP_REBOOT,             // 再起動で記録が途切れた
+    DATA_BUFFER_GAP_STALL,              // 経過時間どおりに記録が止まっていた（センサー読み出しの停止など）
+    DATA_BUFFER_GAP_TIME_JUMP,          // 時刻が経過時間より大きく進んだ、または保持範囲より前に戻った（時刻同期など）
+    DATA_BUFFER_GAP_EXPIRED,            // 保持期間を過ぎて削除した
+    DATA_BUFFER_GAP_OUT_OF_RANGE,       // 1分リングの保持範囲外（最新データより前の24時間より古い、または最新データより新しい）
+} data_buffer_gap_reason_t;
+
+#define DATA_BUFFER_GAP_LOG_SIZE    16  // 記録する欠測の件数（古いものから上書き）
+
+/**
+ * 欠測区間（データのない連続したエポック分）
+ */
+typedef struct {
+    uint32_t start_minute;      // 開始エポック分
+    uint32_t length;            // 分数
+    uint8_t reason;             // 原因（data_buffer_gap_reason_t）
+} data_buffer_gap_t;
+
+/**
+ * 範囲内で1分データのあるエポック分の数を取得
+ * 有効ビットマップのpopcountで数える（32分単位）
+ * @param window 範囲
+ * @return データのある分の数
+ */
+uint16_t data_buffer_count_minutes(const data_buffer_window_t *window);
+
+/**
+ * 範囲内の欠測区間を取得（古い順）
+ * 有効ビットマップの0の並びを区間にまとめ、記録時に検出した欠測の原因を対応付ける。
+ * 1分リングの保持範囲外の部分は DATA_BUFFER_GAP_OUT_OF_RANGE の区間として返す
+ * @param window 範囲
+ * @param gaps 欠測区間の格納先（max_gaps 要素）
+ * @param max_gaps 格納する最大件数
+ * @param count 実際に格納した件数
+ * @param total 範囲内の欠測区間の総数（NULL可）
+ * @return ESP_OK on success
+ */
+esp_err_t data_buffer_get_gaps(const data_buffer_window_t *window, data_buffer_gap_t *gaps, uint16_t max_gaps,
+                               uint16_t *count, uint16_t *total);
+
+/**
+ * 指定期間の履歴データを取得（古い順に格納）
+ * 期間の開始時刻を保持しており、区間数がmax_points以下になる最も細かい階層を自動で選択する
+ * （どの階層でも収まらない場合は1時間集計を使用し、max_points件で打ち切る）
+ * @param start 期間の開始時刻（この時刻を含む）
+ * @param end 期間の終了時刻（この時刻を含まない）
+ * @param points 取得したデータ点の配列（呼び出し側で max_points 要素確保）
+ * @param max_points 配列の要素数
+ * @param count 実際に取得できたデータ点数（データのない区間は含まない）
+ * @param tier 使用した階層（NULL可）
+ * @return ESP_OK on success
+ */
+esp_err_t data_buffer_get_history(const struct tm *start, const struct tm *end,
+                                  history_point_data_t *points, uint16_t max_points,
+                                  uint16_t *count, data_buffer_tier_t *tier);
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * 指定期間のチャンネル別1時間集計を取得（古い順に格納）
+ * 直近 DATA_BUFFER_CHANNEL_HOURLY_CAPACITY 時間を保持する（RAMのみ。再起動後は1分データの復元範囲から再集計される）
+ * @param start 期間の開始時刻（この時刻を含む）
+ * @param end 期間の終了時刻（この時刻を含まない）
+ * @param points 取得したデータ点の配列（呼び出し側で max_points 要素確保）
+ * @param max_points 配列の要素数
+ * @param count 実際に取得できたデータ点数（データのない区間は含まない）
+ * @return ESP_OK on success
+ */
+esp_err_t data_buffer_get_channel_history(const struct tm *start, const struct tm *end,
+                                          channel_point_data_t *points, uint16_t max_points,
+                                          uint16_t *count);
+#endif
+
+/**
+ * 指定時刻以降の1分データを圧縮ブロック（minute_codec形式）にエンコード
+ * 古い順にブロックが満杯になるまで格納する。続きは最後のサンプルの次の分から再度呼び出す
+ * @param start 開始時刻（この時刻を含む）
+ * @param buf 出力先
+ * @param capacity 出力先のバイト数（ブロックの最大サイズ、ヘッダー含む）
+ * @param length ブロックのバイト数
+ * @param count 格納したサンプル数
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no data at or after start
+ */
+esp_err_t data_buffer_encode_minute_block(const struct tm *start, uint8_t *buf, uint16_t capacity,
+                                          uint16_t *length, uint16_t *count);
+
 /**
  * データバッファの統計情報を取得
  * @param stats 統計情報の格納先
@@ -159,14 +679,25 @@ esp_err_t data_buffer_get_day_minute_data(const struct tm *date,
  */
 esp_err_t data_buffer_get_stats(data_buffer_stats_t *stats);
 
+/**
+ * 履歴データが使用する静的RAMの合計を取得
+ * 1分リング・日別データ・集計階層・週/月の要約・間引き記録・履歴ログのページバッファ・再起動用の退避領域を含む
+ * @return 使用量 [byte]
+ */
+size_t data_buffer_ram_usage(void);
+
 /**
  * 古いデータを削除してメモリを整理
+ * 1分リング・日別データ・書き込み中の日の集計を書き換えるため、data_buffer_add_minute_data と同じタスク
+ * （センサー読み取りタスク）からだけ呼び出す（他のタスクからは data_buffer_flush と同様に依頼する）
  * @return ESP_OK on success
  */
 esp_err_t data_buffer_cleanup_old_data(void);
 
 /**
  * データバッファをクリア
+ * 1分リング・集計・週と月の要約・履歴ログを消去するため、data_buffer_add_minute_data と同じタスク
+ * （センサー読み取りタスク）からだけ呼び出す（他のタスクからは data_buffer_flush と同様に依頼する）
  * @return ESP_OK on success
  */
 esp_err_t data_buffer_clear_all(void);
@@ -0,0 +1,133 @@
+#include "drying_rate.h"
+#include <string.h>
+
+#define REBASE_MINUTES  10000   // 区分内の経過時間がこの分数を超えたら基準を平均の位置へ移す
+
+static void slope_reset(drying_slope_t *s) {
+    memset(s, 0, sizeof(drying_slope_t));
+}
+
+/**
+ * 重み付き平均・共分散の逐次更新（古いサンプルの重みの合計 λW に現在位置のサンプル1件を加える）
+ *   W' = λW + 1, C' = λC + (λW / W')·Δt·Δx
+ */
+static void slope_add(drying_slope_t *s) {
+    if (s->samples == 0) {
+        s->weight = 1.0f;
+        s->mean_t = s->pos_t;
+        s->mean_x = s->pos_x;
+        s->cov_tx = 0.0f;
+        s->var_t = 0.0f;
+        s->samples = 1;
+        return;
+    }
+
+    float old_weight = DRYING_RATE_DECAY * s->weight;
+    s->weight = old_weight + 1.0f;
+    float dt = s->pos_t - s->mean_t;
+    float dx = s->pos_x - s->mean_x;
+    s->mean_t += dt / s->weight;
+    s->mean_x += dx / s->weight;
+    float k = old_weight / s->weight;
+    s->cov_tx = DRYING_RATE_DECAY * s->cov_tx + k * dt * dx;
+    s->var_t = DRYING_RATE_DECAY * s->var_t + k * dt * dt;
+    if (s->samples < UINT16_MAX) {
+        s->samples++;
+    }
+
+    if (s->pos_t > REBASE_MINUTES) {
+        // 共分散は平行移動で変わらない
+        s->pos_t -= s->mean_t;
+        s->pos_x -= s->mean_x;
+        s->mean_t = 0.0f;
+        s->mean_x = 0.0f;
+    }
+}
+
+/**
+ * 推定をやり直す
+ */
+void drying_rate_reset(drying_rate_t *est) {
+    memset(est, 0, sizeof(drying_rate_t));
+    est->day_fraction = 0.5f;
+}
+
+/**
+ * サンプルを追加
+ */
+void drying_rate_add(drying_rate_t *est, uint32_t epoch_minute, float moisture, bool is_day, float reset_drop) {
+    if (est->has_last && est->last_moisture - moisture >= reset_drop) {
+        // 灌水: 灌水前の傾きは使わない（昼の割合は引き継ぐ）
+        slope_reset(&est->period[DRYING_PERIOD_NIGHT]);
+        slope_reset(&est->period[DRYING_PERIOD_DAY]);
+    }
+
+    drying_period_t period = is_day ? DRYING_PERIOD_DAY : DRYING_PERIOD_NIGHT;
+    drying_slope_t *s = &est->period[period];
+    if (s->samples > 0 && est->has_last && est->last_period == period &&
+        epoch_minute > est->last_minute && epoch_minute - est->last_minute <= DRYING_RATE_MAX_GAP) {
+        s->pos_t += (float)(epoch_minute - est->last_minute);
+        s->pos_x += moisture - est->last_moisture;
+    }
+    // 区分の切り替わり・欠測・時刻の逆行の後は、前回の区分の終わりの位置から続ける
+    slope_add(s);
+
+    est->day_fraction += ((is_day ? 1.0f : 0.0f) - est->day_fraction) / DRYING_RATE_DAY_WINDOW;
+    est->last_moisture = moisture;
+    est->last_minute = epoch_minute;
+    est->last_period = (uint8_t)period;
+    est->has_last = true;
+}
+
+/**
+ * 区分ごとの乾燥速度を取得
+ */
+bool drying_rate_get(const drying_rate_t *est, drying_period_t period, float *rate_per_hour) {
+    const drying_slope_t *s = &est->period[period];
+    if (s->samples < DRYING_RATE_MIN_SAMPLES || s->var_t <= 0.0f) {
+        return false;
+    }
+    *rate_per_hour = s->cov_tx / s->var_t * 60.0f;
+    return true;
+}
+
+/**
+ * 乾燥閾値に達するまでの時間を予測
+ */
+void drying_rate_forecast(const drying_rate_t *est, float dry_threshold, drying_forecast_t *forecast) {
+    memset(forecast, 0, sizeof(drying_forecast_t));
+    forecast->hours_until_dry = -1.0f;
+    forecast->day_fraction = est->day_fraction;
+    forecast->current_moisture = est->last_moisture;
+    for (int p = 0; p < DRYING_PERIOD_COUNT; p++) {
+        forecast->samples[p] = est->period[p].samples;
+        if (drying_rate_get(est, (drying_period_t)p, &forecast->rate[p])) {
+            forecast->valid_mask |= (uint8_t)(1u << p);
+        }
+    }
+    if (!est->has_last) {
+        return;
+    }
+    if (est->last_moisture >= dry_threshold) {
+        forecast->hours_until_dry = 0.0f;
+        return;
+    }
+
+    // 片方だけ求まっている場合はその速度を使う
+    float rate;
+    uint8_t both = (1u << DRYING_PERIOD_NIGHT) | (1u << DRYING_PERIOD_DAY);
+    if (forecast->valid_mask == both) {
+        rate = est->day_fraction * forecast->rate[DRYING_PERIOD_DAY] +
+               (1.0f - est->day_fraction) * forecast->rate[DRYING_PERIOD_NIGHT];
+    } else if (forecast->valid_mask & (1u << DRYING_PERIOD_DAY)) {
+        rate = forecast->rate[DRYING_PERIOD_DAY];
+    } else if (forecast->valid_mask & (1u << DRYING_PERIOD_NIGHT)) {
+        rate = forecast->rate[DRYING_PERIOD_NIGHT];
+    } else {
+        return;
+    }
+    if (rate <= 0.0f) {
+        return;  // 乾燥していない（湿潤方向・横ばい）
+    }
+    forecast->hours_until_dry = (dry_threshold - est->last_moisture) / rate;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DRYING_RATE_DECAY           0.998f  // 1サンプルごとの重みの減衰（時定数 約500サンプル ≒ 8時間）
+#define DRYING_RATE_MIN_SAMPLES     60      // 速度を求めるのに必要なサンプル数（灌水でやり直した後）
+#define DRYING_RATE_DAY_LUX         50.0f   // この照度以上のサンプルを昼とする [lux]
+#define DRYING_RATE_DAY_WINDOW      10080   // 昼の割合の指数移動平均のサンプル数（1週間、時間帯による偏りを抑える）
+#define DRYING_RATE_MAX_GAP         60      // 同じ区分の連続したサンプルとみなす最大間隔 [分]
+
+/**
+ * 昼・夜の区分
+ */
+typedef enum {
+    DRYING_PERIOD_NIGHT = 0,
+    DRYING_PERIOD_DAY,
+    DRYING_PERIOD_COUNT
+} drying_period_t;
+
+/**
+ * 指数重み付き最小二乗の傾き（区分内の経過時間と土壌水分の変化の重み付き平均・共分散を逐次更新）
+ * 経過時間と変化は同じ区分の連続したサンプルの間だけ進めるため、他の区分（昼に対する夜）の変化は傾きに入らない
+ */
+typedef struct {
+    float pos_t;                // 区分内の経過時間 [分]（平均の位置を基準に移して float の精度を保つ）
+    float pos_x;                // 区分内の土壌水分の累積変化
+    float weight;               // 重みの合計
+    float mean_t;               // 経過時間の重み付き平均
+    float mean_x;               // 累積変化の重み付き平均
+    float cov_tx;               // 経過時間と累積変化の重み付き共分散（重みの合計倍）
+    float var_t;                // 経過時間の重み付き分散（重みの合計倍）
+    uint16_t samples;           // やり直した後のサンプル数（UINT16_MAX で頭打ち）
+} drying_slope_t;
+
+/**
+ * 乾燥速度の推定（昼・夜を別々に推定）
+ */
+typedef struct {
+    drying_slope_t period[DRYING_PERIOD_COUNT];
+    float day_fraction;         // 昼のサンプルの割合（指数移動平均）
+    float last_moisture;        // 最新の土壌水分
+    uint32_t last_minute;       // 最新のサンプルのエポック分
+    uint8_t last_period;        // 最新のサンプルの区分
+    bool has_last;
+} drying_rate_t;
+
+/**
+ * 乾燥の予測
+ */
+typedef struct {
+    float hours_until_dry;      // 乾燥閾値に達するまでの予測時間 [時]（0: 既に乾燥, 負: 予測できない）
+    float rate[DRYING_PERIOD_COUNT];  // 乾燥速度 [土壌水分の単位 / 時]（正: 乾燥方向）
+    uint8_t valid_mask;         // 速度が求まっている区分（bit p: drying_period_t）
+    float day_fraction;         // 昼のサンプルの割合（予測で昼と夜の速度を混ぜる比率）
+    float current_moisture;     // 予測に使った現在の土壌水分
+    uint16_t samples[DRYING_PERIOD_COUNT];  // 推定に使ったサンプル数
+} drying_forecast_t;
+
+/**
+ * 推定をやり直す
+ * @param est 対象
+ */
+void drying_rate_reset(drying_rate_t *est);
+
+/**
+ * サンプルを追加（O(1)）
+ * 直前のサンプルから reset_drop 以上減少した場合（灌水）は昼・夜とも推定をやり直す
+ * @param est 対象
+ * @param epoch_minute エポック分（時刻順）
+ * @param moisture 土壌水分（値が大きいほど乾燥）
+ * @param is_day 昼のサンプルか
+ * @param reset_drop 灌水とみなす減少量（植物プロファイルの灌水検出閾値）
+ */
+void drying_rate_add(drying_rate_t *est, uint32_t epoch_minute, float moisture, bool is_day, float reset_drop);
+
+/**
+ * 区分ごとの乾燥速度を取得
+ * @param est 対象
+ * @param period 区分
+ * @param rate_per_hour 乾燥速度 [土壌水分の単位 / 時]
+ * @return true: 求まった, false: サンプル不足
+ */
+bool drying_rate_get(const drying_rate_t *est, drying_period_t period, float *rate_per_hour);
+
+/**
+ * 乾燥閾値に達するまでの時間を予測（昼と夜の速度を昼の割合で混ぜた速度で外挿）
+ * @param est 対象
+ * @param dry_threshold 乾燥閾値（植物プロファイル）
+ * @param forecast 予測結果
+ */
+void drying_rate_forecast(const drying_rate_t *est, float dry_threshold, drying_forecast_t *forecast);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,162 @@
+#include "event_log.h"
+#include "seqlock.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "EventLog";
+
+// イベント表（g_lock で保護、ライターは植物管理タスクのみ）
+static event_log_table_t g_table;
+static seqlock_t g_lock;
+
+static uint16_t slot_of(const event_log_table_t *table, uint16_t index);
+static uint16_t lower_bound(const event_log_table_t *table, uint32_t epoch);
+
+/**
+ * イベントログを初期化
+ */
+esp_err_t event_log_init(const event_log_table_t *saved) {
+    seqlock_write_begin(&g_lock);
+    memset(&g_table, 0, sizeof(g_table));
+    esp_err_t ret = ESP_OK;
+    if (saved != NULL) {
+        if (saved->count <= EVENT_LOG_CAPACITY && saved->head < EVENT_LOG_CAPACITY) {
+            memcpy(&g_table, saved, sizeof(g_table));
+        } else {
+            ret = ESP_ERR_INVALID_ARG;
+        }
+    }
+    seqlock_write_end(&g_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Saved event log is inconsistent (count=%u, head=%u), starting empty", saved->count, saved->head);
+    } else {
+        ESP_LOGI(TAG, "Event log initialized: %u events", g_table.count);
+    }
+    return ret;
+}
+
+/**
+ * イベントを追加
+ */
+esp_err_t event_log_append(const event_entry_t *event) {
+    if (event == NULL || event->type < EVENT_TYPE_WATERING || event->type > EVENT_TYPE_DROPOUT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event_entry_t entry = *event;
+    if (g_table.count > 0) {
+        uint32_t last_epoch = g_table.entries[slot_of(&g_table, g_table.count - 1)].epoch;
+        if (entry.epoch < last_epoch) {
+            entry.epoch = last_epoch;
+        }
+    }
+
+    seqlock_write_begin(&g_lock);
+    g_table.entries[g_table.head] = entry;
+    g_table.head = (uint16_t)((g_table.head + 1) % EVENT_LOG_CAPACITY);
+    if (g_table.count < EVENT_LOG_CAPACITY) {
+        g_table.count++;
+    }
+    seqlock_write_end(&g_lock);
+    return ESP_OK;
+}
+
+/**
+ * 保持しているイベント数を取得
+ */
+uint16_t event_log_count(void) {
+    return __atomic_load_n(&g_table.count, __ATOMIC_RELAXED);
+}
+
+/**
+ * 最新のイベントから n 件を取得
+ */
+uint16_t event_log_get_last(uint16_t n, event_entry_t *out) {
+    if (out == NULL) {
+        return 0;
+    }
+    uint16_t stored;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_lock);
+        stored = (n < g_table.count) ? n : g_table.count;
+        for (uint16_t i = 0; i < stored; i++) {
+            out[i] = g_table.entries[slot_of(&g_table, g_table.count - 1 - i)];
+        }
+    } while (seqlock_read_retry(&g_lock, seq, &attempts));
+    return stored;
+}
+
+/**
+ * 期間内のイベントを古い順に取得
+ */
+esp_err_t event_log_get_range(uint32_t start_epoch, uint32_t end_epoch, uint16_t skip,
+                              event_entry_t *out, uint16_t max_count, uint16_t *count, uint16_t *total) {
+    if (out == NULL || count == NULL || end_epoch <= start_epoch) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t stored, in_range;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_lock);
+        uint16_t first = lower_bound(&g_table, start_epoch);
+        uint16_t last = lower_bound(&g_table, end_epoch);
+        in_range = (uint16_t)(last - first);
+        stored = 0;
+        for (uint16_t i = (uint16_t)(first + skip); i < last && stored < max_count; i++) {
+            out[stored++] = g_table.entries[slot_of(&g_table, i)];
+        }
+    } while (seqlock_read_retry(&g_lock, seq, &attempts));
+
+    *count = stored;
+    if (total != NULL) {
+        *total = in_range;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 保存用のイベント表を取得
+ */
+void event_log_get_table(event_log_table_t *table) {
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_lock);
+        memcpy(table, &g_table, sizeof(event_log_table_t));
+    } while (seqlock_read_retry(&g_lock, seq, &attempts));
+}
+
+/**
+ * 全てのイベントを削除
+ */
+void event_log_clear(void) {
+    seqlock_write_begin(&g_lock);
+    memset(&g_table, 0, sizeof(g_table));
+    seqlock_write_end(&g_lock);
+}
+
+/**
+ * 古い順の index 番目（0: 最古）のイベントの格納位置
+ */
+static uint16_t slot_of(const event_log_table_t *table, uint16_t index) {
+    return (uint16_t)((table->head + EVENT_LOG_CAPACITY - table->count + index) % EVENT_LOG_CAPACITY);
+}
+
+/**
+ * epoch 以降の最初のイベントの古い順の番号（全て epoch より前なら count）
+ * イベントは追加時に時刻順に揃えているため二分探索できる
+ */
+static uint16_t lower_bound(const event_log_table_t *table, uint32_t epoch) {
+    uint16_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (table->entries[slot_of(table, mid)].epoch < epoch) {
+            lo = (uint16_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
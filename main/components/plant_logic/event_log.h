@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_LOG_CAPACITY  64  // 保持するイベント数（古いものから上書き）
+
+/**
+ * イベントの種類
+ */
+typedef enum {
+    EVENT_TYPE_WATERING = 1,        // 灌水完了（magnitude: 土壌水分の減少量 [1/MINUTE_RECORD_SOIL_SCALE]）
+    EVENT_TYPE_NEEDS_WATERING,      // 灌水要求（magnitude: 乾燥が続いた日数）
+    EVENT_TYPE_TEMP_HIGH,           // 高温限界（magnitude: 気温 [0.01℃]）
+    EVENT_TYPE_TEMP_LOW,            // 低温限界（magnitude: 気温 [0.01℃]）
+    // ストリーミング検出器（stream_detect.h）
+    EVENT_TYPE_WATERING_START,      // 灌水開始（magnitude: 土壌水分の2回前からの減少量 [1/MINUTE_RECORD_SOIL_SCALE]）
+    EVENT_TYPE_WATERING_END,        // 灌水終了（magnitude: 灌水前からの土壌水分の減少量 [1/MINUTE_RECORD_SOIL_SCALE]）
+    EVENT_TYPE_DRAINAGE,            // 排水速度（magnitude: 灌水終了後の土壌水分の戻り [1/MINUTE_RECORD_SOIL_SCALE / 時]）
+    EVENT_TYPE_SPIKE,               // スパイク（magnitude: 平均からの偏差 [1/MINUTE_RECORD_SOIL_SCALE]）
+    EVENT_TYPE_STUCK,               // 固着（magnitude: 同じ値が続いたサンプル数）
+    EVENT_TYPE_DROPOUT,             // 欠測（magnitude: 欠測した分数、読み取り失敗は0）
+} event_type_t;
+
+/**
+ * イベント（8バイト）
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t epoch;             // 発生時刻（UNIX時間 [秒]）
+    uint8_t type;               // event_type_t
+    uint8_t channel_mask;       // 対象の土壌水分チャンネル（bit c: 静電容量 ch(c+1)、Rev1/Rev2はbit0のみ）
+    int16_t magnitude;          // 大きさ（単位は種類ごと）
+} event_entry_t;
+
+/**
+ * 保存用のイベント表（NVSに植物プロファイルと並べて保存する）
+ * entries は head - count から head - 1（容量で剰余）が古い順
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t count;             // イベント数
+    uint16_t head;              // 次に書き込む位置
+    event_entry_t entries[EVENT_LOG_CAPACITY];
+} event_log_table_t;
+
+/**
+ * イベントログを初期化
+ * @param saved 保存していたイベント表（NULL: 空で開始）
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if saved is inconsistent (the log starts empty)
+ */
+esp_err_t event_log_init(const event_log_table_t *saved);
+
+/**
+ * イベントを追加（O(1)）
+ * 時刻順の二分探索を保つため、直前のイベントより前の時刻（時刻同期で時計が戻った場合など）は直前の時刻に揃える
+ * @param event 追加するイベント
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if event or its type is invalid
+ */
+esp_err_t event_log_append(const event_entry_t *event);
+
+/**
+ * 保持しているイベント数を取得
+ * @return イベント数
+ */
+uint16_t event_log_count(void);
+
+/**
+ * 最新のイベントから n 件を取得
+ * @param n 取得する件数
+ * @param out 格納先（n 要素、新しい順）
+ * @return 格納した件数
+ */
+uint16_t event_log_get_last(uint16_t n, event_entry_t *out);
+
+/**
+ * 期間内のイベントを古い順に取得（開始位置は二分探索で O(log N)）
+ * @param start_epoch 開始時刻（この時刻を含む）
+ * @param end_epoch 終了時刻（この時刻を含まない）
+ * @param skip 先頭から読み飛ばす件数（続きの取得用）
+ * @param out 格納先（max_count 要素）
+ * @param max_count 格納する最大件数
+ * @param count 格納した件数
+ * @param total 期間内のイベントの総数（NULL可）
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the range is invalid
+ */
+esp_err_t event_log_get_range(uint32_t start_epoch, uint32_t end_epoch, uint16_t skip,
+                              event_entry_t *out, uint16_t max_count, uint16_t *count, uint16_t *total);
+
+/**
+ * 保存用のイベント表を取得
+ * @param table 格納先
+ */
+void event_log_get_table(event_log_table_t *table);
+
+/**
+ * 全てのイベントを削除
+ */
+void event_log_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,245 @@
+#include "history_log.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stddef.h>
+
+static const char *TAG = "HistoryLog";
+
+// プライベート関数の宣言
+static uint32_t page_crc(const history_log_page_header_t *header, const uint8_t *entries);
+static inline uint32_t page_offset(const history_log_t *log, uint16_t page);
+static bool read_header(const history_log_t *log, uint16_t page, history_log_page_header_t *header);
+
+/**
+ * ログを開く
+ */
+esp_err_t history_log_open(history_log_t *log, const history_storage_t *storage,
+                           uint32_t region_offset, uint32_t region_size,
+                           uint16_t entry_size, uint8_t *page_buf, uint16_t page_buf_size) {
+    if (log == NULL || storage == NULL || page_buf == NULL || entry_size == 0 ||
+        (region_offset % HISTORY_LOG_PAGE_SIZE) != 0 || region_size < 2 * HISTORY_LOG_PAGE_SIZE ||
+        region_offset + region_size > storage->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t buf_size = (page_buf_size > HISTORY_LOG_PAGE_SIZE) ? HISTORY_LOG_PAGE_SIZE : page_buf_size;
+    if (buf_size < HISTORY_LOG_HEADER_SIZE + entry_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(log, 0, sizeof(history_log_t));
+    log->storage = *storage;
+    log->region_offset = region_offset;
+    log->page_count = region_size / HISTORY_LOG_PAGE_SIZE;
+    log->entry_size = entry_size;
+    log->entries_per_page = (buf_size - HISTORY_LOG_HEADER_SIZE) / entry_size;
+    log->page_buf = page_buf;
+
+    // 最も新しい（通し番号が最大の）ページを探す
+    uint32_t newest_seq = 0;
+    int newest_page = -1;
+    history_log_page_header_t header;
+    for (uint16_t page = 0; page < log->page_count; page++) {
+        if (read_header(log, page, &header) && header.seq > newest_seq) {
+            newest_seq = header.seq;
+            newest_page = page;
+        }
+    }
+
+    if (newest_page >= 0) {
+        log->head_page = (newest_page + 1) % log->page_count;
+        log->next_seq = newest_seq + 1;
+    } else {
+        log->head_page = 0;
+        log->next_seq = 1;
+    }
+
+    ESP_LOGI(TAG, "Log opened: %d pages x %d entries (%d bytes), head=%d, seq=%lu",
+             log->page_count, log->entries_per_page, entry_size, log->head_page, (unsigned long)log->next_seq);
+    return ESP_OK;
+}
+
+/**
+ * エントリを追記
+ */
+esp_err_t history_log_append(history_log_t *log, const void *entry) {
+    if (log == NULL || entry == NULL || log->page_buf == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(log->page_buf + HISTORY_LOG_HEADER_SIZE + (size_t)log->pending * log->entry_size, entry, log->entry_size);
+    log->pending++;
+
+    if (log->pending >= log->entries_per_page) {
+        return history_log_flush(log);
+    }
+    return ESP_OK;
+}
+
+/**
+ * 未封印のエントリをページとして封印
+ */
+esp_err_t history_log_flush(history_log_t *log) {
+    if (log == NULL || log->page_buf == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (log->pending == 0) {
+        return ESP_OK;
+    }
+
+    history_log_page_header_t header = {
+        .magic = HISTORY_LOG_PAGE_MAGIC,
+        .seq = log->next_seq,
+        .entry_size = log->entry_size,
+        .entry_count = log->pending,
+    };
+    header.crc32 = page_crc(&header, log->page_buf + HISTORY_LOG_HEADER_SIZE);
+    memcpy(log->page_buf, &header, HISTORY_LOG_HEADER_SIZE);
+
+    // 消去と書き込みはページ封印時の1回のみ
+    uint32_t offset = page_offset(log, log->head_page);
+    esp_err_t ret = log->storage.erase(log->storage.ctx, offset, HISTORY_LOG_PAGE_SIZE);
+    if (ret == ESP_OK) {
+        ret = log->storage.write(log->storage.ctx, offset, log->page_buf,
+                                 HISTORY_LOG_HEADER_SIZE + (size_t)log->pending * log->entry_size);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to seal page %d: %s", log->head_page, esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGD(TAG, "Sealed page %d (seq=%lu, %d entries)", log->head_page, (unsigned long)log->next_seq, log->pending);
+    log->head_page = (log->head_page + 1) % log->page_count;
+    log->next_seq++;
+    log->pending = 0;
+    return ESP_OK;
+}
+
+/**
+ * 封印済みページの末尾から最大N件を古い順に読み出す
+ */
+esp_err_t history_log_replay(history_log_t *log, uint32_t max_entries,
+                             history_log_entry_cb_t cb, void *ctx, uint32_t *count) {
+    if (log == NULL || cb == NULL || log->page_buf == NULL || log->pending > 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (count != NULL) {
+        *count = 0;
+    }
+
+    // 最新ページから通し番号が連続する範囲を遡り、必要な件数を含む最古ページを求める
+    uint16_t pages = 0;
+    uint32_t available = 0;
+    uint32_t expected_seq = log->next_seq - 1;
+    history_log_page_header_t header;
+    while (pages < log->page_count && available < max_entries && expected_seq > 0) {
+        uint16_t page = (log->head_page + log->page_count - 1 - pages) % log->page_count;
+        if (!read_header(log, page, &header) || header.seq != expected_seq) {
+            break;
+        }
+        available += header.entry_count;
+        pages++;
+        expected_seq--;
+    }
+
+    uint32_t skip = (available > max_entries) ? (available - max_entries) : 0;
+    uint32_t replayed = 0;
+
+    // 古いページから順に読み出す
+    for (uint16_t n = pages; n > 0; n--) {
+        uint16_t page = (log->head_page + log->page_count - n) % log->page_count;
+        uint32_t offset = page_offset(log, page);
+
+        if (log->storage.read(log->storage.ctx, offset, &header, HISTORY_LOG_HEADER_SIZE) != ESP_OK) {
+            continue;
+        }
+        size_t len = (size_t)header.entry_count * log->entry_size;
+        if (header.entry_count > log->entries_per_page) {
+            ESP_LOGW(TAG, "Page %d has %d entries (buffer holds %d), skipped", page, header.entry_count, log->entries_per_page);
+            skip = (skip > header.entry_count) ? skip - header.entry_count : 0;
+            continue;
+        }
+        uint8_t *entries = log->page_buf + HISTORY_LOG_HEADER_SIZE;
+        if (log->storage.read(log->storage.ctx, offset + HISTORY_LOG_HEADER_SIZE, entries, len) != ESP_OK ||
+            page_crc(&header, entries) != header.crc32) {
+            ESP_LOGW(TAG, "Page %d (seq=%lu) CRC mismatch, skipped", page, (unsigned long)header.seq);
+            skip = (skip > header.entry_count) ? skip - header.entry_count : 0;
+            continue;
+        }
+
+        for (uint16_t i = 0; i < header.entry_count; i++) {
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            cb(entries + (size_t)i * log->entry_size, ctx);
+            replayed++;
+        }
+    }
+
+    if (count != NULL) {
+        *count = replayed;
+    }
+    return ESP_OK;
+}
+
+/**
+ * ログを空にする
+ */
+esp_err_t history_log_clear(history_log_t *log) {
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    history_log_page_header_t header;
+    for (uint16_t page = 0; page < log->page_count; page++) {
+        if (read_header(log, page, &header)) {
+            esp_err_t ret = log->storage.erase(log->storage.ctx, page_offset(log, page), HISTORY_LOG_PAGE_SIZE);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    }
+    log->head_page = 0;
+    log->next_seq = 1;
+    log->pending = 0;
+    return ESP_OK;
+}
+
+/**
+ * CRC-32 (IEEE 802.3) 4bitテーブル版
+ */
+uint32_t history_log_crc32(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// プライベート関数の実装
+
+static uint32_t page_crc(const history_log_page_header_t *header, const uint8_t *entries) {
+    uint32_t crc = history_log_crc32(0, (const uint8_t *)header, offsetof(history_log_page_header_t, crc32));
+    return history_log_crc32(crc, entries, (size_t)header->entry_count * header->entry_size);
+}
+
+static inline uint32_t page_offset(const history_log_t *log, uint16_t page) {
+    return log->region_offset + (uint32_t)page * HISTORY_LOG_PAGE_SIZE;
+}
+
+static bool read_header(const history_log_t *log, uint16_t page, history_log_page_header_t *header) {
+    if (log->storage.read(log->storage.ctx, page_offset(log, page), header, HISTORY_LOG_HEADER_SIZE) != ESP_OK) {
+        return false;
+    }
+    return header->magic == HISTORY_LOG_PAGE_MAGIC &&
+           header->entry_size == log->entry_size &&
+           header->entry_count > 0 &&
+           header->seq != 0xFFFFFFFFu;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "history_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ページ = フラッシュ1セクタ。ヘッダー + 固定長エントリ列を1回の書き込みで封印する
+#define HISTORY_LOG_PAGE_SIZE       HISTORY_STORAGE_SECTOR_SIZE
+#define HISTORY_LOG_PAGE_MAGIC      0x47484C53u  // "SLHG"
+
+/**
+ * ページヘッダー（ページ先頭に配置）
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // HISTORY_LOG_PAGE_MAGIC
+    uint32_t seq;           // 封印順の通し番号（1〜、ページの新旧判定に使用）
+    uint16_t entry_size;    // エントリサイズ [byte]
+    uint16_t entry_count;   // 格納エントリ数
+    uint32_t crc32;         // ヘッダー（crc32除く）+ エントリ列のCRC32
+} history_log_page_header_t;
+
+#define HISTORY_LOG_HEADER_SIZE     sizeof(history_log_page_header_t)
+
+/**
+ * 追記専用ログ
+ * エントリはRAMのページバッファに溜め、満杯になった時点で次のページを消去して一括で書き込む。
+ * ページは領域内を循環して使用するため、消去回数は全ページに均等に分散される。
+ */
+typedef struct {
+    history_storage_t storage;
+    uint32_t region_offset;     // 保存先内の領域開始オフセット
+    uint16_t page_count;        // 領域のページ数
+    uint16_t entry_size;        // エントリサイズ
+    uint16_t entries_per_page;  // 1ページあたりのエントリ数
+    uint16_t head_page;         // 次に封印するページ
+    uint32_t next_seq;          // 次に封印するページの通し番号
+    uint8_t *page_buf;          // ページバッファ（先頭にヘッダー領域を含む）
+    uint16_t pending;           // ページバッファ内の未封印エントリ数
+} history_log_t;
+
+/**
+ * エントリの読み出しコールバック
+ * @param entry エントリデータ
+ * @param ctx history_log_replay に渡したコンテキスト
+ */
+typedef void (*history_log_entry_cb_t)(const void *entry, void *ctx);
+
+/**
+ * ログを開く（各ページのヘッダーを走査して書き込み位置を決定）
+ * @param log 対象ログ
+ * @param storage 保存先
+ * @param region_offset 領域開始オフセット（セクタ境界）
+ * @param region_size 領域サイズ（セクタの倍数、2ページ以上）
+ * @param entry_size エントリサイズ
+ * @param page_buf ページバッファ（呼び出し側で確保、ログを使用する間保持）
+ * @param page_buf_size ページバッファのサイズ（1ページあたりのエントリ数の上限になる）
+ * @return ESP_OK on success
+ */
+esp_err_t history_log_open(history_log_t *log, const history_storage_t *storage,
+                           uint32_t region_offset, uint32_t region_size,
+                           uint16_t entry_size, uint8_t *page_buf, uint16_t page_buf_size);
+
+/**
+ * エントリを追記（ページが満杯になった場合のみフラッシュに書き込む）
+ * @param log 対象ログ
+ * @param entry エントリデータ（entry_sizeバイト）
+ * @return ESP_OK on success
+ */
+esp_err_t history_log_append(history_log_t *log, const void *entry);
+
+/**
+ * 未封印のエントリをページとして封印する
+ * @param log 対象ログ
+ * @return ESP_OK on success（未封印エントリがなければ何もしない）
+ */
+esp_err_t history_log_flush(history_log_t *log);
+
+/**
+ * 封印済みページの末尾から最大N件を古い順に読み出す
+ * ページバッファを使用するため、open直後（追記前）に呼び出すこと
+ * CRCが一致しないページは読み飛ばす
+ * @param log 対象ログ
+ * @param max_entries 読み出す最大件数
+ * @param cb エントリごとのコールバック
+ * @param ctx コールバックに渡すコンテキスト
+ * @param count 読み出した件数（NULL可）
+ * @return ESP_OK on success
+ */
+esp_err_t history_log_replay(history_log_t *log, uint32_t max_entries,
+                             history_log_entry_cb_t cb, void *ctx, uint32_t *count);
+
+/**
+ * ログを空にする（封印済みページを消去）
+ * @param log 対象ログ
+ * @return ESP_OK on success
+ */
+esp_err_t history_log_clear(history_log_t *log);
+
+/**
+ * CRC-32 (IEEE 802.3) を計算（ページの検証と同じ方式。続けて計算する場合は前回の値を渡す）
+ * @param crc 初期値（0）または前回の値
+ * @param data 対象データ
+ * @param len バイト数
+ * @return CRC-32
+ */
+uint32_t history_log_crc32(uint32_t crc, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
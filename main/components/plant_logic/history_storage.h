@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// フラッシュの消去単位（ESP32のセクタサイズ）
+#define HISTORY_STORAGE_SECTOR_SIZE     4096
+
+// 履歴ログ用パーティション名（partitions.csv）
+#define HISTORY_STORAGE_PARTITION_NAME  "history"
+
+/**
+ * 履歴ログの保存先（NORフラッシュ相当のアクセス関数）
+ * ターゲットではhistoryパーティション、ホストテストではファイルを使用する
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint32_t offset, void *dst, size_t len);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const void *src, size_t len);
+    esp_err_t (*erase)(void *ctx, uint32_t offset, size_t len);  // セクタ単位で0xFFに消去
+    void *ctx;
+    uint32_t size;                                                // 保存先の全体サイズ [byte]
+} history_storage_t;
+
+/**
+ * 履歴ログの保存先を取得
+ * @param storage 保存先の格納先
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the partition does not exist
+ */
+esp_err_t history_storage_get(history_storage_t *storage);
+
+#ifdef __cplusplus
+}
+#endif
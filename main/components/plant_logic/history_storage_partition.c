@@ -0,0 +1,51 @@
+#include "history_storage.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+
+static const char *TAG = "HistoryStorage";
+
+// プライベート関数の宣言
+static esp_err_t partition_read(void *ctx, uint32_t offset, void *dst, size_t len);
+static esp_err_t partition_write(void *ctx, uint32_t offset, const void *src, size_t len);
+static esp_err_t partition_erase(void *ctx, uint32_t offset, size_t len);
+
+/**
+ * historyパーティションを履歴ログの保存先として取得
+ */
+esp_err_t history_storage_get(history_storage_t *storage) {
+    if (storage == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ESP_PARTITION_SUBTYPE_ANY,
+                                                                HISTORY_STORAGE_PARTITION_NAME);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "Partition '%s' not found, history will not persist", HISTORY_STORAGE_PARTITION_NAME);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    storage->read = partition_read;
+    storage->write = partition_write;
+    storage->erase = partition_erase;
+    storage->ctx = (void *)partition;
+    storage->size = partition->size;
+
+    ESP_LOGI(TAG, "History partition: offset=0x%lx, size=%lu",
+             (unsigned long)partition->address, (unsigned long)partition->size);
+    return ESP_OK;
+}
+
+// プライベート関数の実装
+
+static esp_err_t partition_read(void *ctx, uint32_t offset, void *dst, size_t len) {
+    return esp_partition_read((const esp_partition_t *)ctx, offset, dst, len);
+}
+
+static esp_err_t partition_write(void *ctx, uint32_t offset, const void *src, size_t len) {
+    return esp_partition_write((const esp_partition_t *)ctx, offset, src, len);
+}
+
+static esp_err_t partition_erase(void *ctx, uint32_t offset, size_t len) {
+    return esp_partition_erase_range((const esp_partition_t *)ctx, offset, len);
+}
@@ -0,0 +1,276 @@
+#include "minute_codec.h"
+#include <string.h>
+
+// プライベート関数の宣言
+static bool put_bits(uint8_t *data, uint32_t limit, uint32_t *pos, uint32_t value, uint8_t width);
+static bool get_bits(const uint8_t *data, uint32_t limit, uint32_t *pos, uint8_t width, uint32_t *value);
+static void clear_bits(uint8_t *data, uint32_t from, uint32_t to);
+static bool put_timestamp(uint8_t *data, uint32_t limit, uint32_t *pos, int32_t dod);
+static bool get_timestamp(const uint8_t *data, uint32_t limit, uint32_t *pos, int32_t *dod);
+static bool put_value(uint8_t *data, uint32_t limit, uint32_t *pos, int32_t delta);
+static bool get_value(const uint8_t *data, uint32_t limit, uint32_t *pos, int32_t *delta);
+static int32_t sign_extend(uint32_t value, uint8_t width);
+
+/**
+ * エンコーダを初期化
+ */
+void minute_codec_encoder_init(minute_codec_encoder_t *enc, uint8_t *buf, uint16_t capacity) {
+    memset(enc, 0, sizeof(minute_codec_encoder_t));
+    enc->buf = buf;
+    enc->capacity = capacity;
+    memset(buf, 0, capacity);
+}
+
+/**
+ * サンプルを追加
+ */
+esp_err_t minute_codec_encoder_add(minute_codec_encoder_t *enc, uint32_t epoch_minute, const minute_record_t *rec) {
+    if (enc->capacity <= MINUTE_CODEC_HEADER_SIZE) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int32_t fields[MINUTE_RECORD_FIELD_COUNT];
+    minute_record_get_fields(rec, fields);
+
+    uint8_t *data = enc->buf + MINUTE_CODEC_HEADER_SIZE;
+    uint32_t limit = (uint32_t)(enc->capacity - MINUTE_CODEC_HEADER_SIZE) * 8;
+    uint32_t start = enc->bit_pos;
+    int32_t delta = 1;
+    bool ok = true;
+
+    if (enc->count == 0) {
+        // 先頭サンプルは生値
+        for (int f = 0; f < MINUTE_RECORD_FIELD_COUNT && ok; f++) {
+            ok = put_bits(data, limit, &enc->bit_pos, (uint16_t)fields[f], 16);
+        }
+    } else {
+        delta = (int32_t)(epoch_minute - enc->prev_minute);
+        ok = put_timestamp(data, limit, &enc->bit_pos, delta - enc->prev_delta);
+        for (int f = 0; f < MINUTE_RECORD_FIELD_COUNT && ok; f++) {
+            ok = put_value(data, limit, &enc->bit_pos, fields[f] - enc->prev_fields[f]);
+        }
+    }
+
+    if (!ok) {
+        // 途中まで書いたビットを取り消し、ブロックは追加前の状態に戻す
+        clear_bits(data, start, enc->bit_pos);
+        enc->bit_pos = start;
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (enc->count == 0) {
+        enc->first_minute = epoch_minute;
+    }
+    enc->prev_minute = epoch_minute;
+    enc->prev_delta = delta;
+    memcpy(enc->prev_fields, fields, sizeof(fields));
+    enc->count++;
+    return ESP_OK;
+}
+
+/**
+ * ヘッダーを書き込んでブロックを確定
+ */
+uint16_t minute_codec_encoder_finish(minute_codec_encoder_t *enc) {
+    if (enc->capacity < MINUTE_CODEC_HEADER_SIZE) {
+        return 0;
+    }
+    minute_codec_header_t header;
+    header.first_minute = enc->first_minute;
+    header.count = enc->count;
+    header.size = (uint16_t)(MINUTE_CODEC_HEADER_SIZE + (enc->bit_pos + 7) / 8);
+    memcpy(enc->buf, &header, sizeof(header));
+    return header.size;
+}
+
+/**
+ * デコーダを初期化
+ */
+esp_err_t minute_codec_decoder_init(minute_codec_decoder_t *dec, const uint8_t *buf, uint16_t size) {
+    memset(dec, 0, sizeof(minute_codec_decoder_t));
+    if (size < MINUTE_CODEC_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    minute_codec_header_t header;
+    memcpy(&header, buf, sizeof(header));
+    if (header.size < MINUTE_CODEC_HEADER_SIZE || header.size > size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    dec->buf = buf;
+    dec->size = header.size;
+    dec->count = header.count;
+    dec->prev_minute = header.first_minute;
+    return ESP_OK;
+}
+
+/**
+ * 次のサンプルを読み出す
+ */
+esp_err_t minute_codec_decoder_next(minute_codec_decoder_t *dec, uint32_t *epoch_minute, minute_record_t *rec) {
+    if (dec->index >= dec->count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const uint8_t *data = dec->buf + MINUTE_CODEC_HEADER_SIZE;
+    uint32_t limit = (uint32_t)(dec->size - MINUTE_CODEC_HEADER_SIZE) * 8;
+    int32_t fields[MINUTE_RECORD_FIELD_COUNT];
+    memset(rec, 0, sizeof(minute_record_t));
+
+    if (dec->index == 0) {
+        for (int f = 0; f < MINUTE_RECORD_FIELD_COUNT; f++) {
+            uint32_t raw;
+            if (!get_bits(data, limit, &dec->bit_pos, 16, &raw)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            fields[f] = (int32_t)raw;
+        }
+        // 生値をフィールドの型に合わせて正規化（差分の基準をエンコーダと揃える）
+        minute_record_set_fields(rec, fields);
+        minute_record_get_fields(rec, dec->prev_fields);
+        dec->prev_delta = 1;
+    } else {
+        int32_t dod;
+        if (!get_timestamp(data, limit, &dec->bit_pos, &dod)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        dec->prev_delta += dod;
+        dec->prev_minute += (uint32_t)dec->prev_delta;
+        for (int f = 0; f < MINUTE_RECORD_FIELD_COUNT; f++) {
+            int32_t delta;
+            if (!get_value(data, limit, &dec->bit_pos, &delta)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            dec->prev_fields[f] += delta;
+        }
+        minute_record_set_fields(rec, dec->prev_fields);
+    }
+
+    *epoch_minute = dec->prev_minute;
+    dec->index++;
+    return ESP_OK;
+}
+
+// プライベート関数の実装
+
+/**
+ * ビット列に書き込む（MSBファースト、書き込み先は0で初期化済みであること）
+ */
+static bool put_bits(uint8_t *data, uint32_t limit, uint32_t *pos, uint32_t value, uint8_t width) {
+    if (*pos + width > limit) {
+        return false;
+    }
+    while (width > 0) {
+        uint8_t room = 8 - (*pos & 7);
+        uint8_t n = (width < room) ? width : room;
+        uint32_t chunk = (value >> (width - n)) & ((1u << n) - 1);
+        data[*pos >> 3] |= (uint8_t)(chunk << (room - n));
+        *pos += n;
+        width -= n;
+    }
+    return true;
+}
+
+static bool get_bits(const uint8_t *data, uint32_t limit, uint32_t *pos, uint8_t width, uint32_t *value) {
+    if (*pos + width > limit) {
+        return false;
+    }
+    uint32_t result = 0;
+    while (width > 0) {
+        uint8_t room = 8 - (*pos & 7);
+        uint8_t n = (width < room) ? width : room;
+        uint32_t chunk = (data[*pos >> 3] >> (room - n)) & ((1u << n) - 1);
+        result = (result << n) | chunk;
+        *pos += n;
+        width -= n;
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * ビット範囲 [from, to) を0に戻す
+ */
+static void clear_bits(uint8_t *data, uint32_t from, uint32_t to) {
+    for (uint32_t bit = from; bit < to; bit++) {
+        data[bit >> 3] &= (uint8_t)~(0x80u >> (bit & 7));
+    }
+}
+
+static bool put_timestamp(uint8_t *data, uint32_t limit, uint32_t *pos, int32_t dod) {
+    if (dod == 0) {
+        return put_bits(data, limit, pos, 0x0, 1);
+    }
+    if (dod >= -64 && dod <= 63) {
+        return put_bits(data, limit, pos, 0x2, 2) && put_bits(data, limit, pos, (uint32_t)dod & 0x7F, 7);
+    }
+    if (dod >= INT16_MIN && dod <= INT16_MAX) {
+        return put_bits(data, limit, pos, 0x6, 3) && put_bits(data, limit, pos, (uint32_t)dod & 0xFFFF, 16);
+    }
+    return put_bits(data, limit, pos, 0x7, 3) && put_bits(data, limit, pos, (uint32_t)dod, 32);
+}
+
+static bool get_timestamp(const uint8_t *data, uint32_t limit, uint32_t *pos, int32_t *dod) {
+    uint32_t bit, raw;
+    if (!get_bits(data, limit, pos, 1, &bit)) return false;
+    if (bit == 0) {
+        *dod = 0;
+        return true;
+    }
+    if (!get_bits(data, limit, pos, 1, &bit)) return false;
+    if (bit == 0) {
+        if (!get_bits(data, limit, pos, 7, &raw)) return false;
+        *dod = sign_extend(raw, 7);
+        return true;
+    }
+    if (!get_bits(data, limit, pos, 1, &bit)) return false;
+    if (bit == 0) {
+        if (!get_bits(data, limit, pos, 16, &raw)) return false;
+        *dod = sign_extend(raw, 16);
+        return true;
+    }
+    if (!get_bits(data, limit, pos, 32, &raw)) return false;
+    *dod = (int32_t)raw;
+    return true;
+}
+
+static bool put_value(uint8_t *data, uint32_t limit, uint32_t *pos, int32_t delta) {
+    // ジグザグ符号化（0, -1, 1, -2, ... → 0, 1, 2, 3, ...）
+    uint32_t z = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    if (z == 0) {
+        return put_bits(data, limit, pos, 0x0, 1);
+    }
+    if (z < (1u << 4)) {
+        return put_bits(data, limit, pos, 0x2, 2) && put_bits(data, limit, pos, z, 4);
+    }
+    if (z < (1u << 8)) {
+        return put_bits(data, limit, pos, 0x6, 3) && put_bits(data, limit, pos, z, 8);
+    }
+    if (z < (1u << 12)) {
+        return put_bits(data, limit, pos, 0xE, 4) && put_bits(data, limit, pos, z, 12);
+    }
+    return put_bits(data, limit, pos, 0xF, 4) && put_bits(data, limit, pos, z, 17);
+}
+
+static bool get_value(const uint8_t *data, uint32_t limit, uint32_t *pos, int32_t *delta) {
+    static const uint8_t widths[] = { 4, 8, 12, 17 };
+    uint32_t bit, z = 0;
+    int prefix = 0;
+    // 先頭の1の数（最大4）で値のビット幅が決まる
+    while (prefix < 4) {
+        if (!get_bits(data, limit, pos, 1, &bit)) return false;
+        if (bit == 0) break;
+        prefix++;
+    }
+    if (prefix > 0 && !get_bits(data, limit, pos, widths[prefix - 1], &z)) {
+        return false;
+    }
+    *delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+    return true;
+}
+
+static int32_t sign_extend(uint32_t value, uint8_t width) {
+    uint32_t sign = 1u << (width - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "minute_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 1分データの圧縮ブロック
+ *
+ * ブロック = ヘッダー（8バイト）+ ビット列（MSBファースト）。ブロックごとに完結しており、
+ * 他のブロックを参照せずに単独でデコードできる。
+ *
+ * 時刻: 前回との差分（初期値1分）からの二階差分
+ *   '0'                 : 二階差分 0（1分間隔が続く場合）
+ *   '10'  + 7bit符号付き : -64〜63
+ *   '110' + 16bit符号付き: -32768〜32767
+ *   '111' + 32bit        : それ以外
+ * 計測値: 1サンプル目は各フィールド16bitの生値、以降は前回値との差分をジグザグ符号化
+ *   '0'                 : 変化なし
+ *   '10'   + 4bit       : 0〜15
+ *   '110'  + 8bit       : 0〜255
+ *   '1110' + 12bit      : 0〜4095
+ *   '1111' + 17bit      : それ以外（16bit値の差分は必ず収まる）
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t first_minute;      // 先頭サンプルのエポック分
+    uint16_t count;             // サンプル数
+    uint16_t size;              // ブロック全体のバイト数（ヘッダー含む）
+} minute_codec_header_t;
+
+#define MINUTE_CODEC_HEADER_SIZE    sizeof(minute_codec_header_t)
+
+/**
+ * ブロックエンコーダ
+ */
+typedef struct {
+    uint8_t *buf;               // 出力先（ヘッダー領域を含む）
+    uint16_t capacity;          // 出力先のバイト数
+    uint32_t bit_pos;           // ビット列の書き込み位置
+    uint16_t count;             // 格納済みサンプル数
+    uint32_t first_minute;
+    uint32_t prev_minute;
+    int32_t prev_delta;
+    int32_t prev_fields[MINUTE_RECORD_FIELD_COUNT];
+} minute_codec_encoder_t;
+
+/**
+ * ブロックデコーダ
+ */
+typedef struct {
+    const uint8_t *buf;
+    uint16_t size;
+    uint32_t bit_pos;
+    uint16_t count;             // ブロックのサンプル数
+    uint16_t index;             // 次に読み出すサンプル番号
+    uint32_t prev_minute;
+    int32_t prev_delta;
+    int32_t prev_fields[MINUTE_RECORD_FIELD_COUNT];
+} minute_codec_decoder_t;
+
+/**
+ * エンコーダを初期化
+ * @param enc 対象エンコーダ
+ * @param buf 出力先バッファ
+ * @param capacity 出力先のバイト数（ブロックの最大サイズ、ヘッダー含む）
+ */
+void minute_codec_encoder_init(minute_codec_encoder_t *enc, uint8_t *buf, uint16_t capacity);
+
+/**
+ * サンプルを追加
+ * 収まらない場合はブロックを変更せずにESP_ERR_NO_MEMを返す（次のブロックの先頭にする）
+ * @param enc 対象エンコーダ
+ * @param epoch_minute サンプルのエポック分
+ * @param rec サンプル（minute_keyは使用しない）
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the block is full
+ */
+esp_err_t minute_codec_encoder_add(minute_codec_encoder_t *enc, uint32_t epoch_minute, const minute_record_t *rec);
+
+/**
+ * ヘッダーを書き込んでブロックを確定
+ * @param enc 対象エンコーダ
+ * @return ブロックのバイト数
+ */
+uint16_t minute_codec_encoder_finish(minute_codec_encoder_t *enc);
+
+/**
+ * デコーダを初期化（ヘッダーを検証）
+ * @param dec 対象デコーダ
+ * @param buf ブロック
+ * @param size ブロックのバイト数
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the header is inconsistent
+ */
+esp_err_t minute_codec_decoder_init(minute_codec_decoder_t *dec, const uint8_t *buf, uint16_t size);
+
+/**
+ * 次のサンプルを読み出す
+ * @param dec 対象デコーダ
+ * @param epoch_minute サンプルのエポック分の格納先
+ * @param rec サンプルの格納先（minute_keyは0になる）
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND at end of block, ESP_ERR_INVALID_SIZE if truncated
+ */
+esp_err_t minute_codec_decoder_next(minute_codec_decoder_t *dec, uint32_t *epoch_minute, minute_record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,187 @@
+#include "minute_columns.h"
+#include <string.h>
+
+static uint32_t word_mask(uint16_t word, uint16_t from, uint16_t to);
+
+/**
+ * 全スロットを空きにする
+ */
+void minute_columns_clear(minute_columns_t *cols) {
+    memset(cols, 0, sizeof(minute_columns_t));
+    for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+        cols->minute_key[i] = MINUTE_RECORD_KEY_EMPTY;
+    }
+}
+
+/**
+ * 1行を各列に書き込む
+ */
+void minute_columns_put(minute_columns_t *cols, uint16_t slot, const minute_record_t *rec) {
+    if (minute_record_is_empty(rec)) {
+        minute_columns_erase(cols, slot);
+        return;
+    }
+    cols->minute_key[slot] = rec->minute_key;
+    cols->temperature[slot] = rec->temperature;
+    cols->humidity[slot] = rec->humidity;
+    cols->lux[slot] = rec->lux;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        cols->capacitance[c][slot] = rec->soil_moisture_capacitance[c];
+    }
+    memcpy(cols->temp_bits[slot], rec->temp_bits, MINUTE_RECORD_TEMP_BITS_SIZE);
+#else
+    cols->soil_moisture[slot] = rec->soil_moisture;
+    cols->soil_temperature1[slot] = rec->soil_temperature1;
+    cols->soil_temperature2[slot] = rec->soil_temperature2;
+#endif
+    cols->valid[slot >> 5] |= 1u << (slot & 31);
+}
+
+/**
+ * 各列から1行を組み立てる
+ */
+void minute_columns_get(const minute_columns_t *cols, uint16_t slot, minute_record_t *rec) {
+    if (!minute_columns_is_valid(cols, slot)) {
+        memset(rec, 0, sizeof(minute_record_t));
+        rec->minute_key = MINUTE_RECORD_KEY_EMPTY;
+        return;
+    }
+    rec->minute_key = cols->minute_key[slot];
+    rec->temperature = cols->temperature[slot];
+    rec->humidity = cols->humidity[slot];
+    rec->lux = cols->lux[slot];
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        rec->soil_moisture_capacitance[c] = cols->capacitance[c][slot];
+    }
+    memcpy(rec->temp_bits, cols->temp_bits[slot], MINUTE_RECORD_TEMP_BITS_SIZE);
+#else
+    rec->soil_moisture = cols->soil_moisture[slot];
+    rec->soil_temperature1 = cols->soil_temperature1[slot];
+    rec->soil_temperature2 = cols->soil_temperature2[slot];
+#endif
+}
+
+/**
+ * スロットを空きにする（列の値はそのまま残り、ビットマップと時刻キーで無効化する）
+ */
+void minute_columns_erase(minute_columns_t *cols, uint16_t slot) {
+    cols->valid[slot >> 5] &= ~(1u << (slot & 31));
+    cols->minute_key[slot] = MINUTE_RECORD_KEY_EMPTY;
+}
+
+/**
+ * 有効なスロット数を取得
+ */
+uint16_t minute_columns_count(const minute_columns_t *cols) {
+    uint16_t count = 0;
+    for (int w = 0; w < MINUTE_COLUMNS_VALID_WORDS; w++) {
+        count += (uint16_t)__builtin_popcount(cols->valid[w]);
+    }
+    return count;
+}
+
+/**
+ * 連続したスロットを空きにする
+ */
+void minute_columns_erase_range(minute_columns_t *cols, uint16_t first_slot, uint16_t count) {
+    if (count >= MINUTE_COLUMNS_CAPACITY) {
+        memset(cols->valid, 0, sizeof(cols->valid));
+        return;
+    }
+    uint16_t from = first_slot, remaining = count;
+    while (remaining > 0) {
+        uint16_t to = (from + remaining > MINUTE_COLUMNS_CAPACITY) ? MINUTE_COLUMNS_CAPACITY : from + remaining;
+        for (uint16_t w = from >> 5; w <= (to - 1) >> 5; w++) {
+            cols->valid[w] &= ~word_mask(w, from, to);
+        }
+        remaining -= to - from;
+        from = 0;
+    }
+}
+
+/**
+ * 連続したスロットのうち有効なスロット数を取得
+ */
+uint16_t minute_columns_count_range(const minute_columns_t *cols, uint16_t first_slot, uint16_t count) {
+    if (count > MINUTE_COLUMNS_CAPACITY) {
+        count = MINUTE_COLUMNS_CAPACITY;
+    }
+    uint16_t total = 0;
+    uint16_t from = first_slot, remaining = count;
+    while (remaining > 0) {
+        uint16_t to = (from + remaining > MINUTE_COLUMNS_CAPACITY) ? MINUTE_COLUMNS_CAPACITY : from + remaining;
+        for (uint16_t w = from >> 5; w <= (to - 1) >> 5; w++) {
+            total += (uint16_t)__builtin_popcount(cols->valid[w] & word_mask(w, from, to));
+        }
+        remaining -= to - from;
+        from = 0;
+    }
+    return total;
+}
+
+/**
+ * 先頭スロットから同じ状態で続くスロット数を取得
+ */
+uint16_t minute_columns_run_length(const minute_columns_t *cols, uint16_t first_slot, uint16_t count, bool valid) {
+    if (count > MINUTE_COLUMNS_CAPACITY) {
+        count = MINUTE_COLUMNS_CAPACITY;
+    }
+    uint16_t run = 0;
+    uint16_t from = first_slot, remaining = count;
+    while (remaining > 0) {
+        uint16_t to = (from + remaining > MINUTE_COLUMNS_CAPACITY) ? MINUTE_COLUMNS_CAPACITY : from + remaining;
+        for (uint16_t w = from >> 5; w <= (to - 1) >> 5; w++) {
+            // 状態が変わるビット（valid なら空き、そうでなければ有効）を探す
+            uint32_t changed = (valid ? ~cols->valid[w] : cols->valid[w]) & word_mask(w, from, to);
+            if (changed != 0) {
+                return (uint16_t)(run + (w << 5) + __builtin_ctz(changed) - from);
+            }
+        }
+        run += to - from;
+        remaining -= to - from;
+        from = 0;
+    }
+    return run;
+}
+
+/**
+ * 土壌水分の生値を取得
+ */
+int32_t minute_columns_soil_moisture_raw(const minute_columns_t *cols, uint16_t slot) {
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    int32_t max = cols->capacitance[0][slot];
+    for (int c = 1; c < FDC1004_CHANNEL_COUNT; c++) {
+        if (cols->capacitance[c][slot] > max) {
+            max = cols->capacitance[c][slot];
+        }
+    }
+    return max;
+#else
+    return cols->soil_moisture[slot];
+#endif
+}
+
+/**
+ * 代表土壌温度の生値を取得
+ */
+bool minute_columns_soil_temperature_raw(const minute_columns_t *cols, uint16_t slot, int16_t *raw) {
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    return minute_record_temp_bits_soil_temperature_raw(cols->temp_bits[slot], raw);
+#else
+    *raw = cols->soil_temperature1[slot];
+    return true;
+#endif
+}
+
+/**
+ * ビットマップの1ワードのうちスロット範囲 [from, to) に当たるビット
+ */
+static uint32_t word_mask(uint16_t word, uint16_t from, uint16_t to) {
+    uint32_t base = (uint32_t)word << 5;
+    uint32_t lo = (from > base) ? from - base : 0;
+    uint32_t hi = (to < base + 32) ? to - base : 32;
+    uint32_t mask = (hi == 32) ? UINT32_MAX : ((1u << hi) - 1);
+    return mask & ~((1u << lo) - 1);
+}
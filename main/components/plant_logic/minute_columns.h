@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "minute_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MINUTE_COLUMNS_CAPACITY     (24 * 60)   // スロット数（DATA_BUFFER_MINUTE_CAPACITY と同じ）
+#define MINUTE_COLUMNS_VALID_WORDS  ((MINUTE_COLUMNS_CAPACITY + 31) / 32)
+
+/**
+ * 1分データの列形式ストア（フィールドごとの配列 + 共通の時刻キー列 + 有効ビットマップ）
+ * minute_record_t の各フィールドをスロット番号で添字付けした配列に分けて持つ。
+ * 1〜2フィールドだけを走査する集計では、そのフィールドの列（2バイト間隔）と有効ビットマップだけを
+ * 読めばよく、レコード全体をキャッシュに載せずに済む。合計サイズは行形式と同じ（+ ビットマップ）
+ */
+typedef struct {
+    uint32_t valid[MINUTE_COLUMNS_VALID_WORDS];     // 有効ビットマップ（bit slot: データあり）
+    uint16_t minute_key[MINUTE_COLUMNS_CAPACITY];   // 時刻キー（全フィールド共通）
+    int16_t  temperature[MINUTE_COLUMNS_CAPACITY];  // 気温 [0.01℃]
+    uint16_t humidity[MINUTE_COLUMNS_CAPACITY];     // 湿度 [0.01%]
+    uint16_t lux[MINUTE_COLUMNS_CAPACITY];          // 照度（minute_record_encode_lux形式）
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    int16_t  capacitance[FDC1004_CHANNEL_COUNT][MINUTE_COLUMNS_CAPACITY];    // 静電容量 ch1〜4 [1/2048 pF]
+    uint8_t  temp_bits[MINUTE_COLUMNS_CAPACITY][MINUTE_RECORD_TEMP_BITS_SIZE]; // 有効フラグ + 12bit温度列（ビット列のまま1行ずつ）
+#else
+    uint16_t soil_moisture[MINUTE_COLUMNS_CAPACITY];      // 土壌水分 [mV]
+    int16_t  soil_temperature1[MINUTE_COLUMNS_CAPACITY];  // 土壌温度1 [1/16℃]
+    int16_t  soil_temperature2[MINUTE_COLUMNS_CAPACITY];  // 土壌温度2 [1/16℃]
+#endif
+} minute_columns_t;
+
+/**
+ * 全スロットを空きにする
+ * @param cols 対象ストア
+ */
+void minute_columns_clear(minute_columns_t *cols);
+
+/**
+ * 1行（レコード）を各列に書き込む
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ * @param rec 書き込むレコード（minute_key を時刻キー列に格納する。MINUTE_RECORD_KEY_EMPTY の場合は空きにする）
+ */
+void minute_columns_put(minute_columns_t *cols, uint16_t slot, const minute_record_t *rec);
+
+/**
+ * 各列から1行（レコード）を組み立てる（行形式のアクセサ）
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ * @param rec 格納先（空きスロットの場合は minute_key = MINUTE_RECORD_KEY_EMPTY）
+ */
+void minute_columns_get(const minute_columns_t *cols, uint16_t slot, minute_record_t *rec);
+
+/**
+ * スロットを空きにする
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ */
+void minute_columns_erase(minute_columns_t *cols, uint16_t slot);
+
+/**
+ * スロットにデータがあるか判定
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ * @return true: データあり
+ */
+static inline bool minute_columns_is_valid(const minute_columns_t *cols, uint16_t slot) {
+    return (cols->valid[slot >> 5] >> (slot & 31)) & 1u;
+}
+
+/**
+ * 有効なスロット数を取得（ビットマップのpopcount）
+ * @param cols 対象ストア
+ * @return 有効なスロット数
+ */
+uint16_t minute_columns_count(const minute_columns_t *cols);
+
+/**
+ * 連続したスロットを空きにする（有効ビットマップを32スロット単位で消去）
+ * @param cols 対象ストア
+ * @param first_slot 先頭スロット
+ * @param count スロット数（末尾を越えた分は先頭に折り返す）
+ */
+void minute_columns_erase_range(minute_columns_t *cols, uint16_t first_slot, uint16_t count);
+
+/**
+ * 連続したスロットのうち有効なスロット数を取得（ビットマップのpopcount）
+ * @param cols 対象ストア
+ * @param first_slot 先頭スロット
+ * @param count スロット数（末尾を越えた分は先頭に折り返す）
+ * @return 有効なスロット数
+ */
+uint16_t minute_columns_count_range(const minute_columns_t *cols, uint16_t first_slot, uint16_t count);
+
+/**
+ * 先頭スロットから有効/空きが同じ状態で続くスロット数を取得（欠測区間の検出用）
+ * @param cols 対象ストア
+ * @param first_slot 先頭スロット
+ * @param count 調べる最大スロット数（末尾を越えた分は先頭に折り返す）
+ * @param valid 数える状態（true: 有効が続く数, false: 空きが続く数）
+ * @return 続くスロット数（0〜count）
+ */
+uint16_t minute_columns_run_length(const minute_columns_t *cols, uint16_t first_slot, uint16_t count, bool valid);
+
+/**
+ * 土壌水分の生値を取得（minute_record_soil_moisture_raw と同じ定義）
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ * @return 土壌水分の生値
+ */
+int32_t minute_columns_soil_moisture_raw(const minute_columns_t *cols, uint16_t slot);
+
+/**
+ * 代表土壌温度の生値を取得（minute_record_soil_temperature_raw と同じ定義）
+ * @param cols 対象ストア
+ * @param slot スロット番号
+ * @param raw 土壌温度 [1/16℃] の格納先
+ * @return true: 有効な値あり
+ */
+bool minute_columns_soil_temperature_raw(const minute_columns_t *cols, uint16_t slot, int16_t *raw);
+
+#ifdef __cplusplus
+}
+#endif
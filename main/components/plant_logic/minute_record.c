@@ -0,0 +1,292 @@
+#include "minute_record.h"
+#include "data_buffer.h"
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// プライベート関数の宣言
+static int32_t scale_round(float value, float scale, int32_t min, int32_t max);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+static void bits_put(uint8_t *buf, uint16_t bit_pos, uint8_t width, uint32_t value);
+static uint32_t bits_get(const uint8_t *buf, uint16_t bit_pos, uint8_t width);
+static void put_probe_temp(uint8_t *buf, int index, float temperature);
+static int16_t get_probe_temp_raw(const uint8_t *buf, int index);
+static float get_probe_temp(const uint8_t *buf, int index);
+#endif
+
+/**
+ * 1分データをパック形式にエンコード
+ */
+void minute_record_encode(const minute_data_t *src, uint16_t minute_key, minute_record_t *rec) {
+    memset(rec, 0, sizeof(minute_record_t));
+
+    rec->minute_key = minute_key;
+    rec->temperature = (int16_t)scale_round(src->temperature, MINUTE_RECORD_TEMP_SCALE, INT16_MIN, INT16_MAX);
+    rec->humidity = (uint16_t)scale_round(src->humidity, MINUTE_RECORD_HUMIDITY_SCALE, 0, UINT16_MAX);
+    rec->lux = minute_record_encode_lux(src->lux);
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // soil_moisture は4chの最大値（read_all_sensorsと同じ定義）なので格納しない
+    for (int i = 0; i < FDC1004_CHANNEL_COUNT; i++) {
+        rec->soil_moisture_capacitance[i] = (int16_t)scale_round(src->soil_moisture_capacitance[i],
+                                                                  MINUTE_RECORD_CAP_SCALE, INT16_MIN, INT16_MAX);
+    }
+
+    uint8_t count = (src->soil_temperature_count > TMP102_MAX_DEVICES) ? TMP102_MAX_DEVICES : src->soil_temperature_count;
+    bits_put(rec->temp_bits, 0, 3, count);
+    for (int i = 0; i < count; i++) {
+        put_probe_temp(rec->temp_bits, i, src->soil_temperature[i]);
+    }
+#if HARDWARE_VERSION == 40
+    bits_put(rec->temp_bits, 3, 1, src->ext_temperature_valid ? 1 : 0);
+    if (src->ext_temperature_valid) {
+        put_probe_temp(rec->temp_bits, TMP102_MAX_DEVICES, src->ext_temperature);
+    }
+#endif
+#else
+    rec->soil_moisture = (uint16_t)scale_round(src->soil_moisture, 1.0f, 0, UINT16_MAX);
+    rec->soil_temperature1 = (int16_t)scale_round(src->soil_temperature1, MINUTE_RECORD_PROBE_TEMP_SCALE, INT16_MIN, INT16_MAX);
+    rec->soil_temperature2 = (int16_t)scale_round(src->soil_temperature2, MINUTE_RECORD_PROBE_TEMP_SCALE, INT16_MIN, INT16_MAX);
+#endif
+}
+
+/**
+ * パック形式のレコードを1分データにデコード
+ */
+void minute_record_decode(const minute_record_t *rec, uint32_t epoch_minute, minute_data_t *dst) {
+    memset(dst, 0, sizeof(minute_data_t));
+
+    time_t t = (time_t)epoch_minute * 60;
+    localtime_r(&t, &dst->timestamp);
+
+    minute_record_decode_values(rec, dst);
+}
+
+/**
+ * パック形式のレコードから計測値のみをデコード
+ */
+void minute_record_decode_values(const minute_record_t *rec, minute_data_t *dst) {
+    dst->temperature = rec->temperature / MINUTE_RECORD_TEMP_SCALE;
+    dst->humidity = rec->humidity / MINUTE_RECORD_HUMIDITY_SCALE;
+    dst->lux = minute_record_decode_lux(rec->lux);
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    dst->soil_moisture = 0.0f;
+    for (int i = 0; i < FDC1004_CHANNEL_COUNT; i++) {
+        dst->soil_moisture_capacitance[i] = rec->soil_moisture_capacitance[i] / MINUTE_RECORD_CAP_SCALE;
+        if (i == 0 || dst->soil_moisture_capacitance[i] > dst->soil_moisture) {
+            dst->soil_moisture = dst->soil_moisture_capacitance[i];
+        }
+    }
+
+    dst->soil_temperature_count = (uint8_t)bits_get(rec->temp_bits, 0, 3);
+    for (int i = 0; i < TMP102_MAX_DEVICES; i++) {
+        dst->soil_temperature[i] = (i < dst->soil_temperature_count) ? get_probe_temp(rec->temp_bits, i) : 0.0f;
+    }
+#if HARDWARE_VERSION == 40
+    dst->ext_temperature_valid = bits_get(rec->temp_bits, 3, 1) != 0;
+    dst->ext_temperature = dst->ext_temperature_valid ? get_probe_temp(rec->temp_bits, TMP102_MAX_DEVICES) : 0.0f;
+#endif
+#else
+    dst->soil_moisture = rec->soil_moisture;
+    dst->soil_temperature1 = rec->soil_temperature1 / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    dst->soil_temperature2 = rec->soil_temperature2 / MINUTE_RECORD_PROBE_TEMP_SCALE;
+#endif
+
+    dst->valid = true;
+}
+
+/**
+ * レコードの計測値を整数フィールド列に展開
+ */
+void minute_record_get_fields(const minute_record_t *rec, int32_t *fields) {
+    int n = 0;
+    fields[n++] = rec->temperature;
+    fields[n++] = rec->humidity;
+    fields[n++] = rec->lux;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int i = 0; i < FDC1004_CHANNEL_COUNT; i++) {
+        fields[n++] = rec->soil_moisture_capacitance[i];
+    }
+    fields[n++] = (int32_t)bits_get(rec->temp_bits, 0, MINUTE_RECORD_VALID_BITS);
+    for (int i = 0; i < MINUTE_RECORD_PROBE_TEMPS; i++) {
+        fields[n++] = get_probe_temp_raw(rec->temp_bits, i);
+    }
+#else
+    fields[n++] = rec->soil_moisture;
+    fields[n++] = rec->soil_temperature1;
+    fields[n++] = rec->soil_temperature2;
+#endif
+}
+
+/**
+ * 整数フィールド列からレコードの計測値を設定
+ */
+void minute_record_set_fields(minute_record_t *rec, const int32_t *fields) {
+    int n = 0;
+    rec->temperature = (int16_t)fields[n++];
+    rec->humidity = (uint16_t)fields[n++];
+    rec->lux = (uint16_t)fields[n++];
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int i = 0; i < FDC1004_CHANNEL_COUNT; i++) {
+        rec->soil_moisture_capacitance[i] = (int16_t)fields[n++];
+    }
+    bits_put(rec->temp_bits, 0, MINUTE_RECORD_VALID_BITS, (uint32_t)fields[n++]);
+    for (int i = 0; i < MINUTE_RECORD_PROBE_TEMPS; i++) {
+        bits_put(rec->temp_bits, MINUTE_RECORD_VALID_BITS + i * 12, 12, (uint32_t)fields[n++] & 0xFFF);
+    }
+#else
+    rec->soil_moisture = (uint16_t)fields[n++];
+    rec->soil_temperature1 = (int16_t)fields[n++];
+    rec->soil_temperature2 = (int16_t)fields[n++];
+#endif
+}
+
+/**
+ * 土壌水分の生値を取得
+ */
+int32_t minute_record_soil_moisture_raw(const minute_record_t *rec) {
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    int32_t max = rec->soil_moisture_capacitance[0];
+    for (int i = 1; i < FDC1004_CHANNEL_COUNT; i++) {
+        if (rec->soil_moisture_capacitance[i] > max) {
+            max = rec->soil_moisture_capacitance[i];
+        }
+    }
+    return max;
+#else
+    return rec->soil_moisture;
+#endif
+}
+
+/**
+ * 代表土壌温度の生値を取得
+ */
+bool minute_record_soil_temperature_raw(const minute_record_t *rec, int16_t *raw) {
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    return minute_record_temp_bits_soil_temperature_raw(rec->temp_bits, raw);
+#else
+    *raw = rec->soil_temperature1;
+    return true;
+#endif
+}
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * 温度ビット列から代表土壌温度の生値を取得
+ */
+bool minute_record_temp_bits_soil_temperature_raw(const uint8_t *temp_bits, int16_t *raw) {
+    return minute_record_temp_bits_probe_raw(temp_bits, 0, raw);
+}
+
+/**
+ * 温度ビット列から指定した土壌温度センサーの生値を取得
+ */
+bool minute_record_temp_bits_probe_raw(const uint8_t *temp_bits, uint8_t probe, int16_t *raw) {
+    if (probe >= TMP102_MAX_DEVICES || probe >= bits_get(temp_bits, 0, 3)) {
+        return false;
+    }
+    *raw = get_probe_temp_raw(temp_bits, probe);
+    return true;
+}
+#endif
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * 土壌温度センサーの生値をまとめて取得
+ */
+uint8_t minute_record_probe_temperatures_raw(const minute_record_t *rec, int16_t *raw) {
+    uint8_t count = (uint8_t)bits_get(rec->temp_bits, 0, 3);
+    if (count > TMP102_MAX_DEVICES) {
+        count = TMP102_MAX_DEVICES;
+    }
+    for (int i = 0; i < count; i++) {
+        raw[i] = get_probe_temp_raw(rec->temp_bits, i);
+    }
+    return count;
+}
+#endif
+
+/**
+ * 照度を16bit (4bit指数 + 12bit仮数) にエンコード
+ * 0.01lux単位の整数を12bitに収まるまで右シフトする（相対誤差 0.025% 以下）
+ */
+uint16_t minute_record_encode_lux(float lux) {
+    if (!(lux > 0.0f)) {
+        return 0;
+    }
+    float scaled = lux * MINUTE_RECORD_LUX_SCALE + 0.5f;
+    if (scaled >= (float)(0xFFFu << 15)) {
+        return 0xFFFF;
+    }
+
+    uint32_t value = (uint32_t)scaled;
+    uint16_t exponent = 0;
+    while ((value >> exponent) > 0xFFF) {
+        exponent++;
+    }
+
+    // 切り捨てるビットを一度だけ丸める（繰り上がりで13bitになった場合は桁を1つ上げる）
+    uint32_t mantissa = (exponent > 0) ? ((value + (1u << (exponent - 1))) >> exponent) : value;
+    if (mantissa > 0xFFF) {
+        mantissa >>= 1;
+        exponent++;
+    }
+    if (exponent > 15) {
+        return 0xFFFF;
+    }
+    return (uint16_t)((exponent << 12) | mantissa);
+}
+
+/**
+ * 16bit照度値をデコード
+ */
+float minute_record_decode_lux(uint16_t code) {
+    return (float)minute_record_lux_raw(code) / MINUTE_RECORD_LUX_SCALE;
+}
+
+// プライベート関数の実装
+
+static int32_t scale_round(float value, float scale, int32_t min, int32_t max) {
+    float scaled = roundf(value * scale);
+    if (scaled < (float)min) return min;
+    if (scaled > (float)max) return max;
+    return (int32_t)scaled;
+}
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+static void bits_put(uint8_t *buf, uint16_t bit_pos, uint8_t width, uint32_t value) {
+    for (uint8_t i = 0; i < width; i++, bit_pos++) {
+        uint8_t mask = (uint8_t)(1u << (bit_pos & 7));
+        if (value & (1u << i)) {
+            buf[bit_pos >> 3] |= mask;
+        } else {
+            buf[bit_pos >> 3] &= (uint8_t)~mask;
+        }
+    }
+}
+
+static uint32_t bits_get(const uint8_t *buf, uint16_t bit_pos, uint8_t width) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < width; i++, bit_pos++) {
+        if (buf[bit_pos >> 3] & (1u << (bit_pos & 7))) {
+            value |= (1u << i);
+        }
+    }
+    return value;
+}
+
+static void put_probe_temp(uint8_t *buf, int index, float temperature) {
+    int32_t raw = scale_round(temperature, MINUTE_RECORD_PROBE_TEMP_SCALE, -2048, 2047);
+    bits_put(buf, MINUTE_RECORD_VALID_BITS + index * 12, 12, (uint32_t)raw & 0xFFF);
+}
+
+static int16_t get_probe_temp_raw(const uint8_t *buf, int index) {
+    uint32_t raw = bits_get(buf, MINUTE_RECORD_VALID_BITS + index * 12, 12);
+    return (raw & 0x800) ? (int16_t)(raw | 0xF000) : (int16_t)raw;
+}
+
+static float get_probe_temp(const uint8_t *buf, int index) {
+    return get_probe_temp_raw(buf, index) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+}
+#endif
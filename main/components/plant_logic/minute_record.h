@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../common_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct minute_data_t;
+
+// 時刻キーの空きスロット値
+#define MINUTE_RECORD_KEY_EMPTY         0xFFFF
+
+// 固定小数点スケール
+#define MINUTE_RECORD_TEMP_SCALE        100.0f    // 気温 [0.01℃]
+#define MINUTE_RECORD_HUMIDITY_SCALE    100.0f    // 湿度 [0.01%]
+#define MINUTE_RECORD_LUX_SCALE         100.0f    // 照度 [0.01lux] (指数部で桁を拡張)
+#define MINUTE_RECORD_CAP_SCALE         2048.0f   // 静電容量 [1/2048 pF] (FDC1004の分解能 0.5fF, ±16pF)
+#define MINUTE_RECORD_PROBE_TEMP_SCALE  16.0f     // 土壌/拡張温度 [1/16℃] (TMP102/DS18B20の12bit分解能)
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+#define MINUTE_RECORD_SOIL_SCALE        MINUTE_RECORD_CAP_SCALE  // 土壌水分 = 最大静電容量 [1/2048 pF]
+#else
+#define MINUTE_RECORD_SOIL_SCALE        1.0f      // 土壌水分 [mV]
+#endif
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+// 温度ビット列: 有効フラグ4bit + 12bit温度 x N
+//   bit0-2: 有効な土壌温度センサー数 (0〜4)
+//   bit3  : 拡張温度の有効性 (Rev4)
+//   bit4〜: 土壌温度[0..3] (+ 拡張温度) を12bitずつ
+#define MINUTE_RECORD_VALID_BITS        4
+#if HARDWARE_VERSION == 40
+#define MINUTE_RECORD_PROBE_TEMPS       (TMP102_MAX_DEVICES + 1)
+#else
+#define MINUTE_RECORD_PROBE_TEMPS       TMP102_MAX_DEVICES
+#endif
+#define MINUTE_RECORD_TEMP_BITS_SIZE    ((MINUTE_RECORD_VALID_BITS + MINUTE_RECORD_PROBE_TEMPS * 12 + 7) / 8)
+#endif
+
+// 整数フィールド列（圧縮などでレコードを項目単位に扱うための表現）
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+// 気温, 湿度, 照度, 静電容量 x4, 有効フラグ(4bit), 12bit温度 x N
+#define MINUTE_RECORD_FIELD_COUNT       (3 + FDC1004_CHANNEL_COUNT + 1 + MINUTE_RECORD_PROBE_TEMPS)
+#else
+// 気温, 湿度, 照度, 土壌水分, 土壌温度1, 土壌温度2
+#define MINUTE_RECORD_FIELD_COUNT       6
+#endif
+
+/**
+ * 1分データの内部格納形式（固定小数点・パック済み）
+ * minute_data_t の約1/4のサイズで、data_buffer内部のリングバッファに格納される
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t minute_key;            // 時刻キー（解釈はdata_bufferが管理、0xFFFF:空き）
+    int16_t  temperature;           // 気温 [0.01℃]
+    uint16_t humidity;              // 湿度 [0.01%]
+    uint16_t lux;                   // 照度 [上位4bit:指数, 下位12bit:仮数, 0.01lux単位]
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    int16_t  soil_moisture_capacitance[FDC1004_CHANNEL_COUNT]; // 静電容量 [1/2048 pF]
+    uint8_t  temp_bits[MINUTE_RECORD_TEMP_BITS_SIZE];          // 有効フラグ + 12bit温度列
+#else
+    uint16_t soil_moisture;         // 土壌水分 [mV]
+    int16_t  soil_temperature1;     // 土壌温度1 [1/16℃]
+    int16_t  soil_temperature2;     // 土壌温度2 [1/16℃]
+#endif
+} minute_record_t;
+
+/**
+ * 1分データをパック形式にエンコード
+ * タイムスタンプは変換せず、呼び出し側が算出した時刻キーを格納する
+ * @param src 変換元の1分データ
+ * @param minute_key 格納する時刻キー
+ * @param rec 格納先レコード
+ */
+void minute_record_encode(const struct minute_data_t *src, uint16_t minute_key, minute_record_t *rec);
+
+/**
+ * パック形式のレコードを1分データにデコード
+ * @param rec 変換元レコード
+ * @param epoch_minute レコードのエポック分 (UTC, 1970-01-01からの経過分)
+ * @param dst 格納先の1分データ
+ */
+void minute_record_decode(const minute_record_t *rec, uint32_t epoch_minute, struct minute_data_t *dst);
+
+/**
+ * パック形式のレコードから計測値のみをデコード（タイムスタンプは変換しない）
+ * 集計処理などでlocaltime変換を省くために使用する
+ * @param rec 変換元レコード
+ * @param dst 格納先の1分データ（timestampは変更しない）
+ */
+void minute_record_decode_values(const minute_record_t *rec, struct minute_data_t *dst);
+
+/**
+ * レコードの計測値を整数フィールド列に展開（時刻キーは含まない）
+ * 各フィールドは格納形式の生値（16bit以内）で、set_fieldsと組み合わせると可逆
+ * @param rec 変換元レコード
+ * @param fields 格納先（MINUTE_RECORD_FIELD_COUNT要素）
+ */
+void minute_record_get_fields(const minute_record_t *rec, int32_t *fields);
+
+/**
+ * 整数フィールド列からレコードの計測値を設定（時刻キーは変更しない）
+ * @param rec 格納先レコード
+ * @param fields フィールド列（MINUTE_RECORD_FIELD_COUNT要素）
+ */
+void minute_record_set_fields(minute_record_t *rec, const int32_t *fields);
+
+/**
+ * レコードが空きスロットか判定
+ * @param rec 判定するレコード
+ * @return true: 空き
+ */
+static inline bool minute_record_is_empty(const minute_record_t *rec) {
+    return rec->minute_key == MINUTE_RECORD_KEY_EMPTY;
+}
+
+/**
+ * 土壌水分の生値を取得（Rev3/Rev4: 4chの最大静電容量 [1/2048 pF], Rev1/Rev2: [mV]）
+ * @param rec 対象レコード
+ * @return 土壌水分の生値
+ */
+int32_t minute_record_soil_moisture_raw(const minute_record_t *rec);
+
+/**
+ * 代表土壌温度の生値を取得（Rev3/Rev4: TMP102[0], Rev1/Rev2: 土壌温度1）
+ * @param rec 対象レコード
+ * @param raw 土壌温度 [1/16℃] の格納先
+ * @return true: 有効な値あり
+ */
+bool minute_record_soil_temperature_raw(const minute_record_t *rec, int16_t *raw);
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * 温度ビット列（minute_record_t.temp_bits）から代表土壌温度の生値を取得
+ * レコード全体を組み立てずに温度ビット列だけを参照する場合に使用する
+ * @param temp_bits 温度ビット列（MINUTE_RECORD_TEMP_BITS_SIZE バイト）
+ * @param raw 土壌温度 [1/16℃] の格納先
+ * @return true: 有効な値あり
+ */
+bool minute_record_temp_bits_soil_temperature_raw(const uint8_t *temp_bits, int16_t *raw);
+
+/**
+ * 温度ビット列から指定した土壌温度センサーの生値を取得
+ * @param temp_bits 温度ビット列（MINUTE_RECORD_TEMP_BITS_SIZE バイト）
+ * @param probe センサー番号（TMP102[0..3]、深さ順）
+ * @param raw 土壌温度 [1/16℃] の格納先
+ * @return true: 有効な値あり
+ */
+bool minute_record_temp_bits_probe_raw(const uint8_t *temp_bits, uint8_t probe, int16_t *raw);
+
+/**
+ * 土壌温度センサー（TMP102[0..3]、深さ順）の生値をまとめて取得
+ * @param rec 対象レコード
+ * @param raw 土壌温度 [1/16℃] の格納先（TMP102_MAX_DEVICES要素、有効な先頭から格納）
+ * @return 有効な土壌温度センサー数
+ */
+uint8_t minute_record_probe_temperatures_raw(const minute_record_t *rec, int16_t *raw);
+#endif
+
+/**
+ * 16bit照度値を0.01lux単位の整数に展開
+ * @param code エンコード値
+ * @return 照度 [0.01lux]
+ */
+static inline uint32_t minute_record_lux_raw(uint16_t code) {
+    return (uint32_t)(code & 0xFFF) << (code >> 12);
+}
+
+/**
+ * 照度を16bit (4bit指数 + 12bit仮数) にエンコード
+ * @param lux 照度 [lux]
+ * @return エンコード値
+ */
+uint16_t minute_record_encode_lux(float lux);
+
+/**
+ * 16bit照度値をデコード
+ * @param code エンコード値
+ * @return 照度 [lux]
+ */
+float minute_record_decode_lux(uint16_t code);
+
+#ifdef __cplusplus
+}
+#endif
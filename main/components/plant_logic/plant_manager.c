@@ -3,23 +3,67 @@
 #include "plant_manager.h"
 #include "../../nvs_config.h"
 #include "data_buffer.h"
+#include "event_log.h"
+#include "watering_detector.h"
+#include "stream_detect.h"
+#include "drying_rate.h"
+#include "plant_rules.h"
+#include "profile_library.h"
+#include "seqlock.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include <string.h>
 #include <time.h>
-#include <stdlib.h>
+#include <math.h>
 #include "../../common_types.h"
 
 static const char *TAG = "PlantManager";
 
 // プライベート変数
-static plant_profile_t g_plant_profile;
+static plant_profile_t g_plant_profile;     // アクティブのプロファイル（g_profile_lock で保護、初期化後のライターはBLEタスクのみ）
+static seqlock_t g_profile_lock;
+static profile_library_t g_profile_library; // プロファイルのライブラリ（RAMキャッシュ。初期化後に読み書きするのはBLEタスクのみ）
 static bool g_initialized = false;
-static plant_condition_t g_last_plant_condition = SOIL_WET; // 初期状態は湿潤と仮定
+static plant_condition_t g_last_plant_condition = SOIL_WET; // ルールの評価で決まった直近の状態（初期状態は湿潤と仮定。センサー読み取りタスクのみ更新、状態判定タスクは原子的に読む）
+static float g_watering_decrease = 0.0f;    // 直近の灌水判定での2回前からの土壌水分の減少量（センサー読み取りタスクのみ）
+static uint8_t g_watering_channels = 0;     // 直近の灌水判定で閾値以上変化したチャンネル（event_entry_t.channel_mask。センサー読み取りタスクのみ）
+static event_log_table_t g_event_table;     // NVS保存用のイベント表
+static watering_detector_t g_watering_detector;  // 灌水検出用の直近3件（g_watering_lock で保護、ライターはセンサー読み取りタスクのみ）
+static seqlock_t g_watering_lock;
+static drying_rate_t g_drying_rate;         // 乾燥速度の推定（g_drying_lock で保護、ライターはセンサー読み取りタスクのみ）
+static seqlock_t g_drying_lock;
+static rule_engine_t g_rule_engine;         // 状態判定のルールと評価の状態（g_rule_lock で保護、ライターはセンサー読み取りタスクのみ）
+static seqlock_t g_rule_lock;
+static rule_set_t g_custom_rules;           // NVS・BLEから書き込んだルール（count 0: 既定のルール。g_custom_rules_lock で保護、ライターはBLEタスクのみ）
+static seqlock_t g_custom_rules_lock;
+static uint8_t g_dry_days = 0;              // 直近の判定での乾燥日数（イベントログ用。センサー読み取りタスクのみ）
+
+// センサー読み取りタスクで検出したイベント（ストリーミング検出器・植物状態の変化）の待ち行列（状態判定でイベントログへ移す）
+// イベントログのライターを状態判定タスクだけにするため、単一ライター / 単一リーダーのリングで受け渡す
+#define PENDING_EVENT_CAPACITY  16
+static event_entry_t g_pending_events[PENDING_EVENT_CAPACITY];
+static uint32_t g_pending_head = 0;         // 追加した数（センサー読み取りタスクのみ更新）
+static uint32_t g_pending_tail = 0;         // 取り出した数（状態判定タスクのみ更新）
 
 // プライベート関数の宣言
-static plant_condition_t determine_plant_condition(const plant_profile_t *profile, const minute_data_t *latest_data);
-static bool detect_watering_event(float current_moisture, float threshold_mv);
+static void read_profile(plant_profile_t *profile);
+static void evaluate_rules(const data_buffer_window_t *window);
+static void sync_rules(const plant_profile_t *profile);
+static void read_custom_rules(rule_set_t *set);
+static void build_rule_inputs(const plant_profile_t *profile, const minute_data_t *latest_data, uint32_t epoch_minute,
+                              rule_inputs_t *inputs);
+static uint8_t count_dry_days(const plant_profile_t *profile, uint8_t max_days);
+static bool detect_watering_event(float threshold_mv, float *decrease);
+static void feed_moisture_trackers(const data_buffer_window_t *window);
+static void feed_stream_detectors(const data_buffer_window_t *window);
+static bool queue_event(const event_entry_t *event);
+static void flush_pending_events(void);
+static void save_event_log(void);
+static stream_detect_config_t make_stream_config(const plant_profile_t *profile);
+static void apply_archive_errors(const plant_profile_t *profile);
+static void record_condition_event(plant_condition_t condition, const minute_data_t *latest_data, uint32_t epoch_minute);
+
+_Static_assert(DATA_BUFFER_FIELD_COUNT <= PLANT_PROFILE_ARCHIVE_FIELDS, "archive_error must cover every data buffer field");
 
 /**
  * 植物管理システムを初期化
@@ -36,12 +80,47 @@ esp_err_t plant_manager_init(void) {
         return ret;
     }
 
-    // 植物プロファイルを読み込み
-    ret = nvs_config_load_plant_profile(&g_plant_profile);
+    // プロファイルのライブラリを読み込み、アクティブのプロファイルを使う
+    ret = nvs_config_load_profile_library(&g_profile_library);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to load plant profile");
         return ret;
     }
+    seqlock_write_begin(&g_profile_lock);
+    g_plant_profile = *profile_library_get(&g_profile_library, g_profile_library.active);
+    seqlock_write_end(&g_profile_lock);
+    apply_archive_errors(&g_plant_profile);
+    stream_detect_config_t config = make_stream_config(&g_plant_profile);
+    stream_detect_init(&config);
+
+    // 状態判定のルールを読み込み（未保存・不正な表は既定のルールを使う）
+    rule_set_t rules;
+    memset(&rules, 0, sizeof(rules));
+    if (nvs_config_load_rule_set(&rules) != ESP_OK || rule_engine_check(&rules, ERROR_CONDITION, NULL) != ESP_OK) {
+        memset(&rules, 0, sizeof(rules));
+        rules.version = RULE_SET_VERSION;
+    }
+    seqlock_write_begin(&g_custom_rules_lock);
+    g_custom_rules = rules;
+    seqlock_write_end(&g_custom_rules_lock);
+    sync_rules(&g_plant_profile);
+
+    // 灌水検出の窓と乾燥速度の推定を復元済みの直近24時間から作り直す
+    seqlock_write_begin(&g_watering_lock);
+    watering_detector_reset(&g_watering_detector);
+    seqlock_write_end(&g_watering_lock);
+    seqlock_write_begin(&g_drying_lock);
+    drying_rate_reset(&g_drying_rate);
+    seqlock_write_end(&g_drying_lock);
+    data_buffer_window_t recent = data_buffer_window_recent(DATA_BUFFER_MINUTES_PER_DAY);
+    feed_moisture_trackers(&recent);
+
+    // イベントログを復元（未保存・サイズ不一致は空で開始）
+    if (nvs_config_load_event_log(&g_event_table) == ESP_OK) {
+        event_log_init(&g_event_table);
+    } else {
+        event_log_init(NULL);
+    }
 
     g_initialized = true;
     ESP_LOGI(TAG, "Plant management system initialized successfully");
@@ -70,6 +149,15 @@ void plant_manager_process_sensor_data(const soil_data_t *sensor_data) {
         ESP_LOGE(TAG, "Failed to add sensor data to buffer: %s", esp_err_to_name(ret));
     } else {
         ESP_LOGI(TAG, "Sensor data added to buffer successfully. Soil Moisture: %.0fmV", sensor_data->soil_moisture);
+
+        // 格納した1件（リングと同じ量子化済みの値）を灌水検出の窓に追加（エポック分は格納時に求めたものを使う）
+        uint32_t epoch_minute = data_buffer_get_last_added_minute();
+        if (epoch_minute > 0) {
+            data_buffer_window_t window = { epoch_minute, epoch_minute + 1 };
+            feed_moisture_trackers(&window);
+            feed_stream_detectors(&window);
+            evaluate_rules(&window);
+        }
     }
 }
 
@@ -91,12 +179,100 @@ plant_status_result_t plant_manager_determine_status(const minute_data_t *latest
         return result;
     }
 
-    result.plant_condition = determine_plant_condition(&g_plant_profile, latest_data);
-    g_last_plant_condition = result.plant_condition;
+    // 状態はセンサー読み取りタスクが計測ごとにルールで評価した結果（状態の変化のイベントは先に待ち行列に入っている）
+    result.plant_condition = __atomic_load_n(&g_last_plant_condition, __ATOMIC_ACQUIRE);
+    flush_pending_events();
+    plant_manager_get_drying_forecast(&result.drying);
 
     return result;
 }
 
+/**
+ * 乾燥の予測を取得
+ */
+esp_err_t plant_manager_get_drying_forecast(drying_forecast_t *forecast) {
+    if (!g_initialized || forecast == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    drying_rate_t estimator;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_drying_lock);
+        estimator = g_drying_rate;
+    } while (seqlock_read_retry(&g_drying_lock, seq, &attempts));
+    plant_profile_t profile;
+    read_profile(&profile);
+    drying_rate_forecast(&estimator, profile.soil_dry_threshold, forecast);
+    return ESP_OK;
+}
+
+/**
+ * 状態判定のルールを設定
+ */
+esp_err_t plant_manager_set_rules(const rule_set_t *rules) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (rules == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint16_t cost;
+    esp_err_t ret = rule_engine_check(rules, ERROR_CONDITION, &cost);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Rejected rules: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // 使わない要素は0にそろえる（読み込み直しの判定で表全体を比較するため）
+    rule_set_t set;
+    memset(&set, 0, sizeof(set));
+    set.version = rules->version;
+    set.count = rules->count;
+    memcpy(set.rules, rules->rules, set.count * sizeof(rule_t));
+    ret = nvs_config_save_rule_set(&set);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    seqlock_write_begin(&g_custom_rules_lock);
+    g_custom_rules = set;
+    seqlock_write_end(&g_custom_rules_lock);
+    ESP_LOGI(TAG, "Rules updated: %u rules, cost %u (applied from the next sample)", set.count, cost);
+    return ESP_OK;
+}
+
+/**
+ * 状態判定のルールを取得
+ */
+esp_err_t plant_manager_get_rules(rule_set_t *rules, bool *is_custom) {
+    if (!g_initialized || rules == NULL || is_custom == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    read_custom_rules(rules);
+    *is_custom = (rules->count > 0);
+    if (!*is_custom) {
+        plant_profile_t profile;
+        read_profile(&profile);
+        plant_rules_build_default(&profile, rules);
+    }
+    return ESP_OK;
+}
+
+/**
+ * ルールの評価の状態と実績を取得
+ */
+esp_err_t plant_manager_get_rule_engine(rule_engine_t *engine) {
+    if (!g_initialized || engine == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_rule_lock);
+        *engine = g_rule_engine;
+    } while (seqlock_read_retry(&g_rule_lock, seq, &attempts));
+    return ESP_OK;
+}
+
 /**
  * 植物状態の文字列表現を取得
  */
@@ -124,6 +300,17 @@ const plant_profile_t* plant_manager_get_profile(void) {
     return &g_plant_profile;
 }
 
+/**
+ * 現在の植物プロファイルのコピーを取得
+ */
+esp_err_t plant_manager_read_profile(plant_profile_t *profile) {
+    if (!g_initialized || profile == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    read_profile(profile);
+    return ESP_OK;
+}
+
 /**
  * 現在実行中の植物プロファイルを更新
  */
@@ -132,8 +319,111 @@ void plant_manager_update_profile(const plant_profile_t *new_profile) {
         ESP_LOGE(TAG, "Cannot update profile: Not initialized or new profile is NULL");
         return;
     }
+    // 他のタスクは read_profile でコピーを取るので、書き込み途中のしきい値・名前は読まれない
+    seqlock_write_begin(&g_profile_lock);
     memcpy(&g_plant_profile, new_profile, sizeof(plant_profile_t));
-    ESP_LOGI(TAG, "Plant profile updated in memory: %s", g_plant_profile.plant_name);
+    seqlock_write_end(&g_profile_lock);
+    apply_archive_errors(new_profile);
+    stream_detect_config_t config = make_stream_config(new_profile);
+    stream_detect_set_config(&config);
+    ESP_LOGI(TAG, "Plant profile updated in memory: %s", new_profile->plant_name);
+}
+
+/**
+ * 植物プロファイルをライブラリのスロットに保存
+ */
+esp_err_t plant_manager_store_profile(uint8_t index, const plant_profile_t *profile, uint8_t *stored_index) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (profile == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 番号の指定がなければ同じ名前のスロット、なければ空きスロット
+    if (index == PROFILE_LIBRARY_NONE) {
+        index = profile_library_find(&g_profile_library, profile->plant_name);
+        if (index == PROFILE_LIBRARY_NONE) {
+            index = profile_library_free_slot(&g_profile_library);
+        }
+        if (index == PROFILE_LIBRARY_NONE) {
+            ESP_LOGW(TAG, "Profile library is full");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_config_save_profile_slot(index, profile);
+    if (err != ESP_OK) {
+        return err;
+    }
+    profile_library_put(&g_profile_library, index, profile);
+    if (index == g_profile_library.active) {
+        plant_manager_update_profile(&g_profile_library.profiles[index]);
+    }
+    if (stored_index != NULL) {
+        *stored_index = index;
+    }
+    return ESP_OK;
+}
+
+/**
+ * アクティブのプロファイルを切り替える
+ */
+esp_err_t plant_manager_select_profile(uint8_t index) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const plant_profile_t *profile = profile_library_get(&g_profile_library, index);
+    if (profile == NULL) {
+        return index < PROFILE_LIBRARY_SLOTS ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_ARG;
+    }
+    if (index == g_profile_library.active) {
+        return ESP_OK;
+    }
+
+    // NVSにはアクティブの番号（1バイト）だけを書き、プロファイルはRAMキャッシュから適用する
+    esp_err_t err = nvs_config_save_active_profile(index);
+    if (err != ESP_OK) {
+        return err;
+    }
+    profile_library_select(&g_profile_library, index);
+    plant_manager_update_profile(profile);
+    return ESP_OK;
+}
+
+/**
+ * ライブラリのスロットを削除
+ */
+esp_err_t plant_manager_delete_profile(uint8_t index) {
+    if (!g_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (profile_library_get(&g_profile_library, index) == NULL) {
+        return index < PROFILE_LIBRARY_SLOTS ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_ARG;
+    }
+    if (index == g_profile_library.active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = nvs_config_erase_profile_slot(index);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return profile_library_remove(&g_profile_library, index);
+}
+
+/**
+ * プロファイルのライブラリを取得
+ */
+const profile_library_t* plant_manager_get_profile_library(void) {
+    if (!g_initialized) {
+        ESP_LOGE(TAG, "Plant manager not initialized");
+        return NULL;
+    }
+    return &g_profile_library;
 }
 
 /**
@@ -145,8 +435,11 @@ void plant_manager_print_system_status(void) {
         return;
     }
 
+    plant_profile_t profile;
+    read_profile(&profile);
     ESP_LOGI(TAG, "=== Plant Management System Status ===");
-    ESP_LOGI(TAG, "Plant: %s", g_plant_profile.plant_name);
+    ESP_LOGI(TAG, "Plant: %s (profile slot %u, slots 0x%04x)", profile.plant_name,
+             g_profile_library.active, g_profile_library.used_mask);
 
     // データバッファの状態を出力
     data_buffer_print_status();
@@ -156,136 +449,413 @@ void plant_manager_print_system_status(void) {
     if (data_buffer_get_latest_minute_data(&latest_data) == ESP_OK) {
         ESP_LOGI(TAG, "Latest sensor data: temp=%.1f C, soil=%.0fmV", latest_data.temperature, latest_data.soil_moisture);
     }
+
+    // 状態判定のルールごとの評価の費用と実績
+    static rule_engine_t engine;
+    if (plant_manager_get_rule_engine(&engine) == ESP_OK) {
+        ESP_LOGI(TAG, "Rules: %u rules, cost %u/%u, %lu evaluations",
+                 engine.set.count, engine.total_cost, RULE_ENGINE_MAX_COST, (unsigned long)engine.evaluations);
+        for (uint8_t i = 0; i < engine.set.count; i++) {
+            const rule_state_t *state = &engine.state[i];
+            ESP_LOGI(TAG, "  rule %u: cost %u, true %lu, matches %lu, %lu cycles (max %lu)", i, state->cost,
+                     (unsigned long)state->true_count, (unsigned long)state->matches,
+                     (unsigned long)state->last_cycles, (unsigned long)state->max_cycles);
+        }
+    }
 }
 
 // プライベート関数の実装
 
 /**
- * 植物の状態を判断
+ * アクティブのプロファイルを手元にコピー（BLEタスクの書き込みと重なった場合は読み直す）
+ * @param profile 格納先
  */
-static plant_condition_t determine_plant_condition(const plant_profile_t *profile, const minute_data_t *latest_data) {
-    // データは引数で渡されるため、ここでのデータ取得は不要
-    float soil_moisture = latest_data->soil_moisture;
-    float temperature = latest_data->temperature;
+static void read_profile(plant_profile_t *profile) {
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_profile_lock);
+        *profile = g_plant_profile;
+    } while (seqlock_read_retry(&g_profile_lock, seq, &attempts));
+}
 
-    // 最優先：気温の限界チェック
-    if (temperature >= profile->temp_high_limit) {
-        return TEMP_TOO_HIGH;
-    }
-    if (temperature <= profile->temp_low_limit) {
-        return TEMP_TOO_LOW;
+/**
+ * 格納した1件で植物の状態を判断（ルールの表を1回走査して評価）
+ * センサー読み取りタスクで計測ごとに呼び出すため、継続時間・ヒステリシスはサンプル単位で進む
+ * 状態が変わった時は記録対象の状態のイベントを待ち行列に追加してから g_last_plant_condition を更新する
+ *
+ * @param window 格納した1件の範囲
+ */
+static void evaluate_rules(const data_buffer_window_t *window) {
+    data_buffer_iter_t it;
+    minute_data_t latest_data;
+    if (data_buffer_iter_begin(&it, window) != ESP_OK || !data_buffer_iter_next(&it)) {
+        return;
     }
+    data_buffer_iter_decode(&it, &latest_data);
 
-    // 灌水完了判定（2つの条件のいずれかで判定）
-    // 条件1: 2回前のサンプリングから設定値以上下がった場合
-    if (detect_watering_event(soil_moisture, profile->watering_threshold)) {
-        ESP_LOGI(TAG, "💧 灌水イベント検出: 土壌水分が2回前から%.2f以上減少", profile->watering_threshold);
-        return WATERING_COMPLETED;
-    }
+    plant_profile_t profile;
+    read_profile(&profile);
+    sync_rules(&profile);
+
+    rule_inputs_t inputs;
+    build_rule_inputs(&profile, &latest_data, it.epoch_minute, &inputs);
+    rule_result_t rule_result;
+    seqlock_write_begin(&g_rule_lock);
+    bool matched = rule_engine_evaluate(&g_rule_engine, &inputs, &rule_result);
+    seqlock_write_end(&g_rule_lock);
 
-    // 条件2: 従来の判定（乾燥状態から湿潤閾値以下になった場合）
-    if ((g_last_plant_condition == SOIL_DRY || g_last_plant_condition == NEEDS_WATERING) && soil_moisture <= profile->soil_wet_threshold) {
-        ESP_LOGI(TAG, "💧 灌水完了: 乾燥状態から湿潤閾値以下に");
-        return WATERING_COMPLETED;
+    if (!matched) {
+        // いずれのルールも成立しない場合は、最後と同じ状態を維持
+        return;
     }
 
-    // 灌水要求判定
-    daily_summary_data_t daily_summaries[7];
-    uint8_t summary_count = 0;
-    esp_err_t ret = data_buffer_get_recent_daily_summaries(profile->soil_dry_days_for_watering, daily_summaries, &summary_count);
-    if (ret == ESP_OK && summary_count >= profile->soil_dry_days_for_watering) {
-        int consecutive_dry_days = 0;
-        for (int i = 0; i < summary_count; i++) {
-            if (daily_summaries[i].avg_soil_moisture >= profile->soil_dry_threshold) {
-                consecutive_dry_days++;
-            }
-        }
-        if (consecutive_dry_days >= profile->soil_dry_days_for_watering) {
-            ESP_LOGD(TAG, "Needs watering: consecutive_dry_days=%d >= %d",
-                     consecutive_dry_days, profile->soil_dry_days_for_watering);
-            return NEEDS_WATERING;
+    plant_condition_t condition = (plant_condition_t)rule_result.condition;
+    ESP_LOGD(TAG, "Rule %u matched: %s", rule_result.rule_index, plant_manager_get_plant_condition_string(condition));
+    if (condition != g_last_plant_condition) {
+        // 成立し続けている間は毎サンプル出さず、状態が変わった時だけ出す
+        if (condition == WATERING_COMPLETED) {
+            ESP_LOGI(TAG, "💧 灌水完了 (ルール %u)", rule_result.rule_index);
         }
+        record_condition_event(condition, &latest_data, it.epoch_minute);
+        __atomic_store_n(&g_last_plant_condition, condition, __ATOMIC_RELEASE);
     }
+}
 
-    // 乾燥判定
-    if (soil_moisture >= profile->soil_dry_threshold) {
-        ESP_LOGD(TAG, "Soil dry: %.0f >= %.0f", soil_moisture, profile->soil_dry_threshold);
-        return SOIL_DRY;
+/**
+ * 評価するルールの表を更新（書き込まれたルール、なければ植物プロファイルから作る既定のルール）
+ * 表が変わった時（書き込み・プロファイルの更新）だけ読み込み直し、評価の状態と実績をやり直す
+ *
+ * @param profile 植物プロファイル
+ */
+static void sync_rules(const plant_profile_t *profile) {
+    rule_set_t set;
+    read_custom_rules(&set);
+    if (set.count == 0) {
+        plant_rules_build_default(profile, &set);
+    }
+    if (memcmp(&set, &g_rule_engine.set, sizeof(rule_set_t)) == 0) {
+        return;
     }
 
-    // 湿潤判定
-    if (soil_moisture <= profile->soil_wet_threshold) {
-        ESP_LOGD(TAG, "Soil wet: %.0f <= %.0f", soil_moisture, profile->soil_wet_threshold);
-        return SOIL_WET;
+    seqlock_write_begin(&g_rule_lock);
+    esp_err_t ret = rule_engine_load(&g_rule_engine, &set, ERROR_CONDITION);
+    seqlock_write_end(&g_rule_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load rules: %s", esp_err_to_name(ret));
+        return;
     }
+    ESP_LOGI(TAG, "Rules loaded: %u rules, cost %u", set.count, g_rule_engine.total_cost);
+}
 
-    // 上記のいずれにも当てはまらない場合は、最後と同じ状態を維持
-    return g_last_plant_condition;
+/**
+ * 書き込まれたルールの表を読み出す
+ *
+ * @param set 格納先（count 0: 既定のルールを使う）
+ */
+static void read_custom_rules(rule_set_t *set) {
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_custom_rules_lock);
+        *set = g_custom_rules;
+    } while (seqlock_read_retry(&g_custom_rules_lock, seq, &attempts));
 }
 
 /**
- * time_t比較関数（qsort用）
+ * ルールの評価に使うオペランドの値を求める
+ * 灌水検出・乾燥日数・乾燥の予測は表が使う場合だけ求める（乾燥日数は表が必要とする日数まで遡る）
+ *
+ * @param profile 植物プロファイル
+ * @param latest_data 判断に使用するセンサーデータ
+ * @param epoch_minute latest_data のエポック分
+ * @param inputs 格納先
  */
-static int compare_time_desc(const void *a, const void *b) {
-    const minute_data_t *data_a = (const minute_data_t *)a;
-    const minute_data_t *data_b = (const minute_data_t *)b;
+static void build_rule_inputs(const plant_profile_t *profile, const minute_data_t *latest_data, uint32_t epoch_minute,
+                              rule_inputs_t *inputs) {
+    memset(inputs, 0, sizeof(rule_inputs_t));
+    inputs->epoch_minute = epoch_minute;
+
+    inputs->value[RULE_OPERAND_TEMPERATURE] = latest_data->temperature;
+    inputs->value[RULE_OPERAND_HUMIDITY] = latest_data->humidity;
+    inputs->value[RULE_OPERAND_LUX] = latest_data->lux;
+    inputs->value[RULE_OPERAND_SOIL_MOISTURE] = latest_data->soil_moisture;
+    inputs->value[RULE_OPERAND_LAST_CONDITION] = (float)g_last_plant_condition;
+    inputs->valid_mask = (1u << RULE_OPERAND_TEMPERATURE) | (1u << RULE_OPERAND_HUMIDITY) | (1u << RULE_OPERAND_LUX) |
+                         (1u << RULE_OPERAND_SOIL_MOISTURE) | (1u << RULE_OPERAND_LAST_CONDITION);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    if (latest_data->soil_temperature_count > 0) {
+        inputs->value[RULE_OPERAND_SOIL_TEMPERATURE] = latest_data->soil_temperature[0];
+        inputs->valid_mask |= 1u << RULE_OPERAND_SOIL_TEMPERATURE;
+    }
+#else
+    inputs->value[RULE_OPERAND_SOIL_TEMPERATURE] = latest_data->soil_temperature1;
+    inputs->valid_mask |= 1u << RULE_OPERAND_SOIL_TEMPERATURE;
+#endif
+    drying_forecast_t forecast;
+    if ((g_rule_engine.operand_mask & (1u << RULE_OPERAND_HOURS_UNTIL_DRY)) &&
+        plant_manager_get_drying_forecast(&forecast) == ESP_OK && forecast.hours_until_dry >= 0.0f) {
+        inputs->value[RULE_OPERAND_HOURS_UNTIL_DRY] = forecast.hours_until_dry;
+        inputs->valid_mask |= 1u << RULE_OPERAND_HOURS_UNTIL_DRY;
+    }
 
-    time_t time_a = mktime((struct tm*)&data_a->timestamp);
-    time_t time_b = mktime((struct tm*)&data_b->timestamp);
+    g_watering_decrease = 0.0f;
+    g_watering_channels = 0;
+    if (g_rule_engine.operand_mask & (1u << RULE_OPERAND_WATERING_DECREASE)) {
+        if (detect_watering_event(profile->watering_threshold, &inputs->value[RULE_OPERAND_WATERING_DECREASE])) {
+            inputs->valid_mask |= 1u << RULE_OPERAND_WATERING_DECREASE;
+        }
+    }
 
-    // 降順ソート（新しい順）
-    if (time_a > time_b) return -1;
-    if (time_a < time_b) return 1;
-    return 0;
+    g_dry_days = 0;
+    if (g_rule_engine.operand_mask & (1u << RULE_OPERAND_DRY_DAYS)) {
+        g_dry_days = count_dry_days(profile, g_rule_engine.dry_days_depth);
+        inputs->value[RULE_OPERAND_DRY_DAYS] = (float)g_dry_days;
+        inputs->valid_mask |= 1u << RULE_OPERAND_DRY_DAYS;
+    }
 }
 
 /**
- * 灌水イベントを検出
- * 2回前のサンプリングと比較して、土壌水分が指定閾値以上減少したか判定
+ * 日平均の土壌水分が乾燥閾値以上の日が続いた日数（直近の日から新しい順に1日ずつ参照）
  *
- * @param current_moisture 現在の土壌水分値 [mV]
- * @param threshold_mv 灌水検出閾値 [mV]
- * @return true: 灌水イベント検出, false: 検出せず
+ * @param profile 植物プロファイル
+ * @param max_days 遡る日数の上限
+ * @return 続いた日数（max_days で打ち切り）
  */
-static bool detect_watering_event(float current_moisture, float threshold_mv) {
-    uint16_t count = 0;
-
-    // 過去1時間分のデータを取得
-    minute_data_t hour_data[60];
-    esp_err_t ret = data_buffer_get_recent_minute_data(1, hour_data, &count);
+static uint8_t count_dry_days(const plant_profile_t *profile, uint8_t max_days) {
+    uint8_t consecutive_dry_days = 0;
+    daily_summary_data_t summary;
+    for (uint8_t i = 0; i < max_days; i++) {
+        if (data_buffer_get_recent_daily_summary(i, &summary) != ESP_OK ||
+            summary.avg_soil_moisture < profile->soil_dry_threshold) {
+            break;
+        }
+        consecutive_dry_days++;
+    }
+    return consecutive_dry_days;
+}
 
-    if (ret != ESP_OK || count < 3) {
+/**
+ * 灌水イベントを検出
+ * 2回前のサンプリングと比較して、土壌水分の減少量を求める（集約値とチャンネルごとの減少量のうち最大。
+ * 最大以外のチャンネルだけに届いた灌水も閾値以上の減少になる）
+ * サンプル到着時に更新している直近3件の窓だけを見る（過去データの走査なし）
+ * 減少量と閾値以上変化したチャンネルは g_watering_decrease / g_watering_channels に残す（イベントログ用）
+ *
+ * @param threshold_mv 灌水検出閾値 [mV]（ログと閾値以上変化したチャンネルの判定用）
+ * @param decrease 2回前からの減少量の格納先
+ * @return true: 判定できた, false: データ不足
+ */
+static bool detect_watering_event(float threshold_mv, float *decrease) {
+    watering_detector_t detector;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_watering_lock);
+        detector = g_watering_detector;
+    } while (seqlock_read_retry(&g_watering_lock, seq, &attempts));
+
+    // 過去1時間以内の直近3件で判定
+    data_buffer_window_t window = data_buffer_window_recent(60);
+    watering_detection_t detection;
+    if (!watering_detector_check(&detector, window.start_minute, threshold_mv, &detection)) {
         // データが3件未満の場合は判定できない
-        ESP_LOGD(TAG, "灌水検出: データ不足 (count=%d)", count);
+        ESP_LOGD(TAG, "灌水検出: データ不足 (count=%d)", detector.count);
         return false;
     }
 
-    // データを新しい順にソート
-    qsort(hour_data, count, sizeof(minute_data_t), compare_time_desc);
+    *decrease = detection.decrease;
+    g_watering_decrease = detection.decrease;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // チャンネルごとに2回前から閾値以上変化したか（根域のどの深さに水が届いたか）
+    g_watering_channels = detection.channel_mask;
+#else
+    g_watering_channels = detection.detected ? 0x01 : 0;
+#endif
+
+    ESP_LOGD(TAG, "灌水検出チェック: 2回前=%.0fmV, 現在=%.0fmV, 減少量=%.0fmV (集約値 %.0fmV), 閾値=%.0fmV",
+             detection.moisture_2_samples_ago, detection.current_moisture, detection.decrease,
+             detection.aggregate_decrease, threshold_mv);
+
+    if (detection.detected) {
+        ESP_LOGI(TAG, "✅ 灌水イベント検出: 土壌水分が %.0fmV 減少 (2回前: %.0fmV → 現在: %.0fmV, 閾値: %.0fmV, 減少したチャンネル: 0x%02x)",
+                 detection.decrease, detection.moisture_2_samples_ago, detection.current_moisture, threshold_mv,
+                 detection.watering_mask);
+    }
+    return true;
+}
 
-    // 最新3件のデータを使用
-    // インデックス0が最新、1が1回前、2が2回前
-    // 注意: インデックス0は現在追加中のデータなので、実際は1が最新、3が2回前
-    if (count < 3) {
-        ESP_LOGD(TAG, "灌水検出: ソート後のデータ不足 (count=%d)", count);
-        return false;
+/**
+ * 1分リングの指定範囲のデータを古い順に灌水検出の窓と乾燥速度の推定に追加
+ * リングに格納したパック形式の値を換算して使うため、判定はリングを走査した場合と一致する
+ *
+ * @param window 追加する範囲
+ */
+static void feed_moisture_trackers(const data_buffer_window_t *window) {
+    uint16_t fields = (1u << DATA_BUFFER_FIELD_SOIL_MOISTURE) | (1u << DATA_BUFFER_FIELD_LUX);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        fields |= 1u << (DATA_BUFFER_FIELD_CAPACITANCE1 + c);
     }
+#endif
+    data_buffer_iter_t it;
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    if (data_buffer_iter_begin(&it, window) != ESP_OK) {
+        return;
+    }
+    plant_profile_t profile;
+    read_profile(&profile);
+    while (data_buffer_iter_next_fields(&it, fields, values, &valid_mask)) {
+        float moisture = values[DATA_BUFFER_FIELD_SOIL_MOISTURE] / MINUTE_RECORD_SOIL_SCALE;
+        float channels[WATERING_DETECTOR_CHANNELS];
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            channels[c] = values[DATA_BUFFER_FIELD_CAPACITANCE1 + c] / MINUTE_RECORD_SOIL_SCALE;
+        }
+#else
+        channels[0] = moisture;
+#endif
+        seqlock_write_begin(&g_watering_lock);
+        watering_detector_add(&g_watering_detector, it.epoch_minute, moisture, channels);
+        seqlock_write_end(&g_watering_lock);
+
+        if (moisture != 0.0f) {  // 0は読み取り失敗
+            bool is_day = values[DATA_BUFFER_FIELD_LUX] / MINUTE_RECORD_LUX_SCALE >= DRYING_RATE_DAY_LUX;
+            seqlock_write_begin(&g_drying_lock);
+            drying_rate_add(&g_drying_rate, it.epoch_minute, moisture, is_day, profile.watering_threshold);
+            seqlock_write_end(&g_drying_lock);
+        }
+    }
+}
 
-    // インデックス2が2回前のデータ
-    float moisture_2_samples_ago = hour_data[2].soil_moisture;
+/**
+ * プロファイルの許容誤差をフィールドごとの間引き記録に反映
+ * 値が変わったフィールドだけ、次の計測時にセンサー読み取りタスク（1分リングのライター）で記録し直される
+ *
+ * @param profile 植物プロファイル
+ */
+static void apply_archive_errors(const plant_profile_t *profile) {
+    for (int f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+        if (data_buffer_set_archive_error((data_buffer_field_t)f, profile->archive_error[f]) != ESP_OK) {
+            ESP_LOGW(TAG, "Invalid archive error for field %d: %.4f", f, profile->archive_error[f]);
+        }
+    }
+}
 
-    // 土壌水分が2回前から200mV以上減少したか確認
-    float moisture_decrease = moisture_2_samples_ago - current_moisture;
+/**
+ * 植物状態が変わった時、記録対象の状態ならイベントを待ち行列に追加（次の状態判定でイベントログへ移して保存）
+ *
+ * @param condition 新しい植物状態
+ * @param latest_data 判断に使用したセンサーデータ
+ * @param epoch_minute latest_data のエポック分
+ */
+static void record_condition_event(plant_condition_t condition, const minute_data_t *latest_data, uint32_t epoch_minute) {
+    event_entry_t event = {0};
+    float magnitude;
+    switch (condition) {
+        case WATERING_COMPLETED:
+            event.type = EVENT_TYPE_WATERING;
+            event.channel_mask = g_watering_channels;
+            magnitude = g_watering_decrease * MINUTE_RECORD_SOIL_SCALE;
+            break;
+        case NEEDS_WATERING:
+            event.type = EVENT_TYPE_NEEDS_WATERING;
+            magnitude = (float)g_dry_days;
+            break;
+        case TEMP_TOO_HIGH:
+            event.type = EVENT_TYPE_TEMP_HIGH;
+            magnitude = latest_data->temperature * 100.0f;
+            break;
+        case TEMP_TOO_LOW:
+            event.type = EVENT_TYPE_TEMP_LOW;
+            magnitude = latest_data->temperature * 100.0f;
+            break;
+        default:
+            return;
+    }
+    if (magnitude > INT16_MAX) magnitude = INT16_MAX;
+    if (magnitude < INT16_MIN) magnitude = INT16_MIN;
+    event.magnitude = (int16_t)lroundf(magnitude);
+    event.epoch = epoch_minute * 60;
+
+    if (queue_event(&event)) {
+        ESP_LOGI(TAG, "Condition event: type=%u, magnitude=%d, channels=0x%02x",
+                 event.type, event.magnitude, event.channel_mask);
+    }
+}
 
-    ESP_LOGD(TAG, "灌水検出チェック: 2回前=%.0fmV, 現在=%.0fmV, 減少量=%.0fmV, 閾値=%.0fmV",
-             moisture_2_samples_ago, current_moisture, moisture_decrease, threshold_mv);
+/**
+ * イベントログをNVSに保存
+ */
+static void save_event_log(void) {
+    event_log_get_table(&g_event_table);
+    esp_err_t ret = nvs_config_save_event_log(&g_event_table);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save event log: %s", esp_err_to_name(ret));
+    }
+}
 
-    if (moisture_decrease >= threshold_mv) {
-        ESP_LOGI(TAG, "✅ 灌水イベント検出: 土壌水分が %.0fmV 減少 (2回前: %.0fmV → 現在: %.0fmV, 閾値: %.0fmV)",
-                 moisture_decrease, moisture_2_samples_ago, current_moisture, threshold_mv);
-        return true;
+/**
+ * 植物プロファイルからストリーミング検出器の設定を作成
+ */
+static stream_detect_config_t make_stream_config(const plant_profile_t *profile) {
+    stream_detect_config_t config = {
+        .watering_threshold = profile->watering_threshold,
+    };
+    return config;
+}
+
+/**
+ * 1分リングの指定範囲のデータを古い順にストリーミング検出器に渡し、発行されたイベントを待ち行列に追加
+ *
+ * @param window 渡す範囲
+ */
+static void feed_stream_detectors(const data_buffer_window_t *window) {
+    data_buffer_iter_t it;
+    minute_data_t data;
+    event_entry_t events[STREAM_DETECT_MAX_EVENTS];
+    if (data_buffer_iter_begin(&it, window) != ESP_OK) {
+        return;
+    }
+    while (data_buffer_iter_next(&it)) {
+        data_buffer_iter_decode(&it, &data);
+        uint8_t count = stream_detect_process(it.epoch_minute, &data, events, STREAM_DETECT_MAX_EVENTS);
+        for (uint8_t i = 0; i < count; i++) {
+            if (queue_event(&events[i])) {
+                ESP_LOGI(TAG, "Stream event: type=%u, magnitude=%d, channels=0x%02x",
+                         events[i].type, events[i].magnitude, events[i].channel_mask);
+            }
+        }
     }
+}
 
-    return false;
+/**
+ * イベントを待ち行列に追加（センサー読み取りタスクのみ）
+ *
+ * @param event 追加するイベント
+ * @return true: 追加した, false: 待ち行列が満杯
+ */
+static bool queue_event(const event_entry_t *event) {
+    uint32_t head = g_pending_head;
+    if (head - __atomic_load_n(&g_pending_tail, __ATOMIC_ACQUIRE) >= PENDING_EVENT_CAPACITY) {
+        ESP_LOGW(TAG, "Event queue full, dropping type=%u", event->type);
+        return false;
+    }
+    g_pending_events[head % PENDING_EVENT_CAPACITY] = *event;
+    __atomic_store_n(&g_pending_head, head + 1, __ATOMIC_RELEASE);
+    return true;
 }
 
+/**
+ * 待ち行列のイベントをイベントログへ移し、まとめて1回保存
+ */
+static void flush_pending_events(void) {
+    uint32_t head = __atomic_load_n(&g_pending_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = g_pending_tail;
+    if (head == tail) {
+        return;
+    }
+    for (; tail != head; tail++) {
+        event_log_append(&g_pending_events[tail % PENDING_EVENT_CAPACITY]);
+    }
+    __atomic_store_n(&g_pending_tail, tail, __ATOMIC_RELEASE);
+    save_event_log();
+}
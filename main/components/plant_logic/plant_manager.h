@@ -3,6 +3,8 @@
 #include <time.h>
 #include "esp_err.h"
 #include "../../common_types.h"
+#include "drying_rate.h"
+#include "rule_engine.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,6 +12,9 @@ extern "C" {
 
 // Forward declaration to break circular dependency
 struct minute_data_t;
+struct profile_library_t;
+
+#define PLANT_PROFILE_ARCHIVE_FIELDS  12   // 間引き記録の許容誤差の要素数（data_buffer_field_t の順、Rev1/Rev2は先頭5要素のみ使用）
 
 /**
  * 設定値管理構造体
@@ -22,6 +27,7 @@ typedef struct {
     float temp_high_limit;                  // 高温限界 (これを超えると警告)
     float temp_low_limit;                   // 低温限界 (これを下回ると警告)
     float watering_threshold;               // 灌水検出閾値 (2回前から何pF減少で灌水と判定) (例: 200.0mV)
+    float archive_error[PLANT_PROFILE_ARCHIVE_FIELDS]; // フィールドごとの間引き記録の許容誤差（フィールドの単位、0: 記録しない）
 } plant_profile_t;
 
 /**
@@ -42,6 +48,7 @@ typedef enum {
  */
 typedef struct {
     plant_condition_t plant_condition;
+    drying_forecast_t drying;               // 乾燥速度（昼・夜）と乾燥閾値に達するまでの予測時間
 } plant_status_result_t;
 
 // 公開関数
@@ -59,12 +66,42 @@ esp_err_t plant_manager_init(void);
 void plant_manager_process_sensor_data(const soil_data_t *sensor_data);
 
 /**
- * 植物の状態を総合的に判断（データバッファの過去データを使用）
- * @param latest_data 判断に使用する最新のセンサーデータ
+ * 植物の状態を取得（状態はセンサー読み取りタスクが計測ごとにルールで評価した結果）
+ * 待ち行列のイベントをイベントログへ移し、乾燥の予測を求める
+ * @param latest_data 最新のセンサーデータ（無効なら ERROR_CONDITION）
  * @return 植物状態の判断結果
  */
 plant_status_result_t plant_manager_determine_status(const struct minute_data_t *latest_data);
 
+/**
+ * 乾燥の予測を取得（計測ごとに更新している昼・夜の乾燥速度から、乾燥閾値に達するまでの時間を求める）
+ * @param forecast 予測結果
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t plant_manager_get_drying_forecast(drying_forecast_t *forecast);
+
+/**
+ * 状態判定のルールを設定（検証してNVSに保存し、次の計測から適用）
+ * @param rules ルールの表（count 0: 植物プロファイルから作る既定のルールに戻す）
+ * @return ESP_OK on success, rule_engine_check のエラー if the rules are invalid, NVSのエラー if saving failed
+ */
+esp_err_t plant_manager_set_rules(const rule_set_t *rules);
+
+/**
+ * 状態判定のルールを取得
+ * @param rules 格納先（書き込まれたルール、なければ植物プロファイルから作る既定のルール）
+ * @param is_custom true: 書き込まれたルール, false: 既定のルール
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t plant_manager_get_rules(rule_set_t *rules, bool *is_custom);
+
+/**
+ * ルールの評価の状態と実績（ルールごとの費用・成立回数・CPUサイクル数）を取得
+ * @param engine 格納先
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t plant_manager_get_rule_engine(rule_engine_t *engine);
+
 
 /**
  * 植物状態の文字列表現を取得
@@ -75,16 +112,54 @@ const char* plant_manager_get_plant_condition_string(plant_condition_t condition
 
 /**
  * 現在の植物プロファイルを取得
+ * プロファイルを書き換えるのはBLEタスクだけなので、ポインタで読んでよいのはBLEタスク（と初期化中）のみ。
+ * 他のタスクは plant_manager_read_profile でコピーを取得する
  * @return 植物プロファイルへのポインタ
  */
 const plant_profile_t* plant_manager_get_profile(void);
 
 /**
- * 現在実行中の植物プロファイルを更新
+ * 現在の植物プロファイルのコピーを取得（シーケンスロックで書き込みと重なった場合は読み直す）
+ * @param profile 格納先
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t plant_manager_read_profile(plant_profile_t *profile);
+
+/**
+ * 現在実行中の植物プロファイルを更新（BLEタスクから呼び出す）
  * @param new_profile 新しい植物プロファイル
  */
 void plant_manager_update_profile(const plant_profile_t *new_profile);
 
+/**
+ * 植物プロファイルをライブラリのスロットに保存（アクティブのスロットならすぐ適用）
+ * @param index スロット番号（PROFILE_LIBRARY_NONE: 同じ名前のスロット、なければ空きスロット）
+ * @param profile 植物プロファイル
+ * @param stored_index 保存したスロット番号の格納先（NULL可）
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range, ESP_ERR_NO_MEM if no slot is free, NVSのエラー if saving failed
+ */
+esp_err_t plant_manager_store_profile(uint8_t index, const plant_profile_t *profile, uint8_t *stored_index);
+
+/**
+ * アクティブのプロファイルを切り替える（NVSにはスロット番号だけを保存し、プロファイルはRAMキャッシュから適用）
+ * @param index スロット番号
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t plant_manager_select_profile(uint8_t index);
+
+/**
+ * ライブラリのスロットを削除
+ * @param index スロット番号
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty, ESP_ERR_INVALID_STATE if the slot is active
+ */
+esp_err_t plant_manager_delete_profile(uint8_t index);
+
+/**
+ * プロファイルのライブラリ（RAMキャッシュ）を取得
+ * @return ライブラリへのポインタ
+ */
+const struct profile_library_t* plant_manager_get_profile_library(void);
+
 /**
  * システム全体の状態情報をログ出力
  */
@@ -0,0 +1,43 @@
+#include "plant_rules.h"
+#include <string.h>
+
+static void add_rule(rule_set_t *set, rule_operand_t operand, rule_comparator_t comparator, float threshold,
+                     uint8_t flags, plant_condition_t condition, uint8_t priority) {
+    rule_t *rule = &set->rules[set->count++];
+    rule->operand = (uint8_t)operand;
+    rule->comparator = (uint8_t)comparator;
+    rule->flags = flags;
+    rule->condition = (uint8_t)condition;
+    rule->priority = priority;
+    rule->threshold = threshold;
+}
+
+/**
+ * 植物プロファイルから既定のルールの表を作る
+ */
+void plant_rules_build_default(const plant_profile_t *profile, rule_set_t *set) {
+    memset(set, 0, sizeof(rule_set_t));
+    set->version = RULE_SET_VERSION;
+
+    // 最優先：気温の限界
+    add_rule(set, RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, profile->temp_high_limit, 0, TEMP_TOO_HIGH, 0);
+    add_rule(set, RULE_OPERAND_TEMPERATURE, RULE_CMP_LE, profile->temp_low_limit, 0, TEMP_TOO_LOW, 1);
+
+    // 灌水完了: 2回前のサンプリングから設定値以上下がった場合
+    add_rule(set, RULE_OPERAND_WATERING_DECREASE, RULE_CMP_GE, profile->watering_threshold, 0, WATERING_COMPLETED, 2);
+
+    // 灌水完了: 乾燥状態（乾燥・灌水要求）から湿潤閾値以下になった場合
+    add_rule(set, RULE_OPERAND_LAST_CONDITION, RULE_CMP_EQ, (float)SOIL_DRY, RULE_FLAG_AND_NEXT, WATERING_COMPLETED, 3);
+    add_rule(set, RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_LE, profile->soil_wet_threshold, 0, WATERING_COMPLETED, 3);
+    add_rule(set, RULE_OPERAND_LAST_CONDITION, RULE_CMP_EQ, (float)NEEDS_WATERING, RULE_FLAG_AND_NEXT, WATERING_COMPLETED, 3);
+    add_rule(set, RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_LE, profile->soil_wet_threshold, 0, WATERING_COMPLETED, 3);
+
+    // 灌水要求: 乾燥した日が指定日数続いた場合（日別サマリーの保持日数を超える指定は成立しないため省く）
+    if (profile->soil_dry_days_for_watering > 0 && profile->soil_dry_days_for_watering <= RULE_ENGINE_MAX_DRY_DAYS) {
+        add_rule(set, RULE_OPERAND_DRY_DAYS, RULE_CMP_GE, (float)profile->soil_dry_days_for_watering, 0, NEEDS_WATERING, 4);
+    }
+
+    // 乾燥・湿潤
+    add_rule(set, RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_GE, profile->soil_dry_threshold, 0, SOIL_DRY, 5);
+    add_rule(set, RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_LE, profile->soil_wet_threshold, 0, SOIL_WET, 6);
+}
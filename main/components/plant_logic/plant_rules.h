@@ -0,0 +1,21 @@
+#pragma once
+
+#include "plant_manager.h"
+#include "rule_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 植物プロファイルから既定のルールの表を作る
+ * 従来の固定の判定と同じ優先順位（高温・低温 → 灌水検出 → 乾燥状態からの湿潤 → 乾燥日数 → 乾燥 → 湿潤）で、
+ * どのルールも成立しない時は呼び出し側が直前の状態を維持する
+ * @param profile 植物プロファイル
+ * @param set 表の格納先
+ */
+void plant_rules_build_default(const plant_profile_t *profile, rule_set_t *set);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,106 @@
+#include "profile_library.h"
+#include <string.h>
+
+/**
+ * 空のライブラリにする
+ */
+void profile_library_init(profile_library_t *library) {
+    memset(library, 0, sizeof(profile_library_t));
+    library->active = PROFILE_LIBRARY_NONE;
+}
+
+/**
+ * NVSのレコードをプロファイルに変換
+ */
+esp_err_t profile_library_decode(const void *record, size_t size, const plant_profile_t *defaults, plant_profile_t *profile) {
+    if (size < PROFILE_RECORD_MIN_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // フィールドは末尾にだけ追加するので、共通の先頭部分はどの版のレコードでも同じ配置
+    size_t copy = size < sizeof(plant_profile_t) ? size : sizeof(plant_profile_t);
+    *profile = *defaults;
+    memcpy(profile, record, copy);
+    profile->plant_name[sizeof(profile->plant_name) - 1] = '\0';
+    return ESP_OK;
+}
+
+/**
+ * スロットにプロファイルを置く
+ */
+esp_err_t profile_library_put(profile_library_t *library, uint8_t index, const plant_profile_t *profile) {
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    library->profiles[index] = *profile;
+    library->profiles[index].plant_name[sizeof(profile->plant_name) - 1] = '\0';
+    library->used_mask |= (uint16_t)(1u << index);
+    return ESP_OK;
+}
+
+/**
+ * スロットを空にする
+ */
+esp_err_t profile_library_remove(profile_library_t *library, uint8_t index) {
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((library->used_mask & (1u << index)) == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (index == library->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    library->used_mask &= (uint16_t)~(1u << index);
+    memset(&library->profiles[index], 0, sizeof(plant_profile_t));
+    return ESP_OK;
+}
+
+/**
+ * アクティブのスロットを切り替える
+ */
+esp_err_t profile_library_select(profile_library_t *library, uint8_t index) {
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((library->used_mask & (1u << index)) == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    library->active = index;
+    return ESP_OK;
+}
+
+/**
+ * スロットのプロファイルを取得
+ */
+const plant_profile_t *profile_library_get(const profile_library_t *library, uint8_t index) {
+    if (index >= PROFILE_LIBRARY_SLOTS || (library->used_mask & (1u << index)) == 0) {
+        return NULL;
+    }
+    return &library->profiles[index];
+}
+
+/**
+ * 名前でスロットを探す
+ */
+uint8_t profile_library_find(const profile_library_t *library, const char *name) {
+    for (uint8_t i = 0; i < PROFILE_LIBRARY_SLOTS; i++) {
+        if ((library->used_mask & (1u << i)) != 0 &&
+            strncmp(library->profiles[i].plant_name, name, sizeof(library->profiles[i].plant_name)) == 0) {
+            return i;
+        }
+    }
+    return PROFILE_LIBRARY_NONE;
+}
+
+/**
+ * 空いているスロットを探す
+ */
+uint8_t profile_library_free_slot(const profile_library_t *library) {
+    for (uint8_t i = 0; i < PROFILE_LIBRARY_SLOTS; i++) {
+        if ((library->used_mask & (1u << i)) == 0) {
+            return i;
+        }
+    }
+    return PROFILE_LIBRARY_NONE;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "plant_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 植物プロファイルのライブラリ
+ *
+ * 名前付きのプロファイルを番号付きの枠（スロット）に最大 PROFILE_LIBRARY_SLOTS 件持ち、どれを使うかを番号（アクティブ）で指す。
+ * 起動時に全スロットをNVSから1回で読み込んでRAMに置き、切り替えはRAM上のスロットを選んでアクティブの番号だけを保存する。
+ * NVSのレコードは plant_profile_t をそのまま保存した blob で、サイズの異なるレコード（フィールドを末尾に追加する前・後のファームウェアが
+ * 保存したもの）は profile_library_decode で共通の先頭部分を使い、足りないフィールドだけ既定値で補う。
+ */
+
+#define PROFILE_LIBRARY_SLOTS       16      // スロット数
+#define PROFILE_LIBRARY_NONE        0xFF    // アクティブのスロットなし
+#define PROFILE_RECORD_MIN_SIZE     offsetof(plant_profile_t, archive_error)   // 受け付ける最小のレコード（間引き記録の許容誤差を追加する前の形式）
+#define PROFILE_RECORD_MAX_SIZE     256     // 受け付ける最大のレコード（新しいファームウェアが保存したものは先頭だけ使う）
+
+/**
+ * ライブラリ（RAMキャッシュ）
+ */
+typedef struct profile_library_t {
+    plant_profile_t profiles[PROFILE_LIBRARY_SLOTS];
+    uint16_t used_mask;                     // プロファイルのあるスロット（bit: スロット番号）
+    uint8_t active;                         // アクティブのスロット（PROFILE_LIBRARY_NONE: なし）
+} profile_library_t;
+
+/**
+ * 空のライブラリにする
+ * @param library 対象
+ */
+void profile_library_init(profile_library_t *library);
+
+/**
+ * NVSのレコードをプロファイルに変換（サイズの違うレコードは先頭部分を使い、残りを既定値で補う）
+ * @param record レコード
+ * @param size レコードのサイズ
+ * @param defaults 足りないフィールドに使う既定値
+ * @param profile 変換先
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if size is smaller than PROFILE_RECORD_MIN_SIZE
+ */
+esp_err_t profile_library_decode(const void *record, size_t size, const plant_profile_t *defaults, plant_profile_t *profile);
+
+/**
+ * スロットにプロファイルを置く（名前は終端を保証する）
+ * @param library 対象
+ * @param index スロット番号
+ * @param profile プロファイル
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range
+ */
+esp_err_t profile_library_put(profile_library_t *library, uint8_t index, const plant_profile_t *profile);
+
+/**
+ * スロットを空にする
+ * @param library 対象
+ * @param index スロット番号
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range,
+ *         ESP_ERR_NOT_FOUND if the slot is empty, ESP_ERR_INVALID_STATE if the slot is active
+ */
+esp_err_t profile_library_remove(profile_library_t *library, uint8_t index);
+
+/**
+ * アクティブのスロットを切り替える
+ * @param library 対象
+ * @param index スロット番号
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t profile_library_select(profile_library_t *library, uint8_t index);
+
+/**
+ * スロットのプロファイルを取得
+ * @param library 対象
+ * @param index スロット番号
+ * @return プロファイル（空・範囲外のスロットは NULL）
+ */
+const plant_profile_t *profile_library_get(const profile_library_t *library, uint8_t index);
+
+/**
+ * 名前でスロットを探す
+ * @param library 対象
+ * @param name 植物の名前
+ * @return スロット番号（見つからない時は PROFILE_LIBRARY_NONE）
+ */
+uint8_t profile_library_find(const profile_library_t *library, const char *name);
+
+/**
+ * 空いているスロットを探す
+ * @param library 対象
+ * @return 最も小さい空きスロットの番号（空きがない時は PROFILE_LIBRARY_NONE）
+ */
+uint8_t profile_library_free_slot(const profile_library_t *library);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,177 @@
+#include "quantile_sketch.h"
+#include "data_buffer.h"
+#include <string.h>
+
+static const float k_daily_quantiles[DAILY_QUANTILE_COUNT] = { 0.10f, 0.50f, 0.90f };
+
+static void sort_heights(float *v, int n);
+
+/**
+ * 推定器を空の状態に初期化
+ * マーカーの目標位置の割合は {0, p1/2, p1, (p1+p2)/2, p2, …, pm, (1+pm)/2, 1}
+ */
+void p2_estimator_init(p2_estimator_t *est, const float *quantiles, uint8_t count) {
+    memset(est, 0, sizeof(p2_estimator_t));
+    if (count > P2_MAX_QUANTILES) {
+        count = P2_MAX_QUANTILES;
+    }
+    est->marker_count = (uint8_t)(2 * count + 3);
+    float prev = 0.0f;
+    for (int q = 0; q < count; q++) {
+        est->increment[2 * q + 1] = (prev + quantiles[q]) / 2.0f;
+        est->increment[2 * q + 2] = quantiles[q];
+        prev = quantiles[q];
+    }
+    est->increment[est->marker_count - 2] = (prev + 1.0f) / 2.0f;
+    est->increment[est->marker_count - 1] = 1.0f;
+}
+
+/**
+ * サンプルを追加
+ * 値が入るマーカー区間より右のマーカー位置を進め、中間のマーカーが目標位置から
+ * 1以上ずれていれば放物線補間（単調性が崩れる場合は線形補間）で高さを1つ分動かす
+ */
+void p2_estimator_add(p2_estimator_t *est, float x) {
+    int last = est->marker_count - 1;
+    if (est->count <= last) {
+        est->height[est->count++] = x;
+        if (est->count == est->marker_count) {
+            sort_heights(est->height, est->marker_count);
+            for (int i = 0; i <= last; i++) {
+                est->pos[i] = (uint16_t)i;
+            }
+        }
+        return;
+    }
+    if (est->count == UINT16_MAX) {
+        return;
+    }
+
+    // 値が入るマーカー区間 k を求める（両端は最小/最大を更新）
+    int k;
+    if (x < est->height[0]) {
+        est->height[0] = x;
+        k = 0;
+    } else if (x >= est->height[last]) {
+        est->height[last] = x;
+        k = last - 1;
+    } else {
+        k = 0;
+        while (k < last - 1 && x >= est->height[k + 1]) {
+            k++;
+        }
+    }
+    for (int i = k + 1; i <= last; i++) {
+        est->pos[i]++;
+    }
+    est->count++;
+
+    // 中間マーカーの高さを調整（目標位置は (n-1) × 割合）
+    for (int i = 1; i < last; i++) {
+        float d = (est->count - 1) * est->increment[i] - est->pos[i];
+        int gap_right = est->pos[i + 1] - est->pos[i];
+        int gap_left = est->pos[i - 1] - est->pos[i];
+        if ((d >= 1.0f && gap_right > 1) || (d <= -1.0f && gap_left < -1)) {
+            int s = (d > 0) ? 1 : -1;
+            float q_prev = est->height[i - 1], q = est->height[i], q_next = est->height[i + 1];
+            float n_prev = est->pos[i - 1], n = est->pos[i], n_next = est->pos[i + 1];
+            float parabolic = q + s / (n_next - n_prev) *
+                              ((n - n_prev + s) * (q_next - q) / (n_next - n) +
+                               (n_next - n - s) * (q - q_prev) / (n - n_prev));
+            if (parabolic > q_prev && parabolic < q_next) {
+                est->height[i] = parabolic;
+            } else {
+                est->height[i] = q + s * (est->height[i + s] - q) / ((float)est->pos[i + s] - n);
+            }
+            est->pos[i] = (uint16_t)(est->pos[i] + s);
+        }
+    }
+}
+
+/**
+ * 現在の推定値を取得
+ */
+float p2_estimator_get(const p2_estimator_t *est, uint8_t index) {
+    int marker = 2 * index + 2;
+    if (est->count == 0 || marker >= est->marker_count - 1) {
+        return 0.0f;
+    }
+    if (est->count >= est->marker_count) {
+        return est->height[marker];
+    }
+
+    // マーカー数未満: 受け取った値を並べて順位 p*(n-1) を線形補間
+    float sorted[P2_MAX_MARKERS];
+    memcpy(sorted, est->height, sizeof(float) * est->count);
+    sort_heights(sorted, est->count);
+    float rank = est->increment[marker] * (est->count - 1);
+    int lo = (int)rank;
+    if (lo >= est->count - 1) {
+        return sorted[est->count - 1];
+    }
+    return sorted[lo] + (rank - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+/**
+ * 日別の分位点推定を空の状態に初期化
+ */
+void daily_quantiles_reset(daily_quantiles_t *dq) {
+    for (int f = 0; f < QUANTILE_FIELD_COUNT; f++) {
+        p2_estimator_init(&dq->est[f], k_daily_quantiles, DAILY_QUANTILE_COUNT);
+    }
+}
+
+/**
+ * 1分レコードの各フィールドを推定器に追加
+ */
+void daily_quantiles_add(daily_quantiles_t *dq, const minute_record_t *rec) {
+    float values[QUANTILE_FIELD_COUNT];
+    values[QUANTILE_FIELD_TEMPERATURE] = rec->temperature;
+    values[QUANTILE_FIELD_HUMIDITY] = rec->humidity;
+    values[QUANTILE_FIELD_LUX] = (float)minute_record_lux_raw(rec->lux);
+    values[QUANTILE_FIELD_SOIL_MOISTURE] = (float)minute_record_soil_moisture_raw(rec);
+
+    int16_t soil_temp;
+    int fields = QUANTILE_FIELD_SOIL_TEMPERATURE;
+    if (minute_record_soil_temperature_raw(rec, &soil_temp)) {
+        values[QUANTILE_FIELD_SOIL_TEMPERATURE] = soil_temp;
+        fields = QUANTILE_FIELD_COUNT;
+    }
+
+    for (int f = 0; f < fields; f++) {
+        p2_estimator_add(&dq->est[f], values[f]);
+    }
+}
+
+/**
+ * 推定値を日別サマリーの分位点フィールドに格納
+ */
+void daily_quantiles_to_summary(const daily_quantiles_t *dq, daily_summary_data_t *summary) {
+    for (int q = 0; q < DAILY_QUANTILE_COUNT; q++) {
+        summary->temperature_quantiles[q] =
+            p2_estimator_get(&dq->est[QUANTILE_FIELD_TEMPERATURE], q) / MINUTE_RECORD_TEMP_SCALE;
+        summary->humidity_quantiles[q] =
+            p2_estimator_get(&dq->est[QUANTILE_FIELD_HUMIDITY], q) / MINUTE_RECORD_HUMIDITY_SCALE;
+        summary->lux_quantiles[q] =
+            p2_estimator_get(&dq->est[QUANTILE_FIELD_LUX], q) / MINUTE_RECORD_LUX_SCALE;
+        summary->soil_moisture_quantiles[q] =
+            p2_estimator_get(&dq->est[QUANTILE_FIELD_SOIL_MOISTURE], q) / MINUTE_RECORD_SOIL_SCALE;
+        summary->soil_temperature_quantiles[q] =
+            p2_estimator_get(&dq->est[QUANTILE_FIELD_SOIL_TEMPERATURE], q) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    }
+}
+
+/**
+ * 挿入ソート（最大 P2_MAX_MARKERS 要素）
+ */
+static void sort_heights(float *v, int n) {
+    for (int i = 1; i < n; i++) {
+        float x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+}
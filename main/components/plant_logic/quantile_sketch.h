@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "minute_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct daily_summary_data_t;
+
+// 日別サマリーで推定する分位点
+#define DAILY_QUANTILE_COUNT        3         // p10 / p50 / p90
+#define DAILY_QUANTILE_P10          0
+#define DAILY_QUANTILE_P50          1
+#define DAILY_QUANTILE_P90          2
+
+#define P2_MAX_QUANTILES            DAILY_QUANTILE_COUNT
+#define P2_MAX_MARKERS              (2 * P2_MAX_QUANTILES + 3)
+
+/**
+ * P²法による複数分位点の逐次推定（Jain & Chlamtac, 1985 / Raatikainen による複数分位点への拡張）
+ * m個の分位点に対して 2m+3 個のマーカー（最小・各分位点・その中間・最大）の高さと位置だけを保持し、
+ * サンプルを保存・ソートせずに O(1) のメモリと1サンプルあたり O(m) の計算で分位点を推定する。
+ * マーカー数に満たない間は受け取った値そのものから求める。
+ */
+typedef struct {
+    float    height[P2_MAX_MARKERS];    // マーカーの高さ（推定値）
+    float    increment[P2_MAX_MARKERS]; // マーカーの目標位置の増分（1サンプルあたり）
+    uint16_t pos[P2_MAX_MARKERS];       // マーカーの位置（0始まりの順位）
+    uint16_t count;                     // サンプル数
+    uint8_t  marker_count;              // マーカー数（2m+3）
+} p2_estimator_t;
+
+/**
+ * 日別サマリーの分位点推定（気温・湿度・照度・土壌水分・土壌温度 × p10/p50/p90）
+ * 値は1分データのパック形式の整数単位のまま推定し、サマリー生成時に換算する
+ */
+typedef enum {
+    QUANTILE_FIELD_TEMPERATURE = 0,     // 気温 [0.01℃]
+    QUANTILE_FIELD_HUMIDITY,            // 湿度 [0.01%]
+    QUANTILE_FIELD_LUX,                 // 照度 [0.01lux]
+    QUANTILE_FIELD_SOIL_MOISTURE,       // 土壌水分 [MINUTE_RECORD_SOIL_SCALE]
+    QUANTILE_FIELD_SOIL_TEMPERATURE,    // 土壌温度（代表値）[1/16℃]
+    QUANTILE_FIELD_COUNT
+} quantile_field_t;
+
+typedef struct {
+    p2_estimator_t est[QUANTILE_FIELD_COUNT];
+} daily_quantiles_t;
+
+/**
+ * 推定器を空の状態に初期化
+ * @param est 対象推定器
+ * @param quantiles 推定する分位点 (0〜1、昇順)
+ * @param count 分位点の数（最大 P2_MAX_QUANTILES）
+ */
+void p2_estimator_init(p2_estimator_t *est, const float *quantiles, uint8_t count);
+
+/**
+ * サンプルを追加（O(分位点の数)）
+ * @param est 対象推定器
+ * @param x 追加する値
+ */
+void p2_estimator_add(p2_estimator_t *est, float x);
+
+/**
+ * 現在の推定値を取得
+ * @param est 対象推定器
+ * @param index 分位点の添字（p2_estimator_init に渡した順）
+ * @return 分位点の推定値（サンプルがない場合は0）
+ */
+float p2_estimator_get(const p2_estimator_t *est, uint8_t index);
+
+/**
+ * 日別の分位点推定を空の状態に初期化
+ */
+void daily_quantiles_reset(daily_quantiles_t *dq);
+
+/**
+ * 1分レコードの各フィールドを推定器に追加
+ */
+void daily_quantiles_add(daily_quantiles_t *dq, const minute_record_t *rec);
+
+/**
+ * 推定値を日別サマリーの分位点フィールドに格納
+ * @param dq 対象推定器
+ * @param summary 格納先（分位点以外のフィールドは変更しない）
+ */
+void daily_quantiles_to_summary(const daily_quantiles_t *dq, struct daily_summary_data_t *summary);
+
+#ifdef __cplusplus
+}
+#endif
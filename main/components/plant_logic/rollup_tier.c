@@ -0,0 +1,272 @@
+#include "rollup_tier.h"
+#include "data_buffer.h"
+#include <string.h>
+#include <math.h>
+
+// プライベート関数の宣言
+static int32_t div_round(int64_t sum, int32_t count);
+static uint8_t delta_ceil(int32_t delta, int32_t unit);
+static uint8_t humidity_code(int32_t humidity, int32_t round_up);
+static uint8_t lux_code(uint32_t lux_raw, bool round_up);
+static float lux_decode(uint8_t code);
+
+/**
+ * 集計階層を空の状態に初期化
+ */
+void rollup_tier_init(rollup_tier_t *tier, rollup_record_t *records, uint16_t capacity, uint16_t bucket_minutes) {
+    tier->records = records;
+    tier->capacity = capacity;
+    tier->bucket_minutes = bucket_minutes;
+    memset(records, 0, sizeof(rollup_record_t) * capacity);
+    for (int i = 0; i < capacity; i++) {
+        records[i].lap = ROLLUP_LAP_EMPTY;
+    }
+    tier->acc.quantiles = NULL;  // 集計階層は分位点を持たない
+    tier->acc.stats = NULL;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    tier->acc.channels = NULL;   // チャンネル別集計は呼び出し側で必要な階層にのみ設定する
+#endif
+    daily_accumulator_reset(&tier->acc, 0, 0);
+}
+
+/**
+ * 指定区間のレコードを取得
+ */
+const rollup_record_t *rollup_tier_find(const rollup_tier_t *tier, uint32_t bucket) {
+    const rollup_record_t *rec = &tier->records[bucket % tier->capacity];
+    if (rec->lap != (uint8_t)((bucket / tier->capacity) % ROLLUP_LAP_MODULO)) {
+        return NULL;
+    }
+    return rec;
+}
+
+/**
+ * 指定区間のスロットにレコードを格納
+ */
+void rollup_tier_store(rollup_tier_t *tier, uint32_t bucket, const rollup_record_t *rec) {
+    rollup_record_t *slot = &tier->records[bucket % tier->capacity];
+    memcpy(slot, rec, sizeof(rollup_record_t));
+    slot->lap = (uint8_t)((bucket / tier->capacity) % ROLLUP_LAP_MODULO);
+}
+
+/**
+ * 指定区間のレコードを空きにする
+ */
+void rollup_tier_remove(rollup_tier_t *tier, uint32_t bucket) {
+    if (rollup_tier_find(tier, bucket) != NULL) {
+        tier->records[bucket % tier->capacity].lap = ROLLUP_LAP_EMPTY;
+    }
+}
+
+/**
+ * アキュムレータの集計値から集計レコードを生成
+ */
+void rollup_record_from_accumulator(const daily_accumulator_t *acc, rollup_record_t *rec) {
+    int32_t count = acc->count;
+    rec->count = (count > UINT8_MAX) ? UINT8_MAX : (uint8_t)count;
+
+    int32_t temp_avg = div_round(acc->temp_sum, count);
+    rec->temp_avg = (int16_t)temp_avg;
+    rec->temp_min_delta = delta_ceil(temp_avg - acc->temp_min, ROLLUP_TEMP_DELTA_UNIT);
+    rec->temp_max_delta = delta_ceil(acc->temp_max - temp_avg, ROLLUP_TEMP_DELTA_UNIT);
+
+    rec->humidity_min = humidity_code(acc->humidity_min, 0);
+    rec->humidity = humidity_code(div_round(acc->humidity_sum, count), ROLLUP_HUMIDITY_UNIT / 2);
+    rec->humidity_max = humidity_code(acc->humidity_max, ROLLUP_HUMIDITY_UNIT - 1);
+
+    rec->lux_min = lux_code(acc->lux_min, false);
+    rec->lux = minute_record_encode_lux((float)acc->lux_sum / count / MINUTE_RECORD_LUX_SCALE);
+    rec->lux_max = lux_code(acc->lux_max, true);
+
+    int32_t soil_avg = div_round(acc->soil_sum, count);
+    if (soil_avg > INT16_MAX) soil_avg = INT16_MAX;
+    rec->soil_avg = (int16_t)soil_avg;
+    rec->soil_min_delta = delta_ceil(soil_avg - acc->soil_min, ROLLUP_SOIL_DELTA_UNIT);
+    rec->soil_max_delta = delta_ceil(acc->soil_max - soil_avg, ROLLUP_SOIL_DELTA_UNIT);
+
+    // 土壌温度は有効サンプルのみで平均する
+    if (acc->soil_temp_count == 0) {
+        rec->soil_temp_avg = ROLLUP_SOIL_TEMP_NONE;
+        rec->soil_temp_min_delta = 0;
+        rec->soil_temp_max_delta = 0;
+        return;
+    }
+    int32_t soil_temp_avg = div_round(acc->soil_temp_sum, acc->soil_temp_count);
+    rec->soil_temp_avg = (int16_t)soil_temp_avg;
+    rec->soil_temp_min_delta = delta_ceil(soil_temp_avg - acc->soil_temp_min, ROLLUP_PROBE_DELTA_UNIT);
+    rec->soil_temp_max_delta = delta_ceil(acc->soil_temp_max - soil_temp_avg, ROLLUP_PROBE_DELTA_UNIT);
+}
+
+/**
+ * 集計レコードを履歴データ点にデコード
+ */
+void rollup_record_decode(const rollup_record_t *rec, history_point_data_t *point) {
+    point->samples = rec->count;
+
+    point->avg_temperature = rec->temp_avg / MINUTE_RECORD_TEMP_SCALE;
+    point->min_temperature = (rec->temp_avg - rec->temp_min_delta * ROLLUP_TEMP_DELTA_UNIT) / MINUTE_RECORD_TEMP_SCALE;
+    point->max_temperature = (rec->temp_avg + rec->temp_max_delta * ROLLUP_TEMP_DELTA_UNIT) / MINUTE_RECORD_TEMP_SCALE;
+
+    point->min_humidity = rec->humidity_min * ROLLUP_HUMIDITY_UNIT / MINUTE_RECORD_HUMIDITY_SCALE;
+    point->avg_humidity = rec->humidity * ROLLUP_HUMIDITY_UNIT / MINUTE_RECORD_HUMIDITY_SCALE;
+    point->max_humidity = rec->humidity_max * ROLLUP_HUMIDITY_UNIT / MINUTE_RECORD_HUMIDITY_SCALE;
+
+    point->min_lux = lux_decode(rec->lux_min);
+    point->avg_lux = minute_record_decode_lux(rec->lux);
+    point->max_lux = lux_decode(rec->lux_max);
+
+    point->avg_soil_moisture = rec->soil_avg / MINUTE_RECORD_SOIL_SCALE;
+    point->min_soil_moisture = (rec->soil_avg - rec->soil_min_delta * ROLLUP_SOIL_DELTA_UNIT) / MINUTE_RECORD_SOIL_SCALE;
+    point->max_soil_moisture = (rec->soil_avg + rec->soil_max_delta * ROLLUP_SOIL_DELTA_UNIT) / MINUTE_RECORD_SOIL_SCALE;
+
+    point->soil_temperature_valid = (rec->soil_temp_avg != ROLLUP_SOIL_TEMP_NONE);
+    if (!point->soil_temperature_valid) {
+        point->min_soil_temperature = point->avg_soil_temperature = point->max_soil_temperature = 0.0f;
+        return;
+    }
+    int32_t soil_temp_avg = rec->soil_temp_avg;
+    point->avg_soil_temperature = soil_temp_avg / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    point->min_soil_temperature = (soil_temp_avg - rec->soil_temp_min_delta * ROLLUP_PROBE_DELTA_UNIT) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    point->max_soil_temperature = (soil_temp_avg + rec->soil_temp_max_delta * ROLLUP_PROBE_DELTA_UNIT) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+}
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * チャンネル別集計のリングを空の状態に初期化
+ */
+void channel_rollup_init(channel_rollup_ring_t *ring, channel_rollup_record_t *records, uint16_t capacity) {
+    ring->records = records;
+    ring->capacity = capacity;
+    memset(records, 0, sizeof(channel_rollup_record_t) * capacity);
+    for (int i = 0; i < capacity; i++) {
+        records[i].lap = ROLLUP_LAP_EMPTY;
+    }
+}
+
+/**
+ * 指定区間のチャンネル別レコードを取得
+ */
+const channel_rollup_record_t *channel_rollup_find(const channel_rollup_ring_t *ring, uint32_t bucket) {
+    const channel_rollup_record_t *rec = &ring->records[bucket % ring->capacity];
+    if (rec->lap != (uint8_t)((bucket / ring->capacity) % ROLLUP_LAP_MODULO)) {
+        return NULL;
+    }
+    return rec;
+}
+
+/**
+ * 指定区間のスロットにチャンネル別レコードを格納
+ */
+void channel_rollup_store(channel_rollup_ring_t *ring, uint32_t bucket, const channel_rollup_record_t *rec) {
+    channel_rollup_record_t *slot = &ring->records[bucket % ring->capacity];
+    memcpy(slot, rec, sizeof(channel_rollup_record_t));
+    slot->lap = (uint8_t)((bucket / ring->capacity) % ROLLUP_LAP_MODULO);
+}
+
+/**
+ * 指定区間のチャンネル別レコードを空きにする
+ */
+void channel_rollup_remove(channel_rollup_ring_t *ring, uint32_t bucket) {
+    if (channel_rollup_find(ring, bucket) != NULL) {
+        ring->records[bucket % ring->capacity].lap = ROLLUP_LAP_EMPTY;
+    }
+}
+
+/**
+ * チャンネル別の集計値からレコードを生成
+ */
+void channel_rollup_record_from_accumulator(const channel_accumulator_t *ch, uint16_t count,
+                                            channel_rollup_record_t *rec) {
+    rec->count = (count > UINT8_MAX) ? UINT8_MAX : (uint8_t)count;
+
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        int32_t avg = div_round(ch->cap_sum[c], count);
+        rec->cap_avg[c] = (int16_t)avg;
+        rec->cap_min_delta[c] = delta_ceil(avg - ch->cap_min[c], ROLLUP_SOIL_DELTA_UNIT);
+        rec->cap_max_delta[c] = delta_ceil(ch->cap_max[c] - avg, ROLLUP_SOIL_DELTA_UNIT);
+    }
+
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        if (ch->probe_count[p] == 0) {
+            rec->probe_avg[p] = ROLLUP_SOIL_TEMP_NONE;
+            rec->probe_min_delta[p] = 0;
+            rec->probe_max_delta[p] = 0;
+            continue;
+        }
+        int32_t avg = div_round(ch->probe_sum[p], ch->probe_count[p]);
+        rec->probe_avg[p] = (int16_t)avg;
+        rec->probe_min_delta[p] = delta_ceil(avg - ch->probe_min[p], ROLLUP_PROBE_DELTA_UNIT);
+        rec->probe_max_delta[p] = delta_ceil(ch->probe_max[p] - avg, ROLLUP_PROBE_DELTA_UNIT);
+    }
+}
+
+/**
+ * チャンネル別レコードをデータ点にデコード
+ */
+void channel_rollup_record_decode(const channel_rollup_record_t *rec, channel_point_data_t *point) {
+    point->samples = rec->count;
+
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        int32_t avg = rec->cap_avg[c];
+        point->avg_capacitance[c] = avg / MINUTE_RECORD_CAP_SCALE;
+        point->min_capacitance[c] = (avg - rec->cap_min_delta[c] * ROLLUP_SOIL_DELTA_UNIT) / MINUTE_RECORD_CAP_SCALE;
+        point->max_capacitance[c] = (avg + rec->cap_max_delta[c] * ROLLUP_SOIL_DELTA_UNIT) / MINUTE_RECORD_CAP_SCALE;
+    }
+
+    point->probe_valid_mask = 0;
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        int32_t avg = rec->probe_avg[p];
+        if (avg == ROLLUP_SOIL_TEMP_NONE) {
+            point->min_probe_temperature[p] = 0.0f;
+            point->avg_probe_temperature[p] = 0.0f;
+            point->max_probe_temperature[p] = 0.0f;
+            continue;
+        }
+        point->probe_valid_mask |= (uint8_t)(1u << p);
+        point->avg_probe_temperature[p] = avg / MINUTE_RECORD_PROBE_TEMP_SCALE;
+        point->min_probe_temperature[p] = (avg - rec->probe_min_delta[p] * ROLLUP_PROBE_DELTA_UNIT) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+        point->max_probe_temperature[p] = (avg + rec->probe_max_delta[p] * ROLLUP_PROBE_DELTA_UNIT) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    }
+}
+#endif
+
+// プライベート関数の実装
+
+static int32_t div_round(int64_t sum, int32_t count) {
+    return (int32_t)((sum >= 0) ? (sum + count / 2) / count : (sum - count / 2) / count);
+}
+
+/**
+ * 平均からの差分を切り上げで量子化（復元値が実際の最小/最大を包含するように）
+ */
+static uint8_t delta_ceil(int32_t delta, int32_t unit) {
+    if (delta <= 0) {
+        return 0;
+    }
+    int32_t steps = (delta + unit - 1) / unit;
+    return (steps > UINT8_MAX) ? UINT8_MAX : (uint8_t)steps;
+}
+
+/**
+ * 湿度 [0.01%] を0.5%単位に量子化（round_up: 切り上げ量 [0.01%]）
+ */
+static uint8_t humidity_code(int32_t humidity, int32_t round_up) {
+    int32_t code = (humidity + round_up) / ROLLUP_HUMIDITY_UNIT;
+    return (code > UINT8_MAX) ? UINT8_MAX : (uint8_t)code;
+}
+
+/**
+ * 照度 [0.01lux] を対数符号 STEPS * log2(1 + lux) に量子化（最小は切り捨て、最大は切り上げ）
+ */
+static uint8_t lux_code(uint32_t lux_raw, bool round_up) {
+    float steps = ROLLUP_LUX_STEPS_PER_OCTAVE * log2f(1.0f + lux_raw / MINUTE_RECORD_LUX_SCALE);
+    float code = round_up ? ceilf(steps) : floorf(steps);
+    return (code > UINT8_MAX) ? UINT8_MAX : (uint8_t)code;
+}
+
+/**
+ * 対数符号を照度 [lux] に復元
+ */
+static float lux_decode(uint8_t code) {
+    return exp2f((float)code / ROLLUP_LUX_STEPS_PER_OCTAVE) - 1.0f;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "minute_record.h"
+#include "daily_accumulator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct history_point_data_t;
+struct channel_point_data_t;
+
+// 周回番号の空きスロット値
+#define ROLLUP_LAP_EMPTY            0xFF
+#define ROLLUP_LAP_MODULO           255
+
+// 集計レコードの量子化単位
+#define ROLLUP_TEMP_DELTA_UNIT      10        // 気温の平均からの差分 [0.1℃] (最大25.5℃)
+#define ROLLUP_HUMIDITY_UNIT        50        // 湿度 [0.5%]
+#define ROLLUP_LUX_STEPS_PER_OCTAVE 15        // 照度の最小/最大の対数符号 [1/15オクターブ] (約4.7%刻み、最大約131klux)
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+#define ROLLUP_SOIL_DELTA_UNIT      32        // 土壌水分の平均からの差分 [1/64 pF] (最大約4pF)
+#else
+#define ROLLUP_SOIL_DELTA_UNIT      16        // 土壌水分の平均からの差分 [16mV] (最大4080mV)
+#endif
+#define ROLLUP_SOIL_TEMP_NONE       INT16_MIN // 土壌温度なし
+#define ROLLUP_PROBE_DELTA_UNIT     1         // 土壌温度（チャンネル別）の平均からの差分 [1/16℃] (最大約16℃)
+
+/**
+ * 10分/1時間集計の格納形式（21バイト）
+ * 平均値は1分データと同じ固定小数点、最小/最大は平均からの差分を8bitで持つ。
+ * 湿度は0.5%単位の絶対値、照度の最小/最大は対数符号（ROLLUP_LUX_STEPS_PER_OCTAVE）で持つ。
+ * 最小は切り捨て・最大は切り上げで量子化するため、復元した最小/最大は実際の値を必ず包含する。
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  lap;                   // 何周目のリングか（0xFF:空き）
+    uint8_t  count;                 // 区間内の1分データ数
+    int16_t  temp_avg;              // 平均気温 [0.01℃]
+    uint8_t  temp_min_delta;        // 平均 - 最低気温 [ROLLUP_TEMP_DELTA_UNIT]
+    uint8_t  temp_max_delta;        // 最高気温 - 平均 [ROLLUP_TEMP_DELTA_UNIT]
+    uint8_t  humidity_min;          // 最低湿度 [0.5%]
+    uint8_t  humidity;              // 平均湿度 [0.5%]
+    uint8_t  humidity_max;          // 最高湿度 [0.5%]
+    uint8_t  lux_min;               // 最小照度（対数符号）
+    uint16_t lux;                   // 平均照度（minute_record_encode_lux形式）
+    uint8_t  lux_max;               // 最大照度（対数符号）
+    int16_t  soil_avg;              // 平均土壌水分 [MINUTE_RECORD_SOIL_SCALE]
+    uint8_t  soil_min_delta;        // 平均 - 最小土壌水分 [ROLLUP_SOIL_DELTA_UNIT]
+    uint8_t  soil_max_delta;        // 最大土壌水分 - 平均 [ROLLUP_SOIL_DELTA_UNIT]
+    int16_t  soil_temp_avg;         // 平均土壌温度 [1/16℃]（ROLLUP_SOIL_TEMP_NONE:なし）
+    uint8_t  soil_temp_min_delta;   // 平均 - 最低土壌温度 [ROLLUP_PROBE_DELTA_UNIT]
+    uint8_t  soil_temp_max_delta;   // 最高土壌温度 - 平均 [ROLLUP_PROBE_DELTA_UNIT]
+} rollup_record_t;
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * チャンネル別集計の格納形式（34バイト）
+ * rollup_record_t と同じく平均 + 切り上げ量子化した8bit差分で、項目ごとにチャンネルを並べる
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  lap;                                       // 何周目のリングか（0xFF:空き）
+    uint8_t  count;                                     // 区間内の1分データ数
+    int16_t  cap_avg[FDC1004_CHANNEL_COUNT];            // 平均静電容量 [1/2048 pF]
+    uint8_t  cap_min_delta[FDC1004_CHANNEL_COUNT];      // 平均 - 最小 [ROLLUP_SOIL_DELTA_UNIT]
+    uint8_t  cap_max_delta[FDC1004_CHANNEL_COUNT];      // 最大 - 平均 [ROLLUP_SOIL_DELTA_UNIT]
+    int16_t  probe_avg[TMP102_MAX_DEVICES];             // 平均土壌温度 [1/16℃]（ROLLUP_SOIL_TEMP_NONE:なし）
+    uint8_t  probe_min_delta[TMP102_MAX_DEVICES];       // 平均 - 最低 [ROLLUP_PROBE_DELTA_UNIT]
+    uint8_t  probe_max_delta[TMP102_MAX_DEVICES];       // 最高 - 平均 [ROLLUP_PROBE_DELTA_UNIT]
+} channel_rollup_record_t;
+
+/**
+ * チャンネル別集計のリング（rollup_tier_t と同じ割り当て・周回番号の検証を行う）
+ */
+typedef struct {
+    channel_rollup_record_t *records;   // レコード配列（呼び出し側で確保）
+    uint16_t capacity;                  // 保持区間数
+} channel_rollup_ring_t;
+#endif
+
+/**
+ * 集計階層（固定間隔の区間をエポック分で直接スロットに割り当てるリング）
+ */
+typedef struct {
+    rollup_record_t *records;       // レコード配列（呼び出し側で確保）
+    uint16_t capacity;              // 保持区間数
+    uint16_t bucket_minutes;        // 区間の長さ [分]
+    daily_accumulator_t acc;        // 書き込み中の区間の逐次集計
+} rollup_tier_t;
+
+/**
+ * 集計階層を空の状態に初期化
+ * @param tier 対象階層
+ * @param records レコード配列（capacity要素）
+ * @param capacity 保持区間数
+ * @param bucket_minutes 区間の長さ [分]
+ */
+void rollup_tier_init(rollup_tier_t *tier, rollup_record_t *records, uint16_t capacity, uint16_t bucket_minutes);
+
+/**
+ * 指定区間のレコードを取得（周回番号で検証）
+ * @param tier 対象階層
+ * @param bucket 区間番号（エポック分 / bucket_minutes）
+ * @return 見つからない場合はNULL
+ */
+const rollup_record_t *rollup_tier_find(const rollup_tier_t *tier, uint32_t bucket);
+
+/**
+ * 指定区間のスロットにレコードを格納（周回番号を設定）
+ * @param tier 対象階層
+ * @param bucket 区間番号
+ * @param rec 格納するレコード
+ */
+void rollup_tier_store(rollup_tier_t *tier, uint32_t bucket, const rollup_record_t *rec);
+
+/**
+ * 指定区間のレコードを空きにする（スロットが別の周回の区間を持つ場合は何もしない）
+ * @param tier 対象階層
+ * @param bucket 区間番号
+ */
+void rollup_tier_remove(rollup_tier_t *tier, uint32_t bucket);
+
+/**
+ * アキュムレータの集計値から集計レコードを生成
+ * @param acc 区間のアキュムレータ（count > 0）
+ * @param rec 格納先（lapは変更しない）
+ */
+void rollup_record_from_accumulator(const daily_accumulator_t *acc, rollup_record_t *rec);
+
+/**
+ * 集計レコードを履歴データ点にデコード（タイムスタンプは変換しない）
+ * @param rec 変換元レコード
+ * @param point 格納先
+ */
+void rollup_record_decode(const rollup_record_t *rec, struct history_point_data_t *point);
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+/**
+ * チャンネル別集計のリングを空の状態に初期化
+ * @param ring 対象リング
+ * @param records レコード配列（capacity要素）
+ * @param capacity 保持区間数
+ */
+void channel_rollup_init(channel_rollup_ring_t *ring, channel_rollup_record_t *records, uint16_t capacity);
+
+/**
+ * 指定区間のチャンネル別レコードを取得（周回番号で検証）
+ * @param ring 対象リング
+ * @param bucket 区間番号
+ * @return 見つからない場合はNULL
+ */
+const channel_rollup_record_t *channel_rollup_find(const channel_rollup_ring_t *ring, uint32_t bucket);
+
+/**
+ * 指定区間のスロットにチャンネル別レコードを格納（周回番号を設定）
+ * @param ring 対象リング
+ * @param bucket 区間番号
+ * @param rec 格納するレコード
+ */
+void channel_rollup_store(channel_rollup_ring_t *ring, uint32_t bucket, const channel_rollup_record_t *rec);
+
+/**
+ * 指定区間のチャンネル別レコードを空きにする（スロットが別の周回の区間を持つ場合は何もしない）
+ * @param ring 対象リング
+ * @param bucket 区間番号
+ */
+void channel_rollup_remove(channel_rollup_ring_t *ring, uint32_t bucket);
+
+/**
+ * チャンネル別の集計値からレコードを生成
+ * @param ch 区間のチャンネル別集計
+ * @param count 区間内の1分データ数（> 0）
+ * @param rec 格納先（lapは変更しない）
+ */
+void channel_rollup_record_from_accumulator(const channel_accumulator_t *ch, uint16_t count,
+                                            channel_rollup_record_t *rec);
+
+/**
+ * チャンネル別レコードをデータ点にデコード（タイムスタンプは変換しない）
+ * @param rec 変換元レコード
+ * @param point 格納先
+ */
+void channel_rollup_record_decode(const channel_rollup_record_t *rec, struct channel_point_data_t *point);
+#endif
+
+/**
+ * エポック分から区間番号を算出
+ */
+static inline uint32_t rollup_tier_bucket(const rollup_tier_t *tier, uint32_t epoch_minute) {
+    return epoch_minute / tier->bucket_minutes;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,184 @@
+#include "rule_engine.h"
+#include "esp_cpu.h"
+#include <string.h>
+#include <math.h>
+
+_Static_assert(sizeof(rule_t) == 15, "rule_t is part of the NVS/BLE format");
+_Static_assert(RULE_OPERAND_COUNT <= 16, "valid_mask/operand_mask must cover every operand");
+
+/**
+ * 乾燥日数のオペランドで比較結果が決まるまでに遡る日数（遡るのを打ち切った値で比較しても結果が変わらない日数）
+ */
+static int32_t dry_days_depth(const rule_t *rule) {
+    float limit;
+    switch (rule->comparator) {
+        case RULE_CMP_GE:
+            return (int32_t)fmaxf(ceilf(rule->threshold), 0.0f);
+        case RULE_CMP_LE:
+            limit = rule->threshold + rule->hysteresis;
+            break;
+        default:
+            limit = rule->threshold;
+            break;
+    }
+    return (int32_t)fmaxf(floorf(limit) + 1.0f, 0.0f);
+}
+
+/**
+ * ルール1件の検証と費用
+ */
+static esp_err_t check_rule(const rule_t *rule, uint8_t condition_count, uint8_t *cost) {
+    if (rule->operand >= RULE_OPERAND_COUNT || rule->comparator >= RULE_CMP_COUNT ||
+        rule->condition >= condition_count || (rule->flags & ~RULE_FLAG_AND_NEXT) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!isfinite(rule->threshold) || !isfinite(rule->hysteresis) || rule->hysteresis < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *cost = 1;
+    if (rule->operand == RULE_OPERAND_DRY_DAYS) {
+        int32_t depth = dry_days_depth(rule);
+        if (depth > RULE_ENGINE_MAX_DRY_DAYS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        *cost += (uint8_t)depth;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 表を検証し、1回の評価の費用を求める
+ * 日別サマリーは評価ごとに最も深いルールの日数分だけ参照するため、合計はルール数 + 最大の日数
+ */
+esp_err_t rule_engine_check(const rule_set_t *set, uint8_t condition_count, uint16_t *total_cost) {
+    if (set == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (set->version != RULE_SET_VERSION) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (set->count > RULE_ENGINE_MAX_RULES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (set->count > 0 && (set->rules[set->count - 1].flags & RULE_FLAG_AND_NEXT)) {
+        return ESP_ERR_INVALID_ARG;  // 連結が閉じていない
+    }
+
+    uint16_t cost = set->count;
+    uint8_t max_depth = 0;
+    for (uint8_t i = 0; i < set->count; i++) {
+        uint8_t rule_cost;
+        esp_err_t ret = check_rule(&set->rules[i], condition_count, &rule_cost);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (rule_cost - 1 > max_depth) {
+            max_depth = (uint8_t)(rule_cost - 1);
+        }
+    }
+    cost += max_depth;
+    if (cost > RULE_ENGINE_MAX_COST) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (total_cost != NULL) {
+        *total_cost = cost;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 表を検証して読み込む
+ */
+esp_err_t rule_engine_load(rule_engine_t *engine, const rule_set_t *set, uint8_t condition_count) {
+    uint16_t total_cost;
+    esp_err_t ret = rule_engine_check(set, condition_count, &total_cost);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(engine, 0, sizeof(rule_engine_t));
+    engine->set = *set;
+    engine->total_cost = total_cost;
+    for (uint8_t i = 0; i < set->count; i++) {
+        const rule_t *rule = &set->rules[i];
+        check_rule(rule, condition_count, &engine->state[i].cost);
+        engine->operand_mask |= (uint16_t)(1u << rule->operand);
+        if (engine->state[i].cost - 1 > engine->dry_days_depth) {
+            engine->dry_days_depth = (uint8_t)(engine->state[i].cost - 1);
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * ルール1件の比較（成立中はヒステリシス幅だけ条件を緩める）
+ */
+static bool rule_holds(const rule_t *rule, const rule_inputs_t *inputs, bool active) {
+    if (!(inputs->valid_mask & (1u << rule->operand))) {
+        return false;
+    }
+    float value = inputs->value[rule->operand];
+    switch (rule->comparator) {
+        case RULE_CMP_GE:
+            return value >= (active ? rule->threshold - rule->hysteresis : rule->threshold);
+        case RULE_CMP_LE:
+            return value <= (active ? rule->threshold + rule->hysteresis : rule->threshold);
+        case RULE_CMP_EQ:
+            return value == rule->threshold;
+        case RULE_CMP_NE:
+            return value != rule->threshold;
+        default:
+            return false;
+    }
+}
+
+/**
+ * 表を先頭から1回走査して評価
+ * 優先度の低いルールも毎回評価する（ヒステリシスと継続時間の状態を保ち、費用を一定にするため）
+ */
+bool rule_engine_evaluate(rule_engine_t *engine, const rule_inputs_t *inputs, rule_result_t *result) {
+    memset(result, 0, sizeof(rule_result_t));
+    bool chain = true;
+    uint8_t best_priority = 0;
+    for (uint8_t i = 0; i < engine->set.count; i++) {
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        const rule_t *rule = &engine->set.rules[i];
+        rule_state_t *state = &engine->state[i];
+
+        bool holds = rule_holds(rule, inputs, state->active);
+        state->active = holds;
+        if (holds) {
+            state->true_count++;
+        }
+        chain = chain && holds;
+
+        if (!(rule->flags & RULE_FLAG_AND_NEXT)) {
+            // 連結の終わり: 成立し続けた時間で状態を決める（時刻が戻った場合は数え直す）
+            if (!chain) {
+                state->holding = false;
+            } else if (!state->holding || inputs->epoch_minute < state->since_minute) {
+                state->holding = true;
+                state->since_minute = inputs->epoch_minute;
+            }
+            if (chain && inputs->epoch_minute - state->since_minute >= rule->duration_minutes &&
+                (!result->matched || rule->priority < best_priority)) {
+                result->matched = true;
+                result->condition = rule->condition;
+                result->rule_index = i;
+                best_priority = rule->priority;
+            }
+            chain = true;
+        }
+
+        state->last_cycles = (uint32_t)(esp_cpu_get_cycle_count() - start);
+        if (state->last_cycles > state->max_cycles) {
+            state->max_cycles = state->last_cycles;
+        }
+    }
+
+    engine->evaluations++;
+    if (result->matched) {
+        engine->state[result->rule_index].matches++;
+    }
+    return result->matched;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 植物状態の判定ルール
+ *
+ * ルールは「オペランド・比較・閾値・ヒステリシス・継続時間・優先度 → 状態」の固定長の命令で、
+ * 表（rule_set_t）ごとNVSに保存し、BLEで書き換える。評価は表を先頭から1回走査するだけで、
+ * 成立したルールのうち優先度の値が最も小さいもの（同じ値なら先のもの）の状態を返す。
+ * RULE_FLAG_AND_NEXT の付いたルールは次のルールと AND で連結し、連結の最後のルールの状態・優先度・継続時間を使う。
+ * 1回の評価の費用（比較1回・日別サマリーの参照1件を1とする）は読み込み時に求め、RULE_ENGINE_MAX_COST を超える表は受け付けない。
+ */
+
+#define RULE_ENGINE_MAX_RULES       16  // 表のルール数の上限（BLEの1回の書き込みに収まる数）
+#define RULE_ENGINE_MAX_COST        40  // 1回の評価の費用の上限（ルール数 + 日別サマリーの参照件数。既定のルールで保持日数いっぱい遡る費用）
+#define RULE_ENGINE_MAX_DRY_DAYS    30  // 乾燥日数のオペランドで遡る日数の上限（日別サマリーの保持日数）
+#define RULE_SET_VERSION            1   // 表の形式のバージョン
+
+#define RULE_FLAG_AND_NEXT          0x01    // 次のルールと AND で連結する
+
+/**
+ * オペランド（評価のたびに呼び出し側が rule_inputs_t に入れる値）
+ */
+typedef enum {
+    RULE_OPERAND_TEMPERATURE = 0,   // 気温 [℃]
+    RULE_OPERAND_HUMIDITY,          // 湿度 [%]
+    RULE_OPERAND_LUX,               // 照度 [lux]
+    RULE_OPERAND_SOIL_MOISTURE,     // 土壌水分（Rev3/Rev4: [pF]、その他: [mV]）
+    RULE_OPERAND_SOIL_TEMPERATURE,  // 代表土壌温度 [℃]
+    RULE_OPERAND_WATERING_DECREASE, // 2回前からの土壌水分の減少量（集約値とチャンネルごとのうち最大。直近3件が揃わない時は無効）
+    RULE_OPERAND_DRY_DAYS,          // 日平均の土壌水分が乾燥閾値以上の日が続いた日数（最新の日から遡る）
+    RULE_OPERAND_LAST_CONDITION,    // 直前の植物状態
+    RULE_OPERAND_HOURS_UNTIL_DRY,   // 乾燥閾値に達するまでの予測時間 [時]（予測できない時は無効）
+    RULE_OPERAND_COUNT
+} rule_operand_t;
+
+/**
+ * 比較
+ */
+typedef enum {
+    RULE_CMP_GE = 0,    // 閾値以上（成立中は 閾値 - ヒステリシス 以上の間成立を保つ）
+    RULE_CMP_LE,        // 閾値以下（成立中は 閾値 + ヒステリシス 以下の間成立を保つ）
+    RULE_CMP_EQ,        // 閾値と等しい（ヒステリシスは使わない）
+    RULE_CMP_NE,        // 閾値と異なる（ヒステリシスは使わない）
+    RULE_CMP_COUNT
+} rule_comparator_t;
+
+/**
+ * ルール（15バイト）
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t operand;            // rule_operand_t
+    uint8_t comparator;         // rule_comparator_t
+    uint8_t flags;              // RULE_FLAG_*
+    uint8_t condition;          // 成立した時の植物状態（plant_condition_t）
+    uint8_t priority;           // 優先度（小さいほど優先）
+    float threshold;            // 閾値（オペランドの単位）
+    float hysteresis;           // ヒステリシス幅（0以上）
+    uint16_t duration_minutes;  // 成立がこの分数続いたら状態を決める（0: すぐ。計測ごとに評価するため分解能は計測間隔の1分）
+} rule_t;
+
+/**
+ * ルールの表（NVSに保存する形式。BLEでは count 件分だけ送る）
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;            // RULE_SET_VERSION
+    uint8_t count;              // ルール数（0: 植物プロファイルから作る既定のルールを使う）
+    rule_t rules[RULE_ENGINE_MAX_RULES];
+} rule_set_t;
+
+#define RULE_SET_HEADER_SIZE    2
+#define RULE_SET_SIZE(count)    (RULE_SET_HEADER_SIZE + (size_t)(count) * sizeof(rule_t))
+
+/**
+ * 1回の評価の入力
+ */
+typedef struct {
+    uint32_t epoch_minute;                  // 評価するデータのエポック分（継続時間用）
+    float value[RULE_OPERAND_COUNT];        // オペランドの値
+    uint16_t valid_mask;                    // 値が有効なオペランド（bit: rule_operand_t）。無効なオペランドのルールは成立しない
+} rule_inputs_t;
+
+/**
+ * ルールごとの評価の費用と実績
+ */
+typedef struct {
+    uint8_t cost;               // 1回の評価の費用（比較1 + 日別サマリーの参照件数）
+    bool active;                // 直前の評価で成立していたか（ヒステリシス用）
+    bool holding;               // 連結の最後のルール: 連結全体が成立中か（継続時間用）
+    uint32_t since_minute;      // 連結全体が成立し始めたエポック分
+    uint32_t true_count;        // 成立した回数
+    uint32_t matches;           // 状態を決めた回数
+    uint32_t last_cycles;       // 直前の評価にかかったCPUサイクル数
+    uint32_t max_cycles;        // 評価にかかった最大のCPUサイクル数
+} rule_state_t;
+
+/**
+ * ルールエンジン（読み込んだ表と評価の状態）
+ */
+typedef struct {
+    rule_set_t set;
+    rule_state_t state[RULE_ENGINE_MAX_RULES];
+    uint32_t evaluations;       // 評価した回数
+    uint16_t total_cost;        // 1回の評価の費用の合計
+    uint16_t operand_mask;      // 表が使うオペランド（bit: rule_operand_t、呼び出し側はこれだけ求めればよい）
+    uint8_t dry_days_depth;     // 乾燥日数のオペランドで遡る必要のある日数
+} rule_engine_t;
+
+/**
+ * 評価の結果
+ */
+typedef struct {
+    bool matched;               // いずれかのルールが成立したか
+    uint8_t condition;          // 成立したルールの植物状態
+    uint8_t rule_index;         // 状態を決めたルール（連結の最後のルール）の番号
+} rule_result_t;
+
+/**
+ * 表を検証し、1回の評価の費用を求める
+ * @param set 表
+ * @param condition_count 植物状態の数（condition はこれ未満）
+ * @param total_cost 費用の合計の格納先（NULL可）
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the version differs,
+ *         ESP_ERR_INVALID_ARG if a rule is malformed, ESP_ERR_INVALID_SIZE if the cost exceeds RULE_ENGINE_MAX_COST
+ */
+esp_err_t rule_engine_check(const rule_set_t *set, uint8_t condition_count, uint16_t *total_cost);
+
+/**
+ * 表を検証して読み込む（評価の状態と実績はやり直す）
+ * @param engine 対象
+ * @param set 表
+ * @param condition_count 植物状態の数
+ * @return rule_engine_check と同じ（失敗時は engine を変更しない）
+ */
+esp_err_t rule_engine_load(rule_engine_t *engine, const rule_set_t *set, uint8_t condition_count);
+
+/**
+ * 表を先頭から1回走査して評価（費用は total_cost で抑えられる）
+ * @param engine 対象
+ * @param inputs オペランドの値
+ * @param result 評価の結果
+ * @return true: いずれかのルールが成立, false: 成立したルールなし
+ */
+bool rule_engine_evaluate(rule_engine_t *engine, const rule_inputs_t *inputs, rule_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
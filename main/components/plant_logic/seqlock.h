@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <sched.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * シーケンスロック（単一ライター / 複数リーダー）
+ *
+ * ライターは書き込みの前後でシーケンスを1ずつ進める（奇数: 書き込み中）だけで、待つことはない。
+ * リーダーはデータをコピーした前後でシーケンスを比較し、書き込みと重なっていれば読み直す。
+ *
+ *   uint32_t attempts = 0, seq;
+ *   do {
+ *       seq = seqlock_read_begin(&lock);
+ *       ... 共有データを手元にコピー ...
+ *   } while (seqlock_read_retry(&lock, seq, &attempts));
+ *
+ * シングルコア（ESP32-C3）では、優先度の高いリーダー（NimBLEホストタスク等）が書き込み途中の
+ * ライターを割り込んだ場合に読み直しが成功しないため、SEQLOCK_SPIN_LIMIT回続けて失敗したら
+ * 1tick待ってライターに実行を譲る。
+ */
+typedef struct {
+    uint32_t seq;
+} seqlock_t;
+
+#define SEQLOCK_SPIN_LIMIT  4   // この回数続けて読み直したら他タスクに実行を譲る
+
+/**
+ * 書き込み開始（ライターのみ）
+ */
+static inline void seqlock_write_begin(seqlock_t *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * 書き込み完了（ライターのみ）
+ */
+static inline void seqlock_write_end(seqlock_t *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 読み出し開始
+ * @return 読み出し開始時のシーケンス（seqlock_read_retryに渡す）
+ */
+static inline uint32_t seqlock_read_begin(const seqlock_t *lock) {
+    return __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * 読み出し中に書き込みがあったか判定
+ * @param lock 対象ロック
+ * @param seq seqlock_read_begin の戻り値
+ * @param attempts 読み直し回数（呼び出し側で0に初期化）
+ * @return true: 読み直しが必要
+ */
+static inline bool seqlock_read_retry(const seqlock_t *lock, uint32_t seq, uint32_t *attempts) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!(seq & 1) && __atomic_load_n(&lock->seq, __ATOMIC_RELAXED) == seq) {
+        return false;
+    }
+    if (++(*attempts) >= SEQLOCK_SPIN_LIMIT) {
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+#else
+        sched_yield();
+#endif
+    }
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,173 @@
+#include "stat_summary.h"
+#include <string.h>
+#include <math.h>
+
+/**
+ * ヒストグラムのビンの配置
+ * 線形: ビン b は [lo + b * width, lo + (b + 1) * width)。範囲外は両端のビンに入れる
+ * 対数: ビン b (>0) は [2^(b + LOG_SHIFT), 2^(b + LOG_SHIFT + 1))、ビン0は 2^(LOG_SHIFT + 1) 未満
+ */
+typedef struct {
+    int32_t lo;
+    int32_t width;      // 0: 対数
+} bucket_layout_t;
+
+#define LOG_SHIFT   7   // 照度の対数ビンの開始（ビン1 = 2.56〜5.12lux、ビン15 = 約42000lux以上）
+
+static const bucket_layout_t k_bucket_layout[QUANTILE_FIELD_COUNT] = {
+    [QUANTILE_FIELD_TEMPERATURE]      = { -1000, 400 },   // -10〜54℃、4℃ごと [0.01℃]
+    [QUANTILE_FIELD_HUMIDITY]         = { 0, 625 },       // 0〜100%、6.25%ごと [0.01%]
+    [QUANTILE_FIELD_LUX]              = { 0, 0 },         // 2倍ごと [0.01lux]
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    [QUANTILE_FIELD_SOIL_MOISTURE]    = { 0, 2048 },      // 0〜16pF、1pFごと [1/2048 pF]
+#else
+    [QUANTILE_FIELD_SOIL_MOISTURE]    = { 0, 256 },       // 0〜4096mV、256mVごと [mV]
+#endif
+    [QUANTILE_FIELD_SOIL_TEMPERATURE] = { -160, 64 },     // -10〜54℃、4℃ごと [1/16℃]
+};
+
+static void field_reset(stat_field_summary_t *f);
+static void field_add(stat_field_summary_t *f, quantile_field_t field, int32_t value);
+static int bucket_index(quantile_field_t field, int32_t value);
+static void bucket_edges(quantile_field_t field, int b, int64_t *lo, int64_t *hi);
+
+/**
+ * 要約を空にする
+ */
+void stat_summary_reset(stat_summary_t *s) {
+    s->days = 0;
+    for (int f = 0; f < QUANTILE_FIELD_COUNT; f++) {
+        field_reset(&s->field[f]);
+    }
+}
+
+/**
+ * 1分レコードの各フィールドを追加
+ */
+void stat_summary_add(stat_summary_t *s, const minute_record_t *rec) {
+    field_add(&s->field[QUANTILE_FIELD_TEMPERATURE], QUANTILE_FIELD_TEMPERATURE, rec->temperature);
+    field_add(&s->field[QUANTILE_FIELD_HUMIDITY], QUANTILE_FIELD_HUMIDITY, rec->humidity);
+    field_add(&s->field[QUANTILE_FIELD_LUX], QUANTILE_FIELD_LUX, (int32_t)minute_record_lux_raw(rec->lux));
+    field_add(&s->field[QUANTILE_FIELD_SOIL_MOISTURE], QUANTILE_FIELD_SOIL_MOISTURE, minute_record_soil_moisture_raw(rec));
+
+    int16_t soil_temp;
+    if (minute_record_soil_temperature_raw(rec, &soil_temp)) {
+        field_add(&s->field[QUANTILE_FIELD_SOIL_TEMPERATURE], QUANTILE_FIELD_SOIL_TEMPERATURE, soil_temp);
+    }
+}
+
+/**
+ * 要約を結合
+ */
+void stat_summary_merge(stat_summary_t *dst, const stat_summary_t *src) {
+    dst->days = (uint8_t)(dst->days + src->days);
+    for (int i = 0; i < QUANTILE_FIELD_COUNT; i++) {
+        stat_field_summary_t *d = &dst->field[i];
+        const stat_field_summary_t *s = &src->field[i];
+        if (s->count == 0) {
+            continue;
+        }
+        d->count = (uint16_t)(d->count + s->count);
+        if (s->min < d->min) d->min = s->min;
+        if (s->max > d->max) d->max = s->max;
+        d->sum += s->sum;
+        d->sum_sq += s->sum_sq;
+        for (int b = 0; b < STAT_SUMMARY_BUCKETS; b++) {
+            d->bucket[b] = (uint16_t)(d->bucket[b] + s->bucket[b]);
+        }
+    }
+}
+
+/**
+ * 平均を取得
+ */
+float stat_field_mean(const stat_field_summary_t *f) {
+    if (f->count == 0) {
+        return 0.0f;
+    }
+    return (float)((double)f->sum / f->count);
+}
+
+/**
+ * 標準偏差を取得（二乗和の桁が大きいため double で計算）
+ */
+float stat_field_stddev(const stat_field_summary_t *f) {
+    if (f->count == 0) {
+        return 0.0f;
+    }
+    double mean = (double)f->sum / f->count;
+    double variance = (double)f->sum_sq / f->count - mean * mean;
+    return (variance > 0.0) ? (float)sqrt(variance) : 0.0f;
+}
+
+/**
+ * 分位点を推定
+ * 累積数が q × count に達するビンを探し、ビンの範囲（最小〜最大で切り詰め）を線形補間する
+ */
+float stat_field_quantile(const stat_field_summary_t *f, quantile_field_t field, float q) {
+    if (f->count == 0 || field >= QUANTILE_FIELD_COUNT) {
+        return 0.0f;
+    }
+    float target = q * f->count;
+    uint32_t cum = 0;
+    for (int b = 0; b < STAT_SUMMARY_BUCKETS; b++) {
+        if (f->bucket[b] == 0) {
+            continue;
+        }
+        if (cum + f->bucket[b] >= target || b == STAT_SUMMARY_BUCKETS - 1) {
+            int64_t lo, hi;
+            bucket_edges(field, b, &lo, &hi);
+            if (lo < f->min) lo = f->min;
+            if (hi > f->max) hi = f->max;
+            float frac = (target - cum) / f->bucket[b];
+            if (frac < 0.0f) frac = 0.0f;
+            if (frac > 1.0f) frac = 1.0f;
+            return (float)lo + frac * (float)(hi - lo);
+        }
+        cum += f->bucket[b];
+    }
+    return (float)f->max;
+}
+
+static void field_reset(stat_field_summary_t *f) {
+    memset(f, 0, sizeof(stat_field_summary_t));
+    f->min = INT32_MAX;
+    f->max = INT32_MIN;
+}
+
+static void field_add(stat_field_summary_t *f, quantile_field_t field, int32_t value) {
+    if (f->count == UINT16_MAX) {
+        return;
+    }
+    f->count++;
+    if (value < f->min) f->min = value;
+    if (value > f->max) f->max = value;
+    f->sum += value;
+    f->sum_sq += (uint64_t)((int64_t)value * value);
+    f->bucket[bucket_index(field, value)]++;
+}
+
+static int bucket_index(quantile_field_t field, int32_t value) {
+    const bucket_layout_t *layout = &k_bucket_layout[field];
+    int b;
+    if (layout->width == 0) {
+        b = (value < (1 << (LOG_SHIFT + 1))) ? 0 : (31 - __builtin_clz((uint32_t)value)) - LOG_SHIFT;
+    } else {
+        b = (value < layout->lo) ? 0 : (value - layout->lo) / layout->width;
+    }
+    return (b >= STAT_SUMMARY_BUCKETS) ? STAT_SUMMARY_BUCKETS - 1 : b;
+}
+
+/**
+ * ビンの範囲 [lo, hi]（両端のビンは範囲外の値も含むため、呼び出し側で最小〜最大に切り詰める）
+ */
+static void bucket_edges(quantile_field_t field, int b, int64_t *lo, int64_t *hi) {
+    const bucket_layout_t *layout = &k_bucket_layout[field];
+    if (layout->width == 0) {
+        *lo = (b == 0) ? 0 : (int64_t)1 << (b + LOG_SHIFT);
+        *hi = (b == STAT_SUMMARY_BUCKETS - 1) ? INT32_MAX : ((int64_t)1 << (b + LOG_SHIFT + 1)) - 1;
+        return;
+    }
+    *lo = (b == 0) ? INT32_MIN : (int64_t)layout->lo + (int64_t)b * layout->width;
+    *hi = (b == STAT_SUMMARY_BUCKETS - 1) ? INT32_MAX : (int64_t)layout->lo + (int64_t)(b + 1) * layout->width - 1;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "minute_record.h"
+#include "quantile_sketch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STAT_SUMMARY_BUCKETS    16  // 分位点推定用のヒストグラムのビン数
+
+/**
+ * 1フィールドの結合可能な要約（58バイト）
+ * 値は1分データのパック形式の整数単位（照度は 0.01lux）。全ての項目が整数の加算・最小・最大なので、
+ * 日別の要約をどの順序・どの組み合わせで結合しても、全サンプルから直接求めたものと完全に一致する。
+ * ビンはフィールドごとに固定（stat_summary.c の k_bucket_layout）で、ビン内は線形補間して分位点を求める
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t count;                             // サンプル数（1か月 44640 まで）
+    int32_t  min;
+    int32_t  max;
+    int64_t  sum;
+    uint64_t sum_sq;                            // 二乗和（分散用）
+    uint16_t bucket[STAT_SUMMARY_BUCKETS];      // ビンごとのサンプル数
+} stat_field_summary_t;
+
+/**
+ * 気温・湿度・照度・土壌水分・土壌温度（quantile_field_t の順）の結合可能な要約
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t days;                                        // 結合した日数
+    stat_field_summary_t field[QUANTILE_FIELD_COUNT];
+} stat_summary_t;
+
+/**
+ * 要約を空にする
+ * @param s 対象
+ */
+void stat_summary_reset(stat_summary_t *s);
+
+/**
+ * 1分レコードの各フィールドを追加（O(1)、土壌温度がないレコードは土壌温度以外のみ）
+ * @param s 対象
+ * @param rec 追加するレコード
+ */
+void stat_summary_add(stat_summary_t *s, const minute_record_t *rec);
+
+/**
+ * 要約を結合（dst に src を加える。結合則・交換則が成り立つ）
+ * @param dst 結合先
+ * @param src 結合する要約
+ */
+void stat_summary_merge(stat_summary_t *dst, const stat_summary_t *src);
+
+/**
+ * 平均を取得
+ * @param f 対象フィールド
+ * @return 平均（生値の単位、サンプルがない場合は0）
+ */
+float stat_field_mean(const stat_field_summary_t *f);
+
+/**
+ * 標準偏差（母標準偏差）を取得
+ * @param f 対象フィールド
+ * @return 標準偏差（生値の単位、サンプルがない場合は0）
+ */
+float stat_field_stddev(const stat_field_summary_t *f);
+
+/**
+ * 分位点を推定（ヒストグラムのビン内を線形補間し、最小〜最大に収める）
+ * @param f 対象フィールド
+ * @param field フィールド（ビンの配置）
+ * @param q 分位点 (0〜1)
+ * @return 推定値（生値の単位、サンプルがない場合は0）
+ */
+float stat_field_quantile(const stat_field_summary_t *f, quantile_field_t field, float q);
+
+#ifdef __cplusplus
+}
+#endif
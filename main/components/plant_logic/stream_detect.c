@@ -0,0 +1,112 @@
+#include "stream_detect.h"
+#include "seqlock.h"
+#include <string.h>
+
+// 登録されている検出器（新しい検出器はここに追加する）
+static const stream_detector_t *const g_detectors[] = {
+    &stream_detector_watering,
+    &stream_detector_spike,
+    &stream_detector_stuck,
+    &stream_detector_dropout,
+};
+#define DETECTOR_COUNT  (sizeof(g_detectors) / sizeof(g_detectors[0]))
+
+static stream_detect_config_t g_config;    // g_config_lock で保護（ライターはBLEタスク、リーダーはセンサー読み取りタスク）
+static seqlock_t g_config_lock;
+
+/**
+ * 全ての検出器を初期化
+ */
+void stream_detect_init(const stream_detect_config_t *config) {
+    seqlock_write_begin(&g_config_lock);
+    g_config = *config;
+    seqlock_write_end(&g_config_lock);
+    for (size_t i = 0; i < DETECTOR_COUNT; i++) {
+        g_detectors[i]->reset();
+    }
+}
+
+/**
+ * 設定を変更（単一ライター: プロファイルを更新するBLEタスク）
+ */
+void stream_detect_set_config(const stream_detect_config_t *config) {
+    seqlock_write_begin(&g_config_lock);
+    g_config = *config;
+    seqlock_write_end(&g_config_lock);
+}
+
+/**
+ * 1分データから検出器に渡すサンプルを作成
+ */
+void stream_detect_make_sample(uint32_t epoch_minute, const minute_data_t *data, stream_sample_t *sample) {
+    memset(sample, 0, sizeof(stream_sample_t));
+    sample->epoch_minute = epoch_minute;
+    sample->moisture = data->soil_moisture;
+    sample->data = data;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    for (int c = 0; c < STREAM_DETECT_CHANNELS; c++) {
+        sample->channel[c] = data->soil_moisture_capacitance[c];
+    }
+#else
+    sample->channel[0] = data->soil_moisture;
+#endif
+    for (int c = 0; c < STREAM_DETECT_CHANNELS; c++) {
+        if (sample->channel[c] != 0.0f) {
+            sample->valid_mask |= (uint8_t)(1u << c);
+        }
+    }
+}
+
+/**
+ * 1件のサンプルを全ての検出器に渡す
+ */
+uint8_t stream_detect_process(uint32_t epoch_minute, const minute_data_t *data, event_entry_t *events, uint8_t max_events) {
+    stream_sample_t sample;
+    stream_detect_make_sample(epoch_minute, data, &sample);
+
+    // 全ての検出器が同じ設定を使うよう、1サンプルにつき1回だけコピーする
+    stream_detect_config_t config;
+    uint32_t attempts = 0, seq;
+    do {
+        seq = seqlock_read_begin(&g_config_lock);
+        config = g_config;
+    } while (seqlock_read_retry(&g_config_lock, seq, &attempts));
+
+    stream_emit_t emit = { events, max_events, 0, 0 };
+    for (size_t i = 0; i < DETECTOR_COUNT; i++) {
+        g_detectors[i]->process(&sample, &config, &emit);
+    }
+    return emit.count;
+}
+
+/**
+ * 登録されている検出器の数
+ */
+uint8_t stream_detect_count(void) {
+    return (uint8_t)DETECTOR_COUNT;
+}
+
+/**
+ * 登録されている検出器を取得
+ */
+const stream_detector_t *stream_detect_get(uint8_t index) {
+    return (index < DETECTOR_COUNT) ? g_detectors[index] : NULL;
+}
+
+/**
+ * イベントを発行
+ */
+void stream_emit(stream_emit_t *emit, const stream_sample_t *sample, event_type_t type, uint8_t channel_mask, int32_t magnitude) {
+    if (emit->count >= emit->max_events) {
+        emit->dropped++;
+        return;
+    }
+    if (magnitude > INT16_MAX) magnitude = INT16_MAX;
+    if (magnitude < INT16_MIN) magnitude = INT16_MIN;
+
+    event_entry_t *e = &emit->events[emit->count++];
+    e->epoch = sample->epoch_minute * 60u;
+    e->type = (uint8_t)type;
+    e->channel_mask = channel_mask;
+    e->magnitude = (int16_t)magnitude;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "data_buffer.h"
+#include "event_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * ストリーミング検出器
+ *
+ * 1分データを格納するたびに全ての検出器に1件ずつ渡し、各検出器は固定サイズの状態だけを更新して
+ * イベント（event_entry_t）を発行する。検出器は g_detectors 表に登録する（状態判定の分岐は変更不要）。
+ * 呼び出しはセンサー読み取りタスクのみ（検出器の状態はロックなし）。
+ */
+
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+#define STREAM_DETECT_CHANNELS      FDC1004_CHANNEL_COUNT  // 静電容量 ch1〜4
+#else
+#define STREAM_DETECT_CHANNELS      1                      // 土壌水分センサー（ADC）
+#endif
+#define STREAM_DETECT_MAX_EVENTS    8   // 1サンプルで発行できる最大イベント数
+
+/**
+ * 検出器の設定（植物プロファイルから作る）
+ */
+typedef struct {
+    float watering_threshold;   // 灌水検出閾値（土壌水分の単位）。スパイクの最小幅にも使う
+} stream_detect_config_t;
+
+/**
+ * 検出器に渡すサンプル
+ */
+typedef struct {
+    uint32_t epoch_minute;                      // エポック分
+    float moisture;                             // 土壌水分（Rev3/Rev4は全チャンネルの最大）
+    float channel[STREAM_DETECT_CHANNELS];      // チャンネルごとの土壌水分
+    uint8_t valid_mask;                         // 読み取りに成功したチャンネル（失敗時は0が記録される）
+    const minute_data_t *data;                  // 1分データ全体（他のフィールドを使う検出器用）
+} stream_sample_t;
+
+/**
+ * 発行先（呼び出し側のイベント配列）
+ */
+typedef struct {
+    event_entry_t *events;
+    uint8_t max_events;
+    uint8_t count;
+    uint8_t dropped;            // 配列が一杯で捨てたイベント数
+} stream_emit_t;
+
+/**
+ * 検出器（状態は各検出器のファイル内に静的に持つ）
+ */
+typedef struct {
+    const char *name;
+    void (*reset)(void);
+    void (*process)(const stream_sample_t *sample, const stream_detect_config_t *config, stream_emit_t *emit);
+} stream_detector_t;
+
+// 組み込みの検出器（stream_detectors.c）
+extern const stream_detector_t stream_detector_watering;   // 灌水開始・終了・排水速度
+extern const stream_detector_t stream_detector_spike;      // 1サンプルだけの外れ値
+extern const stream_detector_t stream_detector_stuck;      // 値が変わらないセンサー
+extern const stream_detector_t stream_detector_dropout;    // 欠測・読み取り失敗
+
+/**
+ * 全ての検出器を初期化
+ * @param config 設定
+ */
+void stream_detect_init(const stream_detect_config_t *config);
+
+/**
+ * 設定を変更（検出器の状態は保持）
+ * BLEタスクから呼び出してよい（設定はシーケンスロックで保護し、次のサンプルから反映）
+ * @param config 設定
+ */
+void stream_detect_set_config(const stream_detect_config_t *config);
+
+/**
+ * 1分データから検出器に渡すサンプルを作成
+ * @param epoch_minute エポック分
+ * @param data 1分データ
+ * @param sample 格納先
+ */
+void stream_detect_make_sample(uint32_t epoch_minute, const minute_data_t *data, stream_sample_t *sample);
+
+/**
+ * 1件のサンプルを全ての検出器に渡す（時刻順、O(検出器数)）
+ * @param epoch_minute エポック分
+ * @param data 1分データ（リングから読み出した量子化済みの値）
+ * @param events 発行されたイベントの格納先
+ * @param max_events 格納先の要素数
+ * @return 発行されたイベント数
+ */
+uint8_t stream_detect_process(uint32_t epoch_minute, const minute_data_t *data, event_entry_t *events, uint8_t max_events);
+
+/**
+ * 登録されている検出器の数
+ * @return 検出器の数
+ */
+uint8_t stream_detect_count(void);
+
+/**
+ * 登録されている検出器を取得（リプレイでの検出器ごとのコスト計測用）
+ * @param index 番号
+ * @return 検出器（範囲外はNULL）
+ */
+const stream_detector_t *stream_detect_get(uint8_t index);
+
+/**
+ * イベントを発行（検出器から呼ぶ）
+ * @param emit 発行先
+ * @param sample 発生したサンプル（時刻に使う）
+ * @param type 種類
+ * @param channel_mask 対象チャンネル
+ * @param magnitude 大きさ（int16 の範囲に丸める）
+ */
+void stream_emit(stream_emit_t *emit, const stream_sample_t *sample, event_type_t type, uint8_t channel_mask, int32_t magnitude);
+
+#ifdef __cplusplus
+}
+#endif
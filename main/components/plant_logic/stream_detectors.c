@@ -0,0 +1,267 @@
+#include "stream_detect.h"
+#include "minute_record.h"
+#include <string.h>
+#include <math.h>
+
+// 組み込みの検出器。状態は固定サイズで、1サンプルごとの処理はチャンネル数に比例する定数時間
+
+#define ALL_CHANNELS            ((uint8_t)((1u << STREAM_DETECT_CHANNELS) - 1))
+
+// 灌水
+#define WATERING_SETTLE_SAMPLES 3       // 1サンプルの変化が閾値の1/4未満の状態がこの回数続いたら灌水終了
+#define WATERING_MAX_MINUTES    60      // 灌水開始からこの時間が経ったら変化が続いていても終了とする
+#define DRAINAGE_MINUTES        60      // 灌水終了から排水速度を求めるまでの時間
+#define HISTORY_GAP_MINUTES     60      // これより長い欠測の後は直前のサンプルと比較しない
+
+// スパイク
+#define SPIKE_WARMUP_SAMPLES    8       // 平均・分散が落ち着くまでのサンプル数
+#define SPIKE_ALPHA             0.125f  // 指数移動平均の係数
+#define SPIKE_SIGMA             6.0f    // 平均からこの標準偏差倍以上離れたら候補
+
+// 固着
+#define STUCK_SAMPLES           60      // 同じ値がこのサンプル数続いたら固着
+
+// 欠測
+#define DROPOUT_GAP_MINUTES     5       // サンプルの間隔がこれより長ければ欠測（通常は1分間隔）
+
+static int32_t to_soil_units(float value) {
+    return (int32_t)lroundf(value * MINUTE_RECORD_SOIL_SCALE);
+}
+
+// --- 灌水開始・終了・排水速度 ---
+
+typedef enum {
+    WATERING_IDLE = 0,
+    WATERING_ACTIVE,            // 灌水中（土壌水分が変化している）
+    WATERING_DRAINING,          // 灌水終了後、排水速度の計測中
+} watering_phase_t;
+
+static struct {
+    float moisture[2];                          // 1回前・2回前の土壌水分
+    float channel[2][STREAM_DETECT_CHANNELS];   // 1回前・2回前のチャンネルごとの値
+    uint8_t history_count;
+    uint32_t last_minute;
+    watering_phase_t phase;
+    uint8_t settle_count;
+    uint8_t channel_mask;                       // 開始時に閾値以上変化したチャンネル
+    float start_value;                          // 灌水前の土壌水分
+    float end_value;                            // 灌水終了時の土壌水分
+    uint32_t start_minute;
+    uint32_t end_minute;
+} g_watering;
+
+static void watering_reset(void) {
+    memset(&g_watering, 0, sizeof(g_watering));
+}
+
+/**
+ * 2回前から閾値以上減少したら開始、1サンプルの変化が落ち着いたら終了（減少量の合計）、
+ * 終了から DRAINAGE_MINUTES 後に土壌水分の戻りを1時間あたりの排水速度として発行
+ */
+static void watering_process(const stream_sample_t *sample, const stream_detect_config_t *config, stream_emit_t *emit) {
+    if (sample->valid_mask == 0) {
+        return;  // 読み取り失敗（欠測の検出器が扱う）
+    }
+    if (g_watering.history_count > 0 && sample->epoch_minute - g_watering.last_minute > HISTORY_GAP_MINUTES) {
+        g_watering.history_count = 0;
+        g_watering.phase = WATERING_IDLE;
+    }
+
+    float current = sample->moisture;
+    float threshold = config->watering_threshold;
+    if (g_watering.phase != WATERING_ACTIVE && g_watering.history_count >= 2 &&
+        g_watering.moisture[1] - current >= threshold) {
+        uint8_t mask = 0;
+        for (int c = 0; c < STREAM_DETECT_CHANNELS; c++) {
+            if ((sample->valid_mask & (1u << c)) && fabsf(sample->channel[c] - g_watering.channel[1][c]) >= threshold) {
+                mask |= (uint8_t)(1u << c);
+            }
+        }
+        stream_emit(emit, sample, EVENT_TYPE_WATERING_START, mask, to_soil_units(g_watering.moisture[1] - current));
+        g_watering.phase = WATERING_ACTIVE;
+        g_watering.settle_count = 0;
+        g_watering.channel_mask = mask;
+        g_watering.start_value = g_watering.moisture[1];
+        g_watering.start_minute = sample->epoch_minute;
+    } else if (g_watering.phase == WATERING_ACTIVE) {
+        if (fabsf(g_watering.moisture[0] - current) < threshold / 4) {
+            g_watering.settle_count++;
+        } else {
+            g_watering.settle_count = 0;
+        }
+        if (g_watering.settle_count >= WATERING_SETTLE_SAMPLES ||
+            sample->epoch_minute - g_watering.start_minute >= WATERING_MAX_MINUTES) {
+            stream_emit(emit, sample, EVENT_TYPE_WATERING_END, g_watering.channel_mask,
+                        to_soil_units(g_watering.start_value - current));
+            g_watering.phase = WATERING_DRAINING;
+            g_watering.end_value = current;
+            g_watering.end_minute = sample->epoch_minute;
+        }
+    } else if (g_watering.phase == WATERING_DRAINING &&
+               sample->epoch_minute - g_watering.end_minute >= DRAINAGE_MINUTES) {
+        float rate = (current - g_watering.end_value) * 60.0f / (float)(sample->epoch_minute - g_watering.end_minute);
+        stream_emit(emit, sample, EVENT_TYPE_DRAINAGE, g_watering.channel_mask, to_soil_units(rate));
+        g_watering.phase = WATERING_IDLE;
+    }
+
+    g_watering.moisture[1] = g_watering.moisture[0];
+    g_watering.moisture[0] = current;
+    memcpy(g_watering.channel[1], g_watering.channel[0], sizeof(g_watering.channel[0]));
+    memcpy(g_watering.channel[0], sample->channel, sizeof(g_watering.channel[0]));
+    if (g_watering.history_count < 2) {
+        g_watering.history_count++;
+    }
+    g_watering.last_minute = sample->epoch_minute;
+}
+
+const stream_detector_t stream_detector_watering = { "watering", watering_reset, watering_process };
+
+// --- スパイク ---
+
+static struct {
+    float mean[STREAM_DETECT_CHANNELS];         // 指数移動平均
+    float var[STREAM_DETECT_CHANNELS];          // 指数移動分散
+    uint8_t samples[STREAM_DETECT_CHANNELS];    // 平均に加えたサンプル数（SPIKE_WARMUP_SAMPLES で頭打ち）
+    float pending[STREAM_DETECT_CHANNELS];      // 候補の平均からの偏差
+    uint8_t pending_mask;                       // 候補のあるチャンネル
+} g_spike;
+
+static void spike_reset(void) {
+    memset(&g_spike, 0, sizeof(g_spike));
+}
+
+static void spike_update(int c, float value) {
+    if (g_spike.samples[c] == 0) {
+        g_spike.mean[c] = value;
+        g_spike.var[c] = 0.0f;
+    } else {
+        float dev = value - g_spike.mean[c];
+        g_spike.mean[c] += SPIKE_ALPHA * dev;
+        g_spike.var[c] = (1.0f - SPIKE_ALPHA) * (g_spike.var[c] + SPIKE_ALPHA * dev * dev);
+    }
+    if (g_spike.samples[c] < SPIKE_WARMUP_SAMPLES) {
+        g_spike.samples[c]++;
+    }
+}
+
+/**
+ * 平均から大きく離れた値（候補）の次のサンプルが平均付近に戻ればスパイク、戻らなければ段差（灌水など）として平均を移す
+ */
+static void spike_process(const stream_sample_t *sample, const stream_detect_config_t *config, stream_emit_t *emit) {
+    uint8_t mask = 0;
+    float largest = 0.0f;
+    for (int c = 0; c < STREAM_DETECT_CHANNELS; c++) {
+        uint8_t bit = (uint8_t)(1u << c);
+        if (!(sample->valid_mask & bit)) {
+            continue;
+        }
+        float value = sample->channel[c];
+        if (g_spike.samples[c] < SPIKE_WARMUP_SAMPLES) {
+            spike_update(c, value);
+            continue;
+        }
+
+        float dev = value - g_spike.mean[c];
+        float limit = fmaxf(SPIKE_SIGMA * sqrtf(g_spike.var[c]), config->watering_threshold / 2);
+        if (g_spike.pending_mask & bit) {
+            g_spike.pending_mask &= (uint8_t)~bit;
+            if (fabsf(dev) <= limit) {
+                mask |= bit;
+                if (fabsf(g_spike.pending[c]) > fabsf(largest)) {
+                    largest = g_spike.pending[c];
+                }
+                spike_update(c, value);
+            } else {
+                g_spike.mean[c] = value;  // 段差: 新しい水準から平均をやり直す（分散は引き継ぐ）
+            }
+        } else if (fabsf(dev) > limit) {
+            g_spike.pending_mask |= bit;
+            g_spike.pending[c] = dev;
+        } else {
+            spike_update(c, value);
+        }
+    }
+    if (mask != 0) {
+        stream_emit(emit, sample, EVENT_TYPE_SPIKE, mask, to_soil_units(largest));
+    }
+}
+
+const stream_detector_t stream_detector_spike = { "spike", spike_reset, spike_process };
+
+// --- 固着 ---
+
+static struct {
+    float last[STREAM_DETECT_CHANNELS];
+    uint16_t run[STREAM_DETECT_CHANNELS];       // 直前と同じ値が続いた回数
+    uint8_t has_last;                           // last が有効なチャンネル
+    uint8_t reported;                           // 発行済みのチャンネル（値が変わるまで再発行しない）
+} g_stuck;
+
+static void stuck_reset(void) {
+    memset(&g_stuck, 0, sizeof(g_stuck));
+}
+
+/**
+ * 量子化済みの値が STUCK_SAMPLES 回続けて全く同じなら固着（計測値には通常ノイズがある）
+ */
+static void stuck_process(const stream_sample_t *sample, const stream_detect_config_t *config, stream_emit_t *emit) {
+    uint8_t mask = 0;
+    for (int c = 0; c < STREAM_DETECT_CHANNELS; c++) {
+        uint8_t bit = (uint8_t)(1u << c);
+        if (!(sample->valid_mask & bit)) {
+            continue;
+        }
+        if ((g_stuck.has_last & bit) && sample->channel[c] == g_stuck.last[c]) {
+            if (g_stuck.run[c] < UINT16_MAX) {
+                g_stuck.run[c]++;
+            }
+            if (g_stuck.run[c] + 1 >= STUCK_SAMPLES && !(g_stuck.reported & bit)) {
+                mask |= bit;
+                g_stuck.reported |= bit;
+            }
+        } else {
+            g_stuck.run[c] = 0;
+            g_stuck.reported &= (uint8_t)~bit;
+        }
+        g_stuck.last[c] = sample->channel[c];
+        g_stuck.has_last |= bit;
+    }
+    if (mask != 0) {
+        stream_emit(emit, sample, EVENT_TYPE_STUCK, mask, STUCK_SAMPLES);
+    }
+}
+
+const stream_detector_t stream_detector_stuck = { "stuck", stuck_reset, stuck_process };
+
+// --- 欠測・読み取り失敗 ---
+
+static struct {
+    uint32_t last_minute;
+    bool has_last;
+    uint8_t failed_mask;                        // 読み取り失敗が続いているチャンネル
+} g_dropout;
+
+static void dropout_reset(void) {
+    memset(&g_dropout, 0, sizeof(g_dropout));
+}
+
+/**
+ * サンプルの間隔が DROPOUT_GAP_MINUTES より長い（magnitude: 欠測した分数）、
+ * またはチャンネルの読み取りが失敗し始めた（magnitude: 0、失敗が続く間は再発行しない）
+ */
+static void dropout_process(const stream_sample_t *sample, const stream_detect_config_t *config, stream_emit_t *emit) {
+    if (g_dropout.has_last && sample->epoch_minute > g_dropout.last_minute + DROPOUT_GAP_MINUTES) {
+        stream_emit(emit, sample, EVENT_TYPE_DROPOUT, 0, (int32_t)(sample->epoch_minute - g_dropout.last_minute - 1));
+    }
+
+    uint8_t failed = (uint8_t)(~sample->valid_mask & ALL_CHANNELS);
+    uint8_t started = (uint8_t)(failed & ~g_dropout.failed_mask);
+    if (started != 0) {
+        stream_emit(emit, sample, EVENT_TYPE_DROPOUT, started, 0);
+    }
+    g_dropout.failed_mask = failed;
+    g_dropout.last_minute = sample->epoch_minute;
+    g_dropout.has_last = true;
+}
+
+const stream_detector_t stream_detector_dropout = { "dropout", dropout_reset, dropout_process };
@@ -0,0 +1,217 @@
+#include "swinging_door.h"
+#include <string.h>
+
+static void archive_point(swinging_door_t *sd, uint32_t epoch_minute, int32_t value, uint8_t flags);
+static const swinging_door_point_t *newest_point(const swinging_door_t *sd);
+static void get_point(const swinging_door_t *sd, uint16_t index, swinging_door_point_t *point);
+static void open_door(swinging_door_t *sd, uint32_t epoch_minute, int32_t value);
+static int64_t floor_div(int64_t num, int64_t den);
+static int64_t ceil_div(int64_t num, int64_t den);
+
+/**
+ * 間引き記録を初期化
+ */
+void swinging_door_init(swinging_door_t *sd, swinging_door_point_t *points, uint16_t capacity, int32_t deviation) {
+    sd->points = points;
+    sd->capacity = capacity;
+    sd->deviation = (deviation > 0) ? deviation : 0;
+    swinging_door_clear(sd);
+}
+
+/**
+ * 記録を全て破棄
+ */
+void swinging_door_clear(swinging_door_t *sd) {
+    sd->head = 0;
+    sd->count = 0;
+    sd->open = false;
+    sd->has_tail = false;
+    sd->tail_minute = 0;
+    sd->tail_value = 0;
+    sd->lo_num = sd->hi_num = 0;
+    sd->lo_den = sd->hi_den = 1;
+}
+
+/**
+ * サンプルを追加
+ * 起点 (t0, v0) からの直線の傾き s は、各サンプル (t, v) について |v0 + s(t - t0) - v| <= deviation - 1/2 を満たす範囲に絞る。
+ * 復元時の四捨五入（最大1/2）を含めても誤差は deviation 以内になる。半整数を避けるため両辺を2倍して整数で扱う
+ */
+void swinging_door_add(swinging_door_t *sd, uint32_t epoch_minute, int32_t value) {
+    if (sd->deviation <= 0 || sd->capacity == 0) {
+        return;
+    }
+
+    uint32_t last_minute = sd->has_tail ? sd->tail_minute : (sd->open ? newest_point(sd)->epoch_minute : 0);
+    if (!sd->open || epoch_minute != last_minute + 1) {
+        // 欠測・時刻の逆行: 未確定のサンプルを確定して区間を閉じ、このサンプルから新しい区間を始める
+        if (sd->open && sd->has_tail) {
+            archive_point(sd, sd->tail_minute, sd->tail_value, 0);
+        }
+        archive_point(sd, epoch_minute, value, SWINGING_DOOR_SEGMENT_START);
+        sd->open = true;
+        sd->has_tail = false;
+        return;
+    }
+
+    const swinging_door_point_t *anchor = newest_point(sd);
+    int64_t dt = (int64_t)epoch_minute - anchor->epoch_minute;
+    int64_t margin = 2 * (int64_t)sd->deviation - 1;
+    int64_t diff2 = 2 * ((int64_t)value - anchor->value);
+
+    // このサンプルによる傾きの範囲 [(diff2 - margin) / 2dt, (diff2 + margin) / 2dt] と、これまでの範囲の共通部分
+    int64_t lo_num = diff2 - margin, lo_den = 2 * dt;
+    int64_t hi_num = diff2 + margin, hi_den = 2 * dt;
+    if (sd->has_tail) {
+        if (sd->lo_num * lo_den > lo_num * sd->lo_den) {
+            lo_num = sd->lo_num;
+            lo_den = sd->lo_den;
+        }
+        if (sd->hi_num * hi_den < hi_num * sd->hi_den) {
+            hi_num = sd->hi_num;
+            hi_den = sd->hi_den;
+        }
+    }
+
+    // この分に置ける整数値の範囲（空ならドアが閉じた）
+    int64_t vmin = anchor->value + ceil_div(lo_num * dt, lo_den);
+    int64_t vmax = anchor->value + floor_div(hi_num * dt, hi_den);
+    if (vmin <= vmax) {
+        sd->lo_num = lo_num;
+        sd->lo_den = lo_den;
+        sd->hi_num = hi_num;
+        sd->hi_den = hi_den;
+        sd->tail_minute = epoch_minute;
+        sd->tail_value = (int32_t)((value < vmin) ? vmin : (value > vmax) ? vmax : value);
+        sd->has_tail = true;
+        return;
+    }
+
+    // ドアが閉じた: 最後のサンプルの位置に置いた値を確定し、そこを起点に開き直す
+    archive_point(sd, sd->tail_minute, sd->tail_value, 0);
+    open_door(sd, epoch_minute, value);
+}
+
+/**
+ * 指定した分の値を復元
+ */
+bool swinging_door_value_at(const swinging_door_t *sd, uint32_t epoch_minute, int32_t *value) {
+    uint16_t n = swinging_door_point_count(sd);
+    if (n == 0) {
+        return false;
+    }
+
+    // epoch_minute 以前で最も新しい点を二分探索
+    swinging_door_point_t p, q;
+    get_point(sd, 0, &p);
+    if (p.epoch_minute > epoch_minute) {
+        return false;
+    }
+    uint16_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi + 1) / 2);
+        get_point(sd, mid, &q);
+        if (q.epoch_minute <= epoch_minute) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    get_point(sd, lo, &p);
+    if (p.epoch_minute == epoch_minute) {
+        *value = p.value;
+        return true;
+    }
+    if (lo + 1 >= n) {
+        return false;
+    }
+    get_point(sd, lo + 1, &q);
+    if (q.flags & SWINGING_DOOR_SEGMENT_START) {
+        return false;
+    }
+
+    int64_t num = ((int64_t)q.value - p.value) * (int64_t)(epoch_minute - p.epoch_minute);
+    int64_t den = (int64_t)(q.epoch_minute - p.epoch_minute);
+    int64_t delta = (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+    *value = (int32_t)(p.value + delta);
+    return true;
+}
+
+/**
+ * 記録している点の数を取得
+ */
+uint16_t swinging_door_point_count(const swinging_door_t *sd) {
+    return (uint16_t)(sd->count + (sd->has_tail ? 1 : 0));
+}
+
+/**
+ * 記録している最も古い点のエポック分を取得
+ */
+bool swinging_door_first_minute(const swinging_door_t *sd, uint32_t *epoch_minute) {
+    if (swinging_door_point_count(sd) == 0) {
+        return false;
+    }
+    swinging_door_point_t p;
+    get_point(sd, 0, &p);
+    *epoch_minute = p.epoch_minute;
+    return true;
+}
+
+/**
+ * 確定点をリングに追加（満杯なら最古の点を上書き）
+ */
+static void archive_point(swinging_door_t *sd, uint32_t epoch_minute, int32_t value, uint8_t flags) {
+    swinging_door_point_t *point = &sd->points[sd->head];
+    point->epoch_minute = epoch_minute;
+    point->value = value;
+    point->flags = flags;
+    sd->head = (uint16_t)((sd->head + 1) % sd->capacity);
+    if (sd->count < sd->capacity) {
+        sd->count++;
+    }
+}
+
+/**
+ * 最後の確定点（区間の起点）
+ */
+static const swinging_door_point_t *newest_point(const swinging_door_t *sd) {
+    return &sd->points[(sd->head + sd->capacity - 1) % sd->capacity];
+}
+
+/**
+ * 古い順に index 番目の点を取得（count 番目は未確定の最後のサンプル）
+ */
+static void get_point(const swinging_door_t *sd, uint16_t index, swinging_door_point_t *point) {
+    if (index < sd->count) {
+        memcpy(point, &sd->points[(sd->head + sd->capacity - sd->count + index) % sd->capacity], sizeof(swinging_door_point_t));
+        return;
+    }
+    point->epoch_minute = sd->tail_minute;
+    point->value = sd->tail_value;
+    point->flags = 0;
+}
+
+/**
+ * 最後の確定点を起点に、次の分のサンプル1つだけでドアを開く
+ */
+static void open_door(swinging_door_t *sd, uint32_t epoch_minute, int32_t value) {
+    const swinging_door_point_t *anchor = newest_point(sd);
+    int64_t margin = 2 * (int64_t)sd->deviation - 1;
+    int64_t diff2 = 2 * ((int64_t)value - anchor->value);
+    sd->lo_num = diff2 - margin;
+    sd->hi_num = diff2 + margin;
+    sd->lo_den = sd->hi_den = 2;
+    sd->tail_minute = epoch_minute;
+    sd->tail_value = value;
+    sd->has_tail = true;
+}
+
+static int64_t floor_div(int64_t num, int64_t den) {
+    int64_t q = num / den;
+    return (num % den != 0 && num < 0) ? q - 1 : q;
+}
+
+static int64_t ceil_div(int64_t num, int64_t den) {
+    int64_t q = num / den;
+    return (num % den != 0 && num > 0) ? q + 1 : q;
+}
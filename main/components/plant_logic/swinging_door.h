@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWINGING_DOOR_SEGMENT_START  0x01  // 区間の先頭（前の点との間は欠測で、補間しない）
+
+/**
+ * 間引き記録の確定点（9バイト）
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t epoch_minute;      // エポック分
+    int32_t value;              // 値（1分データのパック形式と同じ整数単位）
+    uint8_t flags;              // SWINGING_DOOR_SEGMENT_START
+} swinging_door_point_t;
+
+/**
+ * スイングドア方式の間引き記録（1フィールド分）
+ * 直前の確定点から、これまでの全サンプルを許容誤差以内で通る直線の傾きの範囲（ドア）を整数の分数で保持し、
+ * 新しいサンプルでドアが閉じた（範囲が空になった）時だけ1点を確定する。確定点の値は実際のサンプルではなく
+ * ドア内の直線上の整数値とするため、確定点の間を直線補間して四捨五入した値は、元の全サンプルに対して
+ * 必ず許容誤差以内になる。ゆっくり変化する値ほど確定点が少なくなる。
+ */
+typedef struct {
+    swinging_door_point_t *points;  // 確定点のリング（古い点から上書き）
+    uint16_t capacity;              // リングの点数
+    uint16_t head;                  // 次に書き込む位置
+    uint16_t count;                 // 確定点の数
+    int32_t deviation;              // 許容誤差（生値, 0: 記録しない）
+    bool open;                      // 区間の途中か（最後の確定点が起点）
+    bool has_tail;                  // 起点より後にドア内のサンプルがあるか
+    uint32_t tail_minute;           // 最後のサンプルのエポック分
+    int32_t tail_value;             // 最後のサンプルの時刻に置く値（未確定）
+    int64_t lo_num, lo_den;         // 傾きの下限（lo_num / lo_den、lo_den > 0）
+    int64_t hi_num, hi_den;         // 傾きの上限
+} swinging_door_t;
+
+/**
+ * 間引き記録を初期化
+ * @param sd 対象
+ * @param points 確定点の格納先（capacity 要素）
+ * @param capacity 確定点の最大数
+ * @param deviation 許容誤差（生値、0: 記録しない）
+ */
+void swinging_door_init(swinging_door_t *sd, swinging_door_point_t *points, uint16_t capacity, int32_t deviation);
+
+/**
+ * 記録を全て破棄（許容誤差はそのまま）
+ * @param sd 対象
+ */
+void swinging_door_clear(swinging_door_t *sd);
+
+/**
+ * サンプルを追加（時刻順に呼び出す）
+ * 前のサンプルの次の分でない場合（欠測・時刻の逆行）は区間を閉じて新しい区間を始める
+ * @param sd 対象
+ * @param epoch_minute エポック分
+ * @param value 値
+ */
+void swinging_door_add(swinging_door_t *sd, uint32_t epoch_minute, int32_t value);
+
+/**
+ * 指定した分の値を復元（確定点と未確定の最後のサンプルの間を直線補間し、四捨五入）
+ * @param sd 対象
+ * @param epoch_minute エポック分
+ * @param value 値の格納先
+ * @return true: 値あり, false: 記録の範囲外または欠測
+ */
+bool swinging_door_value_at(const swinging_door_t *sd, uint32_t epoch_minute, int32_t *value);
+
+/**
+ * 記録している点の数を取得（未確定の最後のサンプルを含む）
+ * @param sd 対象
+ * @return 点の数
+ */
+uint16_t swinging_door_point_count(const swinging_door_t *sd);
+
+/**
+ * 記録している最も古い点のエポック分を取得
+ * @param sd 対象
+ * @param epoch_minute 格納先
+ * @return true: 点あり, false: 記録なし
+ */
+bool swinging_door_first_minute(const swinging_door_t *sd, uint32_t *epoch_minute);
+
+#ifdef __cplusplus
+}
+#endif
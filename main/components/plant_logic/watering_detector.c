@@ -0,0 +1,74 @@
+#include "watering_detector.h"
+#include <string.h>
+#include <math.h>
+
+/**
+ * 窓を空にする
+ */
+void watering_detector_reset(watering_detector_t *det) {
+    memset(det, 0, sizeof(watering_detector_t));
+}
+
+/**
+ * サンプルを追加
+ */
+void watering_detector_add(watering_detector_t *det, uint32_t epoch_minute, float moisture, const float *channels) {
+    if (det->count > 0) {
+        uint8_t newest = (uint8_t)((det->head + WATERING_DETECTOR_SAMPLES - 1) % WATERING_DETECTOR_SAMPLES);
+        if (epoch_minute == det->epoch_minute[newest]) {
+            // 同じ分の再計測は置き換え（1分リングのスロット上書きと同じ）
+            det->head = newest;
+            det->count--;
+        } else if (epoch_minute < det->epoch_minute[newest]) {
+            watering_detector_reset(det);
+        }
+    }
+
+    det->epoch_minute[det->head] = epoch_minute;
+    det->moisture[det->head] = moisture;
+    memcpy(det->channel[det->head], channels, sizeof(det->channel[det->head]));
+    det->head = (uint8_t)((det->head + 1) % WATERING_DETECTOR_SAMPLES);
+    if (det->count < WATERING_DETECTOR_SAMPLES) {
+        det->count++;
+    }
+}
+
+/**
+ * 直近3件で灌水を判定
+ * 窓が満杯なら head の位置が2回前、その1つ前が現在のサンプル
+ * 集約値の判定（従来どおり）に加えて、チャンネルごとの減少でも灌水とする
+ */
+bool watering_detector_check(const watering_detector_t *det, uint32_t window_start_minute, float threshold,
+                             watering_detection_t *result) {
+    memset(result, 0, sizeof(watering_detection_t));
+    uint8_t oldest = det->head;
+    if (det->count < WATERING_DETECTOR_SAMPLES || det->epoch_minute[oldest] < window_start_minute) {
+        return false;
+    }
+    uint8_t newest = (uint8_t)((det->head + WATERING_DETECTOR_SAMPLES - 1) % WATERING_DETECTOR_SAMPLES);
+
+    result->moisture_2_samples_ago = det->moisture[oldest];
+    result->current_moisture = det->moisture[newest];
+    result->aggregate_decrease = result->moisture_2_samples_ago - result->current_moisture;
+    result->aggregate_detected = (result->aggregate_decrease >= threshold);
+    result->decrease = result->aggregate_decrease;
+    for (int c = 0; c < WATERING_DETECTOR_CHANNELS; c++) {
+        float before = det->channel[oldest][c];
+        float after = det->channel[newest][c];
+        if (fabsf(after - before) >= threshold) {
+            result->channel_mask |= (uint8_t)(1u << c);
+        }
+        if (before == 0.0f || after == 0.0f) {
+            continue;  // 読み取り失敗
+        }
+        float decrease = before - after;
+        if (decrease >= threshold) {
+            result->watering_mask |= (uint8_t)(1u << c);
+        }
+        if (decrease > result->decrease) {
+            result->decrease = decrease;
+        }
+    }
+    result->detected = result->aggregate_detected || result->watering_mask != 0;
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../common_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATERING_DETECTOR_SAMPLES   3   // 保持するサンプル数（現在・1回前・2回前）
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+#define WATERING_DETECTOR_CHANNELS  FDC1004_CHANNEL_COUNT  // 静電容量 ch1〜4
+#else
+#define WATERING_DETECTOR_CHANNELS  1                      // 土壌水分センサー（ADC）
+#endif
+
+/**
+ * 灌水検出用の直近サンプルの窓（チャンネルごと）
+ * サンプルの到着時に1件ずつ追加し、判定は保持している3件だけを見る（O(1)、コピー・走査なし）
+ */
+typedef struct {
+    uint32_t epoch_minute[WATERING_DETECTOR_SAMPLES];                   // 各サンプルのエポック分
+    float moisture[WATERING_DETECTOR_SAMPLES];                          // 土壌水分（Rev3/Rev4は全チャンネルの最大）
+    float channel[WATERING_DETECTOR_SAMPLES][WATERING_DETECTOR_CHANNELS];  // チャンネルごとの値
+    uint8_t head;               // 次に書き込む位置
+    uint8_t count;              // 保持しているサンプル数
+} watering_detector_t;
+
+/**
+ * 判定結果
+ * 集約値（Rev3/Rev4は全チャンネルの最大）だけでは最大以外のチャンネル（浅い・深い根域）に届いた灌水を見逃すため、
+ * 集約値といずれかのチャンネルのどちらかが閾値以上減少したら灌水とする
+ */
+typedef struct {
+    bool detected;              // 集約値またはいずれかのチャンネルが2回前から閾値以上減少した
+    bool aggregate_detected;    // 集約値が2回前から閾値以上減少した（従来の判定）
+    float decrease;             // 減少量（集約値とチャンネルごとの減少量のうち最大）
+    float aggregate_decrease;   // 集約値の2回前からの減少量（従来の減少量）
+    float moisture_2_samples_ago;  // 2回前の土壌水分
+    float current_moisture;     // 現在の土壌水分
+    uint8_t channel_mask;       // 2回前から閾値以上変化したチャンネル（増加・減少とも。bit c: チャンネル c）
+    uint8_t watering_mask;      // 2回前から閾値以上減少したチャンネル（どちらかの値が0（読み取り失敗）のチャンネルは除く）
+} watering_detection_t;
+
+/**
+ * 窓を空にする
+ * @param det 対象
+ */
+void watering_detector_reset(watering_detector_t *det);
+
+/**
+ * サンプルを追加（時刻順、O(1)）
+ * 最新と同じ分は置き換え、最新より前の分（時刻の逆行）は窓を空にしてから追加する
+ * @param det 対象
+ * @param epoch_minute サンプルのエポック分
+ * @param moisture 土壌水分
+ * @param channels チャンネルごとの値（WATERING_DETECTOR_CHANNELS 要素）
+ */
+void watering_detector_add(watering_detector_t *det, uint32_t epoch_minute, float moisture, const float *channels);
+
+/**
+ * 直近3件で灌水を判定（O(1)）
+ * @param det 対象
+ * @param window_start_minute 判定に使うサンプルの最古のエポック分（これより前のサンプルが含まれる場合は判定しない）
+ * @param threshold 灌水検出閾値（土壌水分の単位）
+ * @param result 判定結果
+ * @return true: 判定した, false: 範囲内のサンプルが3件未満
+ */
+bool watering_detector_check(const watering_detector_t *det, uint32_t window_start_minute, float threshold,
+                             watering_detection_t *result);
+
+#ifdef __cplusplus
+}
+#endif
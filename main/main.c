@@ -11,6 +11,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_pm.h"
@@ -58,6 +59,15 @@ static const char *TAG = "PLANTER_MONITOR";
 static TaskHandle_t g_sensor_task_handle = NULL;
 static TaskHandle_t g_analysis_task_handle = NULL;
 
+// センサー読み取りタスクへの通知（ビット）
+#define SENSOR_NOTIFY_MEASURE   0x01    // 計測
+#define SENSOR_NOTIFY_FLUSH     0x02    // 履歴ログの書き出し
+#define SENSOR_NOTIFY_CLEANUP   0x04    // 保持期間を過ぎたデータの削除
+#define DATA_CLEANUP_INTERVAL   60      // 古いデータを削除する間隔（分析周期の回数、約1時間）
+#define HISTORY_FLUSH_TIMEOUT_MS 5000   // 書き出しの完了を待つ最大時間（計測中なら計測の後に書き出す）
+
+static SemaphoreHandle_t g_flush_done = NULL;  // 書き出しの完了
+
 static TimerHandle_t g_notify_timer;
 
 // 土壌温度センサー接続状態
@@ -308,24 +318,49 @@ void init_gpio(void) {
     gpio_set_level(BLUE_LED_PIN, 0);
 }
 
-// センサー読み取り専用タスク
+// センサー読み取り専用タスク（1分リング・履歴ログのライターはこのタスクだけ）
 static void sensor_read_task(void* pvParameters) {
     soil_data_t data;
+    uint32_t events;
     while (1) {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        gpio_set_level(RED_LED_PIN, 1);
-        read_all_sensors(&data);
-        plant_manager_process_sensor_data(&data);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        gpio_set_level(RED_LED_PIN, 0);
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        if (events & SENSOR_NOTIFY_MEASURE) {
+            gpio_set_level(RED_LED_PIN, 1);
+            read_all_sensors(&data);
+            plant_manager_process_sensor_data(&data);
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            gpio_set_level(RED_LED_PIN, 0);
+            ESP_LOGD(TAG, "sensor_read stack high water mark: %u bytes",
+                     (unsigned)uxTaskGetStackHighWaterMark(NULL));
+        }
+        if (events & SENSOR_NOTIFY_FLUSH) {
+            data_buffer_flush();
+            xSemaphoreGive(g_flush_done);
+        }
+        if (events & SENSOR_NOTIFY_CLEANUP) {
+            data_buffer_cleanup_old_data();
+        }
     }
 }
 
+/**
+ * 履歴ログの書き出しをセンサー読み取りタスクに依頼して完了を待つ（BLEのシステムリセットから呼ばれる）
+ * 他のタスクで書き出すと、追記中のページと競合して履歴ログが壊れる
+ */
+static esp_err_t flush_history_on_sensor_task(void) {
+    if (g_sensor_task_handle == NULL) {
+        return data_buffer_flush();  // タスク開始前はライターがいない
+    }
+    xSemaphoreTake(g_flush_done, 0);
+    xTaskNotify(g_sensor_task_handle, SENSOR_NOTIFY_FLUSH, eSetBits);
+    return (xSemaphoreTake(g_flush_done, pdMS_TO_TICKS(HISTORY_FLUSH_TIMEOUT_MS)) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
 /* --- Timer Callback for Notifications --- */
 static void notify_timer_callback(TimerHandle_t xTimer) {
     if (g_sensor_task_handle != NULL) {
         // タイマーコールバックはISRではないため、通常のタスク通知を使用
-        xTaskNotifyGive(g_sensor_task_handle);
+        xTaskNotify(g_sensor_task_handle, SENSOR_NOTIFY_MEASURE, eSetBits);
     }
 }
 
@@ -355,6 +390,10 @@ static void log_sensor_data_and_status(const soil_data_t *soil_data,
              soil_data->lux, soil_data->soil_moisture);
     ESP_LOGI(TAG, "状態: %s",
              plant_manager_get_plant_condition_string(status->plant_condition));
+    if (status->drying.hours_until_dry >= 0.0f) {
+        ESP_LOGI(TAG, "乾燥まで: %.1f時間 (乾燥速度 昼: %.3f/h, 夜: %.3f/h)", status->drying.hours_until_dry,
+                 status->drying.rate[DRYING_PERIOD_DAY], status->drying.rate[DRYING_PERIOD_NIGHT]);
+    }
 }
 
 /**
@@ -389,6 +428,7 @@ static void status_analysis_task(void *pvParameters) {
             // データ取得失敗またはデータが無効な場合
             ESP_LOGW(TAG, "最新センサーデータの取得に失敗、またはデータが無効です");
             status.plant_condition = ERROR_CONDITION;
+            status.drying.hours_until_dry = -1.0f;
             // display_dataはゼロのまま
         }
 
@@ -452,6 +492,13 @@ static void status_analysis_task(void *pvParameters) {
         }
 #endif
 
+        // 計測が止まったまま残った古いデータの削除は、1分リングのライターであるセンサー読み取りタスクに依頼する
+        if (analysis_count % DATA_CLEANUP_INTERVAL == 0 && g_sensor_task_handle != NULL) {
+            xTaskNotify(g_sensor_task_handle, SENSOR_NOTIFY_CLEANUP, eSetBits);
+        }
+
+        ESP_LOGD(TAG, "analysis_task stack high water mark: %u bytes",
+                 (unsigned)uxTaskGetStackHighWaterMark(NULL));
         vTaskDelay(pdMS_TO_TICKS(60000)); // 1分待機
     }
 }
@@ -663,8 +710,8 @@ static esp_err_t system_init(void) {
     log_plant_profile();
 
     // WiFiと時刻同期の初期化は後で行う（BLEの後）
+    // データバッファは plant_manager_init() 内で初期化・履歴復元済み
 
-    data_buffer_init();
     return ESP_OK;
 }
 
@@ -675,8 +722,10 @@ void app_main(void) {
     ESP_ERROR_CHECK(system_init());
 
     // BLE初期化を最優先で実行（WiFiと電源管理より前）
+    g_flush_done = xSemaphoreCreateBinary();
     esp_err_t ble_ret = ble_manager_init();
     if (ble_ret == ESP_OK) {
+        ble_manager_set_flush_callback(flush_history_on_sensor_task);
         nimble_port_freertos_init(ble_host_task);
         ESP_LOGI(TAG, "✅ BLE initialized and host task started successfully");
     } else {
@@ -705,14 +754,21 @@ void app_main(void) {
     ESP_LOGI(TAG, "ℹ️  WiFi機能は無効化されています (CONFIG_WIFI_ENABLED=0)");
 #endif
 
-    xTaskCreate(sensor_read_task, "sensor_read", 4096, NULL, 5, &g_sensor_task_handle);
-    xTaskCreate(status_analysis_task, "analysis_task", 8192, NULL, 4, &g_analysis_task_handle);
+    // 1分データの格納・履歴ログの書き込み・ストリーム検出・ルール評価と乾燥予測はこのタスクで動く。
+    // ホストの -fstack-usage で自前の関数の最深経路は約1.8KB（process_sensor_data → add_minute_data → 日の確定）。
+    // 末端のフラッシュ書き込みか浮動小数点のログ書式化（各2KB弱と見積もり）を足して4KB前後のため、
+    // 2KBの余裕を残して6144とする（ハイウォーターマークをデバッグログに出す）
+    xTaskCreate(sensor_read_task, "sensor_read", 6144, NULL, 5, &g_sensor_task_handle);
+    // 評価済みの状態と乾燥予測の取得・イベントの書き出し・ログ出力。ホストの -fstack-usage で自前の関数の最深経路は
+    // 約0.8KB（print_status / determine_status）。NVSへのイベントログ保存か浮動小数点のログ書式化（各2KB弱と見積もり）を足しても
+    // 3KB前後のため、2KB以上の余裕を残して6144とする（ハイウォーターマークをデバッグログに出す）
+    xTaskCreate(status_analysis_task, "analysis_task", 6144, NULL, 4, &g_analysis_task_handle);
 
     g_notify_timer = xTimerCreate("notify_timer", pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS), pdTRUE, NULL, notify_timer_callback);
     xTimerStart(g_notify_timer, 0);
 
     // 起動直後に初回センサ読み取りを実行
-    xTaskNotifyGive(g_sensor_task_handle);
+    xTaskNotify(g_sensor_task_handle, SENSOR_NOTIFY_MEASURE, eSetBits);
 
     ESP_LOGI(TAG, "Initialization complete.");
 }
\ No newline at end of file
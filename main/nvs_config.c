@@ -2,15 +2,21 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include "components/plant_logic/data_buffer.h"
 #include <string.h>
+#include <stdio.h>
 
 static const char *TAG = "NVS_Config";
 
 // NVSキー定義
 #define NVS_NAMESPACE "plant_config"
-#define NVS_KEY_PROFILE "profile"
+#define NVS_KEY_PROFILE "profile"            // 旧形式の単一プロファイル（起動時にライブラリのスロット0へ移す）
+#define NVS_KEY_PROFILE_SLOT "prof_%02u"     // ライブラリのスロット（plant_profile_t）
+#define NVS_KEY_PROFILE_ACTIVE "prof_active"  // アクティブのスロット番号（uint8_t）
 #define NVS_KEY_WIFI "wifi_config"
 #define NVS_KEY_TIMEZONE "timezone"
+#define NVS_KEY_EVENTS "events"
+#define NVS_KEY_RULES "rules"
 
 /**
  * デフォルトの植物プロファイル設定（多肉植物向け）
@@ -36,15 +42,152 @@ void nvs_config_set_default_plant_profile(plant_profile_t *profile) {
     // 灌水検出閾値
     profile->watering_threshold = WATERING_DETECTION_THRESHOLD;
 
+    // 間引き記録: ゆっくり変化する土壌温度のみ
+    memset(profile->archive_error, 0, sizeof(profile->archive_error));
+    profile->archive_error[DATA_BUFFER_FIELD_SOIL_TEMPERATURE] = ARCHIVE_SOIL_TEMP_ERROR;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    profile->archive_error[DATA_BUFFER_FIELD_SOIL_TEMPERATURE2] = ARCHIVE_SOIL_TEMP_ERROR;
+    profile->archive_error[DATA_BUFFER_FIELD_SOIL_TEMPERATURE3] = ARCHIVE_SOIL_TEMP_ERROR;
+    profile->archive_error[DATA_BUFFER_FIELD_SOIL_TEMPERATURE4] = ARCHIVE_SOIL_TEMP_ERROR;
+#endif
+
     ESP_LOGI(TAG, "Default plant profile set for: %s", profile->plant_name);
 }
 
 /**
- * 植物プロファイルをNVSに保存
+ * スロットのNVSキーを作る
  */
-esp_err_t nvs_config_save_plant_profile(const plant_profile_t *profile) {
-    if (profile == NULL) {
-        ESP_LOGE(TAG, "Profile pointer is NULL");
+static void make_profile_slot_key(uint8_t index, char *key, size_t key_size) {
+    snprintf(key, key_size, NVS_KEY_PROFILE_SLOT, (unsigned)index);
+}
+
+/**
+ * プロファイルのレコードを読み込む（サイズの違うレコードは profile_library_decode で変換）
+ */
+static esp_err_t read_profile_record(nvs_handle_t nvs_handle, const char *key, const plant_profile_t *defaults, plant_profile_t *profile) {
+    size_t size = 0;
+    esp_err_t err = nvs_get_blob(nvs_handle, key, NULL, &size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (size > PROFILE_RECORD_MAX_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t record[PROFILE_RECORD_MAX_SIZE];
+    err = nvs_get_blob(nvs_handle, key, record, &size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (size != sizeof(plant_profile_t)) {
+        ESP_LOGW(TAG, "Profile record %s has %zu bytes (current %zu), converting", key, size, sizeof(plant_profile_t));
+    }
+    return profile_library_decode(record, size, defaults, profile);
+}
+
+/**
+ * プロファイルのライブラリをNVSから読み込み
+ */
+esp_err_t nvs_config_load_profile_library(profile_library_t *library) {
+    if (library == NULL) {
+        ESP_LOGE(TAG, "Profile library pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    plant_profile_t defaults;
+    nvs_config_set_default_plant_profile(&defaults);
+    profile_library_init(library);
+
+    // NVSハンドルを開く（旧形式の移行と既定値の保存があるため読み書き）
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        ESP_LOGW(TAG, "Using default profile due to NVS error");
+        profile_library_put(library, 0, &defaults);
+        profile_library_select(library, 0);
+        return ESP_OK;
+    }
+
+    // 全スロットを1回で読み込む（読めないスロットは空として扱う）
+    for (uint8_t i = 0; i < PROFILE_LIBRARY_SLOTS; i++) {
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        plant_profile_t profile;
+        make_profile_slot_key(i, key, sizeof(key));
+        err = read_profile_record(nvs_handle, key, &defaults, &profile);
+        if (err == ESP_OK) {
+            profile_library_put(library, i, &profile);
+        } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Skipping profile slot %u: %s", i, esp_err_to_name(err));
+        }
+    }
+
+    bool dirty = false;
+    if (library->used_mask == 0) {
+        // 旧形式の単一プロファイルをスロット0へ移す（なければ既定値）
+        plant_profile_t profile;
+        if (read_profile_record(nvs_handle, NVS_KEY_PROFILE, &defaults, &profile) == ESP_OK) {
+            ESP_LOGI(TAG, "Migrating plant profile to library slot 0: %s", profile.plant_name);
+        } else {
+            ESP_LOGW(TAG, "Plant profile not found in NVS, using default values");
+            profile = defaults;
+        }
+        profile_library_put(library, 0, &profile);
+
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        make_profile_slot_key(0, key, sizeof(key));
+        err = nvs_set_blob(nvs_handle, key, &profile, sizeof(plant_profile_t));
+        if (err == ESP_OK) {
+            nvs_erase_key(nvs_handle, NVS_KEY_PROFILE);
+            dirty = true;
+        } else {
+            ESP_LOGW(TAG, "Failed to save profile slot 0: %s", esp_err_to_name(err));
+        }
+    }
+
+    // アクティブのスロット（未保存・空のスロットを指す時は最も小さい番号のスロット）
+    uint8_t active = PROFILE_LIBRARY_NONE;
+    nvs_get_u8(nvs_handle, NVS_KEY_PROFILE_ACTIVE, &active);
+    if (profile_library_select(library, active) != ESP_OK) {
+        for (uint8_t i = 0; i < PROFILE_LIBRARY_SLOTS; i++) {
+            if (profile_library_select(library, i) == ESP_OK) {
+                break;
+            }
+        }
+        if (nvs_set_u8(nvs_handle, NVS_KEY_PROFILE_ACTIVE, library->active) == ESP_OK) {
+            dirty = true;
+        }
+    }
+
+    if (dirty) {
+        err = nvs_commit(nvs_handle);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Error committing NVS: %s", esp_err_to_name(err));
+        }
+    }
+    nvs_close(nvs_handle);
+
+    const plant_profile_t *profile = profile_library_get(library, library->active);
+    ESP_LOGI(TAG, "Profile library loaded: slots 0x%04x, active %u", library->used_mask, library->active);
+    ESP_LOGI(TAG, "Plant profile loaded successfully: %s", profile->plant_name);
+    ESP_LOGI(TAG, "Soil: Dry >= %.0fmV, Wet <= %.0fmV, Watering after %d dry days",
+                profile->soil_dry_threshold,
+                profile->soil_wet_threshold,
+                profile->soil_dry_days_for_watering);
+    ESP_LOGI(TAG, "Temp Limits: High >= %.1f C, Low <= %.1f C",
+                profile->temp_high_limit,
+                profile->temp_low_limit);
+    ESP_LOGI(TAG, "Watering Detection: %.2f decrease threshold",
+                profile->watering_threshold);
+    return ESP_OK;
+}
+
+/**
+ * 植物プロファイルをライブラリのスロットに保存
+ */
+esp_err_t nvs_config_save_profile_slot(uint8_t index, const plant_profile_t *profile) {
+    if (profile == NULL || index >= PROFILE_LIBRARY_SLOTS) {
+        ESP_LOGE(TAG, "Invalid profile slot %u", index);
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -59,7 +202,9 @@ esp_err_t nvs_config_save_plant_profile(const plant_profile_t *profile) {
     }
 
     // プロファイルをblobとして保存
-    err = nvs_set_blob(nvs_handle, NVS_KEY_PROFILE, profile, sizeof(plant_profile_t));
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    make_profile_slot_key(index, key, sizeof(key));
+    err = nvs_set_blob(nvs_handle, key, profile, sizeof(plant_profile_t));
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error saving plant profile: %s", esp_err_to_name(err));
         nvs_close(nvs_handle);
@@ -71,7 +216,7 @@ esp_err_t nvs_config_save_plant_profile(const plant_profile_t *profile) {
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error committing NVS: %s", esp_err_to_name(err));
     } else {
-        ESP_LOGI(TAG, "Plant profile saved successfully: %s", profile->plant_name);
+        ESP_LOGI(TAG, "Plant profile saved successfully to slot %u: %s", index, profile->plant_name);
     }
 
     nvs_close(nvs_handle);
@@ -79,73 +224,65 @@ esp_err_t nvs_config_save_plant_profile(const plant_profile_t *profile) {
 }
 
 /**
- * 植物プロファイルをNVSから読み込み
+ * ライブラリのスロットをNVSから削除
  */
-esp_err_t nvs_config_load_plant_profile(plant_profile_t *profile) {
-    if (profile == NULL) {
-        ESP_LOGE(TAG, "Profile pointer is NULL");
+esp_err_t nvs_config_erase_profile_slot(uint8_t index) {
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        ESP_LOGE(TAG, "Invalid profile slot %u", index);
         return ESP_ERR_INVALID_ARG;
     }
 
     nvs_handle_t nvs_handle;
-    esp_err_t err;
-    size_t required_size = sizeof(plant_profile_t);
-
-    // NVSハンドルを開く（読み取り専用）
-    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGW(TAG, "NVS partition not found, creating with default profile");
-        nvs_config_set_default_plant_profile(profile);
-        esp_err_t save_err = nvs_config_save_plant_profile(profile);
-        if (save_err != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to save default profile, continuing with defaults");
-        }
-        return ESP_OK;
-    } else if (err != ESP_OK) {
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        ESP_LOGW(TAG, "Using default profile due to NVS error");
-        nvs_config_set_default_plant_profile(profile);
-        return ESP_OK;
+        return err;
     }
 
-    // プロファイルをblobとして読み込み
-    err = nvs_get_blob(nvs_handle, NVS_KEY_PROFILE, profile, &required_size);
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    make_profile_slot_key(index, key, sizeof(key));
+    err = nvs_erase_key(nvs_handle, key);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error erasing profile slot %u: %s", index, esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Profile slot %u erased", index);
+    }
 
-    if (err == ESP_ERR_NVS_NOT_FOUND || required_size != sizeof(plant_profile_t)) {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
-            ESP_LOGW(TAG, "Plant profile not found in NVS, using default values");
-        } else {
-            ESP_LOGE(TAG, "Profile size mismatch. Expected: %zu, Got: %zu. Using defaults.", sizeof(plant_profile_t), required_size);
-        }
-        nvs_close(nvs_handle);
+    nvs_close(nvs_handle);
+    return err;
+}
 
-        nvs_config_set_default_plant_profile(profile);
-        esp_err_t save_err = nvs_config_save_plant_profile(profile);
-        if (save_err != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to save default profile to NVS: %s", esp_err_to_name(save_err));
-        }
-        return ESP_OK;
-    } else if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error reading plant profile: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        ESP_LOGW(TAG, "Using default profile due to read error");
-        nvs_config_set_default_plant_profile(profile);
-        return ESP_OK;
+/**
+ * アクティブのスロット番号をNVSに保存（プロファイルのレコードは書き換えない）
+ */
+esp_err_t nvs_config_save_active_profile(uint8_t index) {
+    if (index >= PROFILE_LIBRARY_SLOTS) {
+        ESP_LOGE(TAG, "Invalid profile slot %u", index);
+        return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "Plant profile loaded successfully: %s", profile->plant_name);
-    ESP_LOGI(TAG, "Soil: Dry >= %.0fmV, Wet <= %.0fmV, Watering after %d dry days",
-                profile->soil_dry_threshold,
-                profile->soil_wet_threshold,
-                profile->soil_dry_days_for_watering);
-    ESP_LOGI(TAG, "Temp Limits: High >= %.1f C, Low <= %.1f C",
-                profile->temp_high_limit,
-                profile->temp_low_limit);
-    ESP_LOGI(TAG, "Watering Detection: %.2f decrease threshold",
-                profile->watering_threshold);
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_u8(nvs_handle, NVS_KEY_PROFILE_ACTIVE, index);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving active profile: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Active profile slot saved: %u", index);
+    }
 
     nvs_close(nvs_handle);
-    return ESP_OK;
+    return err;
 }
 
 /**
@@ -315,3 +452,175 @@ esp_err_t nvs_config_load_timezone(char *timezone, size_t max_len) {
     nvs_close(nvs_handle);
     return ESP_OK;
 }
+
+/**
+ * イベント表をNVSに保存
+ */
+esp_err_t nvs_config_save_event_log(const event_log_table_t *table) {
+    if (table == NULL) {
+        ESP_LOGE(TAG, "Event log pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+
+    // NVSハンドルを開く
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // イベント表をblobとして保存
+    err = nvs_set_blob(nvs_handle, NVS_KEY_EVENTS, table, sizeof(event_log_table_t));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving event log: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+
+    // 変更をコミット
+    err = nvs_commit(nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error committing NVS: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGD(TAG, "Event log saved successfully: %u events", table->count);
+    }
+
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * イベント表をNVSから読み込み
+ */
+esp_err_t nvs_config_load_event_log(event_log_table_t *table) {
+    if (table == NULL) {
+        ESP_LOGE(TAG, "Event log pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+    size_t required_size = sizeof(event_log_table_t);
+
+    // NVSハンドルを開く（読み取り専用）
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "NVS partition not found for event log");
+        } else {
+            ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        }
+        return err;
+    }
+
+    // イベント表をblobとして読み込み
+    err = nvs_get_blob(nvs_handle, NVS_KEY_EVENTS, table, &required_size);
+
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "Event log not found in NVS");
+        nvs_close(nvs_handle);
+        return err;
+    } else if (required_size != sizeof(event_log_table_t)) {
+        ESP_LOGE(TAG, "Event log size mismatch. Expected: %zu, Got: %zu", sizeof(event_log_table_t), required_size);
+        nvs_close(nvs_handle);
+        return ESP_ERR_INVALID_SIZE;
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error reading event log: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Event log loaded successfully: %u events", table->count);
+
+    nvs_close(nvs_handle);
+    return ESP_OK;
+}
+
+/**
+ * 状態判定のルールの表をNVSに保存
+ */
+esp_err_t nvs_config_save_rule_set(const rule_set_t *rules) {
+    if (rules == NULL) {
+        ESP_LOGE(TAG, "Rule set pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+
+    // NVSハンドルを開く
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // ルールの表をblobとして保存
+    err = nvs_set_blob(nvs_handle, NVS_KEY_RULES, rules, sizeof(rule_set_t));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving rule set: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+
+    // 変更をコミット
+    err = nvs_commit(nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error committing NVS: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Rule set saved successfully: %u rules", rules->count);
+    }
+
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * 状態判定のルールの表をNVSから読み込み
+ */
+esp_err_t nvs_config_load_rule_set(rule_set_t *rules) {
+    if (rules == NULL) {
+        ESP_LOGE(TAG, "Rule set pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err;
+    size_t required_size = sizeof(rule_set_t);
+
+    // NVSハンドルを開く（読み取り専用）
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "NVS partition not found for rule set");
+        } else {
+            ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        }
+        return err;
+    }
+
+    // ルールの表をblobとして読み込み
+    err = nvs_get_blob(nvs_handle, NVS_KEY_RULES, rules, &required_size);
+
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "Rule set not found in NVS");
+        nvs_close(nvs_handle);
+        return err;
+    } else if (required_size != sizeof(rule_set_t)) {
+        ESP_LOGE(TAG, "Rule set size mismatch. Expected: %zu, Got: %zu", sizeof(rule_set_t), required_size);
+        nvs_close(nvs_handle);
+        return ESP_ERR_INVALID_SIZE;
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error reading rule set: %s", esp_err_to_name(err));
+        nvs_close(nvs_handle);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Rule set loaded successfully: %u rules", rules->count);
+
+    nvs_close(nvs_handle);
+    return ESP_OK;
+}
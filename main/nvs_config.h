@@ -2,6 +2,8 @@
 
 #include "esp_err.h"
 #include "components/plant_logic/plant_manager.h"
+#include "components/plant_logic/event_log.h"
+#include "components/plant_logic/profile_library.h"
 #include "esp_wifi.h"
 
 #ifdef __cplusplus
@@ -15,18 +17,35 @@ extern "C" {
 esp_err_t nvs_config_init(void);
 
 /**
- * 植物プロファイルをNVSに保存
+ * プロファイルのライブラリをNVSから読み込み（全スロットを1回で読み込む）
+ * 旧形式の単一プロファイルはスロット0へ移し、何もない時は既定のプロファイルをスロット0に保存する。
+ * サイズの違うレコードは先頭部分を使い、足りないフィールドだけ既定値で補う。
+ * @param library 読み込み先（アクティブのスロットは必ずある）
+ * @return ESP_OK on success（NVSを開けない時も既定のプロファイルで ESP_OK）
+ */
+esp_err_t nvs_config_load_profile_library(profile_library_t *library);
+
+/**
+ * 植物プロファイルをライブラリのスロットに保存
+ * @param index スロット番号
  * @param profile 保存する植物プロファイル
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if index is out of range
  */
-esp_err_t nvs_config_save_plant_profile(const plant_profile_t *profile);
+esp_err_t nvs_config_save_profile_slot(uint8_t index, const plant_profile_t *profile);
 
 /**
- * 植物プロファイルをNVSから読み込み
- * @param profile 読み込み先の植物プロファイル
+ * ライブラリのスロットをNVSから削除
+ * @param index スロット番号
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if the slot is not saved
+ */
+esp_err_t nvs_config_erase_profile_slot(uint8_t index);
+
+/**
+ * アクティブのスロット番号をNVSに保存（プロファイルのレコードは書き換えない）
+ * @param index スロット番号
  * @return ESP_OK on success
  */
-esp_err_t nvs_config_load_plant_profile(plant_profile_t *profile);
+esp_err_t nvs_config_save_active_profile(uint8_t index);
 
 /**
  * デフォルトの植物プロファイル設定（多肉植物向け）
@@ -63,6 +82,34 @@ esp_err_t nvs_config_save_timezone(const char *timezone);
  */
 esp_err_t nvs_config_load_timezone(char *timezone, size_t max_len);
 
+/**
+ * イベント表をNVSに保存
+ * @param table 保存するイベント表
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_config_save_event_log(const event_log_table_t *table);
+
+/**
+ * イベント表をNVSから読み込み
+ * @param table 読み込み先のイベント表
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, ESP_ERR_INVALID_SIZE if the saved size differs
+ */
+esp_err_t nvs_config_load_event_log(event_log_table_t *table);
+
+/**
+ * 状態判定のルールの表をNVSに保存
+ * @param rules ルールの表
+ * @return ESP_OK on success
+ */
+esp_err_t nvs_config_save_rule_set(const rule_set_t *rules);
+
+/**
+ * 状態判定のルールの表をNVSから読み込み
+ * @param rules 読み込み先
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, ESP_ERR_INVALID_SIZE if the saved size differs
+ */
+esp_err_t nvs_config_load_rule_set(rule_set_t *rules);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "esp_cpu.h"
+
+// data_buffer_get_stats のコスト比較（旧: レコード毎にmktime / 新: エポック分で比較）
+// ホストではesp_cpu_get_cycle_countスタブがナノ秒を返す
+
+#define ITERATIONS 50
+
+// 旧実装の再現: 1440件の minute_data_t と30日分のサマリーを mktime で比較
+static minute_data_t g_legacy_minutes[DATA_BUFFER_MINUTES_PER_DAY];
+static daily_summary_data_t g_legacy_daily[DATA_BUFFER_DAYS_PER_MONTH];
+
+static void legacy_get_stats(data_buffer_stats_t *stats) {
+    memset(stats, 0, sizeof(data_buffer_stats_t));
+    time_t oldest_minute = 0, newest_minute = 0;
+    time_t oldest_daily = 0, newest_daily = 0;
+
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (g_legacy_minutes[i].valid) {
+            stats->minute_data_count++;
+            time_t data_time = mktime(&g_legacy_minutes[i].timestamp);
+            if (oldest_minute == 0 || data_time < oldest_minute) {
+                oldest_minute = data_time;
+                stats->oldest_minute_data = g_legacy_minutes[i].timestamp;
+            }
+            if (newest_minute == 0 || data_time > newest_minute) {
+                newest_minute = data_time;
+                stats->newest_minute_data = g_legacy_minutes[i].timestamp;
+            }
+        }
+    }
+    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
+        if (g_legacy_daily[i].complete) {
+            stats->daily_data_count++;
+            time_t data_time = mktime(&g_legacy_daily[i].date);
+            if (oldest_daily == 0 || data_time < oldest_daily) {
+                oldest_daily = data_time;
+                stats->oldest_daily_data = g_legacy_daily[i].date;
+            }
+            if (newest_daily == 0 || data_time > newest_daily) {
+                newest_daily = data_time;
+                stats->newest_daily_data = g_legacy_daily[i].date;
+            }
+        }
+    }
+}
+
+static void bench_get_stats(void) {
+    struct tm start_tm = test_make_tm(2025, 3, 1, 0, 0);
+    time_t start = mktime(&start_tm);
+    int total = DATA_BUFFER_MINUTE_CAPACITY;
+
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < total; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, start + i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        time_t t = start + (time_t)(total - DATA_BUFFER_MINUTES_PER_DAY + i) * 60;
+        localtime_r(&t, &g_legacy_minutes[i].timestamp);
+        g_legacy_minutes[i].valid = true;
+    }
+    for (int i = 0; i < DATA_BUFFER_DAYS_PER_MONTH; i++) {
+        time_t t = start + (time_t)i * 86400;
+        localtime_r(&t, &g_legacy_daily[i].date);
+        g_legacy_daily[i].complete = true;
+    }
+
+    data_buffer_stats_t legacy, stats;
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < ITERATIONS; i++) {
+        legacy_get_stats(&legacy);
+    }
+    uint32_t c1 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < ITERATIONS; i++) {
+        CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    }
+    uint32_t c2 = esp_cpu_get_cycle_count();
+
+    printf("  legacy get_stats (mktime per record, %d minutes): %lu ns/call\n",
+           DATA_BUFFER_MINUTES_PER_DAY, (unsigned long)((c1 - c0) / ITERATIONS));
+    printf("  epoch  get_stats (%d minutes):                    %lu ns/call\n",
+           total, (unsigned long)((c2 - c1) / ITERATIONS));
+
+    // 範囲の結果が正しいこと
+    CHECK(stats.minute_data_count == total);
+    CHECK(mktime(&stats.oldest_minute_data) == start);
+    CHECK(mktime(&stats.newest_minute_data) == start + (time_t)(total - 1) * 60);
+    CHECK(stats.daily_data_count == total / DATA_BUFFER_MINUTES_PER_DAY);
+    CHECK(stats.oldest_daily_data.tm_mday == 1 &&
+          stats.newest_daily_data.tm_mday == total / DATA_BUFFER_MINUTES_PER_DAY);
+}
+
+static void test_recent_minutes_ordered(void) {
+    // 過去1時間の取得結果は古い順・最大60件で、最新データを含む
+    time_t now = time(NULL) / 60 * 60;
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 180; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, now - (time_t)(179 - i) * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+
+    minute_data_t hour_data[60];
+    uint16_t count = 0;
+    CHECK(data_buffer_get_recent_minute_data(1, hour_data, &count) == ESP_OK);
+    CHECK(count == 60);
+    CHECK(mktime(&hour_data[count - 1].timestamp) == now);
+    for (int i = 1; i < count; i++) {
+        CHECK(mktime(&hour_data[i].timestamp) - mktime(&hour_data[i - 1].timestamp) == 60);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_recent_minutes_ordered);
+    RUN_TEST(bench_get_stats);
+    return TEST_RESULT();
+}
@@ -0,0 +1,343 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+#include "minute_codec.h"
+#include "esp_cpu.h"
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 1分データ圧縮ブロック（minute_codec）の可逆性・ブロック単独デコード・圧縮率とコスト
+// Rev4 (HARDWARE_VERSION=40) のデータ形式でビルドする
+//
+//   bench_minute_codec [day.csv]
+//   CSV: unix_time,temperature,humidity,lux,cap0,cap1,cap2,cap3,soil_t0,soil_t1,soil_t2,soil_t3,ext_temp
+//   （1行1分、ヘッダー行なし）。省略時はRev4の1日分の計測を模したデータを生成する
+
+#define DAY_SAMPLES         DATA_BUFFER_MINUTES_PER_DAY
+#define BLE_BLOCK_SIZE      (256 - 5)   // BLE_RESPONSE_BUFFER_SIZE - レスポンスヘッダー
+#define RAM_BLOCK_SIZE      4096
+#define ITERATIONS          20
+
+static soil_data_t g_day[DAY_SAMPLES];
+static minute_record_t g_records[DAY_SAMPLES];
+static uint32_t g_minutes[DAY_SAMPLES];
+static int g_sample_count = 0;
+static uint8_t g_blocks[DAY_SAMPLES * sizeof(minute_record_t) * 2];
+
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+}
+
+static inline uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// 再現性のある擬似乱数（xorshift32）と近似正規乱数
+static uint32_t g_rng = 0x12345678u;
+static float rand_uniform(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return (g_rng >> 8) / 16777216.0f;
+}
+static float rand_noise(float sigma) {
+    return (rand_uniform() + rand_uniform() + rand_uniform() - 1.5f) * 2.0f * sigma;
+}
+
+static float quantize(float value, float step) {
+    return roundf(value / step) * step;
+}
+
+/**
+ * Rev4の1日分の計測を模したデータを生成
+ * 気温/湿度は日周変化 + SHT40相当のノイズ、照度は日中のみ雲による揺らぎあり、
+ * 静電容量は乾燥による漸減と朝の灌水による上昇 + FDC1004相当のノイズ、
+ * 土壌温度は深さに応じて振幅が小さく遅れる日周変化（TMP102/DS18B20の1/16℃分解能）
+ */
+static void generate_rev4_day(time_t start) {
+    float cloud = 1.0f;
+    for (int i = 0; i < DAY_SAMPLES; i++) {
+        soil_data_t *d = &g_day[i];
+        memset(d, 0, sizeof(*d));
+        time_t t = start + (time_t)i * 60;
+        localtime_r(&t, &d->datetime);
+
+        float hour = i / 60.0f;
+        float phase = (hour - 9.0f) / 24.0f * 2.0f * (float)M_PI;
+        d->temperature = quantize(21.0f + 6.0f * sinf(phase) + rand_noise(0.03f), 0.01f);
+        d->humidity = quantize(58.0f - 14.0f * sinf(phase) + rand_noise(0.15f), 0.01f);
+
+        cloud += rand_noise(0.02f);
+        if (cloud < 0.3f) cloud = 0.3f;
+        if (cloud > 1.0f) cloud = 1.0f;
+        float sun = sinf((hour - 5.5f) / 13.0f * (float)M_PI);
+        d->lux = (sun > 0.0f) ? quantize(42000.0f * sun * sun * cloud, 0.5f) : 0.0f;
+
+        float watering = (hour >= 8.0f) ? 1.6f * expf(-(hour - 8.0f) / 3.0f) : 0.0f;
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            float base = 6.5f + c * 0.8f - 0.25f * hour / 24.0f;
+            d->soil_moisture_capacitance[c] = base + watering * (1.0f - c * 0.2f) + rand_noise(0.002f);
+            if (c == 0 || d->soil_moisture_capacitance[c] > d->soil_moisture) {
+                d->soil_moisture = d->soil_moisture_capacitance[c];
+            }
+        }
+
+        d->soil_temperature_count = TMP102_MAX_DEVICES;
+        for (int c = 0; c < TMP102_MAX_DEVICES; c++) {
+            float depth_phase = phase - c * 0.35f;
+            d->soil_temperature[c] = quantize(19.0f + (3.0f - c * 0.6f) * sinf(depth_phase) + rand_noise(0.02f), 0.0625f);
+        }
+        d->ext_temperature_valid = true;
+        d->ext_temperature = quantize(d->temperature + 0.4f + rand_noise(0.03f), 0.0625f);
+    }
+    g_sample_count = DAY_SAMPLES;
+}
+
+static bool load_csv(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("  cannot open %s\n", path);
+        return false;
+    }
+    char line[512];
+    g_sample_count = 0;
+    while (g_sample_count < DAY_SAMPLES && fgets(line, sizeof(line), fp) != NULL) {
+        soil_data_t *d = &g_day[g_sample_count];
+        memset(d, 0, sizeof(*d));
+        long long unix_time;
+        float *cap = d->soil_moisture_capacitance, *st = d->soil_temperature;
+        int n = sscanf(line, "%lld,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &unix_time,
+                       &d->temperature, &d->humidity, &d->lux, &cap[0], &cap[1], &cap[2], &cap[3],
+                       &st[0], &st[1], &st[2], &st[3], &d->ext_temperature);
+        if (n != 13) {
+            continue;
+        }
+        time_t t = (time_t)unix_time;
+        localtime_r(&t, &d->datetime);
+        d->soil_temperature_count = TMP102_MAX_DEVICES;
+        d->ext_temperature_valid = true;
+        d->soil_moisture = cap[0];
+        for (int c = 1; c < FDC1004_CHANNEL_COUNT; c++) {
+            if (cap[c] > d->soil_moisture) d->soil_moisture = cap[c];
+        }
+        g_sample_count++;
+    }
+    fclose(fp);
+    printf("  loaded %d samples from %s\n", g_sample_count, path);
+    return g_sample_count > 0;
+}
+
+/**
+ * センサーデータをパック形式に変換（data_buffer_add_minute_data と同じ経路）
+ */
+static void pack_day(void) {
+    for (int i = 0; i < g_sample_count; i++) {
+        const soil_data_t *d = &g_day[i];
+        minute_data_t md;
+        memset(&md, 0, sizeof(md));
+        md.temperature = d->temperature;
+        md.humidity = d->humidity;
+        md.lux = d->lux;
+        md.soil_moisture = d->soil_moisture;
+        md.soil_temperature_count = d->soil_temperature_count;
+        for (int c = 0; c < TMP102_MAX_DEVICES; c++) md.soil_temperature[c] = d->soil_temperature[c];
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) md.soil_moisture_capacitance[c] = d->soil_moisture_capacitance[c];
+        md.ext_temperature = d->ext_temperature;
+        md.ext_temperature_valid = d->ext_temperature_valid;
+        minute_record_encode(&md, 0, &g_records[i]);
+        g_minutes[i] = (uint32_t)(mktime((struct tm *)&d->datetime) / 60);
+    }
+}
+
+typedef struct {
+    int block_count;
+    size_t total_bytes;
+    uint16_t offsets[DAY_SAMPLES + 1];
+    uint16_t sizes[DAY_SAMPLES + 1];
+} encoded_day_t;
+
+static void encode_day(uint16_t block_size, encoded_day_t *out) {
+    minute_codec_encoder_t enc;
+    size_t offset = 0;
+    out->block_count = 0;
+    minute_codec_encoder_init(&enc, g_blocks, block_size);
+    for (int i = 0; i < g_sample_count; i++) {
+        if (minute_codec_encoder_add(&enc, g_minutes[i], &g_records[i]) != ESP_OK) {
+            uint16_t size = minute_codec_encoder_finish(&enc);
+            out->offsets[out->block_count] = (uint16_t)offset;
+            out->sizes[out->block_count++] = size;
+            offset += size;
+            minute_codec_encoder_init(&enc, g_blocks + offset, block_size);
+            minute_codec_encoder_add(&enc, g_minutes[i], &g_records[i]);
+        }
+    }
+    uint16_t size = minute_codec_encoder_finish(&enc);
+    out->offsets[out->block_count] = (uint16_t)offset;
+    out->sizes[out->block_count++] = size;
+    out->total_bytes = offset + size;
+}
+
+/**
+ * ブロックを1つずつ（逆順に）デコードして元のレコードと比較
+ */
+static int decode_and_verify(const encoded_day_t *enc) {
+    int decoded = 0;
+    for (int b = enc->block_count - 1; b >= 0; b--) {
+        minute_codec_decoder_t dec;
+        CHECK(minute_codec_decoder_init(&dec, g_blocks + enc->offsets[b], enc->sizes[b]) == ESP_OK);
+
+        // ブロック先頭のサンプル番号
+        minute_codec_header_t header;
+        memcpy(&header, g_blocks + enc->offsets[b], sizeof(header));
+        int index = 0;
+        while (index < g_sample_count && g_minutes[index] != header.first_minute) index++;
+
+        uint32_t minute;
+        minute_record_t rec;
+        while (minute_codec_decoder_next(&dec, &minute, &rec) == ESP_OK) {
+            CHECK(index < g_sample_count);
+            if (index >= g_sample_count) break;
+            CHECK(minute == g_minutes[index]);
+            CHECK(memcmp(&rec, &g_records[index], sizeof(minute_record_t)) == 0);
+            index++;
+            decoded++;
+        }
+    }
+    return decoded;
+}
+
+static void test_roundtrip_and_ratio(void) {
+    size_t legacy_bytes = sizeof(minute_data_t) * (size_t)g_sample_count;
+    size_t packed_bytes = sizeof(minute_record_t) * (size_t)g_sample_count;
+    printf("  samples: %d, minute_data_t %zu bytes, minute_record_t %zu bytes\n",
+           g_sample_count, legacy_bytes, packed_bytes);
+
+    uint16_t block_sizes[] = { BLE_BLOCK_SIZE, RAM_BLOCK_SIZE };
+    for (size_t s = 0; s < sizeof(block_sizes) / sizeof(block_sizes[0]); s++) {
+        static encoded_day_t enc;
+        encode_day(block_sizes[s], &enc);
+        CHECK(decode_and_verify(&enc) == g_sample_count);
+
+        // エンコード/デコードのコスト
+        uint64_t c0 = read_cycles(), n0 = read_ns();
+        for (int it = 0; it < ITERATIONS; it++) {
+            encode_day(block_sizes[s], &enc);
+        }
+        uint64_t c1 = read_cycles(), n1 = read_ns();
+        for (int it = 0; it < ITERATIONS; it++) {
+            for (int b = 0; b < enc.block_count; b++) {
+                minute_codec_decoder_t dec;
+                uint32_t minute;
+                minute_record_t rec;
+                minute_codec_decoder_init(&dec, g_blocks + enc.offsets[b], enc.sizes[b]);
+                while (minute_codec_decoder_next(&dec, &minute, &rec) == ESP_OK) {
+                }
+            }
+        }
+        uint64_t c2 = read_cycles(), n2 = read_ns();
+        double samples = (double)g_sample_count * ITERATIONS;
+
+        printf("  block %4u bytes: %d blocks, %zu bytes (%.2f bytes/sample)\n",
+               block_sizes[s], enc.block_count, enc.total_bytes, (double)enc.total_bytes / g_sample_count);
+        printf("    ratio vs minute_data_t %.1fx, vs minute_record_t %.2fx\n",
+               (double)legacy_bytes / enc.total_bytes, (double)packed_bytes / enc.total_bytes);
+        printf("    encode %.0f cycles/sample (%.0f ns), decode %.0f cycles/sample (%.0f ns)\n",
+               (c1 - c0) / samples, (n1 - n0) / samples, (c2 - c1) / samples, (n2 - n1) / samples);
+
+        CHECK(enc.total_bytes * 2 < packed_bytes);
+    }
+}
+
+static void test_irregular_timestamps(void) {
+    // 欠測・時刻の巻き戻り・長時間の空白を含む系列も可逆に復元できる
+    uint32_t minutes[] = { 1000, 1001, 1002, 1005, 1006, 1004, 1007, 1200, 100000, 100001, 5000000 };
+    int n = sizeof(minutes) / sizeof(minutes[0]);
+    uint8_t block[256];
+    minute_codec_encoder_t enc;
+    minute_codec_encoder_init(&enc, block, sizeof(block));
+    for (int i = 0; i < n; i++) {
+        CHECK(minute_codec_encoder_add(&enc, minutes[i], &g_records[i * 97 % g_sample_count]) == ESP_OK);
+    }
+    uint16_t size = minute_codec_encoder_finish(&enc);
+
+    minute_codec_decoder_t dec;
+    CHECK(minute_codec_decoder_init(&dec, block, size) == ESP_OK);
+    for (int i = 0; i < n; i++) {
+        uint32_t minute;
+        minute_record_t rec;
+        CHECK(minute_codec_decoder_next(&dec, &minute, &rec) == ESP_OK);
+        CHECK(minute == minutes[i]);
+        CHECK(memcmp(&rec, &g_records[i * 97 % g_sample_count], sizeof(minute_record_t)) == 0);
+    }
+    uint32_t minute;
+    minute_record_t rec;
+    CHECK(minute_codec_decoder_next(&dec, &minute, &rec) == ESP_ERR_NOT_FOUND);
+
+    // 途中で切れたブロックは検出される
+    CHECK(minute_codec_decoder_init(&dec, block, MINUTE_CODEC_HEADER_SIZE + 4) == ESP_ERR_INVALID_SIZE);
+}
+
+static void test_data_buffer_blocks(void) {
+    // リングのデータをBLE用ブロックに分割して取得し、全サンプルが順に復元できること
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < g_sample_count; i++) {
+        if (i % 200 == 17) continue;  // 欠測
+        CHECK(data_buffer_add_minute_data(&g_day[i]) == ESP_OK);
+    }
+
+    time_t next = (time_t)g_minutes[0] * 60;
+    int index = 0, blocks = 0;
+    uint8_t block[BLE_BLOCK_SIZE];
+    uint16_t length, count;
+    for (;;) {
+        struct tm start;
+        localtime_r(&next, &start);
+        if (data_buffer_encode_minute_block(&start, block, sizeof(block), &length, &count) != ESP_OK) {
+            break;
+        }
+        blocks++;
+        CHECK(length <= sizeof(block));
+
+        minute_codec_decoder_t dec;
+        uint32_t minute;
+        minute_record_t rec;
+        CHECK(minute_codec_decoder_init(&dec, block, length) == ESP_OK);
+        while (minute_codec_decoder_next(&dec, &minute, &rec) == ESP_OK) {
+            if (index % 200 == 17) index++;
+            CHECK(minute == g_minutes[index]);
+            int32_t expected[MINUTE_RECORD_FIELD_COUNT], actual[MINUTE_RECORD_FIELD_COUNT];
+            minute_record_get_fields(&g_records[index], expected);
+            minute_record_get_fields(&rec, actual);
+            CHECK(memcmp(expected, actual, sizeof(expected)) == 0);
+            index++;
+            next = (time_t)(minute + 1) * 60;
+        }
+    }
+    printf("  data_buffer -> %d BLE blocks for %d samples\n", blocks, index);
+    CHECK(index == g_sample_count);
+}
+
+int main(int argc, char **argv) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    if (argc > 1) {
+        if (!load_csv(argv[1])) {
+            return 1;
+        }
+    } else {
+        generate_rev4_day(mktime(&t));
+    }
+    pack_day();
+
+    RUN_TEST(test_roundtrip_and_ratio);
+    RUN_TEST(test_irregular_timestamps);
+    RUN_TEST(test_data_buffer_blocks);
+    return TEST_RESULT();
+}
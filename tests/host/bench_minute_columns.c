@@ -0,0 +1,208 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_columns.h"
+#include "esp_cpu.h"
+
+// 1分データの列形式ストア: 行アクセサの往復、有効ビットマップ、列の読み出しと行の読み出しの一致、
+// 1フィールド走査（1440件）のコスト比較（旧: パック形式レコードの配列 / 新: フィールドごとの列）
+// ホストではesp_cpu_get_cycle_countスタブがナノ秒を返す
+
+#define ITERATIONS 50
+
+static minute_columns_t g_cols;
+static minute_record_t g_rows[MINUTE_COLUMNS_CAPACITY];  // 旧形式（行の配列）の再現
+
+static void make_record(int i, minute_record_t *rec) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, (time_t)i * 60, i);
+    minute_data_t md;
+    memset(&md, 0, sizeof(md));
+    md.temperature = sd.temperature;
+    md.humidity = sd.humidity;
+    md.lux = sd.lux;
+    md.soil_moisture = sd.soil_moisture;
+    md.soil_temperature_count = (i % 5 == 0) ? 0 : sd.soil_temperature_count;
+    memcpy(md.soil_temperature, sd.soil_temperature, sizeof(md.soil_temperature));
+    memcpy(md.soil_moisture_capacitance, sd.soil_moisture_capacitance, sizeof(md.soil_moisture_capacitance));
+    minute_record_encode(&md, (uint16_t)(i / 7), rec);
+}
+
+static void test_row_accessors(void) {
+    minute_columns_clear(&g_cols);
+    CHECK(minute_columns_count(&g_cols) == 0);
+    for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+        CHECK(!minute_columns_is_valid(&g_cols, i));
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+        minute_record_t rec, back;
+        make_record(i, &rec);
+        minute_columns_put(&g_cols, i, &rec);
+        minute_columns_get(&g_cols, i, &back);
+        if (memcmp(&rec, &back, sizeof(rec)) != 0) mismatches++;
+
+        // 列から直接読む派生値も行形式と同じ
+        int16_t a = 0, b = 0;
+        bool va = minute_record_soil_temperature_raw(&rec, &a);
+        bool vb = minute_columns_soil_temperature_raw(&g_cols, i, &b);
+        if (minute_columns_soil_moisture_raw(&g_cols, i) != minute_record_soil_moisture_raw(&rec) ||
+            va != vb || (va && a != b)) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(minute_columns_count(&g_cols) == MINUTE_COLUMNS_CAPACITY);
+
+    // 削除はビットマップと時刻キーで無効化し、行アクセサは空きレコードを返す
+    minute_columns_erase(&g_cols, 33);
+    minute_record_t rec;
+    minute_columns_get(&g_cols, 33, &rec);
+    CHECK(minute_record_is_empty(&rec));
+    CHECK(!minute_columns_is_valid(&g_cols, 33) && minute_columns_is_valid(&g_cols, 32));
+    CHECK(minute_columns_count(&g_cols) == MINUTE_COLUMNS_CAPACITY - 1);
+
+    // 空きレコードの書き込みは削除と同じ
+    rec.minute_key = MINUTE_RECORD_KEY_EMPTY;
+    minute_columns_put(&g_cols, 34, &rec);
+    CHECK(!minute_columns_is_valid(&g_cols, 34));
+    CHECK(minute_columns_count(&g_cols) == MINUTE_COLUMNS_CAPACITY - 2);
+}
+
+static void test_field_iter_matches_rows(void) {
+    // 列を読むイテレータと、行を組み立てるイテレータが同じ値を返す（欠測・土壌温度なしを含む）
+    struct tm t = test_make_tm(2025, 2, 1, 0, 0);
+    time_t start = mktime(&t);
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (i >= 100 && i < 130) continue;
+        soil_data_t sd;
+        test_fill_sensor(&sd, start + (time_t)i * 60, i);
+        if (i % 5 == 0) sd.soil_temperature_count = 0;
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+
+    data_buffer_window_t window = { (uint32_t)(start / 60), (uint32_t)(start / 60) + DATA_BUFFER_MINUTES_PER_DAY };
+    uint16_t all = (1u << DATA_BUFFER_FIELD_COUNT) - 1;
+    data_buffer_iter_t rows_it, cols_it;
+    data_buffer_iter_begin(&rows_it, &window);
+    data_buffer_iter_begin(&cols_it, &window);
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    int count = 0, mismatches = 0, no_soil_temp = 0;
+    while (data_buffer_iter_next(&rows_it)) {
+        CHECK(data_buffer_iter_next_fields(&cols_it, all, values, &valid_mask));
+        const minute_record_t *rec = &rows_it.record;
+        int16_t soil_temp;
+        bool has_soil_temp = minute_record_soil_temperature_raw(rec, &soil_temp);
+        if (cols_it.epoch_minute != rows_it.epoch_minute ||
+            values[DATA_BUFFER_FIELD_TEMPERATURE] != rec->temperature ||
+            values[DATA_BUFFER_FIELD_HUMIDITY] != rec->humidity ||
+            values[DATA_BUFFER_FIELD_LUX] != (int32_t)minute_record_lux_raw(rec->lux) ||
+            values[DATA_BUFFER_FIELD_SOIL_MOISTURE] != minute_record_soil_moisture_raw(rec) ||
+            ((valid_mask >> DATA_BUFFER_FIELD_SOIL_TEMPERATURE) & 1) != has_soil_temp ||
+            (has_soil_temp && values[DATA_BUFFER_FIELD_SOIL_TEMPERATURE] != soil_temp)) {
+            mismatches++;
+        }
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            if (values[DATA_BUFFER_FIELD_CAPACITANCE1 + c] != rec->soil_moisture_capacitance[c]) mismatches++;
+        }
+#endif
+        if (!has_soil_temp) no_soil_temp++;
+        count++;
+    }
+    CHECK(!data_buffer_iter_next_fields(&cols_it, all, values, &valid_mask));
+    CHECK(count == DATA_BUFFER_MINUTES_PER_DAY - 30);
+    CHECK(mismatches == 0);
+    CHECK(no_soil_temp > 0);
+
+    // フィールドを指定しない場合は何も返さない
+    data_buffer_iter_begin(&cols_it, &window);
+    CHECK(!data_buffer_iter_next_fields(&cols_it, 0, values, &valid_mask));
+}
+
+/**
+ * キャッシュから追い出す（走査ごとにフラッシュキャッシュ越しの読み出しに近い状態にする）
+ */
+static void evict_cache(void) {
+    static volatile uint8_t junk[4 * 1024 * 1024];
+    for (size_t i = 0; i < sizeof(junk); i += 64) {
+        junk[i]++;
+    }
+}
+
+static void bench_one_field_scan(void) {
+    // 1440件の気温を合計: 行の配列（1件 sizeof(minute_record_t) バイト間隔）と列（2バイト間隔）
+    for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+        make_record(i, &g_rows[i]);
+        minute_columns_put(&g_cols, i, &g_rows[i]);
+    }
+    volatile int64_t sink = 0;
+    uint32_t rows_ns = 0, cols_ns = 0;
+    for (int n = 0; n < ITERATIONS; n++) {
+        evict_cache();
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t sum = 0;
+        for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+            if (!minute_record_is_empty(&g_rows[i])) sum += g_rows[i].temperature;
+        }
+        uint32_t c1 = esp_cpu_get_cycle_count();
+        sink += sum;
+
+        evict_cache();
+        uint32_t c2 = esp_cpu_get_cycle_count();
+        sum = 0;
+        // 有効ビットマップを32スロットずつ見て、全て有効なら列を連続で読む
+        for (int w = 0; w < MINUTE_COLUMNS_VALID_WORDS; w++) {
+            uint32_t bits = g_cols.valid[w];
+            const int16_t *col = &g_cols.temperature[w * 32];
+            if (bits == UINT32_MAX) {
+                for (int j = 0; j < 32; j++) sum += col[j];
+            } else {
+                for (; bits != 0; bits &= bits - 1) sum += col[__builtin_ctz(bits)];
+            }
+        }
+        uint32_t c3 = esp_cpu_get_cycle_count();
+        sink -= sum;
+        rows_ns += c1 - c0;
+        cols_ns += c3 - c2;
+    }
+    printf("  cold scan   rows (%d B stride, %d B touched): %lu ns, columns (2 B stride, %d B touched): %lu ns per 1440 samples\n",
+           (int)sizeof(minute_record_t), (int)sizeof(g_rows), (unsigned long)(rows_ns / ITERATIONS),
+           (int)(sizeof(g_cols.temperature) + sizeof(g_cols.valid)), (unsigned long)(cols_ns / ITERATIONS));
+    CHECK(sink == 0);
+
+    // data_buffer のイテレータ経由（seqlockの確認込み）: 行を組み立てる場合と気温の列だけを読む場合
+    struct tm t = test_make_tm(2025, 2, 1, 0, 0);
+    time_t start = mktime(&t);
+    data_buffer_window_t window = { (uint32_t)(start / 60), (uint32_t)(start / 60) + DATA_BUFFER_MINUTES_PER_DAY };
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    int64_t row_sum = 0, col_sum = 0;
+    uint32_t c3 = esp_cpu_get_cycle_count();
+    for (int n = 0; n < ITERATIONS; n++) {
+        data_buffer_iter_t it;
+        data_buffer_iter_begin(&it, &window);
+        while (data_buffer_iter_next(&it)) row_sum += it.record.temperature;
+    }
+    uint32_t c4 = esp_cpu_get_cycle_count();
+    for (int n = 0; n < ITERATIONS; n++) {
+        data_buffer_iter_t it;
+        data_buffer_iter_begin(&it, &window);
+        while (data_buffer_iter_next_fields(&it, 1u << DATA_BUFFER_FIELD_TEMPERATURE, values, &valid_mask)) {
+            col_sum += values[DATA_BUFFER_FIELD_TEMPERATURE];
+        }
+    }
+    uint32_t c5 = esp_cpu_get_cycle_count();
+    printf("  iterator    record: %lu ns, temperature column: %lu ns per day\n",
+           (unsigned long)((c4 - c3) / ITERATIONS), (unsigned long)((c5 - c4) / ITERATIONS));
+    CHECK(row_sum == col_sum && row_sum != 0);
+}
+
+int main(void) {
+    RUN_TEST(test_row_accessors);
+    RUN_TEST(test_field_iter_matches_rows);
+    RUN_TEST(bench_one_field_scan);
+    return TEST_RESULT();
+}
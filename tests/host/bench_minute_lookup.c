@@ -0,0 +1,127 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include <stdlib.h>
+
+// data_buffer_get_minute_data の検索コスト比較（旧: 線形探索 / 新: スロット直接参照）
+
+#define LOOKUPS 20000
+
+// 旧実装の再現: 1440件の minute_data_t を struct tm の5フィールド比較で線形探索
+static minute_data_t g_legacy_buffer[DATA_BUFFER_MINUTES_PER_DAY];
+
+static bool legacy_is_same_minute(const struct tm *tm1, const struct tm *tm2) {
+    return (tm1->tm_year == tm2->tm_year &&
+            tm1->tm_mon == tm2->tm_mon &&
+            tm1->tm_mday == tm2->tm_mday &&
+            tm1->tm_hour == tm2->tm_hour &&
+            tm1->tm_min == tm2->tm_min);
+}
+
+static esp_err_t legacy_get_minute_data(const struct tm *timestamp, minute_data_t *data) {
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (g_legacy_buffer[i].valid && legacy_is_same_minute(timestamp, &g_legacy_buffer[i].timestamp)) {
+            memcpy(data, &g_legacy_buffer[i], sizeof(minute_data_t));
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run_fill(int percent) {
+    time_t now = time(NULL) / 60 * 60;
+    int legacy_count = DATA_BUFFER_MINUTES_PER_DAY * percent / 100;
+    int new_count = DATA_BUFFER_MINUTE_CAPACITY * percent / 100;
+
+    memset(g_legacy_buffer, 0, sizeof(g_legacy_buffer));
+    CHECK(data_buffer_init() == ESP_OK);
+
+    for (int i = 0; i < legacy_count; i++) {
+        time_t t = now - (time_t)(legacy_count - 1 - i) * 60;
+        localtime_r(&t, &g_legacy_buffer[i].timestamp);
+        g_legacy_buffer[i].valid = true;
+    }
+    for (int i = 0; i < new_count; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, now - (time_t)(new_count - 1 - i) * 60, i);
+        data_buffer_add_minute_data(&sd);
+    }
+
+    // 検索対象: 格納範囲内（ヒット）と範囲外（ミス）を半々
+    static struct tm targets[LOOKUPS];
+    srand(12345);
+    for (int i = 0; i < LOOKUPS; i++) {
+        time_t t = now - (time_t)(rand() % (2 * DATA_BUFFER_MINUTES_PER_DAY)) * 60;
+        localtime_r(&t, &targets[i]);
+    }
+
+    minute_data_t md;
+    int legacy_hits = 0, new_hits = 0;
+
+    double t0 = now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        legacy_hits += (legacy_get_minute_data(&targets[i], &md) == ESP_OK);
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        new_hits += (data_buffer_get_minute_data(&targets[i], &md) == ESP_OK);
+    }
+    double t2 = now_ns();
+
+    printf("  fill %3d%%: legacy %8.1f ns/lookup (%d/%d entries, %5d hits) | slot %8.1f ns/lookup (%d/%d entries, %5d hits)\n",
+           percent, (t1 - t0) / LOOKUPS, legacy_count, DATA_BUFFER_MINUTES_PER_DAY, legacy_hits,
+           (t2 - t1) / LOOKUPS, new_count, DATA_BUFFER_MINUTE_CAPACITY, new_hits);
+
+    // 新方式は24時間より長く保持するので、同じ対象に対するヒット数は旧方式以上
+    CHECK(new_hits >= legacy_hits);
+    if (percent == 0) {
+        CHECK(new_hits == 0);
+    }
+}
+
+static void test_lookup_is_exact(void) {
+    // 同じスロットに別周回のデータがある場合は見つからないこと
+    time_t now = time(NULL) / 60 * 60;
+    CHECK(data_buffer_init() == ESP_OK);
+
+    soil_data_t sd;
+    test_fill_sensor(&sd, now, 0);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+
+    minute_data_t md;
+    struct tm t;
+    time_t aliased = now - (time_t)DATA_BUFFER_MINUTE_CAPACITY * 60;
+    localtime_r(&aliased, &t);
+    CHECK(data_buffer_get_minute_data(&t, &md) == ESP_ERR_NOT_FOUND);
+
+    localtime_r(&now, &t);
+    CHECK(data_buffer_get_minute_data(&t, &md) == ESP_OK);
+    CHECK(mktime(&md.timestamp) == now);
+    CHECK_NEAR(md.temperature, sd.temperature, 0.005f + 1e-4f);
+
+    // 同じ分の再書き込みは上書き（件数は増えない）
+    sd.temperature = 30.0f;
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    CHECK(data_buffer_get_minute_data(&t, &md) == ESP_OK);
+    CHECK_NEAR(md.temperature, 30.0f, 0.005f);
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == 1);
+}
+
+static void bench_fill_levels(void) {
+    run_fill(0);
+    run_fill(50);
+    run_fill(100);
+}
+
+int main(void) {
+    RUN_TEST(test_lookup_is_exact);
+    RUN_TEST(bench_fill_levels);
+    return TEST_RESULT();
+}
@@ -0,0 +1,209 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "stream_detect.h"
+
+// ストリーミング検出器のリプレイ: 1分データを data_buffer に格納し、plant_manager と同じ経路
+// （格納した1分をリングから読み出して stream_detect_process に渡す）で検出器を動かして、
+// 発行されたイベントとサンプルあたりの処理時間（全体・検出器ごと）を表示する
+//
+//   bench_stream_detect [trace.csv]
+//   CSV: unix_time,cap0,cap1,cap2,cap3（1行1サンプル、ヘッダー行なし、時刻順）
+//   省略時は灌水・排水・スパイク・固着・欠測・読み取り失敗を含む1日分の波形を生成し、期待するイベントと照合する
+
+#define MAX_SAMPLES     DATA_BUFFER_MINUTES_PER_DAY
+#define MAX_EVENTS      256
+#define THRESHOLD       0.5f    // 灌水検出閾値 [pF]
+
+static soil_data_t g_trace[MAX_SAMPLES];
+static int g_sample_count = 0;
+static minute_data_t g_decoded[MAX_SAMPLES];
+static uint32_t g_minutes[MAX_SAMPLES];
+static event_entry_t g_events[MAX_EVENTS];
+static int g_event_count = 0;
+static time_t g_start;
+
+static const char *const EVENT_NAMES[] = {
+    "", "watering", "needs_watering", "temp_high", "temp_low",
+    "watering_start", "watering_end", "drainage", "spike", "stuck", "dropout",
+};
+
+static inline uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint32_t g_rng = 0x2545f491u;
+static float noise(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return ((g_rng >> 8) / 16777216.0f - 0.5f) * 0.06f;  // ±0.03pF
+}
+
+static void set_capacitance(soil_data_t *d, const float *cap) {
+    d->soil_moisture = cap[0];
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        d->soil_moisture_capacitance[c] = cap[c];
+        if (cap[c] > d->soil_moisture) d->soil_moisture = cap[c];
+    }
+}
+
+/**
+ * 1日分の波形（分: イベント）
+ *   300-301: 灌水（全チャンネルが2分かけて0.8pF下がる）→ 304: 終了 → 364: 排水速度（1時間で約0.3pF戻る）
+ *   700: ch2 だけ1サンプルのスパイク、900-990: ch3 の値が固定、1100-1119: 欠測、1200-1202: 読み取り失敗
+ */
+static void generate_trace(void) {
+    g_sample_count = 0;
+    for (int i = 0; i < MAX_SAMPLES; i++) {
+        if (i >= 1100 && i < 1120) {
+            continue;
+        }
+        soil_data_t *d = &g_trace[g_sample_count++];
+        test_fill_sensor(d, g_start + (time_t)i * 60, i);
+        float cap[FDC1004_CHANNEL_COUNT];
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            cap[c] = 4.0f + c - 0.0005f * i + noise();
+            if (i >= 300) cap[c] -= (i == 300) ? 0.4f : 0.8f;
+            if (i >= 304) cap[c] += 0.3f * fminf(i - 304, 60) / 60.0f;
+        }
+        if (i == 700) cap[1] += 1.0f;
+        if (i >= 900 && i <= 990) cap[2] = 5.5f;
+        if (i >= 1200 && i <= 1202) {
+            memset(cap, 0, sizeof(cap));
+            d->sensor_error = true;
+        }
+        set_capacitance(d, cap);
+    }
+}
+
+static bool load_csv(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("  cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    g_sample_count = 0;
+    while (g_sample_count < MAX_SAMPLES && fgets(line, sizeof(line), fp) != NULL) {
+        soil_data_t *d = &g_trace[g_sample_count];
+        memset(d, 0, sizeof(*d));
+        long long unix_time;
+        float cap[FDC1004_CHANNEL_COUNT];
+        if (sscanf(line, "%lld,%f,%f,%f,%f", &unix_time, &cap[0], &cap[1], &cap[2], &cap[3]) != 5) {
+            continue;
+        }
+        time_t t = (time_t)unix_time;
+        localtime_r(&t, &d->datetime);
+        set_capacitance(d, cap);
+        g_sample_count++;
+    }
+    fclose(fp);
+    printf("  loaded %d samples from %s\n", g_sample_count, path);
+    return g_sample_count > 0;
+}
+
+/**
+ * 格納してリングから読み出した値で検出器を動かす（plant_manager の feed_stream_detectors と同じ経路）
+ */
+static void replay(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    stream_detect_config_t config = { THRESHOLD };
+    stream_detect_init(&config);
+    g_event_count = 0;
+
+    uint64_t elapsed = 0;
+    for (int s = 0; s < g_sample_count; s++) {
+        CHECK(data_buffer_add_minute_data(&g_trace[s]) == ESP_OK);
+        struct tm datetime = g_trace[s].datetime;
+        uint32_t minute = (uint32_t)(mktime(&datetime) / 60);
+        data_buffer_window_t window = { minute, minute + 1 };
+        data_buffer_iter_t it;
+        CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+        CHECK(data_buffer_iter_next(&it));
+        data_buffer_iter_decode(&it, &g_decoded[s]);
+        g_minutes[s] = it.epoch_minute;
+
+        event_entry_t events[STREAM_DETECT_MAX_EVENTS];
+        uint64_t t0 = read_ns();
+        uint8_t count = stream_detect_process(it.epoch_minute, &g_decoded[s], events, STREAM_DETECT_MAX_EVENTS);
+        elapsed += read_ns() - t0;
+        for (uint8_t e = 0; e < count && g_event_count < MAX_EVENTS; e++) {
+            g_events[g_event_count++] = events[e];
+        }
+    }
+
+    for (int e = 0; e < g_event_count; e++) {
+        const event_entry_t *ev = &g_events[e];
+        printf("  minute %5ld  %-15s channels=0x%02x magnitude=%d\n", (long)(((time_t)ev->epoch - g_start) / 60),
+               EVENT_NAMES[ev->type], ev->channel_mask, ev->magnitude);
+    }
+    printf("  %d samples, %d events, %.1f ns/sample (all detectors)\n",
+           g_sample_count, g_event_count, (double)elapsed / g_sample_count);
+}
+
+/**
+ * 検出器ごとのサンプルあたりの処理時間（読み出し済みのサンプルで各検出器だけを動かす）
+ */
+static void measure_detectors(void) {
+    stream_detect_config_t config = { THRESHOLD };
+    event_entry_t events[STREAM_DETECT_MAX_EVENTS];
+    for (uint8_t d = 0; d < stream_detect_count(); d++) {
+        const stream_detector_t *detector = stream_detect_get(d);
+        detector->reset();
+        stream_emit_t emit = { events, STREAM_DETECT_MAX_EVENTS, 0, 0 };
+        uint64_t elapsed = 0;
+        for (int s = 0; s < g_sample_count; s++) {
+            stream_sample_t sample;
+            stream_detect_make_sample(g_minutes[s], &g_decoded[s], &sample);
+            emit.count = 0;
+            uint64_t t0 = read_ns();
+            detector->process(&sample, &config, &emit);
+            elapsed += read_ns() - t0;
+        }
+        printf("  %-10s %.1f ns/sample\n", detector->name, (double)elapsed / g_sample_count);
+    }
+    CHECK(stream_detect_get(stream_detect_count()) == NULL);
+}
+
+static const event_entry_t *find_event(uint8_t type, int minute) {
+    for (int e = 0; e < g_event_count; e++) {
+        if (g_events[e].type == type && (time_t)g_events[e].epoch == g_start + (time_t)minute * 60) {
+            return &g_events[e];
+        }
+    }
+    return NULL;
+}
+
+static void test_expected_events(void) {
+    // 生成した波形: 期待するイベントだけが発行される
+    const event_entry_t *ev;
+    CHECK((ev = find_event(EVENT_TYPE_WATERING_START, 301)) != NULL && ev->channel_mask == 0x0F);
+    CHECK((ev = find_event(EVENT_TYPE_WATERING_END, 304)) != NULL && fabs(ev->magnitude / 2048.0 - 0.8) < 0.1);
+    CHECK((ev = find_event(EVENT_TYPE_DRAINAGE, 364)) != NULL && fabs(ev->magnitude / 2048.0 - 0.27) < 0.1);
+    CHECK((ev = find_event(EVENT_TYPE_SPIKE, 701)) != NULL && ev->channel_mask == 0x02 &&
+          fabs(ev->magnitude / 2048.0 - 1.0) < 0.1);
+    CHECK((ev = find_event(EVENT_TYPE_STUCK, 959)) != NULL && ev->channel_mask == 0x04);
+    CHECK((ev = find_event(EVENT_TYPE_DROPOUT, 1120)) != NULL && ev->channel_mask == 0 && ev->magnitude == 20);
+    CHECK((ev = find_event(EVENT_TYPE_DROPOUT, 1200)) != NULL && ev->channel_mask == 0x0F && ev->magnitude == 0);
+    CHECK(g_event_count == 7);
+}
+
+int main(int argc, char **argv) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    g_start = mktime(&t);
+    bool synthetic = (argc <= 1);
+    if (synthetic) {
+        generate_trace();
+    } else if (!load_csv(argv[1])) {
+        return 1;
+    }
+
+    RUN_TEST(replay);
+    RUN_TEST(measure_detectors);
+    if (synthetic) {
+        RUN_TEST(test_expected_events);
+    }
+    return TEST_RESULT();
+}
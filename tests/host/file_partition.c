@@ -0,0 +1,115 @@
+#include "file_partition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static FILE *g_file = NULL;
+static uint32_t g_size = 0;
+static uint32_t *g_erases = NULL;
+static uint32_t *g_writes = NULL;
+
+static esp_err_t file_read(void *ctx, uint32_t offset, void *dst, size_t len) {
+    if (offset + len > g_size || fseek(g_file, offset, SEEK_SET) != 0 || fread(dst, 1, len, g_file) != len) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t file_write(void *ctx, uint32_t offset, const void *src, size_t len) {
+    if (offset + len > g_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t *cur = malloc(len);
+    if (cur == NULL || file_read(ctx, offset, cur, len) != ESP_OK) {
+        free(cur);
+        return ESP_FAIL;
+    }
+    // NORフラッシュ: 1→0のみ可能
+    for (size_t i = 0; i < len; i++) {
+        cur[i] &= ((const uint8_t *)src)[i];
+    }
+    esp_err_t ret = (fseek(g_file, offset, SEEK_SET) == 0 && fwrite(cur, 1, len, g_file) == len) ? ESP_OK : ESP_FAIL;
+    free(cur);
+    fflush(g_file);
+    for (uint32_t s = offset / HISTORY_STORAGE_SECTOR_SIZE; s <= (offset + len - 1) / HISTORY_STORAGE_SECTOR_SIZE; s++) {
+        g_writes[s]++;
+    }
+    return ret;
+}
+
+static esp_err_t file_erase(void *ctx, uint32_t offset, size_t len) {
+    if ((offset % HISTORY_STORAGE_SECTOR_SIZE) != 0 || (len % HISTORY_STORAGE_SECTOR_SIZE) != 0 || offset + len > g_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t ff[HISTORY_STORAGE_SECTOR_SIZE];
+    memset(ff, 0xFF, sizeof(ff));
+    for (size_t done = 0; done < len; done += sizeof(ff)) {
+        if (fseek(g_file, offset + done, SEEK_SET) != 0 || fwrite(ff, 1, sizeof(ff), g_file) != sizeof(ff)) {
+            return ESP_FAIL;
+        }
+        g_erases[(offset + done) / HISTORY_STORAGE_SECTOR_SIZE]++;
+    }
+    fflush(g_file);
+    return ESP_OK;
+}
+
+int file_partition_open(const char *path, uint32_t size) {
+    file_partition_close();
+    g_file = fopen(path, "r+b");
+    if (g_file == NULL) {
+        g_file = fopen(path, "w+b");
+        if (g_file == NULL) {
+            return -1;
+        }
+        uint8_t ff[HISTORY_STORAGE_SECTOR_SIZE];
+        memset(ff, 0xFF, sizeof(ff));
+        for (uint32_t done = 0; done < size; done += sizeof(ff)) {
+            fwrite(ff, 1, sizeof(ff), g_file);
+        }
+        fflush(g_file);
+    }
+    g_size = size;
+    g_erases = calloc(size / HISTORY_STORAGE_SECTOR_SIZE, sizeof(uint32_t));
+    g_writes = calloc(size / HISTORY_STORAGE_SECTOR_SIZE, sizeof(uint32_t));
+    return 0;
+}
+
+void file_partition_close(void) {
+    if (g_file != NULL) {
+        fclose(g_file);
+    }
+    free(g_erases);
+    free(g_writes);
+    g_file = NULL;
+    g_erases = NULL;
+    g_writes = NULL;
+    g_size = 0;
+}
+
+uint32_t file_partition_erase_count(uint32_t sector) { return g_erases ? g_erases[sector] : 0; }
+uint32_t file_partition_write_count(uint32_t sector) { return g_writes ? g_writes[sector] : 0; }
+
+uint32_t file_partition_total_erases(void) {
+    uint32_t total = 0;
+    for (uint32_t s = 0; g_erases && s < g_size / HISTORY_STORAGE_SECTOR_SIZE; s++) total += g_erases[s];
+    return total;
+}
+
+uint32_t file_partition_total_writes(void) {
+    uint32_t total = 0;
+    for (uint32_t s = 0; g_writes && s < g_size / HISTORY_STORAGE_SECTOR_SIZE; s++) total += g_writes[s];
+    return total;
+}
+
+// 履歴ログの保存先（ターゲットの history_storage_partition.c に相当）
+esp_err_t history_storage_get(history_storage_t *storage) {
+    if (g_file == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    storage->read = file_read;
+    storage->write = file_write;
+    storage->erase = file_erase;
+    storage->ctx = NULL;
+    storage->size = g_size;
+    return ESP_OK;
+}
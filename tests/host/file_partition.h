@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include "history_storage.h"
+
+// ファイルをhistoryパーティションの代わりに使うホスト用保存先
+// NORフラッシュと同様に、書き込みはビットを0にするのみ（消去で0xFF）
+
+/**
+ * ファイルパーティションを開く（存在しない場合は消去状態で作成）
+ * 開いている間は history_storage_get() がこの保存先を返す
+ */
+int file_partition_open(const char *path, uint32_t size);
+
+/**
+ * ファイルパーティションを閉じる（以降 history_storage_get() は ESP_ERR_NOT_FOUND）
+ */
+void file_partition_close(void);
+
+/**
+ * セクタ毎の消去回数・書き込み回数
+ */
+uint32_t file_partition_erase_count(uint32_t sector);
+uint32_t file_partition_write_count(uint32_t sector);
+uint32_t file_partition_total_erases(void);
+uint32_t file_partition_total_writes(void);
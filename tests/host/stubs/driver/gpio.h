@@ -0,0 +1,3 @@
+#pragma once
+
+// ホストテスト用スタブ（plant_logicはGPIOドライバを使用しない）
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// ホストテスト用 esp_cpu.h スタブ（サイクル数の代わりにナノ秒を返す）
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
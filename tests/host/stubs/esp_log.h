@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdio.h>
+
+// ホストテスト用 esp_log.h スタブ（出力はせず、書式チェックのみ行う）
+#define ESP_LOG_STUB(tag, fmt, ...) do { if (0) printf("%s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_STUB(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_STUB(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_STUB(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_STUB(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_STUB(tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,237 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+#include "rollup_tier.h"
+
+// チャンネル別（静電容量 ch1〜4 / 土壌温度 TMP102[0..3]）の日別・1時間集計と投入値との一致、
+// 検出されていない深さの扱い、保持期間、格納サイズの確認
+
+#define PARTIAL_DAY     1   // この日は浅い2深さの土壌温度センサーのみ検出される
+#define PARTIAL_PROBES  2
+
+static time_t g_start;  // 投入開始時刻（0:00）
+
+/**
+ * 投入データを生成（浅いチャンネルほど水やりで大きく変化する）
+ */
+static void fill_sensor(soil_data_t *sd, int i) {
+    test_fill_sensor(sd, g_start + (time_t)i * 60, i);
+    if ((i % DATA_BUFFER_MINUTES_PER_DAY) >= 8 * 60 && (i % DATA_BUFFER_MINUTES_PER_DAY) < 8 * 60 + 30) {
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            sd->soil_moisture_capacitance[c] += 2.0f / (c + 1);
+        }
+    }
+    if (i / DATA_BUFFER_MINUTES_PER_DAY == PARTIAL_DAY) {
+        sd->soil_temperature_count = PARTIAL_PROBES;
+    }
+}
+
+static void add_minutes(int from, int to) {
+    for (int i = from; i < to; i++) {
+        soil_data_t sd;
+        fill_sensor(&sd, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+}
+
+typedef struct {
+    float cap_min[FDC1004_CHANNEL_COUNT], cap_max[FDC1004_CHANNEL_COUNT];
+    double cap_sum[FDC1004_CHANNEL_COUNT];
+    float probe_min[TMP102_MAX_DEVICES], probe_max[TMP102_MAX_DEVICES];
+    double probe_sum[TMP102_MAX_DEVICES];
+    int probe_count[TMP102_MAX_DEVICES];
+} expected_t;
+
+/**
+ * 投入データ [from, from+n) のチャンネル別の期待値
+ */
+static void expected_for(int from, int n, expected_t *e) {
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        e->cap_min[c] = 1e9f; e->cap_max[c] = -1e9f; e->cap_sum[c] = 0;
+    }
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        e->probe_min[p] = 1e9f; e->probe_max[p] = -1e9f; e->probe_sum[p] = 0; e->probe_count[p] = 0;
+    }
+    for (int i = from; i < from + n; i++) {
+        soil_data_t sd;
+        fill_sensor(&sd, i);
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            float v = sd.soil_moisture_capacitance[c];
+            e->cap_sum[c] += v;
+            if (v < e->cap_min[c]) e->cap_min[c] = v;
+            if (v > e->cap_max[c]) e->cap_max[c] = v;
+        }
+        for (int p = 0; p < sd.soil_temperature_count; p++) {
+            float v = sd.soil_temperature[p];
+            e->probe_sum[p] += v;
+            e->probe_count[p]++;
+            if (v < e->probe_min[p]) e->probe_min[p] = v;
+            if (v > e->probe_max[p]) e->probe_max[p] = v;
+        }
+    }
+}
+
+static void test_daily_channels(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, 3 * DATA_BUFFER_MINUTES_PER_DAY);
+
+    float cap_eps = 1.0f / MINUTE_RECORD_CAP_SCALE;
+    float probe_eps = 0.5f / MINUTE_RECORD_PROBE_TEMP_SCALE + 1e-4f;
+    for (int day = 0; day < 2; day++) {
+        time_t t = g_start + (time_t)day * 86400;
+        struct tm date;
+        localtime_r(&t, &date);
+        daily_summary_data_t s;
+        CHECK(data_buffer_get_daily_summary(&date, &s) == ESP_OK);
+
+        expected_t e;
+        expected_for(day * DATA_BUFFER_MINUTES_PER_DAY, DATA_BUFFER_MINUTES_PER_DAY, &e);
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            CHECK_NEAR(s.min_capacitance[c], e.cap_min[c], cap_eps);
+            CHECK_NEAR(s.avg_capacitance[c], e.cap_sum[c] / DATA_BUFFER_MINUTES_PER_DAY, cap_eps);
+            CHECK_NEAR(s.max_capacitance[c], e.cap_max[c], cap_eps);
+        }
+        // 従来の土壌水分（4chの最大静電容量）の最大はチャンネル別の最大のいずれか
+        float channel_max = s.max_capacitance[0];
+        for (int c = 1; c < FDC1004_CHANNEL_COUNT; c++) {
+            if (s.max_capacitance[c] > channel_max) channel_max = s.max_capacitance[c];
+        }
+        CHECK(s.max_soil_moisture == channel_max);
+
+        int probes = (day == PARTIAL_DAY) ? PARTIAL_PROBES : TMP102_MAX_DEVICES;
+        CHECK(s.probe_valid_mask == (1u << probes) - 1);
+        for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+            if (p < probes) {
+                CHECK(e.probe_count[p] == DATA_BUFFER_MINUTES_PER_DAY);
+                CHECK_NEAR(s.min_probe_temperature[p], e.probe_min[p], probe_eps);
+                CHECK_NEAR(s.avg_probe_temperature[p], e.probe_sum[p] / e.probe_count[p], probe_eps);
+                CHECK_NEAR(s.max_probe_temperature[p], e.probe_max[p], probe_eps);
+            } else {
+                CHECK(s.min_probe_temperature[p] == 999);
+                CHECK(s.max_probe_temperature[p] == -999);
+            }
+        }
+    }
+
+    // 書き込み中の日（1分データが全件残っている）の全件再計算と、日付が変わって確定した逐次集計が一致する
+    time_t t = g_start + 2 * 86400;
+    struct tm date;
+    localtime_r(&t, &date);
+    daily_summary_data_t recalculated, incremental;
+    CHECK(data_buffer_recalculate_daily_summary(&date) == ESP_OK);
+    CHECK(data_buffer_get_daily_summary(&date, &recalculated) == ESP_OK);
+    add_minutes(3 * DATA_BUFFER_MINUTES_PER_DAY, 3 * DATA_BUFFER_MINUTES_PER_DAY + 1);
+    CHECK(data_buffer_get_daily_summary(&date, &incremental) == ESP_OK);
+    CHECK(memcmp(recalculated.min_capacitance, incremental.min_capacitance, sizeof(recalculated.min_capacitance)) == 0);
+    CHECK(memcmp(recalculated.avg_capacitance, incremental.avg_capacitance, sizeof(recalculated.avg_capacitance)) == 0);
+    CHECK(memcmp(recalculated.avg_probe_temperature, incremental.avg_probe_temperature, sizeof(recalculated.avg_probe_temperature)) == 0);
+    CHECK(memcmp(recalculated.max_probe_temperature, incremental.max_probe_temperature, sizeof(recalculated.max_probe_temperature)) == 0);
+    CHECK(recalculated.probe_valid_mask == incremental.probe_valid_mask);
+}
+
+static void check_channel_point(const channel_point_data_t *pt, int from, int n) {
+    expected_t e;
+    expected_for(from, n, &e);
+    float cap_eps = 1.0f / MINUTE_RECORD_CAP_SCALE;
+    float cap_unit = ROLLUP_SOIL_DELTA_UNIT / MINUTE_RECORD_CAP_SCALE;
+    float probe_eps = 1.0f / MINUTE_RECORD_PROBE_TEMP_SCALE + 1e-4f;
+    float probe_unit = ROLLUP_PROBE_DELTA_UNIT / MINUTE_RECORD_PROBE_TEMP_SCALE;
+
+    CHECK(pt->samples == n);
+    CHECK(mktime((struct tm *)&pt->timestamp) == g_start + (time_t)from * 60);
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        CHECK_NEAR(pt->avg_capacitance[c], e.cap_sum[c] / n, cap_eps);
+        // 最小/最大は量子化1段分まで外側に広がるが、実際の値は必ず包含する
+        CHECK(pt->min_capacitance[c] <= e.cap_min[c] + cap_eps && pt->min_capacitance[c] >= e.cap_min[c] - cap_unit - cap_eps);
+        CHECK(pt->max_capacitance[c] >= e.cap_max[c] - cap_eps && pt->max_capacitance[c] <= e.cap_max[c] + cap_unit + cap_eps);
+    }
+    uint8_t mask = 0;
+    for (int p = 0; p < TMP102_MAX_DEVICES; p++) {
+        if (e.probe_count[p] == 0) {
+            continue;
+        }
+        mask |= (uint8_t)(1u << p);
+        CHECK_NEAR(pt->avg_probe_temperature[p], e.probe_sum[p] / e.probe_count[p], probe_eps);
+        CHECK(pt->min_probe_temperature[p] <= e.probe_min[p] + probe_eps &&
+              pt->min_probe_temperature[p] >= e.probe_min[p] - probe_unit - probe_eps);
+        CHECK(pt->max_probe_temperature[p] >= e.probe_max[p] - probe_eps &&
+              pt->max_probe_temperature[p] <= e.probe_max[p] + probe_unit + probe_eps);
+    }
+    CHECK(pt->probe_valid_mask == mask);
+}
+
+static void test_hourly_channels(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, 3 * DATA_BUFFER_MINUTES_PER_DAY + 90);
+
+    // 1日目（1分データからは消えている）と、浅い2深さのみの2日目
+    static channel_point_data_t points[DATA_BUFFER_CHANNEL_HOURLY_CAPACITY];
+    uint16_t count;
+    time_t from = g_start, to = g_start + 2 * 86400;
+    struct tm start, end;
+    localtime_r(&from, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_channel_history(&start, &end, points, 48, &count) == ESP_OK);
+    CHECK(count == 48);
+    for (int h = 0; h < count; h++) {
+        check_channel_point(&points[h], h * 60, 60);
+    }
+    CHECK(points[0].probe_valid_mask == 0x0F);
+    CHECK(points[24].probe_valid_mask == (1u << PARTIAL_PROBES) - 1);
+
+    // 書き込み中の区間は途中までの値を返す
+    from = g_start + 3 * 86400 + 3600;
+    to = from + 3600;
+    localtime_r(&from, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_channel_history(&start, &end, points, 4, &count) == ESP_OK);
+    CHECK(count == 1);
+    check_channel_point(&points[0], 3 * DATA_BUFFER_MINUTES_PER_DAY + 60, 30);
+}
+
+static void test_channel_retention(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    int days = DATA_BUFFER_CHANNEL_HOURLY_CAPACITY / 24 + 2;
+    add_minutes(0, days * DATA_BUFFER_MINUTES_PER_DAY);
+
+    // 直近7日分のみ保持する（それより古い区間は返さない）
+    static channel_point_data_t points[DATA_BUFFER_CHANNEL_HOURLY_CAPACITY + 48];
+    uint16_t count;
+    time_t from = g_start, to = g_start + (time_t)days * 86400;
+    struct tm start, end;
+    localtime_r(&from, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_channel_history(&start, &end, points, DATA_BUFFER_CHANNEL_HOURLY_CAPACITY + 48, &count) == ESP_OK);
+    CHECK(count == DATA_BUFFER_CHANNEL_HOURLY_CAPACITY);
+    int first_hour = days * 24 - DATA_BUFFER_CHANNEL_HOURLY_CAPACITY;
+    CHECK(mktime(&points[0].timestamp) == g_start + (time_t)first_hour * 3600);
+    check_channel_point(&points[0], first_hour * 60, 60);
+    check_channel_point(&points[count - 1], (days * 24 - 1) * 60, 60);
+
+    // 日別のチャンネル別集計は日別リング（30日）に残る
+    time_t t = g_start;
+    struct tm date;
+    localtime_r(&t, &date);
+    daily_summary_data_t s;
+    CHECK(data_buffer_get_daily_summary(&date, &s) == ESP_OK);
+    CHECK(s.probe_valid_mask == 0x0F);
+}
+
+static void test_channel_record_size(void) {
+    // 1時間あたり34バイト（7日分で約5.6KB）
+    printf("  channel_rollup_record_t: %d bytes, %d entries = %d bytes\n",
+           (int)sizeof(channel_rollup_record_t), DATA_BUFFER_CHANNEL_HOURLY_CAPACITY,
+           (int)sizeof(channel_rollup_record_t) * DATA_BUFFER_CHANNEL_HOURLY_CAPACITY);
+    CHECK(sizeof(channel_rollup_record_t) == 34);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_daily_channels);
+    RUN_TEST(test_hourly_channels);
+    RUN_TEST(test_channel_retention);
+    RUN_TEST(test_channel_record_size);
+    return TEST_RESULT();
+}
@@ -0,0 +1,247 @@
+#include "test_common.h"
+#include "data_buffer.h"
+
+// 日別サマリーの逐次集計（追加時）と全件再計算（data_buffer_recalculate_daily_summary）の一致確認、
+// 日付をまたいで戻った時計で確定済みの日を確定し直さないことの確認
+
+static time_t g_day0;   // テスト開始日の0:00
+
+static void add_at(time_t t, int i) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, t, i);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    // 土壌温度センサーが一時的に読めないサンプルを混ぜる
+    if (i % 97 == 0) {
+        sd.soil_temperature_count = 0;
+    }
+#endif
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+}
+
+/**
+ * 指定日の逐次集計結果と再計算結果が一致することを確認
+ */
+static void check_day_matches(time_t day) {
+    struct tm date;
+    localtime_r(&day, &date);
+
+    daily_summary_data_t incremental, recalculated;
+    CHECK(data_buffer_get_daily_summary(&date, &incremental) == ESP_OK);
+    CHECK(data_buffer_recalculate_daily_summary(&date) == ESP_OK);
+    CHECK(data_buffer_get_daily_summary(&date, &recalculated) == ESP_OK);
+
+    CHECK(incremental.valid_samples == recalculated.valid_samples);
+    CHECK(incremental.avg_temperature == recalculated.avg_temperature);
+    CHECK(incremental.min_temperature == recalculated.min_temperature);
+    CHECK(incremental.max_temperature == recalculated.max_temperature);
+    CHECK(incremental.avg_humidity == recalculated.avg_humidity);
+    CHECK(incremental.avg_lux == recalculated.avg_lux);
+    CHECK(incremental.avg_soil_moisture == recalculated.avg_soil_moisture);
+    CHECK(incremental.min_soil_moisture == recalculated.min_soil_moisture);
+    CHECK(incremental.max_soil_moisture == recalculated.max_soil_moisture);
+    CHECK(incremental.avg_soil_temperature == recalculated.avg_soil_temperature);
+    CHECK(incremental.min_soil_temperature == recalculated.min_soil_temperature);
+    CHECK(incremental.max_soil_temperature == recalculated.max_soil_temperature);
+    CHECK(memcmp(&incremental, &recalculated, sizeof(daily_summary_data_t)) == 0);
+}
+
+static void test_consecutive_days(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 3 * DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        add_at(g_day0 + i * 60, i);
+        if (i % DATA_BUFFER_MINUTES_PER_DAY == 1300) {
+            check_day_matches(g_day0 + i * 60);
+        }
+    }
+    // 1分データは24時間分のみ保持するため、再計算で比較できるのは最終日のみ
+    check_day_matches(g_day0 + 2 * 86400);
+}
+
+static void test_overwrite_within_day(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 1300; i++) {
+        add_at(g_day0 + i * 60, i);
+    }
+    // 同じ分のデータを再追加（スロット上書き → 当日の再集計）
+    for (int i = 0; i < 50; i++) {
+        add_at(g_day0 + (i * 13) * 60, 100000 + i);
+    }
+    check_day_matches(g_day0);
+}
+
+static void test_clock_jumps_back(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 1300; i++) {
+        add_at(g_day0 + i * 60, i);
+    }
+    // 翌日のデータで前日の先頭100分が上書きされる
+    for (int i = 0; i < 100; i++) {
+        add_at(g_day0 + 86400 + i * 60, i);
+    }
+    // 時刻が確定済みの前日に戻ったサンプルは捨てる（前日の集計は確定時のまま）
+    struct tm day0_date;
+    localtime_r(&g_day0, &day0_date);
+    daily_summary_data_t before, after;
+    CHECK(data_buffer_get_daily_summary(&day0_date, &before) == ESP_OK);
+    soil_data_t sd;
+    test_fill_sensor(&sd, g_day0 + 1350 * 60, 7);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_ERR_INVALID_STATE);
+    CHECK(data_buffer_get_daily_summary(&day0_date, &after) == ESP_OK);
+    CHECK(after.valid_samples == 1300);
+    CHECK(memcmp(&before, &after, sizeof(daily_summary_data_t)) == 0);
+}
+
+static void test_midnight_step_back(void) {
+    // 土曜（3/1）を1日分記録し、日曜（3/2）の0:05まで進んだ時計が前日の23:58に戻る（同じ週）
+    CHECK(data_buffer_init() == ESP_OK);
+    time_t day1 = g_day0 + 86400;
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY + 6; i++) {
+        add_at(g_day0 + i * 60, i);
+    }
+    struct tm day0_date, day1_date;
+    localtime_r(&g_day0, &day0_date);
+    localtime_r(&day1, &day1_date);
+    daily_summary_data_t day0_before, day0_after;
+    data_buffer_period_stats_t week_before, week_after;
+    CHECK(data_buffer_get_daily_summary(&day0_date, &day0_before) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &day1_date, &week_before) == ESP_OK);
+    CHECK(week_before.days == 1);
+
+    // 23:58, 23:59 は確定済みの前日に入るので捨て、0:00以降は当日の上書きとして続ける
+    // （捨てた分は直近に格納した1件にならない）
+    uint32_t last_added = (uint32_t)(day1 / 60) + 5;
+    CHECK(data_buffer_get_last_added_minute() == last_added);
+    for (int i = -2; i < 0; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, day1 + i * 60, 100000 + i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_ERR_INVALID_STATE);
+        CHECK(data_buffer_get_last_added_minute() == last_added);
+    }
+    for (int i = 0; i < 30; i++) {
+        add_at(day1 + i * 60, 200000 + i);
+    }
+
+    // 当日を途中で確定しない: 前日の日別サマリーと週の要約は変わらない
+    CHECK(data_buffer_get_daily_summary(&day0_date, &day0_after) == ESP_OK);
+    CHECK(memcmp(&day0_before, &day0_after, sizeof(daily_summary_data_t)) == 0);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &day1_date, &week_after) == ESP_OK);
+    CHECK(week_after.days == 1);
+    CHECK(week_after.field[QUANTILE_FIELD_TEMPERATURE].samples == week_before.field[QUANTILE_FIELD_TEMPERATURE].samples);
+
+    // 当日の集計は1分リングからの再計算と一致し、日付が変わると1回だけ確定する
+    for (int i = 30; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        add_at(day1 + i * 60, 200000 + i);
+    }
+    check_day_matches(day1);
+    add_at(day1 + DATA_BUFFER_MINUTES_PER_DAY * 60, 300000);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &day1_date, &week_after) == ESP_OK);
+    CHECK(week_after.days == 2);
+    CHECK(week_after.field[QUANTILE_FIELD_TEMPERATURE].samples == 2 * DATA_BUFFER_MINUTES_PER_DAY);
+}
+
+static void test_ring_wrap(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    // バッファ容量を超えて投入（古い日のデータは上書きで消える）
+    int total = DATA_BUFFER_MINUTE_CAPACITY + 2 * DATA_BUFFER_MINUTES_PER_DAY;
+    for (int i = 0; i < total; i++) {
+        add_at(g_day0 + i * 60, i);
+    }
+    time_t last_day = g_day0 + (time_t)(total - 1) / DATA_BUFFER_MINUTES_PER_DAY * 86400;
+    check_day_matches(last_day);
+}
+
+static void test_date_keyed_ring(void) {
+    // 2025-02-02から35日分（1日1300件）を投入し、20日目だけ欠測させる
+    // 旧実装の月日ハッシュでは 2/7 と 3/6 などが同じスロットに衝突していた
+    CHECK(data_buffer_init() == ESP_OK);
+    struct tm t = test_make_tm(2025, 2, 2, 0, 0);
+    time_t first = mktime(&t);
+    int days = 35, gap = 20;
+    for (int d = 0; d < days; d++) {
+        if (d == gap) continue;
+        for (int m = 0; m < 1300; m++) {
+            add_at(first + (time_t)d * 86400 + m * 60, d * 1440 + m);
+        }
+    }
+
+    // 最新日から30日分（欠測日を除く）が日付どおりに取得でき、それより前は残らない
+    int newest = days - 1, oldest = newest - DATA_BUFFER_DAYS_PER_MONTH + 1;
+    for (int d = 0; d < days; d++) {
+        time_t day = first + (time_t)d * 86400;
+        struct tm date;
+        localtime_r(&day, &date);
+        daily_summary_data_t summary;
+        esp_err_t ret = data_buffer_get_daily_summary(&date, &summary);
+        if (d >= oldest && d != gap) {
+            CHECK(ret == ESP_OK);
+            CHECK(summary.date.tm_mday == date.tm_mday && summary.date.tm_mon == date.tm_mon);
+            CHECK(summary.valid_samples == 1300);
+        } else {
+            CHECK(ret == ESP_ERR_NOT_FOUND);
+        }
+    }
+
+    // 過去N日は古い順に並び、欠測日は飛ばして最新日で終わる
+    daily_summary_data_t summaries[DATA_BUFFER_DAYS_PER_MONTH];
+    uint8_t count = 0;
+    CHECK(data_buffer_get_recent_daily_summaries(20, summaries, &count) == ESP_OK);
+    CHECK(count == 20);
+    CHECK(mktime(&summaries[count - 1].date) == first + (time_t)newest * 86400);
+    CHECK(mktime(&summaries[0].date) == first + (time_t)(newest - 20) * 86400);
+    for (int i = 1; i < count; i++) {
+        CHECK(mktime(&summaries[i].date) > mktime(&summaries[i - 1].date));
+    }
+    CHECK(data_buffer_get_recent_daily_summaries(DATA_BUFFER_DAYS_PER_MONTH, summaries, &count) == ESP_OK);
+    CHECK(count == DATA_BUFFER_DAYS_PER_MONTH - 1);
+
+    // 1件ずつの参照も同じ順序
+    daily_summary_data_t summary;
+    for (int i = 0; i < 20; i++) {
+        CHECK(data_buffer_get_recent_daily_summary(i, &summary) == ESP_OK);
+        CHECK(mktime(&summary.date) == mktime(&summaries[count - 1 - i].date));
+    }
+    CHECK(data_buffer_get_recent_daily_summary(count, &summary) == ESP_ERR_NOT_FOUND);
+
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.daily_data_count == DATA_BUFFER_DAYS_PER_MONTH - 1);
+    CHECK(mktime(&stats.newest_daily_data) == first + (time_t)newest * 86400);
+    CHECK(mktime(&stats.oldest_daily_data) == first + (time_t)oldest * 86400);
+}
+
+static void bench_add_cost(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    struct timespec t0, t1;
+    int total = DATA_BUFFER_MINUTE_CAPACITY;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < total; i++) {
+        add_at(g_day0 + i * 60, i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    printf("  data_buffer_add_minute_data: %.1f ns/sample (%d samples)\n", ns / total, total);
+
+    struct tm date;
+    localtime_r(&g_day0, &date);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < 100; i++) {
+        data_buffer_recalculate_daily_summary(&date);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    printf("  full rescan (recalculate):   %.1f ns/call\n", ns / 100);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 3, 1, 0, 0);
+    g_day0 = mktime(&t);
+
+    RUN_TEST(test_consecutive_days);
+    RUN_TEST(test_overwrite_within_day);
+    RUN_TEST(test_clock_jumps_back);
+    RUN_TEST(test_midnight_step_back);
+    RUN_TEST(test_ring_wrap);
+    RUN_TEST(test_date_keyed_ring);
+    RUN_TEST(bench_add_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,137 @@
+#include "test_common.h"
+#include "drying_rate.h"
+
+// 乾燥速度の推定: 昼・夜の速度（指数重み付き最小二乗）、乾燥閾値に達する時刻の予測と実際の到達時刻、
+// 灌水でのやり直し、既に乾燥・湿潤方向、長期間（基準の移動）での精度
+
+#define BASE_MINUTE     29000000u   // 2025年頃のエポック分
+#define DAY_RATE        0.9f        // 昼の乾燥速度 [pF/時]
+#define NIGHT_RATE      0.3f        // 夜の乾燥速度 [pF/時]
+#define RESET_DROP      0.5f        // 灌水とみなす減少量 [pF]
+
+static uint32_t g_rng = 0x9e3779b9u;
+static float noise(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return ((g_rng >> 8) / 16777216.0f - 0.5f) * 0.02f;  // ±0.01pF
+}
+
+static bool is_day(int minute) {
+    int hour = (minute / 60) % 24;
+    return hour >= 6 && hour < 18;
+}
+
+/**
+ * 昼は DAY_RATE、夜は NIGHT_RATE で乾燥する波形（ノイズなしの値を返す）
+ */
+static float advance(float moisture, int minute) {
+    return moisture + (is_day(minute) ? DAY_RATE : NIGHT_RATE) / 60.0f;
+}
+
+static void test_day_night_rates(void) {
+    drying_rate_t est;
+    drying_rate_reset(&est);
+    float rate;
+    CHECK(!drying_rate_get(&est, DRYING_PERIOD_DAY, &rate));
+
+    float moisture = 3.0f;
+    for (int m = 0; m < 3 * 1440; m++) {
+        moisture = advance(moisture, m);
+        drying_rate_add(&est, BASE_MINUTE + m, moisture + noise(), is_day(m), RESET_DROP);
+    }
+    float day, night;
+    CHECK(drying_rate_get(&est, DRYING_PERIOD_DAY, &day));
+    CHECK(drying_rate_get(&est, DRYING_PERIOD_NIGHT, &night));
+    printf("  day %.4f pF/h, night %.4f pF/h, day fraction %.3f\n", day, night, est.day_fraction);
+    CHECK_NEAR(day, DAY_RATE, DAY_RATE * 0.05);
+    CHECK_NEAR(night, NIGHT_RATE, NIGHT_RATE * 0.05);
+    CHECK_NEAR(est.day_fraction, 0.5, 0.1);
+}
+
+static void test_forecast_matches_crossing(void) {
+    // 2日分で推定し、予測した時間と、同じ波形を続けて実際に閾値を越えた時間を比べる
+    drying_rate_t est;
+    drying_rate_reset(&est);
+    float moisture = 2.0f;
+    int m = 0;
+    for (; m < 2 * 1440 + 9 * 60; m++) {
+        moisture = advance(moisture, m);
+        drying_rate_add(&est, BASE_MINUTE + m, moisture, is_day(m), RESET_DROP);
+    }
+    float threshold = moisture + 50.0f;  // 数日先（昼と夜の速度を昼の割合で混ぜるため、1日未満の予測は時間帯でずれる）
+    drying_forecast_t forecast;
+    drying_rate_forecast(&est, threshold, &forecast);
+    CHECK(forecast.valid_mask == 0x03);
+    CHECK(forecast.samples[DRYING_PERIOD_DAY] > DRYING_RATE_MIN_SAMPLES);
+
+    int start = m;
+    while (moisture < threshold) {
+        moisture = advance(moisture, m++);
+    }
+    float actual_hours = (m - start) / 60.0f;
+    printf("  predicted %.1f h, actual %.1f h\n", forecast.hours_until_dry, actual_hours);
+    CHECK_NEAR(forecast.hours_until_dry, actual_hours, actual_hours * 0.1);
+}
+
+static void test_watering_restarts(void) {
+    drying_rate_t est;
+    drying_rate_reset(&est);
+    float moisture = 3.0f;
+    int m = 0;
+    for (; m < 600; m++) {
+        moisture = advance(moisture, m);
+        drying_rate_add(&est, BASE_MINUTE + m, moisture, false, RESET_DROP);
+    }
+    float rate;
+    CHECK(drying_rate_get(&est, DRYING_PERIOD_NIGHT, &rate));
+
+    // 灌水: 灌水前の傾きを捨て、DRYING_RATE_MIN_SAMPLES 件たまるまで求めない
+    moisture -= 2.0f;
+    drying_rate_add(&est, BASE_MINUTE + m++, moisture, false, RESET_DROP);
+    CHECK(est.period[DRYING_PERIOD_NIGHT].samples == 1);
+    CHECK(!drying_rate_get(&est, DRYING_PERIOD_NIGHT, &rate));
+    drying_forecast_t forecast;
+    drying_rate_forecast(&est, 10.0f, &forecast);
+    CHECK(forecast.valid_mask == 0 && forecast.hours_until_dry < 0.0f);
+
+    for (int i = 0; i < DRYING_RATE_MIN_SAMPLES; i++, m++) {
+        moisture += 0.5f / 60.0f;
+        drying_rate_add(&est, BASE_MINUTE + m, moisture, false, RESET_DROP);
+    }
+    CHECK(drying_rate_get(&est, DRYING_PERIOD_NIGHT, &rate));
+    CHECK_NEAR(rate, 0.5, 0.01);
+
+    // 既に乾燥閾値以上は0、湿潤方向は予測しない
+    drying_rate_forecast(&est, moisture - 0.1f, &forecast);
+    CHECK(forecast.hours_until_dry == 0.0f);
+    for (int i = 0; i < 300; i++, m++) {
+        moisture -= 0.2f / 60.0f;
+        drying_rate_add(&est, BASE_MINUTE + m, moisture, false, RESET_DROP);
+    }
+    drying_rate_forecast(&est, moisture + 1.0f, &forecast);
+    CHECK(forecast.rate[DRYING_PERIOD_NIGHT] < 0.0f && forecast.hours_until_dry < 0.0f);
+}
+
+static void test_long_run_precision(void) {
+    // 灌水なしで30日: 区分内の経過時間の基準を移しながら float の精度を保つ
+    drying_rate_t est;
+    drying_rate_reset(&est);
+    float moisture = 1.0f;
+    for (int m = 0; m < 30 * 1440; m++) {
+        moisture += 0.05f / 60.0f;
+        drying_rate_add(&est, BASE_MINUTE + m, moisture, true, RESET_DROP);
+    }
+    float rate;
+    CHECK(drying_rate_get(&est, DRYING_PERIOD_DAY, &rate));
+    CHECK_NEAR(rate, 0.05, 0.0025);
+    CHECK(est.period[DRYING_PERIOD_DAY].pos_t < 20000.0f);
+}
+
+int main(void) {
+    RUN_TEST(test_day_night_rates);
+    RUN_TEST(test_forecast_matches_crossing);
+    RUN_TEST(test_watering_restarts);
+    RUN_TEST(test_long_run_precision);
+    return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+#include "test_common.h"
+#include "event_log.h"
+
+// イベントログ: 最新N件・期間指定の取得（リングの折り返しをまたぐ二分探索）、容量超過時の上書き、
+// 時刻の逆行、保存用のイベント表からの復元
+
+#define BASE_EPOCH  1750000000u
+
+static event_entry_t make_event(uint32_t epoch, uint8_t type, int16_t magnitude) {
+    event_entry_t e = { epoch, type, 0x01, magnitude };
+    return e;
+}
+
+static void append_series(int n) {
+    for (int i = 0; i < n; i++) {
+        event_entry_t e = make_event(BASE_EPOCH + (uint32_t)i * 60, EVENT_TYPE_WATERING + (i % 4), (int16_t)i);
+        CHECK(event_log_append(&e) == ESP_OK);
+    }
+}
+
+static void test_empty_and_invalid(void) {
+    CHECK(event_log_init(NULL) == ESP_OK);
+    event_entry_t out[8];
+    uint16_t count = 99, total = 99;
+    CHECK(event_log_count() == 0);
+    CHECK(event_log_get_last(8, out) == 0);
+    CHECK(event_log_get_range(0, UINT32_MAX, 0, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 0 && total == 0);
+
+    event_entry_t bad = make_event(BASE_EPOCH, 0, 0);
+    CHECK(event_log_append(&bad) == ESP_ERR_INVALID_ARG);
+    bad.type = EVENT_TYPE_DROPOUT + 1;
+    CHECK(event_log_append(&bad) == ESP_ERR_INVALID_ARG);
+    CHECK(event_log_append(NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(event_log_get_range(BASE_EPOCH, BASE_EPOCH, 0, out, 8, &count, &total) == ESP_ERR_INVALID_ARG);
+    CHECK(event_log_count() == 0);
+}
+
+static void test_last_and_range(void) {
+    // 容量を超えて追加すると古いものから上書き（100件中、最新64件が残る）
+    CHECK(event_log_init(NULL) == ESP_OK);
+    append_series(100);
+    CHECK(event_log_count() == EVENT_LOG_CAPACITY);
+
+    event_entry_t out[EVENT_LOG_CAPACITY];
+    CHECK(event_log_get_last(5, out) == 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(out[i].magnitude == 99 - i);  // 新しい順
+    }
+    CHECK(event_log_get_last(200, out) == EVENT_LOG_CAPACITY);
+    CHECK(out[EVENT_LOG_CAPACITY - 1].magnitude == 100 - EVENT_LOG_CAPACITY);
+
+    // 期間指定: 開始を含み終了を含まない。リングの折り返し位置（i = 64）をまたぐ
+    uint16_t count, total;
+    CHECK(event_log_get_range(BASE_EPOCH + 50 * 60, BASE_EPOCH + 80 * 60, 0, out, 64, &count, &total) == ESP_OK);
+    CHECK(count == 30 && total == 30);
+    CHECK(out[0].magnitude == 50 && out[29].magnitude == 79);
+    bool ordered = true;
+    for (int i = 1; i < count; i++) {
+        ordered &= (out[i].epoch > out[i - 1].epoch);
+    }
+    CHECK(ordered);
+
+    // 件数の上限と読み飛ばしで続きを取得
+    CHECK(event_log_get_range(BASE_EPOCH + 50 * 60, BASE_EPOCH + 80 * 60, 0, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 8 && total == 30 && out[7].magnitude == 57);
+    CHECK(event_log_get_range(BASE_EPOCH + 50 * 60, BASE_EPOCH + 80 * 60, 24, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 6 && out[0].magnitude == 74);
+
+    // 時刻がイベントの間にある場合・上書き済みの期間
+    CHECK(event_log_get_range(BASE_EPOCH + 50 * 60 + 1, BASE_EPOCH + 51 * 60 + 1, 0, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 1 && out[0].magnitude == 51);
+    CHECK(event_log_get_range(BASE_EPOCH, BASE_EPOCH + 36 * 60, 0, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 0 && total == 0);
+    CHECK(event_log_get_range(BASE_EPOCH, BASE_EPOCH + 37 * 60, 0, out, 8, &count, &total) == ESP_OK);
+    CHECK(count == 1 && out[0].magnitude == 36 && out[0].type == EVENT_TYPE_WATERING);
+}
+
+static void test_time_backwards(void) {
+    // 直前より前の時刻は直前の時刻に揃え、時刻順（二分探索）を保つ
+    CHECK(event_log_init(NULL) == ESP_OK);
+    event_entry_t a = make_event(BASE_EPOCH + 600, EVENT_TYPE_WATERING, 1);
+    event_entry_t b = make_event(BASE_EPOCH, EVENT_TYPE_TEMP_HIGH, 2);
+    event_entry_t c = make_event(BASE_EPOCH + 1200, EVENT_TYPE_TEMP_LOW, 3);
+    CHECK(event_log_append(&a) == ESP_OK);
+    CHECK(event_log_append(&b) == ESP_OK);
+    CHECK(event_log_append(&c) == ESP_OK);
+
+    event_entry_t out[4];
+    uint16_t count, total;
+    CHECK(event_log_get_range(BASE_EPOCH + 600, BASE_EPOCH + 601, 0, out, 4, &count, &total) == ESP_OK);
+    CHECK(count == 2 && out[0].magnitude == 1 && out[1].magnitude == 2);
+    CHECK(event_log_get_range(BASE_EPOCH, BASE_EPOCH + 600, 0, out, 4, &count, &total) == ESP_OK);
+    CHECK(count == 0);
+}
+
+static void test_table_restore(void) {
+    // 保存用のイベント表から復元すると同じ結果を返す（NVSへの保存・読み込みに相当）
+    CHECK(event_log_init(NULL) == ESP_OK);
+    append_series(70);
+    static event_log_table_t table;
+    event_log_get_table(&table);
+    CHECK(table.count == EVENT_LOG_CAPACITY && table.head == 70 - EVENT_LOG_CAPACITY);
+
+    event_entry_t before[8], after[8];
+    CHECK(event_log_get_last(8, before) == 8);
+    event_log_clear();
+    CHECK(event_log_count() == 0);
+    CHECK(event_log_init(&table) == ESP_OK);
+    CHECK(event_log_count() == EVENT_LOG_CAPACITY);
+    CHECK(event_log_get_last(8, after) == 8);
+    CHECK(memcmp(before, after, sizeof(before)) == 0);
+
+    // 復元後も追加を続けられる
+    event_entry_t e = make_event(BASE_EPOCH + 70 * 60, EVENT_TYPE_NEEDS_WATERING, 70);
+    CHECK(event_log_append(&e) == ESP_OK);
+    CHECK(event_log_get_last(1, after) == 1 && after[0].magnitude == 70);
+
+    // 不整合な表は空で開始
+    table.count = EVENT_LOG_CAPACITY + 1;
+    CHECK(event_log_init(&table) == ESP_ERR_INVALID_ARG);
+    CHECK(event_log_count() == 0);
+}
+
+int main(void) {
+    RUN_TEST(test_empty_and_invalid);
+    RUN_TEST(test_last_and_range);
+    RUN_TEST(test_time_backwards);
+    RUN_TEST(test_table_restore);
+    return TEST_RESULT();
+}
@@ -0,0 +1,297 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_columns.h"
+#include "file_partition.h"
+#include <stdio.h>
+
+// 有効ビットマップの範囲操作（折り返しを含む）、件数のpopcount、欠測区間と原因（再起動・時刻の飛び・期限切れ・保持範囲外）、
+// 欠測時のスロット消去と統計、保持範囲より前に戻った時刻（時計の巻き戻し）での記録し直しと日別・週・月・集計の切り詰め
+
+#define GAP_PARTITION_FILE  "test_gaps.bin"
+
+static minute_columns_t g_cols;
+static time_t g_start;  // 投入開始時刻（0:00）
+
+static void add_minute(time_t base, int i) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, base + (time_t)i * 60, i);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+}
+
+static data_buffer_window_t make_window(int from, int to) {
+    data_buffer_window_t window = { (uint32_t)(g_start / 60) + from, (uint32_t)(g_start / 60) + to };
+    return window;
+}
+
+static void test_bitmap_ranges(void) {
+    minute_columns_clear(&g_cols);
+    minute_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.minute_key = 1;
+    for (int i = 0; i < MINUTE_COLUMNS_CAPACITY; i++) {
+        minute_columns_put(&g_cols, i, &rec);
+    }
+    CHECK(minute_columns_count_range(&g_cols, 100, 50) == 50);
+
+    // 末尾を越える範囲は先頭に折り返す
+    minute_columns_erase_range(&g_cols, MINUTE_COLUMNS_CAPACITY - 10, 20);
+    CHECK(minute_columns_count(&g_cols) == MINUTE_COLUMNS_CAPACITY - 20);
+    CHECK(!minute_columns_is_valid(&g_cols, MINUTE_COLUMNS_CAPACITY - 1) && !minute_columns_is_valid(&g_cols, 9));
+    CHECK(minute_columns_is_valid(&g_cols, MINUTE_COLUMNS_CAPACITY - 11) && minute_columns_is_valid(&g_cols, 10));
+    CHECK(minute_columns_count_range(&g_cols, MINUTE_COLUMNS_CAPACITY - 20, 40) == 20);
+    CHECK(minute_columns_run_length(&g_cols, MINUTE_COLUMNS_CAPACITY - 10, 30, false) == 20);
+    CHECK(minute_columns_run_length(&g_cols, MINUTE_COLUMNS_CAPACITY - 20, 40, true) == 10);
+    CHECK(minute_columns_run_length(&g_cols, 10, 5, true) == 5);
+
+    // ワードの途中から途中まで
+    minute_columns_erase_range(&g_cols, 37, 61);
+    CHECK(minute_columns_count_range(&g_cols, 32, 96) == 96 - 61);
+    CHECK(minute_columns_run_length(&g_cols, 10, 200, true) == 27);
+    CHECK(minute_columns_run_length(&g_cols, 37, 200, false) == 61);
+    CHECK(minute_columns_is_valid(&g_cols, 36) && !minute_columns_is_valid(&g_cols, 37) &&
+          !minute_columns_is_valid(&g_cols, 97) && minute_columns_is_valid(&g_cols, 98));
+
+    // 容量以上は全消去
+    minute_columns_erase_range(&g_cols, 500, MINUTE_COLUMNS_CAPACITY);
+    CHECK(minute_columns_count(&g_cols) == 0);
+    CHECK(minute_columns_run_length(&g_cols, 500, MINUTE_COLUMNS_CAPACITY, false) == MINUTE_COLUMNS_CAPACITY);
+}
+
+static void test_time_jump(void) {
+    // 0:00〜23:59 のうち 10:00〜11:59 が欠測（連続投入なので経過時間より時刻が大きく進んだ扱い）
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (i >= 600 && i < 720) continue;
+        add_minute(g_start, i);
+    }
+
+    data_buffer_window_t day = make_window(0, DATA_BUFFER_MINUTES_PER_DAY);
+    CHECK(data_buffer_count_minutes(&day) == DATA_BUFFER_MINUTES_PER_DAY - 120);
+    data_buffer_window_t hour = make_window(590, 650);
+    CHECK(data_buffer_count_minutes(&hour) == 10);
+
+    // 保持範囲の前後は保持範囲外の区間
+    data_buffer_gap_t gaps[4];
+    uint16_t count = 0, total = 0;
+    data_buffer_window_t wide = make_window(-60, DATA_BUFFER_MINUTES_PER_DAY + 60);
+    CHECK(data_buffer_get_gaps(&wide, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 3 && total == 3);
+    CHECK(gaps[0].start_minute == wide.start_minute && gaps[0].length == 60 && gaps[0].reason == DATA_BUFFER_GAP_OUT_OF_RANGE);
+    CHECK(gaps[1].start_minute == day.start_minute + 600 && gaps[1].length == 120 && gaps[1].reason == DATA_BUFFER_GAP_TIME_JUMP);
+    CHECK(gaps[2].start_minute == day.end_minute && gaps[2].length == 60 && gaps[2].reason == DATA_BUFFER_GAP_OUT_OF_RANGE);
+
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == DATA_BUFFER_MINUTES_PER_DAY - 120);
+    CHECK(mktime(&stats.oldest_minute_data) == g_start);
+    CHECK(mktime(&stats.newest_minute_data) == g_start + (DATA_BUFFER_MINUTES_PER_DAY - 1) * 60);
+
+    // 翌日 5:00 まで飛ぶ: 間のスロット（前日 0:00〜4:59 のデータ）は空きになる
+    add_minute(g_start, DATA_BUFFER_MINUTES_PER_DAY + 300);
+    data_buffer_window_t ring = make_window(301, DATA_BUFFER_MINUTES_PER_DAY + 301);
+    CHECK(data_buffer_count_minutes(&ring) == 299 + 720 + 1);
+    CHECK(data_buffer_count_minutes(&day) == 299 + 720);
+    CHECK(data_buffer_get_gaps(&ring, gaps, 1, &count, &total) == ESP_OK);
+    CHECK(count == 1 && total == 2);
+    CHECK(data_buffer_get_gaps(&ring, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 2);
+    CHECK(gaps[1].start_minute == day.end_minute && gaps[1].length == 300 && gaps[1].reason == DATA_BUFFER_GAP_TIME_JUMP);
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == 299 + 720 + 1);
+    CHECK(mktime(&stats.oldest_minute_data) == g_start + 301 * 60);
+
+    // 範囲が保持範囲と重ならない場合は全体が1区間
+    data_buffer_window_t old = make_window(-DATA_BUFFER_MINUTES_PER_DAY, -10);
+    CHECK(data_buffer_count_minutes(&old) == 0);
+    CHECK(data_buffer_get_gaps(&old, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 1 && gaps[0].length == DATA_BUFFER_MINUTES_PER_DAY - 10 && gaps[0].reason == DATA_BUFFER_GAP_OUT_OF_RANGE);
+}
+
+static void test_reboot(void) {
+    // 10時間分を記録して再起動、復元後の最初の記録までの欠測は再起動
+    file_partition_close();
+    remove(GAP_PARTITION_FILE);
+    CHECK(file_partition_open(GAP_PARTITION_FILE, 1024 * 1024) == 0);
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 600; i++) {
+        add_minute(g_start, i);
+    }
+    CHECK(data_buffer_flush() == ESP_OK);
+
+    CHECK(data_buffer_init() == ESP_OK);
+    data_buffer_window_t window = make_window(0, 800);
+    CHECK(data_buffer_count_minutes(&window) == 600);
+    for (int i = 700; i < 710; i++) {
+        add_minute(g_start, i);
+    }
+    add_minute(g_start, 720);
+
+    data_buffer_gap_t gaps[4];
+    uint16_t count = 0, total = 0;
+    window = make_window(0, 721);
+    CHECK(data_buffer_get_gaps(&window, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 2 && total == 2);
+    CHECK(gaps[0].start_minute == window.start_minute + 600 && gaps[0].length == 100 && gaps[0].reason == DATA_BUFFER_GAP_REBOOT);
+    CHECK(gaps[1].start_minute == window.start_minute + 710 && gaps[1].length == 10 && gaps[1].reason == DATA_BUFFER_GAP_TIME_JUMP);
+    CHECK(data_buffer_count_minutes(&window) == 611);
+
+    // 履歴ログを空にして後片付け
+    CHECK(data_buffer_clear_all() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    file_partition_close();
+    remove(GAP_PARTITION_FILE);
+}
+
+static struct tm day_date(int day) {
+    time_t t = g_start + (time_t)day * DATA_BUFFER_MINUTES_PER_DAY * 60;
+    struct tm date;
+    localtime_r(&t, &date);
+    return date;
+}
+
+static void check_reset_summaries(int bogus_day) {
+    // 巻き戻した後の2日（日曜・月曜）は確定して週・月に結合され、未来の日・週・月は残らない
+    struct tm today = day_date(0), bogus = day_date(bogus_day), tomorrow = day_date(1);
+    daily_summary_data_t summary;
+    CHECK(data_buffer_get_daily_summary(&today, &summary) == ESP_OK);
+    CHECK(summary.valid_samples == DATA_BUFFER_MINUTES_PER_DAY - 60);
+    CHECK(data_buffer_get_daily_summary(&tomorrow, &summary) == ESP_OK);
+    CHECK(summary.valid_samples == DATA_BUFFER_MINUTES_PER_DAY);
+    data_buffer_period_stats_t stats;
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &today, &stats) == ESP_OK && stats.days == 1);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &tomorrow, &stats) == ESP_OK && stats.days == 1);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &today, &stats) == ESP_OK && stats.days == 2);
+    CHECK(stats.field[QUANTILE_FIELD_TEMPERATURE].samples == 2 * DATA_BUFFER_MINUTES_PER_DAY - 60);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &bogus, &stats) == ESP_ERR_NOT_FOUND);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &bogus, &stats) == ESP_ERR_NOT_FOUND);
+    CHECK(data_buffer_merge_days(&bogus, &bogus, &stats) == ESP_ERR_NOT_FOUND);
+
+    // 1時間集計は巻き戻した時刻の区間から
+    history_point_data_t points[24];
+    uint16_t count = 0;
+    data_buffer_tier_t tier;
+    CHECK(data_buffer_get_history(&today, &tomorrow, points, 24, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_HOURLY && count == 23);
+    CHECK(points[0].samples == 60 && mktime(&points[0].timestamp) == g_start + 3600);
+
+    data_buffer_stats_t buffer_stats;
+    CHECK(data_buffer_get_stats(&buffer_stats) == ESP_OK);
+    CHECK(mktime(&buffer_stats.newest_minute_data) == g_start + 2 * DATA_BUFFER_MINUTES_PER_DAY * 60);
+}
+
+static void test_clock_reset(void) {
+    // 時刻同期前の不正な時刻で40日先の日付をまたいで1時間分を記録して再起動（最新データ・確定した日・10分/1時間集計は履歴ログから復元される）
+    const int bogus_day = 39;
+    const int future = (bogus_day + 1) * DATA_BUFFER_MINUTES_PER_DAY;
+    file_partition_close();
+    remove(GAP_PARTITION_FILE);
+    CHECK(file_partition_open(GAP_PARTITION_FILE, 1024 * 1024) == 0);
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = -30; i < 30; i++) {
+        add_minute(g_start, future + i);
+    }
+    CHECK(data_buffer_flush() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    data_buffer_window_t bogus = make_window(future - 30, future + 30);
+    CHECK(data_buffer_count_minutes(&bogus) == 60);
+    struct tm bogus_date = day_date(bogus_day);
+    data_buffer_period_stats_t period;
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &bogus_date, &period) == ESP_OK);
+
+    // 正しい時刻の記録は捨てずに、1分リングを空にして記録し直す
+    add_minute(g_start, 60);
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == 1);
+    CHECK(mktime(&stats.oldest_minute_data) == g_start + 60 * 60);
+    CHECK(mktime(&stats.newest_minute_data) == g_start + 60 * 60);
+    CHECK(data_buffer_count_minutes(&bogus) == 0);
+    for (int i = 61; i < 70; i++) {
+        add_minute(g_start, i);
+    }
+    data_buffer_window_t window = make_window(0, 70);
+    CHECK(data_buffer_count_minutes(&window) == 10);
+
+    // 巻き戻した時刻より前の保持範囲は時刻の飛びによる欠測
+    data_buffer_gap_t gaps[4];
+    uint16_t count = 0, total = 0;
+    CHECK(data_buffer_get_gaps(&window, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 1 && total == 1);
+    CHECK(gaps[0].start_minute == window.start_minute && gaps[0].length == 60 && gaps[0].reason == DATA_BUFFER_GAP_TIME_JUMP);
+
+    // 保持範囲内で戻った時刻は上書きするだけ
+    add_minute(g_start, 65);
+    CHECK(data_buffer_count_minutes(&window) == 10);
+
+    // 再起動後も巻き戻した時刻から続く
+    CHECK(data_buffer_flush() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minute(g_start, 70);
+    window = make_window(0, 71);
+    CHECK(data_buffer_count_minutes(&window) == 11);
+
+    // 日付が変わると巻き戻した日を確定する（未来の日が保持範囲の基準に残っていると捨てられる）
+    for (int i = 71; i <= 2 * DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        add_minute(g_start, i);
+    }
+    check_reset_summaries(bogus_day);
+
+    // 再起動後も履歴ログの未来の日・週・月・集計は復元しない（1日目は1分リングに残らず、日別ログからだけ復元される）
+    CHECK(data_buffer_flush() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    check_reset_summaries(bogus_day);
+
+    CHECK(data_buffer_clear_all() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    file_partition_close();
+    remove(GAP_PARTITION_FILE);
+}
+
+static void test_expiry(void) {
+    // 最新データが現在時刻の約100分前になる1日分を投入し、24時間より前の分を期限切れで削除
+    time_t now = time(NULL);
+    time_t base = now - (time_t)(DATA_BUFFER_MINUTES_PER_DAY + 100) * 60;
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        add_minute(base, i);
+    }
+    data_buffer_window_t window = { (uint32_t)(base / 60), (uint32_t)(base / 60) + DATA_BUFFER_MINUTES_PER_DAY };
+    CHECK(data_buffer_count_minutes(&window) == DATA_BUFFER_MINUTES_PER_DAY);
+
+    CHECK(data_buffer_cleanup_old_data() == ESP_OK);
+    uint16_t remaining = data_buffer_count_minutes(&window);
+    uint16_t expired = DATA_BUFFER_MINUTES_PER_DAY - remaining;
+    CHECK(expired >= 100 && expired <= 102);
+
+    data_buffer_gap_t gaps[4];
+    uint16_t count = 0, total = 0;
+    CHECK(data_buffer_get_gaps(&window, gaps, 4, &count, &total) == ESP_OK);
+    CHECK(count == 1 && gaps[0].start_minute == window.start_minute && gaps[0].length == expired &&
+          gaps[0].reason == DATA_BUFFER_GAP_EXPIRED);
+
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == remaining);
+    CHECK(mktime(&stats.oldest_minute_data) == (base / 60 + expired) * 60);
+
+    // 2回目は何も消さない
+    CHECK(data_buffer_cleanup_old_data() == ESP_OK);
+    CHECK(data_buffer_count_minutes(&window) == remaining);
+
+    // 次の記録は期限切れ後の残りから日別集計を再計算する
+    add_minute(base, DATA_BUFFER_MINUTES_PER_DAY);
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == remaining + 1);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_bitmap_ranges);
+    RUN_TEST(test_time_jump);
+    RUN_TEST(test_reboot);
+    RUN_TEST(test_clock_reset);
+    RUN_TEST(test_expiry);
+    return TEST_RESULT();
+}
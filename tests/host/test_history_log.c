@@ -0,0 +1,319 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "history_log.h"
+#include "rollup_tier.h"
+#include "file_partition.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+// 追記ログの形式（ファイルパーティション上）と、data_buffer の再起動時復元・確定済みの集計区間を追記し直さないことの確認
+
+#define LOG_PARTITION_FILE  "test_history_log.bin"
+#define LOG_ENTRY_SIZE      27
+#define LOG_REGION_PAGES    8
+
+static uint8_t g_page_buf[HISTORY_LOG_PAGE_SIZE];
+static uint8_t g_replay_buf[HISTORY_LOG_PAGE_SIZE];   // 再起動後のログ用（書き込み中のログとは別）
+
+typedef struct {
+    uint32_t count;
+    uint32_t first;
+    uint32_t last;
+    bool ordered;
+} replay_result_t;
+
+static void make_entry(uint8_t *entry, uint32_t index) {
+    for (int i = 0; i < LOG_ENTRY_SIZE; i++) {
+        entry[i] = (uint8_t)(index * 7 + i);
+    }
+    memcpy(entry, &index, sizeof(index));
+}
+
+static void collect_entry(const void *entry, void *ctx) {
+    replay_result_t *r = (replay_result_t *)ctx;
+    uint32_t index;
+    memcpy(&index, entry, sizeof(index));
+    uint8_t expected[LOG_ENTRY_SIZE];
+    make_entry(expected, index);
+    if (memcmp(entry, expected, LOG_ENTRY_SIZE) != 0 || (r->count > 0 && index != r->last + 1)) {
+        r->ordered = false;
+    }
+    if (r->count == 0) {
+        r->first = index;
+    }
+    r->last = index;
+    r->count++;
+}
+
+static replay_result_t reopen_and_replay(uint32_t max_entries) {
+    history_storage_t storage;
+    history_log_t log;
+    replay_result_t r = { .ordered = true };
+    CHECK(history_storage_get(&storage) == ESP_OK);
+    CHECK(history_log_open(&log, &storage, 0, LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE,
+                           LOG_ENTRY_SIZE, g_replay_buf, sizeof(g_replay_buf)) == ESP_OK);
+    uint32_t count = 0;
+    CHECK(history_log_replay(&log, max_entries, collect_entry, &r, &count) == ESP_OK);
+    CHECK(count == r.count);
+    return r;
+}
+
+static void fresh_partition(uint32_t size) {
+    file_partition_close();
+    remove(LOG_PARTITION_FILE);
+    CHECK(file_partition_open(LOG_PARTITION_FILE, size) == 0);
+}
+
+static void test_append_and_replay(void) {
+    fresh_partition(LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE);
+
+    history_storage_t storage;
+    history_log_t log;
+    CHECK(history_storage_get(&storage) == ESP_OK);
+    CHECK(history_log_open(&log, &storage, 0, LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE,
+                           LOG_ENTRY_SIZE, g_page_buf, sizeof(g_page_buf)) == ESP_OK);
+    uint16_t per_page = log.entries_per_page;
+    CHECK(per_page == (HISTORY_LOG_PAGE_SIZE - HISTORY_LOG_HEADER_SIZE) / LOG_ENTRY_SIZE);
+
+    uint8_t entry[LOG_ENTRY_SIZE];
+    uint32_t total = per_page * 3 + 10;
+    for (uint32_t i = 0; i < total; i++) {
+        make_entry(entry, i);
+        CHECK(history_log_append(&log, entry) == ESP_OK);
+    }
+
+    // フラッシュへのアクセスは封印したページ数分のみ（サンプル毎ではない）
+    CHECK(file_partition_total_erases() == 3);
+    CHECK(file_partition_total_writes() == 3);
+    printf("  %u entries -> %u page erases, %u page writes (%u entries/page)\n",
+           (unsigned)total, (unsigned)file_partition_total_erases(), (unsigned)file_partition_total_writes(), per_page);
+
+    // 未封印の10件は再起動で失われ、封印済みは古い順に復元される
+    replay_result_t r = reopen_and_replay(UINT32_MAX);
+    CHECK(r.ordered);
+    CHECK(r.count == per_page * 3u);
+    CHECK(r.first == 0);
+
+    // flush後は全件
+    CHECK(history_log_flush(&log) == ESP_OK);
+    r = reopen_and_replay(UINT32_MAX);
+    CHECK(r.ordered && r.count == total && r.last == total - 1);
+
+    // 末尾からN件
+    r = reopen_and_replay(100);
+    CHECK(r.ordered && r.count == 100 && r.first == total - 100 && r.last == total - 1);
+}
+
+static void test_wrap_and_wear(void) {
+    fresh_partition(LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE);
+
+    history_storage_t storage;
+    history_log_t log;
+    CHECK(history_storage_get(&storage) == ESP_OK);
+    CHECK(history_log_open(&log, &storage, 0, LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE,
+                           LOG_ENTRY_SIZE, g_page_buf, sizeof(g_page_buf)) == ESP_OK);
+
+    // 領域を約5周させる
+    uint8_t entry[LOG_ENTRY_SIZE];
+    uint32_t total = log.entries_per_page * (LOG_REGION_PAGES * 5 + 3);
+    for (uint32_t i = 0; i < total; i++) {
+        make_entry(entry, i);
+        CHECK(history_log_append(&log, entry) == ESP_OK);
+    }
+
+    replay_result_t r = reopen_and_replay(UINT32_MAX);
+    CHECK(r.ordered);
+    CHECK(r.count == (uint32_t)log.entries_per_page * LOG_REGION_PAGES);
+    CHECK(r.last == total - 1);
+
+    // 消去回数は全ページで均等（差は1以内）
+    uint32_t min = UINT32_MAX, max = 0;
+    for (uint32_t s = 0; s < LOG_REGION_PAGES; s++) {
+        uint32_t n = file_partition_erase_count(s);
+        if (n < min) min = n;
+        if (n > max) max = n;
+    }
+    printf("  erase count per page: min=%u max=%u\n", (unsigned)min, (unsigned)max);
+    CHECK(max - min <= 1);
+}
+
+static void test_corrupt_page_skipped(void) {
+    fresh_partition(LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE);
+
+    history_storage_t storage;
+    history_log_t log;
+    CHECK(history_storage_get(&storage) == ESP_OK);
+    CHECK(history_log_open(&log, &storage, 0, LOG_REGION_PAGES * HISTORY_LOG_PAGE_SIZE,
+                           LOG_ENTRY_SIZE, g_page_buf, sizeof(g_page_buf)) == ESP_OK);
+    uint8_t entry[LOG_ENTRY_SIZE];
+    uint32_t total = log.entries_per_page * 3;
+    for (uint32_t i = 0; i < total; i++) {
+        make_entry(entry, i);
+        CHECK(history_log_append(&log, entry) == ESP_OK);
+    }
+
+    // 2ページ目のエントリを1ビット破壊（書き込み途中の電源断に相当）
+    uint8_t zero = 0;
+    CHECK(storage.write(storage.ctx, HISTORY_LOG_PAGE_SIZE + HISTORY_LOG_HEADER_SIZE + 5, &zero, 1) == ESP_OK);
+
+    replay_result_t r = reopen_and_replay(UINT32_MAX);
+    CHECK(r.count == (uint32_t)log.entries_per_page * 2);
+    CHECK(r.first == 0 && r.last == total - 1);
+}
+
+static void test_data_buffer_restore(void) {
+    fresh_partition(1024 * 1024);
+    CHECK(data_buffer_init() == ESP_OK);
+
+    // 3日と21時間分を投入し、最後の書き戻しバッファも保存
+    struct tm start_tm = test_make_tm(2025, 5, 1, 0, 0);
+    time_t start = mktime(&start_tm);
+    int total = 3 * DATA_BUFFER_MINUTES_PER_DAY + 21 * 60;
+    for (int i = 0; i < total; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+    CHECK(data_buffer_flush() == ESP_OK);
+
+    data_buffer_stats_t before, after;
+    CHECK(data_buffer_get_stats(&before) == ESP_OK);
+    minute_data_t latest_before, latest_after;
+    CHECK(data_buffer_get_latest_minute_data(&latest_before) == ESP_OK);
+    daily_summary_data_t day1_before, day1_after, day5_before, day5_after;
+    struct tm day1 = test_make_tm(2025, 5, 1, 12, 0);
+    struct tm day4 = test_make_tm(2025, 5, 4, 12, 0);
+    CHECK(data_buffer_get_daily_summary(&day1, &day1_before) == ESP_OK);
+    CHECK(data_buffer_get_daily_summary(&day4, &day5_before) == ESP_OK);
+
+    // 全期間の10分集計（1分データから消えた区間を含む）
+    static history_point_data_t points_before[600], points_after[600];
+    uint16_t points_count_before, points_count_after;
+    data_buffer_tier_t tier_before, tier_after;
+    time_t end = start + (time_t)total * 60;
+    struct tm range_start, range_end;
+    localtime_r(&start, &range_start);
+    localtime_r(&end, &range_end);
+    CHECK(data_buffer_get_history(&range_start, &range_end, points_before, 600, &points_count_before, &tier_before) == ESP_OK);
+    CHECK(tier_before == DATA_BUFFER_TIER_10MIN && points_count_before == total / 10);
+
+    printf("  flash usage: %u page erases for %d samples\n", (unsigned)file_partition_total_erases(), total);
+
+    // 再起動（RAMを破棄して履歴ログから復元）
+    int64_t t0 = esp_timer_get_time();
+    CHECK(data_buffer_init() == ESP_OK);
+    int64_t elapsed_us = esp_timer_get_time() - t0;
+    printf("  restore: %lld us\n", (long long)elapsed_us);
+    CHECK(elapsed_us < 200000);
+
+    CHECK(data_buffer_get_stats(&after) == ESP_OK);
+    CHECK(after.minute_data_count == before.minute_data_count);
+    CHECK(mktime(&after.oldest_minute_data) == mktime(&before.oldest_minute_data));
+    CHECK(mktime(&after.newest_minute_data) == mktime(&before.newest_minute_data));
+    CHECK(after.daily_data_count == before.daily_data_count);
+
+    CHECK(data_buffer_get_latest_minute_data(&latest_after) == ESP_OK);
+    CHECK(mktime(&latest_after.timestamp) == mktime(&latest_before.timestamp));
+    CHECK(latest_after.temperature == latest_before.temperature);
+
+    // 1日目はリングから消えているので日別ログから、4日目は1分データから再集計
+    CHECK(data_buffer_get_daily_summary(&day1, &day1_after) == ESP_OK);
+    CHECK(memcmp(&day1_before, &day1_after, sizeof(daily_summary_data_t)) == 0);
+    CHECK(data_buffer_get_daily_summary(&day4, &day5_after) == ESP_OK);
+    CHECK(memcmp(&day5_before, &day5_after, sizeof(daily_summary_data_t)) == 0);
+
+    // 10分集計は集計ログから、直近24時間分は1分データから再構築
+    CHECK(data_buffer_get_history(&range_start, &range_end, points_after, 600, &points_count_after, &tier_after) == ESP_OK);
+    CHECK(tier_after == tier_before && points_count_after == points_count_before);
+    CHECK(memcmp(points_before, points_after, sizeof(history_point_data_t) * points_count_before) == 0);
+
+    // 復元後の追記も継続できる
+    soil_data_t sd;
+    test_fill_sensor(&sd, start + (time_t)total * 60, total);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    CHECK(data_buffer_clear_all() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_get_stats(&after) == ESP_OK);
+    CHECK(after.minute_data_count == 0 && after.daily_data_count == 0);
+
+    file_partition_close();
+    remove(LOG_PARTITION_FILE);
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t buckets[16];
+} rollup_replay_t;
+
+static void collect_rollup_bucket(const void *entry, void *ctx) {
+    rollup_replay_t *r = (rollup_replay_t *)ctx;
+    if (r->count < 16) {
+        memcpy(&r->buckets[r->count], entry, sizeof(uint32_t));
+    }
+    r->count++;
+}
+
+static void test_late_sample_not_resealed(void) {
+    fresh_partition(1024 * 1024);
+    CHECK(data_buffer_init() == ESP_OK);
+
+    // 0:00〜0:59 を記録した後、時計が0:25に戻ってから0:60以降に進む
+    struct tm start_tm = test_make_tm(2025, 5, 1, 0, 0);
+    time_t start = mktime(&start_tm);
+    soil_data_t sd;
+    for (int i = 0; i < 60; i++) {
+        test_fill_sensor(&sd, start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+    history_point_data_t before, after;
+    uint16_t count;
+    data_buffer_tier_t tier;
+    time_t bucket_start = start + 20 * 60, bucket_end = start + 30 * 60;
+    struct tm range_start, range_end;
+    localtime_r(&bucket_start, &range_start);
+    localtime_r(&bucket_end, &range_end);
+    CHECK(data_buffer_get_history(&range_start, &range_end, &before, 1, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_10MIN && count == 1);
+
+    test_fill_sensor(&sd, start + 25 * 60, 100000);
+    sd.temperature = 40.0f;
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    for (int i = 60; i < 70; i++) {
+        test_fill_sensor(&sd, start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+
+    // 遅れたサンプルは確定済みの区間のレコードに反映される
+    CHECK(data_buffer_get_history(&range_start, &range_end, &after, 1, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_10MIN && count == 1 && after.samples == 10);
+    CHECK(after.max_temperature >= 40.0f && after.avg_temperature > before.avg_temperature);
+
+    // 10分集計ログには各区間が1回ずつ順に記録される（書き込み中だった0:50の区間を途中で確定しない）
+    CHECK(data_buffer_flush() == ESP_OK);
+    history_storage_t storage;
+    history_log_t log;
+    CHECK(history_storage_get(&storage) == ESP_OK);
+    CHECK(history_log_open(&log, &storage, DATA_BUFFER_HISTORY_DAILY_REGION, DATA_BUFFER_HISTORY_TIER10_REGION,
+                           sizeof(uint32_t) + sizeof(rollup_record_t), g_replay_buf, sizeof(g_replay_buf)) == ESP_OK);
+    rollup_replay_t r = { 0 };
+    uint32_t replayed = 0;
+    CHECK(history_log_replay(&log, DATA_BUFFER_TIER10_CAPACITY, collect_rollup_bucket, &r, &replayed) == ESP_OK);
+    CHECK(r.count == 6);
+    uint32_t first_bucket = (uint32_t)(start / 60) / DATA_BUFFER_TIER10_MINUTES;
+    for (uint32_t i = 0; i < r.count && i < 16; i++) {
+        CHECK(r.buckets[i] == first_bucket + i);
+    }
+
+    CHECK(data_buffer_clear_all() == ESP_OK);
+    file_partition_close();
+    remove(LOG_PARTITION_FILE);
+}
+
+int main(void) {
+    RUN_TEST(test_append_and_replay);
+    RUN_TEST(test_wrap_and_wear);
+    RUN_TEST(test_corrupt_page_skipped);
+    RUN_TEST(test_data_buffer_restore);
+    RUN_TEST(test_late_sample_not_resealed);
+    return TEST_RESULT();
+}
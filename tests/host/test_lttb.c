@@ -0,0 +1,257 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+
+// 範囲クエリのLTTBモード: 配列上の素朴なLTTBとの一致、山（スパイク）と最初/最後の点の保持、
+// 欠測行、分割取得、不正なクエリ、1440分→約200点の処理時間（平均による間引きとの比較）
+
+#define GAP_FROM    300             // 欠測区間 [GAP_FROM, GAP_TO)
+#define GAP_TO      330
+#define SPIKE_AT    700             // 1分だけの急上昇（平均では潰れる）
+#define STEP        7               // 1440分 → 206点
+
+static time_t g_start;  // 投入開始時刻（0:00）
+
+/**
+ * 気温の投入値（ゆっくりした変化 + 疑似乱数のノイズ + スパイク）
+ */
+static float sample_temperature(int i) {
+    uint32_t h = (uint32_t)i * 2654435761u;
+    float noise = (float)((h >> 16) % 61) / 100.0f - 0.3f;
+    float t = 20.0f + 5.0f * sinf(i * 0.01f) + noise;
+    if (i == SPIKE_AT) {
+        t += 12.0f;
+    }
+    return t;
+}
+
+static bool in_gap(int i) {
+    return i >= GAP_FROM && i < GAP_TO;
+}
+
+/**
+ * 投入値をパック形式の整数に変換した期待値
+ */
+static int32_t expected_raw(int i) {
+    minute_data_t md;
+    memset(&md, 0, sizeof(md));
+    md.temperature = sample_temperature(i);
+    minute_record_t rec;
+    minute_record_encode(&md, 0, &rec);
+    return rec.temperature;
+}
+
+/**
+ * 全データを配列に展開してから行ごとに選ぶ素朴なLTTB（次の行の平均点は浮動小数点）
+ */
+static void reference_lttb(int step, int rows, int16_t *values, int16_t *offsets) {
+    bool has_prev = false;
+    double prev_x = 0, prev_y = 0;
+    for (int r = 0; r < rows; r++) {
+        values[r] = DATA_BUFFER_QUERY_NONE;
+        offsets[r] = DATA_BUFFER_QUERY_NONE;
+        int first = -1, last = -1;
+        for (int i = r * step; i < (r + 1) * step && i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+            if (!in_gap(i)) {
+                if (first < 0) first = i;
+                last = i;
+            }
+        }
+        if (first < 0) {
+            continue;
+        }
+
+        // 次のデータのある行の平均点
+        double cx = 0, cy = 0;
+        int cn = 0;
+        for (int nr = r + 1; nr < rows && cn == 0; nr++) {
+            for (int i = nr * step; i < (nr + 1) * step && i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+                if (!in_gap(i)) {
+                    cx += i;
+                    cy += expected_raw(i);
+                    cn++;
+                }
+            }
+        }
+
+        int best = first;
+        if (has_prev && cn == 0) {
+            best = last;
+        } else if (has_prev) {
+            cx /= cn;
+            cy /= cn;
+            double best_area = -1;
+            for (int i = first; i <= last; i++) {
+                if (in_gap(i)) continue;
+                double area = fabs((prev_x - cx) * (expected_raw(i) - prev_y) - (prev_x - i) * (cy - prev_y)) * 0.5;
+                if (area > best_area) {
+                    best_area = area;
+                    best = i;
+                }
+            }
+        }
+        has_prev = true;
+        prev_x = best;
+        prev_y = expected_raw(best);
+        values[r] = (int16_t)expected_raw(best);
+        offsets[r] = (int16_t)(best - r * step);
+    }
+}
+
+static void test_matches_reference(void) {
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, STEP, 1u << DATA_BUFFER_FIELD_TEMPERATURE,
+                                            DATA_BUFFER_AGG_LTTB);
+    CHECK(data_buffer_query_columns(&q) == 2);
+    uint16_t total = data_buffer_query_rows(&q);
+    CHECK(total == 206);
+
+    static int16_t columns[2 * 206];
+    static int16_t ref_values[206], ref_offsets[206];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, total, columns, &rows) == ESP_OK);
+    CHECK(rows == total);
+    reference_lttb(STEP, total, ref_values, ref_offsets);
+
+    int mismatches = 0;
+    for (int r = 0; r < rows; r++) {
+        if (columns[r] != ref_values[r] || columns[total + r] != ref_offsets[r]) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // 選ばれた点は実在する1分データ（行内の分から時刻を復元して一致）
+    int not_real = 0;
+    for (int r = 0; r < rows; r++) {
+        if (columns[r] == DATA_BUFFER_QUERY_NONE) continue;
+        int minute = r * STEP + columns[total + r];
+        if (columns[total + r] < 0 || columns[total + r] >= STEP || in_gap(minute) || expected_raw(minute) != columns[r]) {
+            not_real++;
+        }
+    }
+    CHECK(not_real == 0);
+}
+
+static void test_keeps_extremes(void) {
+    uint16_t mask = 1u << DATA_BUFFER_FIELD_TEMPERATURE;
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, STEP, mask, DATA_BUFFER_AGG_LTTB);
+    static int16_t lttb[2 * 206];
+    static int16_t avg[206];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, 206, lttb, &rows) == ESP_OK);
+    q.aggregate = DATA_BUFFER_AGG_AVG;
+    CHECK(data_buffer_query(&q, 0, 206, avg, &rows) == ESP_OK);
+
+    // スパイクの行はLTTBではスパイクそのもの、平均では大きく潰れる
+    int spike_row = SPIKE_AT / STEP;
+    CHECK(lttb[spike_row] == expected_raw(SPIKE_AT));
+    CHECK(lttb[206 + spike_row] == SPIKE_AT % STEP);
+    CHECK(avg[spike_row] < expected_raw(SPIKE_AT) - 1000);
+
+    // 最初の点と最後の点は必ず残る
+    CHECK(lttb[0] == expected_raw(0) && lttb[206] == 0);
+    int last = DATA_BUFFER_MINUTES_PER_DAY - 1;
+    CHECK(lttb[205] == expected_raw(last) && lttb[206 + 205] == last % STEP);
+
+    // データのない行は値・分ともに DATA_BUFFER_QUERY_NONE
+    for (int r = GAP_FROM / STEP + 1; r < GAP_TO / STEP; r++) {
+        CHECK(lttb[r] == DATA_BUFFER_QUERY_NONE && lttb[206 + r] == DATA_BUFFER_QUERY_NONE);
+    }
+    CHECK(lttb[GAP_TO / STEP] != DATA_BUFFER_QUERY_NONE);
+}
+
+static void test_chunked(void) {
+    // 選択は前の行に依存するが、分割取得でも一括取得と同じ
+    uint16_t mask = 1u << DATA_BUFFER_FIELD_TEMPERATURE;
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, STEP, mask, DATA_BUFFER_AGG_LTTB);
+    static int16_t whole[2 * 206];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, 206, whole, &rows) == ESP_OK);
+
+    int16_t chunk[2 * 50];
+    int mismatches = 0;
+    uint16_t first = 0;
+    while (first < 206) {
+        CHECK(data_buffer_query(&q, first, 50, chunk, &rows) == ESP_OK);
+        CHECK(rows > 0);
+        for (int k = 0; k < 2; k++) {
+            for (int r = 0; r < rows; r++) {
+                if (chunk[k * 50 + r] != whole[k * 206 + first + r]) mismatches++;
+            }
+        }
+        first += rows;
+    }
+    CHECK(mismatches == 0);
+
+    // 照度でも選べる（値の列は16bit符号）
+    q.field_mask = 1u << DATA_BUFFER_FIELD_LUX;
+    CHECK(data_buffer_query(&q, 0, 206, whole, &rows) == ESP_OK);
+    CHECK(rows == 206);
+    int none = 0;
+    for (int r = 0; r < rows; r++) {
+        if (whole[r] == DATA_BUFFER_QUERY_NONE) none++;
+    }
+    CHECK(none == GAP_TO / STEP - GAP_FROM / STEP - 1);
+}
+
+static void test_invalid_query(void) {
+    int16_t columns[16];
+    uint16_t rows;
+    // 複数フィールド、候補点を保持できない行幅は不可
+    data_buffer_query_t q = test_make_query(g_start, 0, 60, 5, (1u << DATA_BUFFER_FIELD_TEMPERATURE) | (1u << DATA_BUFFER_FIELD_HUMIDITY),
+                                            DATA_BUFFER_AGG_LTTB);
+    CHECK(data_buffer_query_columns(&q) == 0);
+    CHECK(data_buffer_query(&q, 0, 8, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q = test_make_query(g_start, 0, 600, DATA_BUFFER_LTTB_MAX_STEP + 1, 1u << DATA_BUFFER_FIELD_TEMPERATURE, DATA_BUFFER_AGG_LTTB);
+    CHECK(data_buffer_query(&q, 0, 8, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q.step_minutes = DATA_BUFFER_LTTB_MAX_STEP;
+    CHECK(data_buffer_query_rows(&q) == 600 / DATA_BUFFER_LTTB_MAX_STEP);
+    CHECK(data_buffer_query(&q, 0, 8, columns, &rows) == ESP_OK && rows == 8);
+}
+
+static void bench_lttb_vs_avg(void) {
+    // 1440分 → 206点: LTTB（整数の外積のみ、浮動小数点なし）と平均による間引き
+    const int iterations = 200;
+    static int16_t columns[2 * 206];
+    uint16_t rows = 0;
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, STEP, 1u << DATA_BUFFER_FIELD_TEMPERATURE,
+                                            DATA_BUFFER_AGG_AVG);
+    clock_t t0 = clock();
+    for (int n = 0; n < iterations; n++) {
+        CHECK(data_buffer_query(&q, 0, 206, columns, &rows) == ESP_OK);
+    }
+    clock_t t1 = clock();
+    q.aggregate = DATA_BUFFER_AGG_LTTB;
+    for (int n = 0; n < iterations; n++) {
+        CHECK(data_buffer_query(&q, 0, 206, columns, &rows) == ESP_OK);
+    }
+    clock_t t2 = clock();
+    printf("  1440 -> %u points: avg %.1f us, lttb %.1f us (candidate buffer %d bytes)\n", rows,
+           (double)(t1 - t0) * 1e6 / CLOCKS_PER_SEC / iterations,
+           (double)(t2 - t1) * 1e6 / CLOCKS_PER_SEC / iterations,
+           (int)(2 * DATA_BUFFER_LTTB_MAX_STEP * (sizeof(int32_t) + sizeof(uint8_t))));
+    CHECK(rows == 206);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (in_gap(i)) {
+            continue;
+        }
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        sd.temperature = sample_temperature(i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_keeps_extremes);
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_invalid_query);
+    RUN_TEST(bench_lttb_vs_avg);
+    return TEST_RESULT();
+}
@@ -0,0 +1,136 @@
+#include "test_common.h"
+#include "data_buffer.h"
+
+// 1分データイテレータの走査順・範囲・欠測の扱い、コピー版APIとの一致、走査中の書き込み
+
+static time_t g_start;  // 投入開始時刻（0:00）
+
+static void add_minute(int i) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+}
+
+static void test_day_window_order_and_gaps(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    // 2日目の途中まで投入（17分おきに欠測）。1日目の0:00〜4:59はリングから上書きされる
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY + 300; i++) {
+        if (i % 17 != 0) add_minute(i);
+    }
+
+    struct tm day1 = test_make_tm(2025, 1, 1, 12, 0);
+    data_buffer_window_t window = data_buffer_window_day(&day1);
+    data_buffer_iter_t it;
+    CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+
+    int expected = 300, count = 0;
+    while (data_buffer_iter_next(&it)) {
+        while (expected % 17 == 0) expected++;
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)expected * 60, expected);
+        CHECK(data_buffer_iter_time(&it) == g_start + (time_t)expected * 60);
+        CHECK_NEAR(data_buffer_iter_temperature(&it), sd.temperature, 0.006f);
+        CHECK_NEAR(data_buffer_iter_humidity(&it), sd.humidity, 0.006f);
+        CHECK_NEAR(data_buffer_iter_lux(&it), sd.lux, sd.lux * 0.0005f);
+        CHECK_NEAR(data_buffer_iter_soil_moisture(&it), sd.soil_moisture, 0.001f);
+        float soil_temp;
+        CHECK(data_buffer_iter_soil_temperature(&it, &soil_temp));
+        expected++;
+        count++;
+    }
+    // 1日目は24:00で終わる
+    CHECK(expected == DATA_BUFFER_MINUTES_PER_DAY);
+
+    // コピー版と件数・内容が一致する
+    static minute_data_t data[DATA_BUFFER_MINUTES_PER_DAY];
+    uint16_t copied = 0;
+    CHECK(data_buffer_get_day_minute_data(&day1, data, &copied) == ESP_OK);
+    CHECK(copied == count);
+    CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+    for (int i = 0; i < copied && data_buffer_iter_next(&it); i++) {
+        minute_data_t decoded;
+        data_buffer_iter_decode(&it, &decoded);
+        CHECK(memcmp(&decoded, &data[i], sizeof(minute_data_t)) == 0);
+    }
+
+    // 保持範囲より前から始まる範囲も、残っている最古のデータ（最新の1439分前）から返る
+    window.start_minute = 0;
+    window.end_minute = UINT32_MAX;
+    CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+    CHECK(data_buffer_iter_next(&it));
+    CHECK(data_buffer_iter_time(&it) == g_start + 300 * 60);
+}
+
+static void test_recent_window(void) {
+    // 過去1時間の範囲は現在時刻基準で、最新データまで返る
+    time_t now = time(NULL) / 60 * 60;
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < 90; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, now - (time_t)(89 - i) * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+    data_buffer_window_t window = data_buffer_window_recent(60);
+    data_buffer_iter_t it;
+    CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+    int count = 0;
+    time_t last = 0;
+    while (data_buffer_iter_next(&it)) {
+        CHECK(data_buffer_iter_time(&it) > now - 3600);
+        last = data_buffer_iter_time(&it);
+        count++;
+    }
+    CHECK(count == 60);
+    CHECK(last == now);
+}
+
+static void test_writer_during_iteration(void) {
+    // 走査の途中で書き込みがあっても、上書きされた分は読み飛ばし、追加された分は順に返す
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        add_minute(i);
+    }
+
+    data_buffer_window_t window = { 0, UINT32_MAX };
+    data_buffer_iter_t it;
+    CHECK(data_buffer_iter_begin(&it, &window) == ESP_OK);
+    int next_writer = DATA_BUFFER_MINUTES_PER_DAY;
+    time_t prev = 0;
+    int count = 0;
+    while (data_buffer_iter_next(&it)) {
+        time_t t = data_buffer_iter_time(&it);
+        CHECK(t > prev);
+        int i = (int)((t - g_start) / 60);
+        soil_data_t sd;
+        test_fill_sensor(&sd, t, i);
+        CHECK_NEAR(data_buffer_iter_temperature(&it), sd.temperature, 0.006f);
+        prev = t;
+        count++;
+        // 1件読むごとに2件追加（リングの先頭から上書きされていく）
+        if (next_writer < 2 * DATA_BUFFER_MINUTES_PER_DAY) {
+            add_minute(next_writer++);
+            add_minute(next_writer++);
+        }
+    }
+    // 追い越された分は返らないが、最後は必ず最新データで終わる
+    CHECK(prev == g_start + (time_t)(next_writer - 1) * 60);
+    printf("  read %d records while %d were written\n", count, next_writer - DATA_BUFFER_MINUTES_PER_DAY);
+}
+
+static void test_watering_stack_usage(void) {
+    // detect_watering_event が従来スタックに置いていた60件分の配列とイテレータの比較
+    printf("  minute_data_t[60]: %zu bytes, data_buffer_iter_t: %zu bytes\n",
+           sizeof(minute_data_t) * 60, sizeof(data_buffer_iter_t));
+    CHECK(sizeof(data_buffer_iter_t) < 64);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_day_window_order_and_gaps);
+    RUN_TEST(test_recent_window);
+    RUN_TEST(test_writer_during_iteration);
+    RUN_TEST(test_watering_stack_usage);
+    return TEST_RESULT();
+}
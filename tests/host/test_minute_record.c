@@ -0,0 +1,159 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+
+// 固定小数点形式の往復変換と、パック形式による保持分数の確認
+
+static void test_roundtrip_values(void) {
+    minute_data_t src, dst;
+    minute_record_t rec;
+    time_t base = 1760000000 / 60 * 60;
+
+    for (int i = 0; i < 5000; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, base + i * 60, i);
+        memset(&src, 0, sizeof(src));
+        src.timestamp = sd.datetime;
+        src.temperature = sd.temperature;
+        src.humidity = sd.humidity;
+        src.lux = sd.lux * (1 + i % 7);
+        src.soil_moisture = sd.soil_moisture;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        memcpy(src.soil_moisture_capacitance, sd.soil_moisture_capacitance, sizeof(src.soil_moisture_capacitance));
+        memcpy(src.soil_temperature, sd.soil_temperature, sizeof(src.soil_temperature));
+        src.soil_temperature_count = (uint8_t)(i % (TMP102_MAX_DEVICES + 1));
+#else
+        src.soil_temperature1 = sd.soil_temperature1;
+        src.soil_temperature2 = sd.soil_temperature2;
+#endif
+        src.valid = true;
+
+        minute_record_encode(&src, (uint16_t)i, &rec);
+        minute_record_decode(&rec, (uint32_t)((base + i * 60) / 60), &dst);
+
+        CHECK(rec.minute_key == i);
+        CHECK(dst.valid);
+        CHECK(mktime(&dst.timestamp) == base + i * 60);
+        CHECK_NEAR(dst.temperature, src.temperature, 0.005f + 1e-4f);
+        CHECK_NEAR(dst.humidity, src.humidity, 0.005f + 1e-4f);
+        CHECK_NEAR(dst.lux, src.lux, src.lux * 0.00025f + 0.005f);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        float max_cap = 0.0f;
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            CHECK_NEAR(dst.soil_moisture_capacitance[c], src.soil_moisture_capacitance[c], 1.0f / 4096 + 1e-6f);
+            if (c == 0 || dst.soil_moisture_capacitance[c] > max_cap) {
+                max_cap = dst.soil_moisture_capacitance[c];
+            }
+        }
+        CHECK_NEAR(dst.soil_moisture, max_cap, 0.0f);
+        CHECK_NEAR(dst.soil_moisture, src.soil_moisture, 1.0f / 4096 + 1e-6f);
+        CHECK(dst.soil_temperature_count == src.soil_temperature_count);
+        for (int c = 0; c < src.soil_temperature_count; c++) {
+            CHECK_NEAR(dst.soil_temperature[c], src.soil_temperature[c], 1.0f / 32 + 1e-6f);
+        }
+#else
+        CHECK_NEAR(dst.soil_moisture, src.soil_moisture, 0.5f);
+        CHECK_NEAR(dst.soil_temperature1, src.soil_temperature1, 1.0f / 32 + 1e-6f);
+        CHECK_NEAR(dst.soil_temperature2, src.soil_temperature2, 1.0f / 32 + 1e-6f);
+#endif
+    }
+}
+
+static void test_extreme_values(void) {
+    minute_data_t src = {0}, dst;
+    minute_record_t rec;
+
+    // センサー範囲の端（負温度・飽和照度・負の静電容量）
+    src.temperature = -40.0f;
+    src.humidity = 100.0f;
+    src.lux = 88000.0f;
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    src.soil_moisture_capacitance[0] = -15.9995f;
+    src.soil_moisture_capacitance[1] = 15.9995f;
+    src.soil_temperature_count = 2;
+    src.soil_temperature[0] = -55.0f;
+    src.soil_temperature[1] = 127.9375f;
+#endif
+    minute_record_encode(&src, 0, &rec);
+    minute_record_decode_values(&rec, &dst);
+
+    CHECK_NEAR(dst.temperature, -40.0f, 0.005f);
+    CHECK_NEAR(dst.humidity, 100.0f, 0.005f);
+    CHECK_NEAR(dst.lux, 88000.0f, 88000.0f * 0.00025f);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+    CHECK_NEAR(dst.soil_moisture_capacitance[0], -15.9995f, 1.0f / 4096);
+    CHECK_NEAR(dst.soil_moisture_capacitance[1], 15.9995f, 1.0f / 4096);
+    CHECK_NEAR(dst.soil_temperature[0], -55.0f, 1.0f / 32);
+    CHECK_NEAR(dst.soil_temperature[1], 127.9375f, 1.0f / 32);
+    CHECK(dst.soil_temperature[2] == 0.0f);
+#endif
+
+    // 照度0と負値は0、範囲外は上限で飽和
+    CHECK(minute_record_encode_lux(0.0f) == 0);
+    CHECK(minute_record_encode_lux(-1.0f) == 0);
+    CHECK(minute_record_encode_lux(1e9f) == 0xFFFF);
+    CHECK_NEAR(minute_record_decode_lux(minute_record_encode_lux(0.01f)), 0.01f, 1e-6f);
+}
+
+static void test_buffer_holds_capacity(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+
+    // 保持数 + 1時間分を投入し、最古の1時間分だけが上書きされることを確認
+    time_t now = time(NULL) / 60 * 60;
+    int total = DATA_BUFFER_MINUTE_CAPACITY + 60;
+    time_t first = now - (time_t)(total - 1) * 60;
+    for (int i = 0; i < total; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, first + i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == DATA_BUFFER_MINUTE_CAPACITY);
+
+    minute_data_t md;
+    struct tm t;
+    time_t evicted = first + 59 * 60;
+    localtime_r(&evicted, &t);
+    CHECK(data_buffer_get_minute_data(&t, &md) == ESP_ERR_NOT_FOUND);
+
+    time_t oldest = first + 60 * 60;
+    localtime_r(&oldest, &t);
+    CHECK(data_buffer_get_minute_data(&t, &md) == ESP_OK);
+    CHECK(mktime(&md.timestamp) == oldest);
+
+    minute_data_t latest;
+    CHECK(data_buffer_get_latest_minute_data(&latest) == ESP_OK);
+    CHECK(mktime(&latest.timestamp) == now);
+
+    // 24時間以内に遡って書き直した分は最新にならない
+    soil_data_t sd;
+    test_fill_sensor(&sd, now - 30 * 60, 0);
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    CHECK(data_buffer_get_latest_minute_data(&latest) == ESP_OK);
+    CHECK(mktime(&latest.timestamp) == now);
+}
+
+static void test_report_size(void) {
+    size_t record = sizeof(minute_record_t);
+    size_t legacy = sizeof(minute_data_t);
+    size_t legacy_ram = legacy * DATA_BUFFER_MINUTES_PER_DAY;
+    size_t packed_ram = record * DATA_BUFFER_MINUTE_CAPACITY;
+
+    printf("  minute_data_t  : %zu bytes/record x %d = %zu bytes\n", legacy, DATA_BUFFER_MINUTES_PER_DAY, legacy_ram);
+    printf("  minute_record_t: %zu bytes/record x %d = %zu bytes\n", record, DATA_BUFFER_MINUTE_CAPACITY, packed_ram);
+    printf("  minutes per byte: %.2fx\n", (double)legacy / (double)record);
+
+    // 従来のRAM量で4倍以上の分数を保持できること
+    CHECK(record * 4 <= legacy);
+    CHECK(packed_ram <= legacy_ram);
+}
+
+int main(void) {
+    RUN_TEST(test_roundtrip_values);
+    RUN_TEST(test_extreme_values);
+    RUN_TEST(test_buffer_holds_capacity);
+    RUN_TEST(test_report_size);
+    return TEST_RESULT();
+}
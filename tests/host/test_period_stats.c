@@ -0,0 +1,218 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "stat_summary.h"
+#include "file_partition.h"
+#include <stdio.h>
+
+// 結合可能な要約: 結合の順序によらず全サンプルから直接求めた要約と一致すること、分位点の推定、
+// 日の確定ごとに更新する週・月の要約と任意の日の範囲の結合の一致、確定した週・月と書き込み中の週・月の再起動後の復元
+
+#define PERIOD_PARTITION_FILE   "test_period_stats.bin"
+#define STEP_MINUTES            10      // 10分ごとに投入（1日144件）
+#define SAMPLES_PER_DAY         (DATA_BUFFER_MINUTES_PER_DAY / STEP_MINUTES)
+
+static time_t g_start;  // 投入開始時刻（2025-05-26 月曜 0:00）
+
+static void encode_sample(int i, minute_record_t *rec) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+    minute_data_t md;
+    memset(&md, 0, sizeof(md));
+    md.temperature = sd.temperature;
+    md.humidity = sd.humidity;
+    md.lux = sd.lux;
+    md.soil_moisture = sd.soil_moisture;
+    md.soil_temperature_count = (i % 5 == 0) ? 0 : sd.soil_temperature_count;
+    memcpy(md.soil_temperature, sd.soil_temperature, sizeof(md.soil_temperature));
+    memcpy(md.soil_moisture_capacitance, sd.soil_moisture_capacitance, sizeof(md.soil_moisture_capacitance));
+    minute_record_encode(&md, 0, rec);
+}
+
+static void test_merge_associative(void) {
+    // 3つに分けた要約を異なる順序で結合しても、全件から直接求めた要約とバイト単位で一致する
+    static stat_summary_t a, b, c, all, left, right;
+    stat_summary_reset(&a);
+    stat_summary_reset(&b);
+    stat_summary_reset(&c);
+    stat_summary_reset(&all);
+    for (int i = 0; i < 3000; i++) {
+        minute_record_t rec;
+        encode_sample(i * 7, &rec);
+        stat_summary_add((i < 1000) ? &a : (i < 1800) ? &b : &c, &rec);
+        stat_summary_add(&all, &rec);
+    }
+    a.days = b.days = c.days = 1;
+    all.days = 3;
+
+    memcpy(&left, &a, sizeof(left));
+    stat_summary_merge(&left, &b);
+    stat_summary_merge(&left, &c);
+    memcpy(&right, &c, sizeof(right));
+    stat_summary_merge(&right, &b);
+    stat_summary_merge(&right, &a);
+    CHECK(memcmp(&left, &all, sizeof(all)) == 0);
+    CHECK(memcmp(&right, &all, sizeof(all)) == 0);
+
+    // 空の要約は単位元
+    stat_summary_t empty;
+    stat_summary_reset(&empty);
+    stat_summary_merge(&left, &empty);
+    CHECK(memcmp(&left, &all, sizeof(all)) == 0);
+
+    // 土壌温度のないレコードは土壌温度だけ数えない
+    CHECK(all.field[QUANTILE_FIELD_TEMPERATURE].count == 3000);
+    CHECK(all.field[QUANTILE_FIELD_SOIL_TEMPERATURE].count < 3000);
+}
+
+static void test_quantiles(void) {
+    // 10.00〜29.99℃の一様分布: 中央値・p10・p90はビン内の補間でビン幅(4℃)より十分小さい誤差
+    stat_summary_t s;
+    stat_summary_reset(&s);
+    minute_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    for (int v = 1000; v < 3000; v++) {
+        rec.temperature = (int16_t)v;
+        stat_summary_add(&s, &rec);
+    }
+    const stat_field_summary_t *t = &s.field[QUANTILE_FIELD_TEMPERATURE];
+    CHECK_NEAR(stat_field_mean(t), 1999.5, 0.01);
+    CHECK_NEAR(stat_field_stddev(t), 2000.0 / sqrt(12.0), 1.0);
+    CHECK_NEAR(stat_field_quantile(t, QUANTILE_FIELD_TEMPERATURE, 0.5f), 2000, 20);
+    CHECK_NEAR(stat_field_quantile(t, QUANTILE_FIELD_TEMPERATURE, 0.1f), 1200, 20);
+    CHECK_NEAR(stat_field_quantile(t, QUANTILE_FIELD_TEMPERATURE, 0.9f), 2800, 20);
+    CHECK(stat_field_quantile(t, QUANTILE_FIELD_TEMPERATURE, 0.0f) >= 1000);
+    CHECK(stat_field_quantile(t, QUANTILE_FIELD_TEMPERATURE, 1.0f) <= 2999);
+
+    // 照度（対数ビン）: 100〜10000lux の値の中央値は同じビン（2倍幅）の範囲内
+    stat_summary_reset(&s);
+    for (int i = 0; i < 1000; i++) {
+        rec.lux = minute_record_encode_lux((i < 500) ? 100.0f : 10000.0f);
+        stat_summary_add(&s, &rec);
+    }
+    const stat_field_summary_t *l = &s.field[QUANTILE_FIELD_LUX];
+    float q25 = stat_field_quantile(l, QUANTILE_FIELD_LUX, 0.25f);
+    float q75 = stat_field_quantile(l, QUANTILE_FIELD_LUX, 0.75f);
+    CHECK(q25 >= 10000 && q25 < 2 * 10000);
+    CHECK(q75 > 1000000 / 2 && q75 <= 1000000);
+}
+
+static struct tm make_date(int mon, int mday) {
+    return test_make_tm(2025, mon, mday, 0, 0);
+}
+
+static void add_days(int from_minute, int to_minute) {
+    for (int i = from_minute; i < to_minute; i += STEP_MINUTES) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+}
+
+static bool same_stats(const data_buffer_period_stats_t *a, const data_buffer_period_stats_t *b) {
+    return a->days == b->days && memcmp(a->field, b->field, sizeof(a->field)) == 0;
+}
+
+static void test_weekly_monthly(void) {
+    file_partition_close();
+    remove(PERIOD_PARTITION_FILE);
+    CHECK(file_partition_open(PERIOD_PARTITION_FILE, 1024 * 1024) == 0);
+    CHECK(data_buffer_init() == ESP_OK);
+
+    // 5/26（月）〜 7/1 の 0:00 過ぎまで（6/30 までの日が確定）
+    int end_minute = 36 * DATA_BUFFER_MINUTES_PER_DAY + 20;
+    add_days(0, end_minute);
+
+    // 確定した週は、その7日を結合したものと一致する
+    data_buffer_period_stats_t week, merged;
+    struct tm wed = make_date(6, 18), mon = make_date(6, 16), sun = make_date(6, 22);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &wed, &week) == ESP_OK);
+    CHECK(data_buffer_merge_days(&mon, &sun, &merged) == ESP_OK);
+    CHECK(week.days == 7 && week.field[QUANTILE_FIELD_TEMPERATURE].samples == 7 * SAMPLES_PER_DAY);
+    CHECK(week.start.tm_mon == 5 && week.start.tm_mday == 16 && week.start.tm_wday == 1);
+    CHECK(same_stats(&week, &merged));
+
+    // 月: 6月の30日分、平均は投入値から直接求めたものと一致
+    data_buffer_period_stats_t month;
+    struct tm june1 = make_date(6, 1), june30 = make_date(6, 30);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &wed, &month) == ESP_OK);
+    CHECK(data_buffer_merge_days(&june1, &june30, &merged) == ESP_OK);
+    CHECK(month.days == 30 && month.field[QUANTILE_FIELD_TEMPERATURE].samples == 30 * SAMPLES_PER_DAY);
+    CHECK(month.start.tm_mon == 5 && month.start.tm_mday == 1);
+    CHECK(same_stats(&month, &merged));
+    double temp_sum = 0.0, temp_min = 1e9, temp_max = -1e9;
+    for (int i = 6 * DATA_BUFFER_MINUTES_PER_DAY; i < 36 * DATA_BUFFER_MINUTES_PER_DAY; i += STEP_MINUTES) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        temp_sum += sd.temperature;
+        if (sd.temperature < temp_min) temp_min = sd.temperature;
+        if (sd.temperature > temp_max) temp_max = sd.temperature;
+    }
+    const data_buffer_field_stats_t *t = &month.field[QUANTILE_FIELD_TEMPERATURE];
+    CHECK_NEAR(t->mean, temp_sum / (30 * SAMPLES_PER_DAY), 0.01);
+    CHECK_NEAR(t->min, temp_min, 0.01);
+    CHECK_NEAR(t->max, temp_max, 0.01);
+    CHECK(t->stddev > 3.0f && t->stddev < 4.0f);  // 振幅5℃の正弦波（約3.5℃）
+    CHECK(t->quantiles[0] <= t->quantiles[1] && t->quantiles[1] <= t->quantiles[2]);
+    CHECK(t->quantiles[0] >= t->min && t->quantiles[2] <= t->max);
+
+    // 5月は6日分（5/26〜31）。書き込み中の週（6/30〜）は確定した6/30のみ。当日（7/1）は週・月に含まない
+    data_buffer_period_stats_t may, open_week, july;
+    struct tm may28 = make_date(5, 28), july1 = make_date(7, 1);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &may28, &may) == ESP_OK);
+    CHECK(may.days == 6);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &july1, &open_week) == ESP_OK);
+    CHECK(open_week.days == 1 && open_week.field[QUANTILE_FIELD_TEMPERATURE].samples == SAMPLES_PER_DAY);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &july1, &july) == ESP_ERR_NOT_FOUND);
+
+    // 任意の範囲（週をまたぐ）は書き込み中の日を含む
+    struct tm june28 = make_date(6, 28);
+    CHECK(data_buffer_merge_days(&june28, &july1, &merged) == ESP_OK);
+    CHECK(merged.days == 4 && merged.field[QUANTILE_FIELD_TEMPERATURE].samples == 3 * SAMPLES_PER_DAY + 2);
+
+    // 不正な範囲・保持範囲外（日の範囲は最大31日間）
+    struct tm may1 = make_date(5, 1), may31 = make_date(5, 31);
+    CHECK(data_buffer_merge_days(&june1, &july1, &merged) == ESP_OK);
+    CHECK(merged.days == 31);
+    CHECK(data_buffer_merge_days(&may31, &july1, &merged) == ESP_ERR_INVALID_ARG);
+    CHECK(data_buffer_merge_days(&july1, &june28, &merged) == ESP_ERR_INVALID_ARG);
+    CHECK(data_buffer_merge_days(&may1, &july1, &merged) == ESP_ERR_INVALID_ARG);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &may1, &week) == ESP_ERR_NOT_FOUND);
+
+    // 再起動: 確定した週・月は履歴ログから、書き込み中の週・月は日ごとの要約から復元する
+    data_buffer_period_stats_t before[4], after[4];
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &wed, &before[0]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &may28, &before[1]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &wed, &before[2]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &july1, &before[3]) == ESP_OK);
+    CHECK(data_buffer_flush() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &wed, &after[0]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &may28, &after[1]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &wed, &after[2]) == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &july1, &after[3]) == ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        CHECK(same_stats(&before[i], &after[i]));
+    }
+
+    // 再起動後も日の確定で結合が続き、二重に結合しない
+    add_days(end_minute, 37 * DATA_BUFFER_MINUTES_PER_DAY + 20);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &july1, &open_week) == ESP_OK);
+    CHECK(open_week.days == 2 && open_week.field[QUANTILE_FIELD_TEMPERATURE].samples == 2 * SAMPLES_PER_DAY);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_MONTH, &wed, &month) == ESP_OK);
+    CHECK(same_stats(&month, &after[2]));
+
+    CHECK(data_buffer_clear_all() == ESP_OK);
+    CHECK(data_buffer_get_period_stats(DATA_BUFFER_PERIOD_WEEK, &wed, &week) == ESP_ERR_NOT_FOUND);
+    file_partition_close();
+    remove(PERIOD_PARTITION_FILE);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 5, 26, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_merge_associative);
+    RUN_TEST(test_quantiles);
+    RUN_TEST(test_weekly_monthly);
+    return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+#include "test_common.h"
+#include "profile_library.h"
+
+// 植物プロファイルのライブラリ: スロットの保存・検索・削除、アクティブの切り替え、
+// サイズの違うNVSレコード（旧形式・新しいファームウェアの形式）の変換
+
+static plant_profile_t make_profile(const char *name, float dry_threshold) {
+    plant_profile_t profile;
+    memset(&profile, 0, sizeof(profile));
+    strncpy(profile.plant_name, name, sizeof(profile.plant_name) - 1);
+    profile.soil_dry_threshold = dry_threshold;
+    profile.soil_wet_threshold = 1000.0f;
+    profile.soil_dry_days_for_watering = 3;
+    profile.temp_high_limit = 35.0f;
+    profile.temp_low_limit = 5.0f;
+    profile.watering_threshold = 200.0f;
+    for (int i = 0; i < PLANT_PROFILE_ARCHIVE_FIELDS; i++) {
+        profile.archive_error[i] = 0.5f;
+    }
+    return profile;
+}
+
+static void test_slots(void) {
+    profile_library_t library;
+    profile_library_init(&library);
+    CHECK(library.used_mask == 0 && library.active == PROFILE_LIBRARY_NONE);
+    CHECK(profile_library_get(&library, 0) == NULL);
+    CHECK(profile_library_free_slot(&library) == 0);
+
+    plant_profile_t tomato = make_profile("Tomato", 2000.0f);
+    plant_profile_t basil = make_profile("Basil", 1800.0f);
+    CHECK(profile_library_put(&library, 0, &tomato) == ESP_OK);
+    CHECK(profile_library_put(&library, 5, &basil) == ESP_OK);
+    CHECK(profile_library_put(&library, PROFILE_LIBRARY_SLOTS, &basil) == ESP_ERR_INVALID_ARG);
+    CHECK(library.used_mask == ((1u << 0) | (1u << 5)));
+    CHECK(profile_library_free_slot(&library) == 1);
+    CHECK(profile_library_find(&library, "Basil") == 5);
+    CHECK(profile_library_find(&library, "Mint") == PROFILE_LIBRARY_NONE);
+    CHECK(profile_library_get(&library, 5)->soil_dry_threshold == 1800.0f);
+
+    // 名前は終端を保証する
+    plant_profile_t long_name = make_profile("", 1500.0f);
+    memset(long_name.plant_name, 'x', sizeof(long_name.plant_name));
+    CHECK(profile_library_put(&library, 1, &long_name) == ESP_OK);
+    CHECK(strlen(profile_library_get(&library, 1)->plant_name) == sizeof(long_name.plant_name) - 1);
+
+    // 全スロットが埋まると空きなし
+    for (uint8_t i = 0; i < PROFILE_LIBRARY_SLOTS; i++) {
+        if (profile_library_get(&library, i) == NULL) {
+            CHECK(profile_library_put(&library, i, &tomato) == ESP_OK);
+        }
+    }
+    CHECK(library.used_mask == 0xFFFF);
+    CHECK(profile_library_free_slot(&library) == PROFILE_LIBRARY_NONE);
+}
+
+static void test_select_remove(void) {
+    profile_library_t library;
+    profile_library_init(&library);
+    plant_profile_t tomato = make_profile("Tomato", 2000.0f);
+    plant_profile_t basil = make_profile("Basil", 1800.0f);
+    profile_library_put(&library, 2, &tomato);
+    profile_library_put(&library, 3, &basil);
+
+    CHECK(profile_library_select(&library, 4) == ESP_ERR_NOT_FOUND);
+    CHECK(profile_library_select(&library, PROFILE_LIBRARY_NONE) == ESP_ERR_INVALID_ARG);
+    CHECK(library.active == PROFILE_LIBRARY_NONE);
+
+    // 切り替えはアクティブの番号だけを変え、スロットの内容はそのまま
+    profile_library_t before = library;
+    CHECK(profile_library_select(&library, 3) == ESP_OK);
+    CHECK(library.active == 3);
+    CHECK(memcmp(library.profiles, before.profiles, sizeof(library.profiles)) == 0);
+    CHECK(profile_library_select(&library, 2) == ESP_OK);
+    CHECK(strcmp(profile_library_get(&library, library.active)->plant_name, "Tomato") == 0);
+
+    // アクティブのスロットは削除できない
+    CHECK(profile_library_remove(&library, 2) == ESP_ERR_INVALID_STATE);
+    CHECK(profile_library_remove(&library, 4) == ESP_ERR_NOT_FOUND);
+    CHECK(profile_library_remove(&library, 3) == ESP_OK);
+    CHECK(profile_library_get(&library, 3) == NULL);
+    CHECK(library.used_mask == (1u << 2));
+    CHECK(profile_library_select(&library, 3) == ESP_ERR_NOT_FOUND);
+}
+
+static void test_decode(void) {
+    plant_profile_t defaults = make_profile("Default", 2500.0f);
+    for (int i = 0; i < PLANT_PROFILE_ARCHIVE_FIELDS; i++) {
+        defaults.archive_error[i] = 1.25f;
+    }
+    plant_profile_t stored = make_profile("Tomato", 2000.0f);
+    plant_profile_t profile;
+
+    // 同じ形式
+    CHECK(profile_library_decode(&stored, sizeof(stored), &defaults, &profile) == ESP_OK);
+    CHECK(memcmp(&profile, &stored, sizeof(stored)) == 0);
+
+    // 間引き記録の許容誤差を追加する前の形式: 先頭は保存した値、追加したフィールドは既定値
+    CHECK(profile_library_decode(&stored, PROFILE_RECORD_MIN_SIZE, &defaults, &profile) == ESP_OK);
+    CHECK(strcmp(profile.plant_name, "Tomato") == 0);
+    CHECK(profile.soil_dry_threshold == 2000.0f && profile.watering_threshold == 200.0f);
+    CHECK(profile.archive_error[0] == 1.25f && profile.archive_error[PLANT_PROFILE_ARCHIVE_FIELDS - 1] == 1.25f);
+
+    // 末尾にフィールドを追加した新しい形式: 先頭だけ使う
+    uint8_t record[sizeof(plant_profile_t) + 16];
+    memset(record, 0xA5, sizeof(record));
+    memcpy(record, &stored, sizeof(stored));
+    CHECK(profile_library_decode(record, sizeof(record), &defaults, &profile) == ESP_OK);
+    CHECK(memcmp(&profile, &stored, sizeof(stored)) == 0);
+
+    // 旧形式より短いレコードは受け付けない
+    CHECK(profile_library_decode(&stored, PROFILE_RECORD_MIN_SIZE - 1, &defaults, &profile) == ESP_ERR_INVALID_SIZE);
+
+    // 終端のない名前
+    memset(record, 'x', sizeof(stored.plant_name));
+    CHECK(profile_library_decode(record, sizeof(plant_profile_t), &defaults, &profile) == ESP_OK);
+    CHECK(strlen(profile.plant_name) == sizeof(profile.plant_name) - 1);
+}
+
+int main(void) {
+    RUN_TEST(test_slots);
+    RUN_TEST(test_select_remove);
+    RUN_TEST(test_decode);
+    return TEST_RESULT();
+}
@@ -0,0 +1,259 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "quantile_sketch.h"
+#include <stdlib.h>
+
+// P²法による分位点の逐次推定と、ソートによる正確な分位点との比較
+//
+//   test_quantile_sketch [day.csv]
+//   CSV: bench_minute_codec と同じ形式（unix_time,temperature,humidity,lux,cap0..3,soil_t0..3,ext_temp）。
+//   指定すると、その記録データでも日別サマリーの分位点を検証する
+
+// 許容する順位の誤差（全サンプル数に対する割合）
+#define RANK_TOLERANCE_IID      0.01f   // 独立同分布の入力（1440件以上）
+#define RANK_TOLERANCE_SMALL    0.03f   // 独立同分布の入力（100件）
+#define RANK_TOLERANCE_DAY      0.05f   // 時刻順の1日分（日周変化で入力の順序に偏りがある）
+#define MAX_SAMPLES         10000
+
+static float g_samples[MAX_SAMPLES];
+static float g_sorted[MAX_SAMPLES];
+static uint32_t g_rand = 12345;
+
+static float rand_uniform(void) {
+    g_rand = g_rand * 1103515245u + 12345u;
+    return ((g_rand >> 8) & 0xFFFF) / 65536.0f;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * 推定値の順位の誤差
+ * 推定値 ± resolution 未満/以下のサンプルの割合の区間から p までの距離（同値が多い場合に対応）
+ */
+static float rank_error(const float *sorted, int n, float estimate, float resolution, float p) {
+    int below = 0, at_or_below = 0;
+    while (below < n && sorted[below] < estimate - resolution) below++;
+    at_or_below = below;
+    while (at_or_below < n && sorted[at_or_below] <= estimate + resolution) at_or_below++;
+    float lo = (float)below / n, hi = (float)at_or_below / n;
+    return (p < lo) ? lo - p : (p > hi) ? p - hi : 0.0f;
+}
+
+static void check_estimators(const char *name, int n) {
+    static const float ps[DAILY_QUANTILE_COUNT] = { 0.10f, 0.50f, 0.90f };
+    p2_estimator_t est;
+    p2_estimator_init(&est, ps, DAILY_QUANTILE_COUNT);
+    for (int i = 0; i < n; i++) {
+        p2_estimator_add(&est, g_samples[i]);
+    }
+    memcpy(g_sorted, g_samples, sizeof(float) * n);
+    qsort(g_sorted, n, sizeof(float), compare_float);
+
+    printf("  %-10s n=%5d", name, n);
+    for (int q = 0; q < DAILY_QUANTILE_COUNT; q++) {
+        float estimate = p2_estimator_get(&est, q);
+        float exact = g_sorted[(int)(ps[q] * (n - 1))];
+        float err = rank_error(g_sorted, n, estimate, 0.0f, ps[q]);
+        CHECK(err <= ((n < 1000) ? RANK_TOLERANCE_SMALL : RANK_TOLERANCE_IID));
+        printf("  p%02d %.3f/%.3f (rank err %.4f)", (int)(ps[q] * 100 + 0.5f), estimate, exact, err);
+    }
+    printf("\n");
+}
+
+static void test_small_counts(void) {
+    // マーカー数（9）未満は受け取った値から正確に求める
+    static const float ps[DAILY_QUANTILE_COUNT] = { 0.10f, 0.50f, 0.90f };
+    p2_estimator_t est;
+    p2_estimator_init(&est, ps, DAILY_QUANTILE_COUNT);
+    CHECK(p2_estimator_get(&est, DAILY_QUANTILE_P50) == 0.0f);
+    p2_estimator_add(&est, 3.0f);
+    CHECK(p2_estimator_get(&est, DAILY_QUANTILE_P50) == 3.0f);
+    p2_estimator_add(&est, 1.0f);
+    p2_estimator_add(&est, 2.0f);
+    CHECK(p2_estimator_get(&est, DAILY_QUANTILE_P50) == 2.0f);
+    p2_estimator_add(&est, 4.0f);
+    CHECK_NEAR(p2_estimator_get(&est, DAILY_QUANTILE_P10), 1.3f, 1e-6f);
+    CHECK_NEAR(p2_estimator_get(&est, DAILY_QUANTILE_P90), 3.7f, 1e-6f);
+
+    // 定数列では全マーカーが同じ値
+    p2_estimator_init(&est, ps, DAILY_QUANTILE_COUNT);
+    for (int i = 0; i < 1000; i++) {
+        p2_estimator_add(&est, 42.0f);
+    }
+    for (int q = 0; q < DAILY_QUANTILE_COUNT; q++) {
+        CHECK(p2_estimator_get(&est, q) == 42.0f);
+    }
+}
+
+static void test_synthetic_distributions(void) {
+    int sizes[] = { 100, DATA_BUFFER_MINUTES_PER_DAY, MAX_SAMPLES };
+    for (int s = 0; s < 3; s++) {
+        int n = sizes[s];
+
+        for (int i = 0; i < n; i++) g_samples[i] = rand_uniform();
+        check_estimators("uniform", n);
+
+        for (int i = 0; i < n; i++) {
+            // Box-Muller
+            float u1 = rand_uniform() + 1e-6f, u2 = rand_uniform();
+            g_samples[i] = sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+        }
+        check_estimators("normal", n);
+
+        for (int i = 0; i < n; i++) g_samples[i] = -logf(rand_uniform() + 1e-6f);
+        check_estimators("exp", n);
+
+        // 昇順・降順に並んだ入力（日中の単調な変化）
+        for (int i = 0; i < n; i++) g_samples[i] = (float)i;
+        check_estimators("ascending", n);
+        for (int i = 0; i < n; i++) g_samples[i] = (float)(n - i);
+        check_estimators("descending", n);
+    }
+}
+
+/**
+ * 水やりで土壌水分が跳ね上がり、その後ゆっくり乾く1日分（1分間隔）
+ */
+static void generate_watering_day(soil_data_t *day, time_t start) {
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        soil_data_t *d = &day[i];
+        memset(d, 0, sizeof(*d));
+        time_t t = start + (time_t)i * 60;
+        localtime_r(&t, &d->datetime);
+        float hour = i / 60.0f;
+        d->temperature = 18.0f + 8.0f * sinf((hour - 9.0f) * 3.14159f / 12.0f) + (rand_uniform() - 0.5f) * 0.2f;
+        d->humidity = 60.0f - 15.0f * sinf((hour - 9.0f) * 3.14159f / 12.0f) + (rand_uniform() - 0.5f);
+        d->lux = (hour > 6.0f && hour < 18.0f) ? 20000.0f * sinf((hour - 6.0f) * 3.14159f / 12.0f) : 0.0f;
+        // 7:00と19:00に水やり（+2pF）、その後指数的に乾燥
+        float since = (hour >= 19.0f) ? hour - 19.0f : (hour >= 7.0f) ? hour - 7.0f : hour + 5.0f;
+        float wet = 2.0f * expf(-since / 3.0f);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            d->soil_moisture_capacitance[c] = 4.0f + c * 0.3f + wet * (1.0f - c * 0.2f) + (rand_uniform() - 0.5f) * 0.01f;
+            if (c == 0 || d->soil_moisture_capacitance[c] > d->soil_moisture) {
+                d->soil_moisture = d->soil_moisture_capacitance[c];
+            }
+        }
+        d->soil_temperature_count = TMP102_MAX_DEVICES;
+        for (int c = 0; c < TMP102_MAX_DEVICES; c++) {
+            d->soil_temperature[c] = 17.0f + 3.0f * sinf((hour - 11.0f) * 3.14159f / 12.0f) - c * 0.4f;
+        }
+#else
+        d->soil_moisture = 1500.0f + 800.0f * wet;
+        d->soil_temperature1 = 17.0f + 3.0f * sinf((hour - 11.0f) * 3.14159f / 12.0f);
+        d->soil_temperature2 = d->soil_temperature1 - 0.4f;
+#endif
+    }
+}
+
+/**
+ * 1日分を data_buffer に投入し、日別サマリーの分位点を格納された1分データの正確な分位点と比較
+ */
+static void check_day_quantiles(const char *name, const soil_data_t *day, int n) {
+    CHECK(data_buffer_init() == ESP_OK);
+    for (int i = 0; i < n; i++) {
+        CHECK(data_buffer_add_minute_data(&day[i]) == ESP_OK);
+    }
+
+    // 日付指定で取得できるのは完全な日（20時間以上）のみ
+    daily_summary_data_t summary;
+    memset(&summary, 0, sizeof(summary));
+    CHECK(data_buffer_get_daily_summary(&day[0].datetime, &summary) == ESP_OK);
+
+    static minute_data_t stored[DATA_BUFFER_MINUTES_PER_DAY];
+    uint16_t count = 0;
+    CHECK(data_buffer_get_day_minute_data(&day[0].datetime, stored, &count) == ESP_OK);
+    CHECK(count == summary.valid_samples);
+
+    static const float ps[DAILY_QUANTILE_COUNT] = { 0.10f, 0.50f, 0.90f };
+    const char *fields[] = { "temp", "humidity", "lux", "soil", "soil_temp" };
+    const float resolution[] = { 0.01f, 0.01f, 0.01f, 1.0f / MINUTE_RECORD_SOIL_SCALE, 1.0f / MINUTE_RECORD_PROBE_TEMP_SCALE };
+    const float *estimates[] = { summary.temperature_quantiles, summary.humidity_quantiles, summary.lux_quantiles,
+                                 summary.soil_moisture_quantiles, summary.soil_temperature_quantiles };
+    printf("  %s (%d samples)\n", name, count);
+    for (int f = 0; f < 5; f++) {
+        for (int i = 0; i < count; i++) {
+            const minute_data_t *m = &stored[i];
+            float v[] = { m->temperature, m->humidity, m->lux, m->soil_moisture,
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+                          m->soil_temperature[0] };
+#else
+                          m->soil_temperature1 };
+#endif
+            g_sorted[i] = v[f];
+        }
+        qsort(g_sorted, count, sizeof(float), compare_float);
+        printf("    %-9s", fields[f]);
+        for (int q = 0; q < DAILY_QUANTILE_COUNT; q++) {
+            float estimate = estimates[f][q];
+            float err = rank_error(g_sorted, count, estimate, resolution[f], ps[q]);
+            CHECK(err <= RANK_TOLERANCE_DAY);
+            printf("  p%02d %9.3f/%9.3f (%.3f)", (int)(ps[q] * 100 + 0.5f), estimate, g_sorted[(int)(ps[q] * (count - 1))], err);
+        }
+        printf("\n");
+    }
+
+    // 水やり直後の高い値に引っ張られる平均とは異なり、中央値は乾燥中の典型値を示す
+    printf("    soil avg %.3f vs p50 %.3f\n", summary.avg_soil_moisture, summary.soil_moisture_quantiles[DAILY_QUANTILE_P50]);
+}
+
+static void test_watering_day(void) {
+    static soil_data_t day[DATA_BUFFER_MINUTES_PER_DAY];
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    generate_watering_day(day, mktime(&t));
+    check_day_quantiles("watering day", day, DATA_BUFFER_MINUTES_PER_DAY);
+}
+
+static bool load_csv_day(const char *path, soil_data_t *day, int *n) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("  cannot open %s\n", path);
+        return false;
+    }
+    char line[512];
+    *n = 0;
+    while (*n < DATA_BUFFER_MINUTES_PER_DAY && fgets(line, sizeof(line), fp) != NULL) {
+        soil_data_t *d = &day[*n];
+        memset(d, 0, sizeof(*d));
+        long long unix_time;
+        float cap[4], st[4], ext;
+        int fields = sscanf(line, "%lld,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", &unix_time,
+                            &d->temperature, &d->humidity, &d->lux, &cap[0], &cap[1], &cap[2], &cap[3],
+                            &st[0], &st[1], &st[2], &st[3], &ext);
+        if (fields != 13) {
+            continue;
+        }
+        time_t t = (time_t)unix_time;
+        localtime_r(&t, &d->datetime);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        d->soil_temperature_count = TMP102_MAX_DEVICES;
+        for (int c = 0; c < 4; c++) {
+            d->soil_moisture_capacitance[c] = cap[c];
+            d->soil_temperature[c] = st[c];
+            if (c == 0 || cap[c] > d->soil_moisture) d->soil_moisture = cap[c];
+        }
+#endif
+        (*n)++;
+    }
+    fclose(fp);
+    return *n > 0;
+}
+
+int main(int argc, char **argv) {
+    RUN_TEST(test_small_counts);
+    RUN_TEST(test_synthetic_distributions);
+    RUN_TEST(test_watering_day);
+    if (argc > 1) {
+        static soil_data_t day[DATA_BUFFER_MINUTES_PER_DAY];
+        int n = 0;
+        CHECK(load_csv_day(argv[1], day, &n));
+        if (n > 0) {
+            printf("[ RUN ] recorded day (%s)\n", argv[1]);
+            check_day_quantiles(argv[1], day, n);
+        }
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,307 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+
+// 範囲クエリ: フィールドの射影と列の並び、間引き（first/avg/min/max）、欠測行、
+// 行を分けた取得と一括取得の一致、不正なクエリ、1分ずつ取得する場合とのコスト比較
+
+#define GAP_FROM    (10 * 60)       // 欠測区間 [GAP_FROM, GAP_TO)
+#define GAP_TO      (10 * 60 + 25)
+
+static time_t g_start;  // 投入開始時刻（0:00）
+
+static void add_minutes(int from, int to) {
+    for (int i = from; i < to; i++) {
+        if (i >= GAP_FROM && i < GAP_TO) {
+            continue;
+        }
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        if (i % 7 == 0) {
+            sd.soil_temperature_count = 0;  // 土壌温度センサーの読み取り失敗
+        }
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+}
+
+/**
+ * 投入値をパック形式の整数に変換した期待値（欠測・無効の場合はfalse）
+ */
+static bool expected_raw(int i, int field, int32_t *value) {
+    if (i >= GAP_FROM && i < GAP_TO) {
+        return false;
+    }
+    soil_data_t sd;
+    test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+    if (i % 7 == 0) {
+        sd.soil_temperature_count = 0;
+    }
+    minute_data_t md;
+    memset(&md, 0, sizeof(md));
+    md.temperature = sd.temperature;
+    md.humidity = sd.humidity;
+    md.lux = sd.lux;
+    md.soil_moisture = sd.soil_moisture;
+    md.soil_temperature_count = sd.soil_temperature_count;
+    memcpy(md.soil_temperature, sd.soil_temperature, sizeof(md.soil_temperature));
+    memcpy(md.soil_moisture_capacitance, sd.soil_moisture_capacitance, sizeof(md.soil_moisture_capacitance));
+    minute_record_t rec;
+    minute_record_encode(&md, 0, &rec);
+
+    switch (field) {
+    case DATA_BUFFER_FIELD_TEMPERATURE:      *value = rec.temperature; return true;
+    case DATA_BUFFER_FIELD_HUMIDITY:         *value = rec.humidity; return true;
+    case DATA_BUFFER_FIELD_LUX:              *value = (int32_t)minute_record_lux_raw(rec.lux); return true;
+    case DATA_BUFFER_FIELD_SOIL_MOISTURE:    *value = minute_record_soil_moisture_raw(&rec); return true;
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE: {
+        int16_t raw;
+        if (!minute_record_soil_temperature_raw(&rec, &raw)) return false;
+        *value = raw;
+        return true;
+    }
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE2:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE3:
+    case DATA_BUFFER_FIELD_SOIL_TEMPERATURE4: {
+        int16_t raw[TMP102_MAX_DEVICES];
+        int probe = field - DATA_BUFFER_FIELD_SOIL_TEMPERATURE2 + 1;
+        if (minute_record_probe_temperatures_raw(&rec, raw) <= probe) return false;
+        *value = raw[probe];
+        return true;
+    }
+    default:
+        *value = rec.soil_moisture_capacitance[field - DATA_BUFFER_FIELD_CAPACITANCE1];
+        return true;
+    }
+}
+
+/**
+ * 行 [from, from+step) の期待値
+ */
+static int16_t expected_cell(int from, int step, int field, data_buffer_aggregate_t agg) {
+    int64_t sum = 0;
+    int32_t value = 0;
+    int n = 0;
+    for (int i = from; i < from + step; i++) {
+        int32_t v;
+        if (!expected_raw(i, field, &v)) {
+            continue;
+        }
+        if (n == 0 || (agg == DATA_BUFFER_AGG_MIN && v < value) || (agg == DATA_BUFFER_AGG_MAX && v > value)) {
+            value = v;
+        }
+        sum += v;
+        n++;
+    }
+    if (n == 0) {
+        return DATA_BUFFER_QUERY_NONE;
+    }
+    if (agg == DATA_BUFFER_AGG_AVG) {
+        value = (int32_t)((sum + n / 2) / n);
+    }
+    if (field == DATA_BUFFER_FIELD_LUX) {
+        return (int16_t)minute_record_encode_lux(value / MINUTE_RECORD_LUX_SCALE);
+    }
+    return (int16_t)value;
+}
+
+static void test_projection_columns(void) {
+    // 1分間隔・先頭値: 要求したフィールドだけが番号順に列として並ぶ
+    uint16_t mask = (1u << DATA_BUFFER_FIELD_HUMIDITY) | (1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE) |
+                    (1u << DATA_BUFFER_FIELD_CAPACITANCE3);
+    const int fields[] = { DATA_BUFFER_FIELD_HUMIDITY, DATA_BUFFER_FIELD_SOIL_TEMPERATURE, DATA_BUFFER_FIELD_CAPACITANCE3 };
+    data_buffer_query_t q = test_make_query(g_start, 9 * 60, 11 * 60, 1, mask, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query_rows(&q) == 120);
+
+    static int16_t columns[3 * 120];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, 120, columns, &rows) == ESP_OK);
+    CHECK(rows == 120);
+    int mismatches = 0;
+    for (int k = 0; k < 3; k++) {
+        for (int r = 0; r < rows; r++) {
+            if (columns[k * 120 + r] != expected_cell(9 * 60 + r, 1, fields[k], DATA_BUFFER_AGG_FIRST)) {
+                mismatches++;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // 欠測区間と、土壌温度が無効な分は DATA_BUFFER_QUERY_NONE
+    CHECK(columns[0 * 120 + (GAP_FROM - 9 * 60)] == DATA_BUFFER_QUERY_NONE);
+    CHECK(columns[2 * 120 + (GAP_TO - 1 - 9 * 60)] == DATA_BUFFER_QUERY_NONE);
+    CHECK(columns[0 * 120 + (GAP_TO - 9 * 60)] != DATA_BUFFER_QUERY_NONE);
+    CHECK(columns[1 * 120 + (546 - 9 * 60)] == DATA_BUFFER_QUERY_NONE);  // 546 = 7 * 78
+}
+
+static void test_decimation(void) {
+    // 24時間を10/15/60/7分ごとに集約（端数の行・欠測を含む行）
+    const uint16_t steps[] = { 10, 15, 60, 7 };
+    const data_buffer_aggregate_t aggs[] = { DATA_BUFFER_AGG_FIRST, DATA_BUFFER_AGG_AVG, DATA_BUFFER_AGG_MIN, DATA_BUFFER_AGG_MAX };
+    static int16_t columns[DATA_BUFFER_FIELD_COUNT * DATA_BUFFER_MINUTES_PER_DAY];
+    uint16_t all = (1u << DATA_BUFFER_FIELD_COUNT) - 1;
+    for (int s = 0; s < 4; s++) {
+        for (int a = 0; a < 4; a++) {
+            data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, steps[s], all, aggs[a]);
+            uint16_t expected_rows = (DATA_BUFFER_MINUTES_PER_DAY + steps[s] - 1) / steps[s];
+            uint16_t rows = 0;
+            CHECK(data_buffer_query(&q, 0, expected_rows, columns, &rows) == ESP_OK);
+            CHECK(rows == expected_rows);
+            int mismatches = 0;
+            for (int f = 0; f < DATA_BUFFER_FIELD_COUNT; f++) {
+                for (int r = 0; r < rows; r++) {
+                    int from = r * steps[s];
+                    int step = (from + steps[s] > DATA_BUFFER_MINUTES_PER_DAY) ? DATA_BUFFER_MINUTES_PER_DAY - from : steps[s];
+                    if (columns[f * rows + r] != expected_cell(from, step, f, aggs[a])) {
+                        mismatches++;
+                    }
+                }
+            }
+            if (mismatches) printf("  step %u agg %d: %d mismatches\n", steps[s], aggs[a], mismatches);
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+static void test_chunked(void) {
+    // 行を分けて取得しても一括取得と同じ
+    uint16_t mask = (1u << DATA_BUFFER_FIELD_TEMPERATURE) | (1u << DATA_BUFFER_FIELD_LUX);
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, 3, mask, DATA_BUFFER_AGG_AVG);
+    uint16_t total = data_buffer_query_rows(&q);
+    CHECK(total == 480);
+
+    static int16_t whole[2 * 480];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, total, whole, &rows) == ESP_OK);
+    CHECK(rows == total);
+
+    int16_t chunk[2 * 61];
+    int mismatches = 0;
+    uint16_t first = 0;
+    while (first < total) {
+        CHECK(data_buffer_query(&q, first, 61, chunk, &rows) == ESP_OK);
+        CHECK(rows > 0);
+        for (int k = 0; k < 2; k++) {
+            for (int r = 0; r < rows; r++) {
+                if (chunk[k * 61 + r] != whole[k * total + first + r]) mismatches++;
+            }
+        }
+        first += rows;
+    }
+    CHECK(mismatches == 0);
+    CHECK(data_buffer_query(&q, total, 61, chunk, &rows) == ESP_OK && rows == 0);
+
+    // 終了が未来の場合は最新データの次の分で打ち切る
+    q = test_make_query(g_start, DATA_BUFFER_MINUTES_PER_DAY - 30, DATA_BUFFER_MINUTES_PER_DAY + 600, 1, mask, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query_rows(&q) == 30);
+}
+
+static void test_frozen_rows(void) {
+    // 行を分けた取得の途中で1分データが追加されても、確定した全行数と各行の範囲のまま取得できる
+    uint16_t mask = 1u << DATA_BUFFER_FIELD_TEMPERATURE;
+    data_buffer_query_t q = test_make_query(g_start, DATA_BUFFER_MINUTES_PER_DAY - 30, DATA_BUFFER_MINUTES_PER_DAY + 600, 7, mask,
+                                            DATA_BUFFER_AGG_AVG);
+    uint16_t total = 0;
+    CHECK(data_buffer_query_freeze(&q, false, &total) == ESP_OK);
+    CHECK(total == 5);
+    CHECK(q.window.end_minute == (uint32_t)(g_start / 60) + DATA_BUFFER_MINUTES_PER_DAY);
+
+    int16_t before[5];
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&q, 0, 2, before, &rows) == ESP_OK && rows == 2);
+
+    // 最後の行（1438〜1444分）の範囲に新しいデータが入る
+    add_minutes(DATA_BUFFER_MINUTES_PER_DAY, DATA_BUFFER_MINUTES_PER_DAY + 20);
+    CHECK(data_buffer_query_rows(&q) == total);
+    CHECK(data_buffer_query(&q, 2, 3, before + 2, &rows) == ESP_OK && rows == 3);
+    for (int r = 0; r < total; r++) {
+        int from = DATA_BUFFER_MINUTES_PER_DAY - 30 + r * 7;
+        int step = (from + 7 > DATA_BUFFER_MINUTES_PER_DAY) ? DATA_BUFFER_MINUTES_PER_DAY - from : 7;
+        CHECK(before[r] == expected_cell(from, step, DATA_BUFFER_FIELD_TEMPERATURE, DATA_BUFFER_AGG_AVG));
+    }
+}
+
+static void test_frozen_start(void) {
+    // 開始が1分リングより前の範囲は、行の区切りを保って保持範囲を含む行まで先頭を進める
+    uint16_t mask = 1u << DATA_BUFFER_FIELD_TEMPERATURE;
+    uint32_t base = (uint32_t)(g_start / 60);
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY + 20, 7, mask, DATA_BUFFER_AGG_AVG);
+    q.window.start_minute = base - 365 * DATA_BUFFER_MINUTES_PER_DAY;
+    uint32_t requested = q.window.start_minute;
+    uint16_t total = 0;
+    CHECK(data_buffer_query_freeze(&q, false, &total) == ESP_OK);
+    CHECK((q.window.start_minute - requested) % 7 == 0);
+    CHECK(q.window.start_minute <= base + 20 && q.window.start_minute + 7 > base + 20);
+    CHECK(total == (DATA_BUFFER_MINUTES_PER_DAY + 20 - (q.window.start_minute - base) + 6) / 7);
+
+    // 行数の上限を超える範囲は打ち切らずに0行
+    q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, 1, mask, DATA_BUFFER_AGG_FIRST);
+    q.window.start_minute = base - 365 * DATA_BUFFER_MINUTES_PER_DAY;
+    CHECK(data_buffer_query_rows(&q) == 0);
+    CHECK(data_buffer_query_freeze(&q, false, &total) == ESP_OK);
+    CHECK(total == DATA_BUFFER_MINUTES_PER_DAY - 20);
+
+    // 保持範囲より後だけの範囲はデータなし
+    q = test_make_query(g_start, DATA_BUFFER_MINUTES_PER_DAY + 60, DATA_BUFFER_MINUTES_PER_DAY + 120, 1, mask, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query_freeze(&q, false, &total) == ESP_ERR_NOT_FOUND);
+}
+
+static void test_invalid_query(void) {
+    int16_t columns[16];
+    uint16_t rows;
+    data_buffer_query_t q = test_make_query(g_start, 0, 60, 0, 1, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query(&q, 0, 16, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q = test_make_query(g_start, 0, 60, 1, 0, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query(&q, 0, 16, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q = test_make_query(g_start, 0, 60, 1, 1u << DATA_BUFFER_FIELD_COUNT, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query(&q, 0, 16, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q = test_make_query(g_start, 0, 60, 1, 1, DATA_BUFFER_AGG_COUNT);
+    CHECK(data_buffer_query(&q, 0, 16, columns, &rows) == ESP_ERR_INVALID_ARG);
+    q = test_make_query(g_start, 60, 60, 1, 1, DATA_BUFFER_AGG_FIRST);
+    CHECK(data_buffer_query_rows(&q) == 0);
+}
+
+static void bench_query_vs_per_minute(void) {
+    // 24時間分の気温: 1分ずつの時刻指定取得（従来の CMD_GET_TIME_DATA 1440回相当）と1回のクエリ
+    const int iterations = 20;
+    clock_t t0 = clock();
+    int found = 0;
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+            time_t t = g_start + (time_t)i * 60;
+            struct tm ts;
+            localtime_r(&t, &ts);
+            minute_data_t data;
+            if (data_buffer_get_minute_data(&ts, &data) == ESP_OK) found++;
+        }
+    }
+    clock_t t1 = clock();
+    static int16_t columns[DATA_BUFFER_MINUTES_PER_DAY];
+    uint16_t rows = 0;
+    data_buffer_query_t q = test_make_query(g_start, 0, DATA_BUFFER_MINUTES_PER_DAY, 1, 1u << DATA_BUFFER_FIELD_TEMPERATURE, DATA_BUFFER_AGG_FIRST);
+    for (int n = 0; n < iterations; n++) {
+        CHECK(data_buffer_query(&q, 0, DATA_BUFFER_MINUTES_PER_DAY, columns, &rows) == ESP_OK);
+    }
+    clock_t t2 = clock();
+    printf("  per-minute lookup: %.1f us/day, query: %.1f us/day (%u rows, %d bytes)\n",
+           (double)(t1 - t0) * 1e6 / CLOCKS_PER_SEC / iterations,
+           (double)(t2 - t1) * 1e6 / CLOCKS_PER_SEC / iterations, rows, (int)(rows * sizeof(int16_t)));
+    CHECK(found == iterations * (DATA_BUFFER_MINUTES_PER_DAY - (GAP_TO - GAP_FROM)));
+    CHECK(rows == DATA_BUFFER_MINUTES_PER_DAY);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, DATA_BUFFER_MINUTES_PER_DAY);
+
+    RUN_TEST(test_projection_columns);
+    RUN_TEST(test_decimation);
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_invalid_query);
+    RUN_TEST(bench_query_vs_per_minute);
+    RUN_TEST(test_frozen_rows);
+    RUN_TEST(test_frozen_start);
+    return TEST_RESULT();
+}
@@ -0,0 +1,222 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+#include "rollup_tier.h"
+
+// 10分/1時間集計の逐次更新、保持期間、期間指定取得の階層選択、履歴データ全体のRAM使用量の確認
+
+// 従来の1分データバッファ（ターゲットの minute_data_t 92バイト x 1440件, Rev3）
+#define LEGACY_MINUTE_BUFFER_BYTES  (92 * DATA_BUFFER_MINUTES_PER_DAY)
+
+static time_t g_start;  // 投入開始時刻（0:00）
+
+static void add_minutes(int from, int to) {
+    for (int i = from; i < to; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+}
+
+/**
+ * 投入データ [from, from+n) の値から期待する集計値を求め、データ点と比較
+ */
+static void check_point(const history_point_data_t *p, int from, int n) {
+    double temp_sum = 0, hum_sum = 0, soil_sum = 0;
+    float temp_min = 1e9f, temp_max = -1e9f, soil_min = 1e9f, soil_max = -1e9f;
+    float hum_min = 1e9f, hum_max = -1e9f, lux_min = 1e9f, lux_max = -1e9f;
+    float soil_temp_min = 1e9f, soil_temp_max = -1e9f;
+    for (int i = from; i < from + n; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+#if (HARDWARE_VERSION == 30 || HARDWARE_VERSION == 40)
+        float soil_temp = sd.soil_temperature[0];
+#else
+        float soil_temp = sd.soil_temperature1;
+#endif
+        temp_sum += sd.temperature;
+        hum_sum += sd.humidity;
+        soil_sum += sd.soil_moisture;
+        if (sd.temperature < temp_min) temp_min = sd.temperature;
+        if (sd.temperature > temp_max) temp_max = sd.temperature;
+        if (sd.humidity < hum_min) hum_min = sd.humidity;
+        if (sd.humidity > hum_max) hum_max = sd.humidity;
+        if (sd.lux < lux_min) lux_min = sd.lux;
+        if (sd.lux > lux_max) lux_max = sd.lux;
+        if (sd.soil_moisture < soil_min) soil_min = sd.soil_moisture;
+        if (sd.soil_moisture > soil_max) soil_max = sd.soil_moisture;
+        if (soil_temp < soil_temp_min) soil_temp_min = soil_temp;
+        if (soil_temp > soil_temp_max) soil_temp_max = soil_temp;
+    }
+
+    float temp_unit = ROLLUP_TEMP_DELTA_UNIT / MINUTE_RECORD_TEMP_SCALE;
+    float soil_unit = ROLLUP_SOIL_DELTA_UNIT / MINUTE_RECORD_SOIL_SCALE;
+    float soil_eps = 1.0f / MINUTE_RECORD_SOIL_SCALE;
+
+    CHECK(p->samples == n);
+    CHECK(mktime((struct tm *)&p->timestamp) == g_start + (time_t)from * 60);
+    CHECK_NEAR(p->avg_temperature, temp_sum / n, 0.011f);
+    CHECK_NEAR(p->avg_humidity, hum_sum / n, 0.26f);
+    CHECK_NEAR(p->avg_soil_moisture, soil_sum / n, soil_eps);
+
+    // 最小/最大は量子化1段分まで外側に広がるが、実際の値は必ず包含する
+    CHECK(p->min_temperature <= temp_min + 0.006f && p->min_temperature >= temp_min - temp_unit - 0.011f);
+    CHECK(p->max_temperature >= temp_max - 0.006f && p->max_temperature <= temp_max + temp_unit + 0.011f);
+    CHECK(p->min_soil_moisture <= soil_min + soil_eps && p->min_soil_moisture >= soil_min - soil_unit - soil_eps);
+    CHECK(p->max_soil_moisture >= soil_max - soil_eps && p->max_soil_moisture <= soil_max + soil_unit + soil_eps);
+
+    // 湿度は0.5%、照度は対数符号1段（約4.7%）、土壌温度は1/16℃まで外側に広がる
+    float hum_unit = ROLLUP_HUMIDITY_UNIT / MINUTE_RECORD_HUMIDITY_SCALE;
+    float lux_step = exp2f(1.0f / ROLLUP_LUX_STEPS_PER_OCTAVE);
+    float probe_unit = ROLLUP_PROBE_DELTA_UNIT / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    CHECK(p->min_humidity <= hum_min + 0.006f && p->min_humidity >= hum_min - hum_unit - 0.011f);
+    CHECK(p->max_humidity >= hum_max - 0.006f && p->max_humidity <= hum_max + hum_unit + 0.011f);
+    CHECK(p->min_lux <= lux_min * 1.001f && p->min_lux >= lux_min / lux_step / 1.001f);
+    CHECK(p->max_lux >= lux_max / 1.001f && p->max_lux <= lux_max * lux_step * 1.001f);
+    CHECK(p->min_lux <= p->avg_lux && p->avg_lux <= p->max_lux);
+    CHECK(p->soil_temperature_valid);
+    CHECK(p->min_soil_temperature <= soil_temp_min + 0.001f && p->min_soil_temperature >= soil_temp_min - probe_unit - 0.001f);
+    CHECK(p->max_soil_temperature >= soil_temp_max - 0.001f && p->max_soil_temperature <= soil_temp_max + probe_unit + 0.001f);
+}
+
+static void test_rollup_values(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, 3 * DATA_BUFFER_MINUTES_PER_DAY);
+
+    // 1日目は1分データから消えているので10分集計で返る
+    static history_point_data_t points[DATA_BUFFER_MINUTES_PER_DAY];
+    uint16_t count;
+    data_buffer_tier_t tier;
+    time_t from = g_start, to = g_start + 86400;
+    struct tm start, end;
+    localtime_r(&from, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_history(&start, &end, points, 144, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_10MIN);
+    CHECK(count == 144);
+    for (int b = 0; b < count; b += 7) {
+        check_point(&points[b], b * 10, 10);
+    }
+
+    // 区間数を絞ると1時間集計に切り替わる
+    CHECK(data_buffer_get_history(&start, &end, points, 24, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_HOURLY);
+    CHECK(count == 24);
+    for (int b = 0; b < count; b++) {
+        check_point(&points[b], b * 60, 60);
+    }
+
+    // 書き込み中の区間（途中まで）も逐次反映される
+    add_minutes(3 * DATA_BUFFER_MINUTES_PER_DAY, 3 * DATA_BUFFER_MINUTES_PER_DAY + 37);
+    from = g_start + 3 * 86400;
+    to = from + 3600;
+    localtime_r(&from, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_history(&start, &end, points, 1, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_HOURLY && count == 1);
+    check_point(&points[0], 3 * DATA_BUFFER_MINUTES_PER_DAY, 37);
+}
+
+static void test_overwrite_rebuilds_bucket(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, 30);
+    // 同じ時刻のデータを再投入しても区間のサンプル数は増えない
+    add_minutes(10, 20);
+
+    history_point_data_t points[3];
+    uint16_t count;
+    data_buffer_tier_t tier;
+    time_t to = g_start + 30 * 60;
+    struct tm start, end;
+    localtime_r(&g_start, &start);
+    localtime_r(&to, &end);
+    CHECK(data_buffer_get_history(&start, &end, points, 3, &count, &tier) == ESP_OK);
+    CHECK(tier == DATA_BUFFER_TIER_10MIN && count == 3);
+    for (int b = 0; b < count; b++) {
+        check_point(&points[b], b * 10, 10);
+    }
+}
+
+static void test_tier_selection_and_retention(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    int days = 40;
+    int total = days * DATA_BUFFER_MINUTES_PER_DAY;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    add_minutes(0, total);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    printf("  data_buffer_add_minute_data with tiers: %.1f ns/sample (%d samples)\n", ns / total, total);
+
+    time_t now = g_start + (time_t)(total - 1) * 60;
+    time_t end_time = now + 60;
+    struct tm start, end;
+    localtime_r(&end_time, &end);
+    static history_point_data_t points[1500];  // cases の max_points の最大値
+    uint16_t count;
+    data_buffer_tier_t tier;
+
+    struct {
+        int hours;
+        uint16_t max_points;
+        data_buffer_tier_t expected;
+        uint16_t expected_count;
+    } cases[] = {
+        { 6,        360,  DATA_BUFFER_TIER_MINUTE, 360 },
+        { 24,       1440, DATA_BUFFER_TIER_MINUTE, 1440 },
+        { 6,        100,  DATA_BUFFER_TIER_10MIN,  36 },
+        { 25,       1500, DATA_BUFFER_TIER_10MIN,  150 },
+        { 7 * 24,   1008, DATA_BUFFER_TIER_10MIN,  1008 },
+        { 8 * 24,   1152, DATA_BUFFER_TIER_HOURLY, 192 },
+        { 31 * 24,  DATA_BUFFER_HOURLY_CAPACITY, DATA_BUFFER_TIER_HOURLY, DATA_BUFFER_HOURLY_CAPACITY },
+        // 保持期間より前は返らない
+        { 35 * 24,  DATA_BUFFER_HOURLY_CAPACITY, DATA_BUFFER_TIER_HOURLY, DATA_BUFFER_HOURLY_CAPACITY },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        time_t start_time = end_time - (time_t)cases[c].hours * 3600;
+        localtime_r(&start_time, &start);
+        CHECK(data_buffer_get_history(&start, &end, points, cases[c].max_points, &count, &tier) == ESP_OK);
+        CHECK(tier == cases[c].expected);
+        CHECK(count == cases[c].expected_count);
+        CHECK(count > 0 && mktime(&points[count - 1].timestamp) <= now);
+        if (count != cases[c].expected_count || tier != cases[c].expected) {
+            printf("  case %zu: tier=%d count=%u\n", c, tier, count);
+        }
+    }
+
+    // 31日前の1時間集計が最古のデータ
+    time_t oldest = end_time - (time_t)DATA_BUFFER_HOURLY_CAPACITY * 3600;
+    CHECK(mktime(&points[0].timestamp) == oldest);
+    check_point(&points[0], (int)((oldest - g_start) / 60), 60);
+
+    // 期間が逆転している場合はエラー
+    CHECK(data_buffer_get_history(&end, &start, points, 10, &count, &tier) == ESP_ERR_INVALID_ARG);
+}
+
+static void test_ram_budget(void) {
+    size_t minute_ram = sizeof(minute_record_t) * DATA_BUFFER_MINUTE_CAPACITY;
+    size_t tier10_ram = sizeof(rollup_record_t) * DATA_BUFFER_TIER10_CAPACITY;
+    size_t hourly_ram = sizeof(rollup_record_t) * DATA_BUFFER_HOURLY_CAPACITY;
+    size_t total = data_buffer_ram_usage();
+
+    printf("  1min  : %zu bytes x %d = %zu bytes\n", sizeof(minute_record_t), DATA_BUFFER_MINUTE_CAPACITY, minute_ram);
+    printf("  10min : %zu bytes x %d = %zu bytes\n", sizeof(rollup_record_t), DATA_BUFFER_TIER10_CAPACITY, tier10_ram);
+    printf("  hourly: %zu bytes x %d = %zu bytes\n", sizeof(rollup_record_t), DATA_BUFFER_HOURLY_CAPACITY, hourly_ram);
+    printf("  total : %zu bytes incl. daily/stats/archive/log buffers/snapshot (legacy minute buffer %d bytes)\n",
+           total, LEGACY_MINUTE_BUFFER_BYTES);
+
+    CHECK(sizeof(rollup_record_t) == 21);
+    CHECK(total > minute_ram + tier10_ram + hourly_ram);
+    CHECK(total <= LEGACY_MINUTE_BUFFER_BYTES);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_rollup_values);
+    RUN_TEST(test_overwrite_rebuilds_bucket);
+    RUN_TEST(test_tier_selection_and_retention);
+    RUN_TEST(test_ram_budget);
+    return TEST_RESULT();
+}
@@ -0,0 +1,348 @@
+#include "test_common.h"
+#include "rule_engine.h"
+#include "plant_rules.h"
+
+// 状態判定のルール: 表の検証と費用の上限、優先度、ヒステリシス、継続時間、AND の連結、
+// 既定のルールが置き換え前の固定の判定と全サンプルで一致すること、ルールごとの実績
+
+#define BASE_MINUTE     29000000u
+
+static rule_t make_rule(rule_operand_t operand, rule_comparator_t comparator, float threshold, uint8_t condition, uint8_t priority) {
+    rule_t rule = {0};
+    rule.operand = (uint8_t)operand;
+    rule.comparator = (uint8_t)comparator;
+    rule.condition = condition;
+    rule.priority = priority;
+    rule.threshold = threshold;
+    return rule;
+}
+
+static void init_set(rule_set_t *set) {
+    memset(set, 0, sizeof(*set));
+    set->version = RULE_SET_VERSION;
+}
+
+static void set_value(rule_inputs_t *inputs, rule_operand_t operand, float value) {
+    inputs->value[operand] = value;
+    inputs->valid_mask |= (uint16_t)(1u << operand);
+}
+
+static void test_check(void) {
+    rule_set_t set;
+    init_set(&set);
+    uint16_t cost = 0;
+    CHECK(rule_engine_check(&set, ERROR_CONDITION, &cost) == ESP_OK && cost == 0);
+
+    set.rules[set.count++] = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 30.0f, TEMP_TOO_HIGH, 0);
+    CHECK(rule_engine_check(&set, ERROR_CONDITION, &cost) == ESP_OK && cost == 1);
+
+    rule_set_t bad = set;
+    bad.version = RULE_SET_VERSION + 1;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_NOT_SUPPORTED);
+    bad = set;
+    bad.count = RULE_ENGINE_MAX_RULES + 1;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].operand = RULE_OPERAND_COUNT;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].comparator = RULE_CMP_COUNT;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].condition = ERROR_CONDITION;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].flags = 0x80;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].flags = RULE_FLAG_AND_NEXT;  // 連結が閉じていない
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].hysteresis = -1.0f;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0].threshold = NAN;
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+    bad = set;
+    bad.rules[0] = make_rule(RULE_OPERAND_DRY_DAYS, RULE_CMP_GE, RULE_ENGINE_MAX_DRY_DAYS + 1, NEEDS_WATERING, 0);
+    CHECK(rule_engine_check(&bad, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_ARG);
+
+    // 費用: ルール数 + 最も深い乾燥日数。上限を超える表は受け付けない
+    init_set(&set);
+    for (int i = 0; i < RULE_ENGINE_MAX_RULES; i++) {
+        set.rules[set.count++] = make_rule(RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_GE, 10.0f + i, SOIL_DRY, 0);
+    }
+    set.rules[3] = make_rule(RULE_OPERAND_DRY_DAYS, RULE_CMP_GE, RULE_ENGINE_MAX_COST - RULE_ENGINE_MAX_RULES, NEEDS_WATERING, 0);
+    set.rules[4] = make_rule(RULE_OPERAND_DRY_DAYS, RULE_CMP_LE, 2.0f, SOIL_WET, 0);
+    CHECK(rule_engine_check(&set, ERROR_CONDITION, &cost) == ESP_OK && cost == RULE_ENGINE_MAX_COST);
+    set.rules[3].threshold += 1.0f;
+    CHECK(rule_engine_check(&set, ERROR_CONDITION, NULL) == ESP_ERR_INVALID_SIZE);
+
+    // 失敗した読み込みは engine を変更しない
+    rule_engine_t engine;
+    rule_set_t small;
+    init_set(&small);
+    small.rules[small.count++] = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 30.0f, TEMP_TOO_HIGH, 0);
+    CHECK(rule_engine_load(&engine, &small, ERROR_CONDITION) == ESP_OK);
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_ERR_INVALID_SIZE);
+    CHECK(engine.set.count == 1 && engine.total_cost == 1);
+}
+
+static void test_priority(void) {
+    rule_set_t set;
+    init_set(&set);
+    set.rules[set.count++] = make_rule(RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_GE, 5.0f, SOIL_DRY, 5);
+    set.rules[set.count++] = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 30.0f, TEMP_TOO_HIGH, 0);
+    set.rules[set.count++] = make_rule(RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_GE, 6.0f, NEEDS_WATERING, 5);
+    rule_engine_t engine;
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+
+    rule_inputs_t inputs = { .epoch_minute = BASE_MINUTE };
+    set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 7.0f);
+    set_value(&inputs, RULE_OPERAND_TEMPERATURE, 31.0f);
+    rule_result_t result;
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == TEMP_TOO_HIGH && result.rule_index == 1);
+
+    // 優先度が同じなら先のルール
+    set_value(&inputs, RULE_OPERAND_TEMPERATURE, 20.0f);
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == SOIL_DRY && result.rule_index == 0);
+
+    // 無効なオペランドのルールは成立しない
+    inputs.valid_mask &= (uint16_t)~(1u << RULE_OPERAND_SOIL_MOISTURE);
+    CHECK(!rule_engine_evaluate(&engine, &inputs, &result) && !result.matched);
+}
+
+static void test_hysteresis(void) {
+    rule_set_t set;
+    init_set(&set);
+    rule_t rule = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 30.0f, TEMP_TOO_HIGH, 0);
+    rule.hysteresis = 2.0f;
+    set.rules[set.count++] = rule;
+    rule = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_LE, 10.0f, TEMP_TOO_LOW, 0);
+    rule.hysteresis = 1.0f;
+    set.rules[set.count++] = rule;
+    rule_engine_t engine;
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+
+    const float temps[] = { 29.0f, 30.0f, 29.0f, 28.0f, 27.9f, 29.0f, 10.5f, 10.0f, 10.9f, 11.0f, 11.1f, 10.5f };
+    const int expect[] = { -1, TEMP_TOO_HIGH, TEMP_TOO_HIGH, TEMP_TOO_HIGH, -1, -1, -1, TEMP_TOO_LOW, TEMP_TOO_LOW, TEMP_TOO_LOW, -1, -1 };
+    for (size_t i = 0; i < sizeof(temps) / sizeof(temps[0]); i++) {
+        rule_inputs_t inputs = { .epoch_minute = BASE_MINUTE + (uint32_t)i };
+        set_value(&inputs, RULE_OPERAND_TEMPERATURE, temps[i]);
+        rule_result_t result;
+        bool matched = rule_engine_evaluate(&engine, &inputs, &result);
+        CHECK(matched == (expect[i] >= 0));
+        if (matched) {
+            CHECK(result.condition == expect[i]);
+        }
+    }
+}
+
+static void test_duration(void) {
+    rule_set_t set;
+    init_set(&set);
+    rule_t rule = make_rule(RULE_OPERAND_SOIL_MOISTURE, RULE_CMP_GE, 5.0f, SOIL_DRY, 0);
+    rule.duration_minutes = 10;
+    set.rules[set.count++] = rule;
+    rule_engine_t engine;
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+
+    rule_inputs_t inputs = {0};
+    rule_result_t result;
+    set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 6.0f);
+    for (uint32_t m = 0; m < 10; m++) {
+        inputs.epoch_minute = BASE_MINUTE + m;
+        CHECK(!rule_engine_evaluate(&engine, &inputs, &result));
+    }
+    inputs.epoch_minute = BASE_MINUTE + 10;
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == SOIL_DRY);
+    CHECK(engine.state[0].holding && engine.state[0].since_minute == BASE_MINUTE);
+
+    // 途切れたら数え直す
+    inputs.epoch_minute = BASE_MINUTE + 11;
+    set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 4.0f);
+    CHECK(!rule_engine_evaluate(&engine, &inputs, &result) && !engine.state[0].holding);
+    set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 6.0f);
+    inputs.epoch_minute = BASE_MINUTE + 12;
+    CHECK(!rule_engine_evaluate(&engine, &inputs, &result));
+    inputs.epoch_minute = BASE_MINUTE + 22;
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result));
+
+    // 時刻が戻った場合も数え直す
+    inputs.epoch_minute = BASE_MINUTE + 5;
+    CHECK(!rule_engine_evaluate(&engine, &inputs, &result) && engine.state[0].since_minute == BASE_MINUTE + 5);
+}
+
+static void test_and_chain(void) {
+    // (湿度 >= 80 AND 気温 >= 25) が5分続いたら高温（優先度・状態・継続時間は連結の最後のルール）
+    rule_set_t set;
+    init_set(&set);
+    rule_t rule = make_rule(RULE_OPERAND_HUMIDITY, RULE_CMP_GE, 80.0f, SOIL_WET, 9);
+    rule.flags = RULE_FLAG_AND_NEXT;
+    set.rules[set.count++] = rule;
+    rule = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 25.0f, TEMP_TOO_HIGH, 1);
+    rule.duration_minutes = 5;
+    set.rules[set.count++] = rule;
+    set.rules[set.count++] = make_rule(RULE_OPERAND_TEMPERATURE, RULE_CMP_GE, 20.0f, SOIL_DRY, 2);
+    rule_engine_t engine;
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+
+    rule_inputs_t inputs = {0};
+    rule_result_t result;
+    set_value(&inputs, RULE_OPERAND_HUMIDITY, 85.0f);
+    set_value(&inputs, RULE_OPERAND_TEMPERATURE, 26.0f);
+    for (uint32_t m = 0; m < 5; m++) {
+        inputs.epoch_minute = BASE_MINUTE + m;
+        CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == SOIL_DRY);
+    }
+    inputs.epoch_minute = BASE_MINUTE + 5;
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == TEMP_TOO_HIGH && result.rule_index == 1);
+
+    // 連結の片方が不成立なら連結全体が不成立
+    set_value(&inputs, RULE_OPERAND_HUMIDITY, 70.0f);
+    inputs.epoch_minute = BASE_MINUTE + 6;
+    CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == SOIL_DRY);
+    CHECK(!engine.state[0].active && engine.state[1].active && !engine.state[1].holding);
+}
+
+/**
+ * 置き換え前の固定の判定（determine_plant_condition と同じ処理、過去データの参照は引数で渡す）
+ */
+static plant_condition_t legacy_condition(const plant_profile_t *profile, const rule_inputs_t *inputs,
+                                          plant_condition_t last, int dry_days_available) {
+    float soil_moisture = inputs->value[RULE_OPERAND_SOIL_MOISTURE];
+    float temperature = inputs->value[RULE_OPERAND_TEMPERATURE];
+    if (temperature >= profile->temp_high_limit) {
+        return TEMP_TOO_HIGH;
+    }
+    if (temperature <= profile->temp_low_limit) {
+        return TEMP_TOO_LOW;
+    }
+    if ((inputs->valid_mask & (1u << RULE_OPERAND_WATERING_DECREASE)) &&
+        inputs->value[RULE_OPERAND_WATERING_DECREASE] >= profile->watering_threshold) {
+        return WATERING_COMPLETED;
+    }
+    if ((last == SOIL_DRY || last == NEEDS_WATERING) && soil_moisture <= profile->soil_wet_threshold) {
+        return WATERING_COMPLETED;
+    }
+    if (profile->soil_dry_days_for_watering > 0) {
+        int consecutive_dry_days = 0;
+        for (int i = 0; i < profile->soil_dry_days_for_watering && i < dry_days_available; i++) {
+            consecutive_dry_days++;
+        }
+        if (consecutive_dry_days >= profile->soil_dry_days_for_watering) {
+            return NEEDS_WATERING;
+        }
+    }
+    if (soil_moisture >= profile->soil_dry_threshold) {
+        return SOIL_DRY;
+    }
+    if (soil_moisture <= profile->soil_wet_threshold) {
+        return SOIL_WET;
+    }
+    return last;
+}
+
+static uint32_t g_rng = 0x12345678u;
+static uint32_t next_random(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return g_rng;
+}
+
+static void test_default_matches_legacy(void) {
+    const int dry_days_settings[] = { 0, 1, 3, RULE_ENGINE_MAX_DRY_DAYS, RULE_ENGINE_MAX_DRY_DAYS + 1 };
+    for (size_t p = 0; p < sizeof(dry_days_settings) / sizeof(dry_days_settings[0]); p++) {
+        plant_profile_t profile = {0};
+        profile.soil_dry_threshold = 6.0f;
+        profile.soil_wet_threshold = 4.0f;
+        profile.soil_dry_days_for_watering = dry_days_settings[p];
+        profile.temp_high_limit = 35.0f;
+        profile.temp_low_limit = 5.0f;
+        profile.watering_threshold = 0.5f;
+
+        rule_set_t set;
+        plant_rules_build_default(&profile, &set);
+        rule_engine_t engine;
+        CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+        if (profile.soil_dry_days_for_watering > 0 && profile.soil_dry_days_for_watering <= RULE_ENGINE_MAX_DRY_DAYS) {
+            CHECK(engine.dry_days_depth == profile.soil_dry_days_for_watering);
+        } else {
+            CHECK(!(engine.operand_mask & (1u << RULE_OPERAND_DRY_DAYS)));
+        }
+
+        plant_condition_t last_legacy = SOIL_WET, last_rules = SOIL_WET;
+        int mismatches = 0;
+        for (uint32_t m = 0; m < 100000; m++) {
+            // 閾値付近に値が集まるように生成（境界の一致も確かめる）
+            rule_inputs_t inputs = { .epoch_minute = BASE_MINUTE + m };
+            set_value(&inputs, RULE_OPERAND_TEMPERATURE, (float)(next_random() % 9) * 5.0f - 5.0f);
+            set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 3.0f + (float)(next_random() % 9) * 0.5f);
+            if (next_random() % 4 != 0) {
+                set_value(&inputs, RULE_OPERAND_WATERING_DECREASE, (float)(next_random() % 5) * 0.25f - 0.25f);
+            }
+            int available = (int)(next_random() % (RULE_ENGINE_MAX_DRY_DAYS + 1));  // 日別サマリーは最大30日分
+            if (engine.operand_mask & (1u << RULE_OPERAND_DRY_DAYS)) {
+                set_value(&inputs, RULE_OPERAND_DRY_DAYS, (float)(available < engine.dry_days_depth ? available : engine.dry_days_depth));
+            }
+            set_value(&inputs, RULE_OPERAND_LAST_CONDITION, (float)last_rules);
+
+            plant_condition_t expected = legacy_condition(&profile, &inputs, last_legacy, available);
+            rule_result_t result;
+            plant_condition_t actual = rule_engine_evaluate(&engine, &inputs, &result) ? (plant_condition_t)result.condition : last_rules;
+            if (actual != expected) {
+                mismatches++;
+            }
+            last_legacy = expected;
+            last_rules = actual;
+        }
+        printf("  dry days %d: %u rules, cost %u, %d mismatches\n", profile.soil_dry_days_for_watering,
+               set.count, engine.total_cost, mismatches);
+        CHECK(mismatches == 0);
+    }
+}
+
+static void test_stats(void) {
+    plant_profile_t profile = {0};
+    profile.soil_dry_threshold = 6.0f;
+    profile.soil_wet_threshold = 4.0f;
+    profile.soil_dry_days_for_watering = 3;
+    profile.temp_high_limit = 35.0f;
+    profile.temp_low_limit = 5.0f;
+    profile.watering_threshold = 0.5f;
+    rule_set_t set;
+    plant_rules_build_default(&profile, &set);
+    rule_engine_t engine;
+    CHECK(rule_engine_load(&engine, &set, ERROR_CONDITION) == ESP_OK);
+    CHECK(set.count == 10 && engine.total_cost == 10 + 3);
+    CHECK(engine.state[7].cost == 4 && engine.state[0].cost == 1);
+
+    rule_inputs_t inputs = { .epoch_minute = BASE_MINUTE };
+    set_value(&inputs, RULE_OPERAND_TEMPERATURE, 20.0f);
+    set_value(&inputs, RULE_OPERAND_SOIL_MOISTURE, 7.0f);
+    set_value(&inputs, RULE_OPERAND_LAST_CONDITION, (float)SOIL_WET);
+    set_value(&inputs, RULE_OPERAND_DRY_DAYS, 0.0f);
+    rule_result_t result;
+    for (int i = 0; i < 5; i++) {
+        inputs.epoch_minute++;
+        CHECK(rule_engine_evaluate(&engine, &inputs, &result) && result.condition == SOIL_DRY);
+    }
+    CHECK(engine.evaluations == 5);
+    CHECK(engine.state[result.rule_index].true_count == 5 && engine.state[result.rule_index].matches == 5);
+    CHECK(engine.state[0].true_count == 0 && engine.state[0].matches == 0);
+    for (uint8_t i = 0; i < set.count; i++) {
+        CHECK(engine.state[i].max_cycles >= engine.state[i].last_cycles);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_check);
+    RUN_TEST(test_priority);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_duration);
+    RUN_TEST(test_and_chain);
+    RUN_TEST(test_default_matches_legacy);
+    RUN_TEST(test_stats);
+    return TEST_RESULT();
+}
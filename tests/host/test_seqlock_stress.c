@@ -0,0 +1,259 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "seqlock.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+// 書き込みスレッド1本と読み出しスレッド複数を並行に走らせ、読み出した値が
+// 書き込み途中の混ざったデータになっていないことを確認する
+// （シングルコアでも重なりが起きるよう、プリミティブのテストでは書き込み途中で実行を譲る）
+
+#define STRESS_DAYS       6   // 書き込むデータの日数
+#define STRESS_READERS    3   // 読み出しスレッド数
+#define STRESS_WORDS      16  // プリミティブテストのペイロード長
+#define STRESS_WRITES     20000
+
+static time_t g_start;                  // 投入開始時刻（0:00）
+static atomic_bool g_writer_done;
+static atomic_int g_torn;               // 不整合を検出した回数（スレッド間で集計）
+
+typedef struct {
+    int kind;                           // 読み出し方法
+    unsigned long reads;                // 読み出し成功回数
+} reader_ctx_t;
+
+/**
+ * 1分データがその時刻に書き込まれた値と一致するか
+ */
+static bool minute_matches(const minute_data_t *data) {
+    time_t t = mktime((struct tm *)&data->timestamp);
+    int i = (int)((t - g_start) / 60);
+    if (i < 0 || i >= STRESS_DAYS * DATA_BUFFER_MINUTES_PER_DAY) {
+        return false;
+    }
+    soil_data_t sd;
+    test_fill_sensor(&sd, t, i);
+    return fabsf(data->temperature - sd.temperature) < 0.006f &&
+           fabsf(data->humidity - sd.humidity) < 0.006f &&
+           fabsf(data->lux - sd.lux) <= sd.lux * 0.0005f &&
+           fabsf(data->soil_moisture - sd.soil_moisture) < 0.001f &&
+           fabsf(data->soil_temperature[0] - sd.soil_temperature[0]) < 0.01f;
+}
+
+static bool summary_consistent(const daily_summary_data_t *s) {
+    return s->valid_samples > 0 && s->valid_samples <= DATA_BUFFER_MINUTES_PER_DAY &&
+           s->min_temperature <= s->avg_temperature + 0.01f && s->avg_temperature <= s->max_temperature + 0.01f &&
+           s->min_soil_moisture <= s->avg_soil_moisture + 0.01f && s->avg_soil_moisture <= s->max_soil_moisture + 0.01f;
+}
+
+/**
+ * 10分集計が区間先頭から samples 件の投入値の平均と一致するか（件数と合計の食い違いを検出）
+ */
+static bool point_matches(const history_point_data_t *point) {
+    time_t t = mktime((struct tm *)&point->timestamp);
+    int first = (int)((t - g_start) / 60);
+    if (point->samples == 0 || point->samples > DATA_BUFFER_TIER10_MINUTES) {
+        return false;
+    }
+    double lux_sum = 0;
+    for (int i = first; i < first + point->samples; i++) {
+        lux_sum += 1000.0 + (i % 600) * 50.0;
+    }
+    double expected = lux_sum / point->samples;
+    return fabs(point->avg_lux - expected) <= expected * 0.0005 &&
+           point->min_temperature <= point->avg_temperature + 0.01f &&
+           point->avg_temperature <= point->max_temperature + 0.01f;
+}
+
+static void read_once(reader_ctx_t *ctx) {
+    switch (ctx->kind) {
+    case 0: {
+        // 最新1件と、その1分前の時刻指定取得
+        minute_data_t data;
+        if (data_buffer_get_latest_minute_data(&data) == ESP_OK) {
+            if (!minute_matches(&data)) atomic_fetch_add(&g_torn, 1);
+            ctx->reads++;
+            time_t t = mktime(&data.timestamp) - 60;
+            struct tm prev;
+            localtime_r(&t, &prev);
+            if (data_buffer_get_minute_data(&prev, &data) == ESP_OK) {
+                if (!minute_matches(&data)) atomic_fetch_add(&g_torn, 1);
+                ctx->reads++;
+            }
+        }
+        break;
+    }
+    case 1: {
+        // 最古から60分をイテレータで走査（次に上書きされるスロットから読むので書き込みと重なりやすい）
+        data_buffer_window_t window = { 0, UINT32_MAX };
+        data_buffer_iter_t it;
+        if (data_buffer_iter_begin(&it, &window) != ESP_OK) break;
+        time_t prev = 0;
+        for (int n = 0; n < 60 && data_buffer_iter_next(&it); n++) {
+            minute_data_t data;
+            data_buffer_iter_decode(&it, &data);
+            time_t t = data_buffer_iter_time(&it);
+            if (t <= prev || !minute_matches(&data)) atomic_fetch_add(&g_torn, 1);
+            prev = t;
+            ctx->reads++;
+        }
+        break;
+    }
+    default: {
+        // 日別サマリー・統計・10分集計
+        daily_summary_data_t summary;
+        if (data_buffer_get_recent_daily_summary(0, &summary) == ESP_OK) {
+            if (!summary_consistent(&summary)) atomic_fetch_add(&g_torn, 1);
+            ctx->reads++;
+        }
+        data_buffer_stats_t stats;
+        if (data_buffer_get_stats(&stats) == ESP_OK) {
+            if (stats.minute_data_count > DATA_BUFFER_MINUTE_CAPACITY) atomic_fetch_add(&g_torn, 1);
+            ctx->reads++;
+        }
+        // 書き込み中の区間を含む直近2時間の10分集計
+        if (stats.minute_data_count == 0) break;
+        time_t now = mktime(&stats.newest_minute_data) + 60;
+        struct tm start, end;
+        time_t from = now - 2 * 3600;
+        localtime_r(&from, &start);
+        localtime_r(&now, &end);
+        history_point_data_t points[16];
+        uint16_t count = 0;
+        data_buffer_tier_t tier;
+        if (data_buffer_get_history(&start, &end, points, 16, &count, &tier) == ESP_OK) {
+            if (tier != DATA_BUFFER_TIER_10MIN) atomic_fetch_add(&g_torn, 1);
+            for (int i = 0; i < count; i++) {
+                if (!point_matches(&points[i])) atomic_fetch_add(&g_torn, 1);
+            }
+            ctx->reads += count;
+        }
+        break;
+    }
+    }
+}
+
+static void *reader_main(void *arg) {
+    reader_ctx_t *ctx = (reader_ctx_t *)arg;
+    while (!atomic_load(&g_writer_done)) {
+        read_once(ctx);
+    }
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    for (int i = 0; i < STRESS_DAYS * DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        if (data_buffer_add_minute_data(&sd) != ESP_OK) {
+            atomic_fetch_add(&g_torn, 1);
+        }
+    }
+    atomic_store(&g_writer_done, true);
+    return NULL;
+}
+
+static seqlock_t g_lock;
+static volatile uint32_t g_payload[STRESS_WORDS];  // 全ワードが同じ値なら整合している
+
+static void *primitive_writer_main(void *arg) {
+    for (uint32_t v = 1; v <= STRESS_WRITES; v++) {
+        seqlock_write_begin(&g_lock);
+        for (int w = 0; w < STRESS_WORDS; w++) {
+            g_payload[w] = v;
+            if (w == STRESS_WORDS / 2 && (v % 8) == 0) {
+                sched_yield();  // 書き込み途中でリーダーに割り込ませる
+            }
+        }
+        seqlock_write_end(&g_lock);
+    }
+    atomic_store(&g_writer_done, true);
+    return NULL;
+}
+
+static void *primitive_reader_main(void *arg) {
+    unsigned long *retries = (unsigned long *)arg;
+    while (!atomic_load(&g_writer_done)) {
+        uint32_t copy[STRESS_WORDS];
+        uint32_t attempts = 0, seq;
+        do {
+            seq = seqlock_read_begin(&g_lock);
+            for (int w = 0; w < STRESS_WORDS; w++) {
+                copy[w] = g_payload[w];
+            }
+        } while (seqlock_read_retry(&g_lock, seq, &attempts));
+        *retries += attempts;
+        for (int w = 1; w < STRESS_WORDS; w++) {
+            if (copy[w] != copy[0]) {
+                atomic_fetch_add(&g_torn, 1);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void test_seqlock_primitive(void) {
+    atomic_store(&g_writer_done, false);
+    atomic_store(&g_torn, 0);
+
+    pthread_t writer, readers[STRESS_READERS];
+    unsigned long retries[STRESS_READERS] = {0};
+    for (int r = 0; r < STRESS_READERS; r++) {
+        CHECK(pthread_create(&readers[r], NULL, primitive_reader_main, &retries[r]) == 0);
+    }
+    CHECK(pthread_create(&writer, NULL, primitive_writer_main, NULL) == 0);
+
+    pthread_join(writer, NULL);
+    unsigned long total_retries = 0;
+    for (int r = 0; r < STRESS_READERS; r++) {
+        pthread_join(readers[r], NULL);
+        total_retries += retries[r];
+    }
+    printf("  %d writes, %lu read retries\n", STRESS_WRITES, total_retries);
+    // 書き込み途中のリーダーは必ず読み直し、混ざった値は返らない
+    CHECK(total_retries > 0);
+    CHECK(atomic_load(&g_torn) == 0);
+    CHECK(g_lock.seq == 2u * STRESS_WRITES);
+}
+
+static void test_concurrent_readers(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    atomic_store(&g_writer_done, false);
+    atomic_store(&g_torn, 0);
+
+    pthread_t writer, readers[STRESS_READERS];
+    reader_ctx_t ctx[STRESS_READERS];
+    for (int r = 0; r < STRESS_READERS; r++) {
+        ctx[r].kind = r;
+        ctx[r].reads = 0;
+        CHECK(pthread_create(&readers[r], NULL, reader_main, &ctx[r]) == 0);
+    }
+    CHECK(pthread_create(&writer, NULL, writer_main, NULL) == 0);
+
+    pthread_join(writer, NULL);
+    for (int r = 0; r < STRESS_READERS; r++) {
+        pthread_join(readers[r], NULL);
+        printf("  reader %d: %lu reads\n", r, ctx[r].reads);
+        CHECK(ctx[r].reads > 0);
+    }
+    CHECK(atomic_load(&g_torn) == 0);
+
+    // 書き込み完了後の状態は単一スレッドの場合と同じ
+    minute_data_t latest;
+    CHECK(data_buffer_get_latest_minute_data(&latest) == ESP_OK);
+    CHECK(mktime(&latest.timestamp) == g_start + (time_t)(STRESS_DAYS * DATA_BUFFER_MINUTES_PER_DAY - 1) * 60);
+    data_buffer_stats_t stats;
+    CHECK(data_buffer_get_stats(&stats) == ESP_OK);
+    CHECK(stats.minute_data_count == DATA_BUFFER_MINUTE_CAPACITY);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 1, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_seqlock_primitive);
+    RUN_TEST(test_concurrent_readers);
+    return TEST_RESULT();
+}
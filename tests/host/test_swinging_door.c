@@ -0,0 +1,231 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "swinging_door.h"
+#include <stdlib.h>
+
+// スイングドア方式の間引き記録: 全サンプルの復元誤差が許容誤差以内、点数の削減、欠測をまたいで補間しない、
+// 範囲クエリ（間引き記録から1分単位に復元）と1分リングの一致、許容誤差の変更時の記録し直し（次の1分データの追加時）
+
+#define SERIES_MINUTES  (3 * DATA_BUFFER_MINUTES_PER_DAY)
+#define GAP_FROM        1000    // 欠測区間 [GAP_FROM, GAP_TO)
+#define GAP_TO          1090
+#define DIRECT_CAPACITY 2048
+
+static time_t g_start;  // 投入開始時刻（0:00）
+static swinging_door_point_t g_points[DIRECT_CAPACITY];
+
+/**
+ * ゆっくり変化する値（1日周期）に ±1 の雑音を乗せた系列（生値）
+ */
+static int32_t series_raw(int i) {
+    uint32_t h = (uint32_t)i * 2654435761u;
+    int32_t noise = (int32_t)((h >> 16) % 3) - 1;
+    return (int32_t)lroundf(300.0f + 48.0f * sinf(i * 2.0f * (float)M_PI / DATA_BUFFER_MINUTES_PER_DAY)) + noise;
+}
+
+static void check_series(int32_t deviation) {
+    swinging_door_t sd;
+    swinging_door_init(&sd, g_points, DIRECT_CAPACITY, deviation);
+    uint32_t base = 29000000;
+    int samples = 0;
+    for (int i = 0; i < SERIES_MINUTES; i++) {
+        if (i >= GAP_FROM && i < GAP_TO) continue;
+        swinging_door_add(&sd, base + i, series_raw(i));
+        samples++;
+    }
+
+    int32_t max_error = 0;
+    int missing = 0;
+    for (int i = 0; i < SERIES_MINUTES; i++) {
+        int32_t value;
+        bool found = swinging_door_value_at(&sd, base + i, &value);
+        if (i >= GAP_FROM && i < GAP_TO) {
+            CHECK(!found);  // 欠測をまたいで補間しない
+            continue;
+        }
+        if (!found) {
+            missing++;
+            continue;
+        }
+        int32_t error = abs(value - series_raw(i));
+        if (error > max_error) max_error = error;
+    }
+    uint16_t points = swinging_door_point_count(&sd);
+    printf("  deviation %ld: %d samples -> %u points, max error %ld\n",
+           (long)deviation, samples, points, (long)max_error);
+    CHECK(missing == 0);
+    CHECK(max_error <= deviation);
+    CHECK(points < samples / 10);
+
+    // 範囲外
+    int32_t value;
+    CHECK(!swinging_door_value_at(&sd, base - 1, &value));
+    CHECK(!swinging_door_value_at(&sd, base + SERIES_MINUTES, &value));
+}
+
+static void test_error_bound(void) {
+    check_series(4);
+    check_series(8);
+    check_series(16);
+}
+
+static void test_step_and_ring(void) {
+    swinging_door_t sd;
+    swinging_door_init(&sd, g_points, 8, 1);
+
+    // 許容誤差1（生値）では段差のたびに点を確定する。元の値と完全に一致する
+    for (int i = 0; i < 60; i++) {
+        swinging_door_add(&sd, 100 + i, (i / 10) * 5);
+    }
+    for (int i = 20; i < 60; i++) {
+        int32_t value;
+        CHECK(swinging_door_value_at(&sd, 100 + i, &value) && value == (i / 10) * 5);
+    }
+    // リングが満杯になると古い点から上書きする
+    CHECK(swinging_door_point_count(&sd) == 9);
+    int32_t value;
+    CHECK(!swinging_door_value_at(&sd, 100, &value));
+    uint32_t first_minute;
+    CHECK(swinging_door_first_minute(&sd, &first_minute) && first_minute > 100);
+    CHECK(!swinging_door_value_at(&sd, first_minute - 1, &value));
+
+    // 許容誤差0は記録しない
+    swinging_door_init(&sd, g_points, 8, 0);
+    swinging_door_add(&sd, 100, 1);
+    CHECK(swinging_door_point_count(&sd) == 0);
+    CHECK(!swinging_door_value_at(&sd, 100, &value));
+    CHECK(!swinging_door_first_minute(&sd, &first_minute));
+}
+
+static void add_minute(int i) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+    sd.soil_temperature[1] = series_raw(i) / MINUTE_RECORD_PROBE_TEMP_SCALE;
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+}
+
+/**
+ * 間引き記録と1分リングの同じ範囲を比較し、最大誤差を返す（値の有無が異なる行は -1）
+ */
+static int32_t compare_with_ring(data_buffer_field_t field, const data_buffer_window_t *window, int *rows_with_data) {
+    static int16_t ring[DATA_BUFFER_MINUTES_PER_DAY];
+    static int16_t archive[DATA_BUFFER_MINUTES_PER_DAY];
+    data_buffer_query_t query = { *window, 1, (uint16_t)(1u << field), DATA_BUFFER_AGG_FIRST };
+    uint16_t ring_rows = 0, archive_rows = 0;
+    CHECK(data_buffer_query(&query, 0, DATA_BUFFER_MINUTES_PER_DAY, ring, &ring_rows) == ESP_OK);
+    CHECK(data_buffer_query_archive(&query, 0, DATA_BUFFER_MINUTES_PER_DAY, archive, &archive_rows) == ESP_OK);
+    CHECK(ring_rows == archive_rows);
+
+    int32_t max_error = 0;
+    *rows_with_data = 0;
+    for (uint16_t r = 0; r < ring_rows; r++) {
+        if ((ring[r] == DATA_BUFFER_QUERY_NONE) != (archive[r] == DATA_BUFFER_QUERY_NONE)) {
+            return -1;
+        }
+        if (ring[r] == DATA_BUFFER_QUERY_NONE) continue;
+        (*rows_with_data)++;
+        int32_t error = abs((int32_t)archive[r] - ring[r]);
+        if (error > max_error) max_error = error;
+    }
+    return max_error;
+}
+
+static void test_archive_query(void) {
+    // 2番目の土壌温度を許容誤差 0.25℃（生値4）で記録し、2日分を投入（1日目に欠測あり）
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2, 0.25f) == ESP_OK);
+    for (int i = 0; i < 2 * DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        if (i >= GAP_FROM && i < GAP_TO) continue;
+        add_minute(i);
+    }
+    uint16_t points = data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2);
+    printf("  archive: %d minutes -> %u points\n", 2 * DATA_BUFFER_MINUTES_PER_DAY - (GAP_TO - GAP_FROM), points);
+    CHECK(points > 0 && points < DATA_BUFFER_ARCHIVE_CAPACITY);
+    CHECK(data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3) == 0);
+
+    // 1分リングに残る直近24時間は、復元値との差が許容誤差以内
+    uint32_t start = (uint32_t)(g_start / 60);
+    data_buffer_window_t day2 = { start + DATA_BUFFER_MINUTES_PER_DAY, start + 2 * DATA_BUFFER_MINUTES_PER_DAY };
+    int rows_with_data = 0;
+    int32_t max_error = compare_with_ring(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2, &day2, &rows_with_data);
+    CHECK(max_error >= 0 && max_error <= 4);
+    CHECK(rows_with_data == DATA_BUFFER_MINUTES_PER_DAY);
+
+    // 1分リングから消えた1日目も間引き記録から復元でき、欠測区間は補間しない
+    static int16_t columns[2 * DATA_BUFFER_MINUTES_PER_DAY];
+    data_buffer_window_t day1 = { start, start + DATA_BUFFER_MINUTES_PER_DAY };
+    data_buffer_query_t query = { day1, 1, (1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE2) | (1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE3),
+                                  DATA_BUFFER_AGG_FIRST };
+    uint16_t rows = 0;
+    CHECK(data_buffer_query_archive(&query, 0, DATA_BUFFER_MINUTES_PER_DAY, columns, &rows) == ESP_OK);
+    CHECK(rows == DATA_BUFFER_MINUTES_PER_DAY);
+    int32_t day1_error = 0;
+    bool day1_ok = true;
+    for (int i = 0; i < DATA_BUFFER_MINUTES_PER_DAY; i++) {
+        int16_t v = columns[i];
+        if (i >= GAP_FROM && i < GAP_TO) {
+            day1_ok &= (v == DATA_BUFFER_QUERY_NONE);
+            continue;
+        }
+        day1_ok &= (v != DATA_BUFFER_QUERY_NONE);
+        int32_t error = abs((int32_t)v - series_raw(i));
+        if (error > day1_error) day1_error = error;
+        // 記録していないフィールドの列は全てデータなし
+        day1_ok &= (columns[DATA_BUFFER_MINUTES_PER_DAY + i] == DATA_BUFFER_QUERY_NONE);
+    }
+    CHECK(day1_ok);
+    CHECK(day1_error <= 4);
+
+    // 間引き記録より前から始まる範囲は、記録の最も古い点を含む行まで先頭を進める
+    query.window.start_minute = start - 10 * DATA_BUFFER_MINUTES_PER_DAY - 30;
+    query.window.end_minute = start + 3 * DATA_BUFFER_MINUTES_PER_DAY;
+    query.step_minutes = 60;
+    query.field_mask = 1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE2;
+    query.aggregate = DATA_BUFFER_AGG_AVG;
+    CHECK(data_buffer_query_freeze(&query, true, &rows) == ESP_OK);
+    CHECK(query.window.start_minute == start - 30);
+    CHECK(query.window.end_minute == start + 2 * DATA_BUFFER_MINUTES_PER_DAY);
+    CHECK(rows == 2 * 24 + 1);
+    query.field_mask = 1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE3;
+    CHECK(data_buffer_query_freeze(&query, true, &rows) == ESP_ERR_NOT_FOUND);
+
+    // 間引き（1時間ごとの平均）も復元値から計算できる。LTTBは不可
+    query.window = day2;
+    query.step_minutes = 60;
+    query.field_mask = 1u << DATA_BUFFER_FIELD_SOIL_TEMPERATURE2;
+    query.aggregate = DATA_BUFFER_AGG_AVG;
+    CHECK(data_buffer_query_archive(&query, 0, 24, columns, &rows) == ESP_OK && rows == 24);
+    query.aggregate = DATA_BUFFER_AGG_LTTB;
+    CHECK(data_buffer_query_archive(&query, 0, 24, columns, &rows) == ESP_ERR_INVALID_ARG);
+
+    // 後から許容誤差を設定したフィールドは、次の1分データの追加時に1分リングに残っているデータから記録し直す
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3, 0.5f) == ESP_OK);
+    CHECK(data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3) == 0);
+    add_minute(2 * DATA_BUFFER_MINUTES_PER_DAY);
+    CHECK(data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3) > 0);
+    data_buffer_window_t ring = { day2.start_minute + 1, day2.end_minute + 1 };
+    max_error = compare_with_ring(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3, &ring, &rows_with_data);
+    CHECK(max_error >= 0 && max_error <= 8);
+    CHECK(rows_with_data == DATA_BUFFER_MINUTES_PER_DAY);
+
+    // 許容誤差の変更は記録し直し、0で停止
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2, 1.0f) == ESP_OK);
+    add_minute(2 * DATA_BUFFER_MINUTES_PER_DAY + 1);
+    CHECK(data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2) < points);
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2, 0.0f) == ESP_OK);
+    add_minute(2 * DATA_BUFFER_MINUTES_PER_DAY + 2);
+    CHECK(data_buffer_archive_points(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2) == 0);
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE2, -1.0f) == ESP_ERR_INVALID_ARG);
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_COUNT, 1.0f) == ESP_ERR_INVALID_ARG);
+    CHECK(data_buffer_set_archive_error(DATA_BUFFER_FIELD_SOIL_TEMPERATURE3, 0.0f) == ESP_OK);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    g_start = mktime(&t);
+
+    RUN_TEST(test_error_bound);
+    RUN_TEST(test_step_and_ring);
+    RUN_TEST(test_archive_query);
+    return TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "file_partition.h"
+#include "esp_timer.h"
+#include <stdio.h>
+
+// 再起動用の退避: 直近 DATA_BUFFER_SNAPSHOT_HOURS 時間の1分データが全フィールドそのまま復元されること、
+// 復元時間、再起動の欠測、1回で無効になること、履歴ログとの重複なし
+
+#define WARM_PARTITION_FILE     "test_warm_restart.bin"
+#define SNAPSHOT_MINUTES        (DATA_BUFFER_SNAPSHOT_HOURS * 60)
+#define ALL_FIELDS              ((1u << DATA_BUFFER_FIELD_COUNT) - 1)
+
+static time_t g_start;  // 投入開始時刻（0:00）
+static uint32_t g_start_minute;
+
+static void add_minutes(int from, int to) {
+    for (int i = from; i < to; i++) {
+        soil_data_t sd;
+        test_fill_sensor(&sd, g_start + (time_t)i * 60, i);
+        CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+    }
+}
+
+static data_buffer_window_t make_window(int from, int to) {
+    data_buffer_window_t window = { g_start_minute + from, g_start_minute + to };
+    return window;
+}
+
+static void query_all(const data_buffer_window_t *window, int16_t *columns) {
+    data_buffer_query_t query = { *window, 1, ALL_FIELDS, DATA_BUFFER_AGG_FIRST };
+    uint16_t rows = 0;
+    CHECK(data_buffer_query(&query, 0, SNAPSHOT_MINUTES, columns, &rows) == ESP_OK);
+    CHECK(rows == SNAPSHOT_MINUTES);
+}
+
+static void test_ram_only(void) {
+    // 履歴パーティションなし: 退避だけで直近6時間が戻る
+    static int16_t before[DATA_BUFFER_FIELD_COUNT * SNAPSHOT_MINUTES];
+    static int16_t after[DATA_BUFFER_FIELD_COUNT * SNAPSHOT_MINUTES];
+    CHECK(data_buffer_init() == ESP_OK);
+    int end = 30 * 60;
+    add_minutes(0, 26 * 60);
+    add_minutes(26 * 60 + 20, end);  // 退避範囲内に欠測
+
+    data_buffer_window_t recent = make_window(end - SNAPSHOT_MINUTES, end);
+    query_all(&recent, before);
+    uint16_t present = data_buffer_count_minutes(&recent);
+    CHECK(present == SNAPSHOT_MINUTES - 20);
+    minute_data_t latest_before, latest_after;
+    CHECK(data_buffer_get_latest_minute_data(&latest_before) == ESP_OK);
+
+    CHECK(data_buffer_save_snapshot() == ESP_OK);
+    int64_t start_us = esp_timer_get_time();
+    CHECK(data_buffer_init() == ESP_OK);
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    printf("  warm restart: %u minutes available after %lld us\n",
+           data_buffer_count_minutes(&recent), (long long)elapsed_us);
+    CHECK(elapsed_us < 50000);
+
+    // 全フィールドが一致し、退避範囲より前は残らない
+    query_all(&recent, after);
+    CHECK(memcmp(before, after, sizeof(before)) == 0);
+    CHECK(data_buffer_count_minutes(&recent) == present);
+    data_buffer_window_t older = make_window(end - DATA_BUFFER_MINUTES_PER_DAY, end - SNAPSHOT_MINUTES);
+    CHECK(data_buffer_count_minutes(&older) == 0);
+    CHECK(data_buffer_get_latest_minute_data(&latest_after) == ESP_OK);
+    CHECK(latest_after.temperature == latest_before.temperature);
+    CHECK(data_buffer_compare_time(&latest_after.timestamp, &latest_before.timestamp) == 0);
+
+    // 再起動後の最初のデータまでは再起動の欠測
+    add_minutes(end + 5, end + 6);
+    data_buffer_gap_t gaps[2];
+    uint16_t count = 0, total = 0;
+    data_buffer_window_t restart = make_window(end - 1, end + 6);
+    CHECK(data_buffer_get_gaps(&restart, gaps, 2, &count, &total) == ESP_OK);
+    CHECK(count == 1 && gaps[0].length == 5 && gaps[0].reason == DATA_BUFFER_GAP_REBOOT);
+
+    // 退避は1回使ったら無効（保存せずに再起動すると何も戻らない）
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_count_minutes(&recent) == 0);
+    CHECK(data_buffer_save_snapshot() == ESP_ERR_NOT_FOUND);
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_get_latest_minute_data(&latest_after) != ESP_OK);
+}
+
+static void test_with_history(void) {
+    // 履歴パーティションあり: 履歴ログから復元済みの分は重複させない
+    file_partition_close();
+    remove(WARM_PARTITION_FILE);
+    CHECK(file_partition_open(WARM_PARTITION_FILE, 1024 * 1024) == 0);
+    CHECK(data_buffer_init() == ESP_OK);
+    add_minutes(0, 3 * 60);
+    data_buffer_window_t all = make_window(0, 3 * 60);
+    CHECK(data_buffer_count_minutes(&all) == 3 * 60);
+
+    CHECK(data_buffer_save_snapshot() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    CHECK(data_buffer_count_minutes(&all) == 3 * 60);
+    // 書き込み中の日の集計も二重に数えない
+    static data_buffer_period_stats_t stats;
+    struct tm today = test_make_tm(2025, 6, 1, 0, 0);
+    CHECK(data_buffer_merge_days(&today, &today, &stats) == ESP_OK);
+    CHECK(stats.field[QUANTILE_FIELD_TEMPERATURE].samples == 3 * 60);
+
+    // 続けて記録し、次の再起動でも件数が変わらない
+    add_minutes(3 * 60, 4 * 60);
+    CHECK(data_buffer_save_snapshot() == ESP_OK);
+    CHECK(data_buffer_init() == ESP_OK);
+    all = make_window(0, 4 * 60);
+    CHECK(data_buffer_count_minutes(&all) == 4 * 60);
+    CHECK(data_buffer_merge_days(&today, &today, &stats) == ESP_OK);
+    CHECK(stats.field[QUANTILE_FIELD_TEMPERATURE].samples == 4 * 60);
+
+    file_partition_close();
+    remove(WARM_PARTITION_FILE);
+}
+
+int main(void) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    g_start = mktime(&t);
+    g_start_minute = (uint32_t)(g_start / 60);
+
+    RUN_TEST(test_ram_only);
+    RUN_TEST(test_with_history);
+    return TEST_RESULT();
+}
@@ -0,0 +1,318 @@
+#include "test_common.h"
+#include "data_buffer.h"
+#include "minute_record.h"
+#include "watering_detector.h"
+
+// 灌水検出: サンプル到着時に更新する直近3件の窓が、従来の判定（過去1時間のリングを走査して直近3件を比較）と
+// 全サンプルで一致すること（灌水・片側チャンネルだけの変化・増加・欠測・1時間を超える欠測・同じ分の再計測を含む波形）、
+// 集約値（最大）に現れないチャンネルだけの灌水も検出すること、データ不足・時刻の逆行
+//
+//   test_watering_detector [trace.csv]
+//   CSV: unix_time,cap0,cap1,cap2,cap3（bench_stream_detect と同じ形式）
+//   実機で記録した波形を渡すと、合成波形の代わりにその波形で従来の判定との一致を確かめる
+
+#define THRESHOLD       0.5f    // 灌水検出閾値 [pF]
+#define TRACE_MINUTES   1200
+#define MAX_SAMPLES     (DATA_BUFFER_MINUTES_PER_DAY * 2)
+
+typedef struct {
+    time_t when;
+    float cap[FDC1004_CHANNEL_COUNT];
+} trace_point_t;
+
+static time_t g_start;
+static uint32_t g_noise = 12345;
+static trace_point_t g_trace[MAX_SAMPLES];
+static int g_sample_count = 0;
+
+typedef struct {
+    bool detected;
+    float decrease;
+    uint8_t channel_mask;
+    uint8_t watering_mask;
+} legacy_result_t;
+
+static float noise(void) {
+    g_noise = g_noise * 1103515245u + 12345u;
+    return ((int)((g_noise >> 16) % 61) - 30) * 0.001f;  // ±0.03pF
+}
+
+/**
+ * 従来の判定（置き換え前の detect_watering_event と同じ処理）
+ * watering_mask は同じ3件からチャンネルごとの減少を求めたもの（集約値の判定とは別に照合する）
+ */
+static bool legacy_detect(time_t now, float current_moisture, float threshold, legacy_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    uint16_t count = 0;
+    float recent_moisture[3];
+    int32_t recent_capacitance[3][FDC1004_CHANNEL_COUNT];
+    uint16_t fields = 1u << DATA_BUFFER_FIELD_SOIL_MOISTURE;
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        fields |= 1u << (DATA_BUFFER_FIELD_CAPACITANCE1 + c);
+    }
+    // data_buffer_window_recent(60) を now 基準で作ったもの
+    data_buffer_window_t window = { (uint32_t)((now - 3600) / 60) + 1, UINT32_MAX };
+    data_buffer_iter_t it;
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    esp_err_t ret = data_buffer_iter_begin(&it, &window);
+    while (ret == ESP_OK && data_buffer_iter_next_fields(&it, fields, values, &valid_mask)) {
+        recent_moisture[count % 3] = values[DATA_BUFFER_FIELD_SOIL_MOISTURE] / MINUTE_RECORD_SOIL_SCALE;
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            recent_capacitance[count % 3][c] = values[DATA_BUFFER_FIELD_CAPACITANCE1 + c];
+        }
+        count++;
+    }
+    if (ret != ESP_OK || count < 3) {
+        return false;
+    }
+    result->decrease = recent_moisture[count % 3] - current_moisture;
+    const int32_t *latest = recent_capacitance[(count - 1) % 3];
+    const int32_t *oldest = recent_capacitance[count % 3];
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        if (fabsf((latest[c] - oldest[c]) / MINUTE_RECORD_SOIL_SCALE) >= threshold) {
+            result->channel_mask |= (uint8_t)(1u << c);
+        }
+        if (latest[c] != 0 && oldest[c] != 0 && (oldest[c] - latest[c]) / MINUTE_RECORD_SOIL_SCALE >= threshold) {
+            result->watering_mask |= (uint8_t)(1u << c);
+        }
+    }
+    result->detected = (result->decrease >= threshold);
+    return true;
+}
+
+/**
+ * 1分リングの範囲を窓に追加（plant_manager の feed_watering_detector と同じ処理）
+ */
+static void feed(watering_detector_t *det, const data_buffer_window_t *window) {
+    uint16_t fields = 1u << DATA_BUFFER_FIELD_SOIL_MOISTURE;
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        fields |= 1u << (DATA_BUFFER_FIELD_CAPACITANCE1 + c);
+    }
+    data_buffer_iter_t it;
+    int32_t values[DATA_BUFFER_FIELD_COUNT];
+    uint16_t valid_mask;
+    CHECK(data_buffer_iter_begin(&it, window) == ESP_OK);
+    while (data_buffer_iter_next_fields(&it, fields, values, &valid_mask)) {
+        float channels[WATERING_DETECTOR_CHANNELS];
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+            channels[c] = values[DATA_BUFFER_FIELD_CAPACITANCE1 + c] / MINUTE_RECORD_SOIL_SCALE;
+        }
+        watering_detector_add(det, it.epoch_minute, values[DATA_BUFFER_FIELD_SOIL_MOISTURE] / MINUTE_RECORD_SOIL_SCALE,
+                              channels);
+    }
+}
+
+/**
+ * 鉢植えの静電容量の波形（ch4が最大、乾燥でゆっくり下がり、灌水で段差）
+ * @return false: この分は欠測
+ */
+static bool trace_sample(int i, float *cap) {
+    if ((i >= 300 && i < 310) || (i >= 600 && i < 680) || (i >= 900 && i < 1000 && i % 7 == 0)) {
+        return false;
+    }
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        cap[c] = 4.0f + c - 0.002f * i + noise();
+    }
+    if (i >= 200) cap[3] -= (i == 200) ? 0.4f : 0.8f;   // 灌水（最大のチャンネルが2分かけて下がる）
+    if (i >= 500) cap[0] -= 0.8f;                       // 最大以外のチャンネルだけ変化
+    if (i >= 800) {                                     // 全チャンネルが増加
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) cap[c] += 1.0f;
+    }
+    if (i >= 1050) {                                    // 数分おきのサンプリング中の灌水（全チャンネル）
+        for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) cap[c] -= 0.6f;
+    }
+    return true;
+}
+
+static void add_sample(time_t when, const float *cap) {
+    soil_data_t sd;
+    test_fill_sensor(&sd, when, 0);
+    for (int c = 0; c < FDC1004_CHANNEL_COUNT; c++) {
+        sd.soil_moisture_capacitance[c] = cap[c];
+        if (c == 0 || cap[c] > sd.soil_moisture) {
+            sd.soil_moisture = cap[c];
+        }
+    }
+    CHECK(data_buffer_add_minute_data(&sd) == ESP_OK);
+}
+
+/**
+ * 合成波形（5分間隔のサンプリングと同じ分の再計測を含む）
+ */
+static void generate_trace(void) {
+    g_sample_count = 0;
+    for (int i = 0; i < TRACE_MINUTES; i++) {
+        if (i >= 1040 && i % 5 != 0) {
+            continue;  // 5分間隔のサンプリング
+        }
+        trace_point_t *p = &g_trace[g_sample_count];
+        if (!trace_sample(i, p->cap)) {
+            continue;
+        }
+        p->when = g_start + (time_t)i * 60;
+        g_sample_count++;
+        if (i == 1100) {
+            // 同じ分の再計測（リングは上書き）
+            g_trace[g_sample_count] = *p;
+            g_trace[g_sample_count].cap[3] += 0.7f;
+            g_sample_count++;
+        }
+    }
+}
+
+static bool load_csv(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("  cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    g_sample_count = 0;
+    while (g_sample_count < MAX_SAMPLES && fgets(line, sizeof(line), fp) != NULL) {
+        trace_point_t *p = &g_trace[g_sample_count];
+        long long unix_time;
+        if (sscanf(line, "%lld,%f,%f,%f,%f", &unix_time, &p->cap[0], &p->cap[1], &p->cap[2], &p->cap[3]) != 5) {
+            continue;
+        }
+        p->when = (time_t)unix_time;
+        g_sample_count++;
+    }
+    fclose(fp);
+    printf("  loaded %d samples from %s\n", g_sample_count, path);
+    return g_sample_count > 0;
+}
+
+static int g_detections, g_aggregate_detections, g_channel_only_detections, g_change_only;
+
+static void test_replay_matches_legacy(void) {
+    CHECK(data_buffer_init() == ESP_OK);
+    watering_detector_t det;
+    watering_detector_reset(&det);
+
+    int compared = 0, mismatches = 0;
+    g_detections = g_aggregate_detections = g_channel_only_detections = g_change_only = 0;
+    for (int n = 0; n < g_sample_count; n++) {
+        const trace_point_t *p = &g_trace[n];
+        add_sample(p->when, p->cap);
+        uint32_t minute = (uint32_t)(p->when / 60);
+        data_buffer_window_t window = { minute, minute + 1 };
+        feed(&det, &window);
+
+        // 判定は取得から少し遅れて行う（解析タスク）
+        time_t now = p->when + 30;
+        minute_data_t latest;
+        CHECK(data_buffer_get_latest_minute_data(&latest) == ESP_OK);
+        legacy_result_t expected;
+        watering_detection_t actual;
+        bool legacy_ok = legacy_detect(now, latest.soil_moisture, THRESHOLD, &expected);
+        bool ok = watering_detector_check(&det, (uint32_t)((now - 3600) / 60) + 1, THRESHOLD, &actual);
+        compared++;
+        // 集約値の判定は従来と一致し、検出は集約値またはチャンネルごとの減少
+        if (legacy_ok != ok ||
+            (ok && (expected.detected != actual.aggregate_detected || expected.decrease != actual.aggregate_decrease ||
+                    expected.channel_mask != actual.channel_mask || expected.watering_mask != actual.watering_mask ||
+                    actual.detected != (actual.aggregate_detected || actual.watering_mask != 0) ||
+                    actual.decrease < actual.aggregate_decrease))) {
+            if (mismatches++ < 5) {
+                printf("  sample %d: legacy %d/%d/%.4f/0x%x/0x%x, detector %d/%d/%.4f/0x%x/0x%x\n", n,
+                       legacy_ok, expected.detected, expected.decrease, expected.channel_mask, expected.watering_mask,
+                       ok, actual.aggregate_detected, actual.aggregate_decrease, actual.channel_mask, actual.watering_mask);
+            }
+        }
+        g_detections += actual.detected;
+        g_aggregate_detections += actual.aggregate_detected;
+        g_channel_only_detections += (actual.detected && !actual.aggregate_detected);
+        g_change_only += (!actual.detected && actual.channel_mask != 0);
+    }
+    printf("  %d samples compared, %d detections (%d aggregate, %d channel only), %d changes without watering\n",
+           compared, g_detections, g_aggregate_detections, g_channel_only_detections, g_change_only);
+    CHECK(mismatches == 0);
+}
+
+/**
+ * 合成波形で期待する検出
+ */
+static void test_expected_detections(void) {
+    CHECK(g_aggregate_detections >= 3);     // 灌水 (i=201)、5分間隔中の灌水 (i=1050,1055)
+    CHECK(g_channel_only_detections >= 2);  // 最大以外のチャンネルだけの灌水 (i=500,501)
+    CHECK(g_change_only >= 2);              // 増加は灌水ではない (i=800,801)
+}
+
+static void test_insufficient_and_backwards(void) {
+    watering_detector_t det;
+    watering_detector_reset(&det);
+    watering_detection_t result;
+    float ch[WATERING_DETECTOR_CHANNELS] = {0};
+    uint32_t base = (uint32_t)(g_start / 60);
+
+    // 3件未満・同じ分の置き換えでは件数が増えない
+    ch[0] = 5.0f;
+    watering_detector_add(&det, base, 5.0f, ch);
+    watering_detector_add(&det, base + 1, 5.0f, ch);
+    watering_detector_add(&det, base + 1, 5.0f, ch);
+    CHECK(!watering_detector_check(&det, 0, THRESHOLD, &result));
+    CHECK(det.count == 2);
+
+    ch[0] = 4.0f;
+    watering_detector_add(&det, base + 2, 4.0f, ch);
+    CHECK(watering_detector_check(&det, base, THRESHOLD, &result));
+    CHECK(result.detected && result.aggregate_detected && result.channel_mask == 0x01 && result.watering_mask == 0x01);
+    CHECK_NEAR(result.decrease, 1.0f, 1e-6);
+
+    // 2回前が範囲外なら判定しない
+    CHECK(!watering_detector_check(&det, base + 1, THRESHOLD, &result));
+
+    // 時刻の逆行で窓を空にする
+    watering_detector_add(&det, base, 4.0f, ch);
+    CHECK(det.count == 1);
+    CHECK(!watering_detector_check(&det, 0, THRESHOLD, &result));
+}
+
+static void test_channel_watering_and_read_failure(void) {
+    watering_detector_t det;
+    watering_detector_reset(&det);
+    watering_detection_t result;
+    float ch[WATERING_DETECTOR_CHANNELS] = { 3.0f, 4.0f, 5.0f, 6.0f };
+    uint32_t base = (uint32_t)(g_start / 60);
+
+    // 最大のチャンネル（集約値）は変わらず、最小のチャンネルだけが減少
+    watering_detector_add(&det, base, 6.0f, ch);
+    watering_detector_add(&det, base + 1, 6.0f, ch);
+    ch[0] = 2.2f;
+    watering_detector_add(&det, base + 2, 6.0f, ch);
+    CHECK(watering_detector_check(&det, base, THRESHOLD, &result));
+    CHECK(result.detected && !result.aggregate_detected);
+    CHECK(result.watering_mask == 0x01 && result.channel_mask == 0x01);
+    CHECK_NEAR(result.decrease, 0.8f, 1e-6);
+    CHECK_NEAR(result.aggregate_decrease, 0.0f, 1e-6);
+
+    // 読み取り失敗（0）への変化は灌水ではない
+    watering_detector_reset(&det);
+    ch[0] = 3.0f;
+    watering_detector_add(&det, base, 6.0f, ch);
+    watering_detector_add(&det, base + 1, 6.0f, ch);
+    ch[1] = 0.0f;
+    watering_detector_add(&det, base + 2, 6.0f, ch);
+    CHECK(watering_detector_check(&det, base, THRESHOLD, &result));
+    CHECK(!result.detected && result.watering_mask == 0 && result.channel_mask == 0x02);
+}
+
+int main(int argc, char **argv) {
+    struct tm t = test_make_tm(2025, 6, 1, 0, 0);
+    g_start = mktime(&t);
+    bool synthetic = (argc <= 1);
+    if (synthetic) {
+        generate_trace();
+    } else if (!load_csv(argv[1])) {
+        return 1;
+    }
+
+    RUN_TEST(test_replay_matches_legacy);
+    if (synthetic) {
+        RUN_TEST(test_expected_detections);
+    }
+    RUN_TEST(test_insufficient_and_backwards);
+    RUN_TEST(test_channel_watering_and_read_failure);
+    return TEST_RESULT();
+}
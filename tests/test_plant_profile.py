@@ -127,10 +127,11 @@ class PlantProfileTester:
         #     float temp_high_limit;            // 4 bytes
         #     float temp_low_limit;             // 4 bytes
         #     float watering_threshold_mv;      // 4 bytes
-        # };  // Total: 60 bytes
+        #     float archive_error[12];          // 48 bytes
+        # };  // Total: 104 bytes（archive_error を追加する前のファームウェアは56 bytes）
 
-        if len(resp["data"]) < 60:
-            print(f"❌ Invalid plant profile data length: {len(resp['data'])} (expected 60)")
+        if len(resp["data"]) < 56:
+            print(f"❌ Invalid plant profile data length: {len(resp['data'])} (expected 104)")
             return None
 
         # 植物名（32バイト）を抽出
@@ -139,7 +140,8 @@ class PlantProfileTester:
 
         # 残りのパラメータを抽出（little-endian）
         soil_dry_threshold, soil_wet_threshold, soil_dry_days, temp_high_limit, temp_low_limit, watering_threshold = \
-            struct.unpack('<ffifff', resp["data"][32:60])
+            struct.unpack('<ffifff', resp["data"][32:56])
+        archive_error = list(struct.unpack('<12f', resp["data"][56:104])) if len(resp["data"]) >= 104 else None
 
         print(f"✅ Plant Profile:")
         print(f"   Plant Name: {plant_name}")
@@ -149,6 +151,8 @@ class PlantProfileTester:
         print(f"   Temperature High Limit: {temp_high_limit:.1f} °C")
         print(f"   Temperature Low Limit: {temp_low_limit:.1f} °C")
         print(f"   Watering Detection Threshold: {watering_threshold:.1f} mV")
+        if archive_error is not None:
+            print(f"   Archive Error: {archive_error}")
 
         return {
             "plant_name": plant_name,
@@ -157,17 +161,20 @@ class PlantProfileTester:
             "soil_dry_days_for_watering": soil_dry_days,
             "temp_high_limit": temp_high_limit,
             "temp_low_limit": temp_low_limit,
-            "watering_threshold_mv": watering_threshold
+            "watering_threshold_mv": watering_threshold,
+            "archive_error": archive_error
         }
 
     async def set_plant_profile(self, profile):
         """植物プロファイルを設定"""
         print(f"\n🌱 Setting plant profile...")
 
-        # plant_profile_t構造体を構築（60バイト）
+        # plant_profile_t構造体を構築（104バイト）
+        # archive_error を指定しない場合は旧形式の56バイトを送り、デバイスの現在の値をそのまま使う
         plant_name_bytes = profile["plant_name"].encode('utf-8')[:31]  # 最大31文字 + NULL
 
-        data = bytearray(60)
+        archive_error = profile.get("archive_error")
+        data = bytearray(104 if archive_error is not None else 56)
         # 植物名（32バイト）
         data[0:len(plant_name_bytes)] = plant_name_bytes
         # 残りのパラメータ（little-endian）
@@ -178,6 +185,8 @@ class PlantProfileTester:
                          profile["temp_high_limit"],
                          profile["temp_low_limit"],
                          profile.get("watering_threshold_mv", 200.0))
+        if archive_error is not None:
+            struct.pack_into('<12f', data, 56, *archive_error)
 
         resp = await self.send_command(CMD_SET_PLANT_PROFILE, bytes(data))
 